@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch_plan.h"
+
+static int batchPlanItemCmp(const void *a, const void *b)
+{
+    const batch_plan_item_t *itemA = (const batch_plan_item_t*)a;
+    const batch_plan_item_t *itemB = (const batch_plan_item_t*)b;
+    
+    if (itemA->size != itemB->size) return (itemA->size < itemB->size ? -1 : 1);
+    
+    // Keep the caller's order for titles with the same size
+    if (itemA->index != itemB->index) return (itemA->index < itemB->index ? -1 : 1);
+    
+    return 0;
+}
+
+u32 batchPlanCreate(batch_plan_item_t *items, u32 itemCnt, u64 freeSpace, u64 *outPlannedSize)
+{
+    if (outPlannedSize) *outPlannedSize = 0;
+    
+    if (!items || !itemCnt) return 0;
+    
+    u32 i, fitCnt = 0;
+    u64 available = (freeSpace > BATCH_PLAN_FREE_SPACE_MARGIN ? (freeSpace - BATCH_PLAN_FREE_SPACE_MARGIN) : 0);
+    u64 plannedSize = 0, itemSize;
+    
+    // Picking the smallest titles first maximizes the number of titles that can be completed with the available space
+    // Since items are sorted, no other title fits once one of them doesn't
+    qsort(items, itemCnt, sizeof(batch_plan_item_t), batchPlanItemCmp);
+    
+    for(i = 0; i < itemCnt; i++)
+    {
+        itemSize = (items[i].size + BATCH_PLAN_TITLE_OVERHEAD);
+        
+        items[i].fits = (fitCnt == i && itemSize <= (available - plannedSize));
+        
+        if (items[i].fits)
+        {
+            plannedSize += itemSize;
+            fitCnt++;
+        }
+    }
+    
+    if (outPlannedSize) *outPlannedSize = plannedSize;
+    
+    return fitCnt;
+}
+
+void batchPlanAddSample(batchTimingStats *stats, u64 size, u64 elapsedNs)
+{
+    if (!stats || !size || !elapsedNs) return;
+    
+    double x = (double)size;
+    double y = ((double)elapsedNs / 1000000000.0);
+    
+    stats->weight = ((stats->weight * BATCH_PLAN_HISTORY_DECAY) + 1.0);
+    stats->size_sum = ((stats->size_sum * BATCH_PLAN_HISTORY_DECAY) + x);
+    stats->time_sum = ((stats->time_sum * BATCH_PLAN_HISTORY_DECAY) + y);
+    stats->size_sq_sum = ((stats->size_sq_sum * BATCH_PLAN_HISTORY_DECAY) + (x * x));
+    stats->size_time_sum = ((stats->size_time_sum * BATCH_PLAN_HISTORY_DECAY) + (x * y));
+}
+
+bool batchPlanEstimateTime(const batchTimingStats *stats, u64 totalSize, u32 titleCnt, u64 *outSeconds)
+{
+    if (!stats || !outSeconds || stats->weight <= 0.0 || stats->size_sum <= 0.0 || stats->time_sum <= 0.0) return false;
+    
+    // Fall back to a plain average throughput if the per-title setup time can't be estimated
+    double setupTime = 0.0;
+    double timePerByte = (stats->time_sum / stats->size_sum);
+    
+    if (stats->weight >= BATCH_PLAN_MIN_SAMPLE_WEIGHT)
+    {
+        // Weighted least squares fit of "time = setup + (size * time per byte)"
+        double meanSize = (stats->size_sum / stats->weight);
+        double meanTime = (stats->time_sum / stats->weight);
+        double sizeVar = ((stats->size_sq_sum / stats->weight) - (meanSize * meanSize));
+        double sizeTimeCov = ((stats->size_time_sum / stats->weight) - (meanSize * meanTime));
+        
+        if (sizeVar > 0.0 && sizeTimeCov > 0.0)
+        {
+            double slope = (sizeTimeCov / sizeVar);
+            double intercept = (meanTime - (slope * meanSize));
+            
+            if (intercept >= 0.0)
+            {
+                setupTime = intercept;
+                timePerByte = slope;
+            }
+        }
+    }
+    
+    *outSeconds = (u64)((setupTime * (double)titleCnt) + (timePerByte * (double)totalSize) + 0.5);
+    
+    return true;
+}
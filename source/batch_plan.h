@@ -0,0 +1,31 @@
+#pragma once
+
+#ifndef __BATCH_PLAN_H__
+#define __BATCH_PLAN_H__
+
+#include <switch.h>
+#include "util.h"
+
+#define BATCH_PLAN_TITLE_OVERHEAD       (u64)0x100000               // 1 MiB (1048576 bytes). Reserved for each title on top of its content size (PFS0 header, generated XML and icon files)
+#define BATCH_PLAN_FREE_SPACE_MARGIN    (u64)0x2000000              // 32 MiB (33554432 bytes). Never planned to be used, so the configuration and override files can still be written
+#define BATCH_PLAN_HISTORY_DECAY        0.9                         // Weight kept by previous measurements every time a new title is measured
+#define BATCH_PLAN_MIN_SAMPLE_WEIGHT    2.0                         // Setup time can only be told apart from transfer time once at least two titles have been measured
+
+typedef struct {
+    u32 index;                                      // Caller-defined entry index
+    u64 size;                                       // Expected output size
+    bool fits;                                      // Set by batchPlanCreate()
+} batch_plan_item_t;
+
+// Sorts the items so the largest possible number of titles fits in 'freeSpace', placing those first (smallest first) followed by the ones that don't fit
+// Returns the number of items that fit. 'outPlannedSize' receives the space they're expected to take
+u32 batchPlanCreate(batch_plan_item_t *items, u32 itemCnt, u64 freeSpace, u64 *outPlannedSize);
+
+// Adds a title that has been dumped from a storage to its timing history
+void batchPlanAddSample(batchTimingStats *stats, u64 size, u64 elapsedNs);
+
+// Estimates the time needed to dump 'titleCnt' titles totalling 'totalSize' bytes from a storage, in seconds
+// Returns false if there's no timing history for the storage yet
+bool batchPlanEstimateTime(const batchTimingStats *stats, u64 totalSize, u32 titleCnt, u64 *outSeconds);
+
+#endif
@@ -0,0 +1,76 @@
+#include <string.h>
+
+#include "chunk_tuner.h"
+
+bool chunkTunerIsValidSize(u64 size, u64 maxSize)
+{
+    return (size >= CHUNK_TUNER_MIN_SIZE && size <= maxSize && !(size & (size - 1)));
+}
+
+void chunkTunerInit(chunk_tuner_ctx_t *ctx, u64 storedSize, u64 maxSize)
+{
+    if (!ctx) return;
+    
+    memset(ctx, 0, sizeof(chunk_tuner_ctx_t));
+    
+    if (maxSize < CHUNK_TUNER_MIN_SIZE)
+    {
+        ctx->chunk_size = maxSize;
+        return;
+    }
+    
+    if (chunkTunerIsValidSize(storedSize, maxSize))
+    {
+        ctx->chunk_size = storedSize;
+        return;
+    }
+    
+    u64 size;
+    
+    for(size = CHUNK_TUNER_MIN_SIZE; size <= maxSize && ctx->candidate_cnt < CHUNK_TUNER_MAX_CANDIDATES; size <<= 1) ctx->candidates[ctx->candidate_cnt++] = size;
+    
+    ctx->tuning = (ctx->candidate_cnt > 1);
+    ctx->chunk_size = ctx->candidates[0];
+}
+
+bool chunkTunerUpdate(chunk_tuner_ctx_t *ctx, u64 size, u64 elapsedNs)
+{
+    if (!ctx || !ctx->tuning || !size) return false;
+    
+    // Skip the first chunk from each candidate. It usually includes the cost of switching request sizes
+    if (!ctx->warm)
+    {
+        ctx->warm = true;
+        return false;
+    }
+    
+    u32 i, best = 0;
+    
+    ctx->measured_size[ctx->candidate_idx] += size;
+    ctx->measured_ns[ctx->candidate_idx] += elapsedNs;
+    
+    if (ctx->measured_size[ctx->candidate_idx] < CHUNK_TUNER_WINDOW_SIZE) return false;
+    
+    ctx->candidate_idx++;
+    ctx->warm = false;
+    
+    if (ctx->candidate_idx < ctx->candidate_cnt)
+    {
+        ctx->chunk_size = ctx->candidates[ctx->candidate_idx];
+        return false;
+    }
+    
+    // Bigger chunks also delay progress updates and cancellation checks, so only switch to one if it's clearly faster
+    for(i = 1; i < ctx->candidate_cnt; i++)
+    {
+        double cur = ((double)ctx->measured_size[i] / (double)(ctx->measured_ns[i] ? ctx->measured_ns[i] : 1));
+        double prev = ((double)ctx->measured_size[best] / (double)(ctx->measured_ns[best] ? ctx->measured_ns[best] : 1));
+        
+        if (cur > (prev * (1.0 + ((double)CHUNK_TUNER_MIN_GAIN / 100.0)))) best = i;
+    }
+    
+    ctx->tuning = false;
+    ctx->chunk_size = ctx->candidates[best];
+    
+    return true;
+}
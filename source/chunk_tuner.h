@@ -0,0 +1,49 @@
+#pragma once
+
+#ifndef __CHUNK_TUNER_H__
+#define __CHUNK_TUNER_H__
+
+// Only fixed-width types are needed, so the tuner can also be built on a host to benchmark file-backed stand-ins (see tools/chunk_tuner_bench.c)
+#ifdef __SWITCH__
+#include <switch.h>
+#else
+#include <stdint.h>
+#include <stdbool.h>
+typedef uint8_t u8;
+typedef uint32_t u32;
+typedef uint64_t u64;
+#endif
+
+#define CHUNK_TUNER_MIN_SIZE            (u64)0x100000               // 1 MiB (1048576 bytes). Smallest chunk size that gets measured
+#define CHUNK_TUNER_MAX_CANDIDATES      8
+#define CHUNK_TUNER_WINDOW_SIZE         (u64)0x4000000              // 64 MiB (67108864 bytes). Amount of data measured with each candidate chunk size
+#define CHUNK_TUNER_MIN_GAIN            5                           // A bigger chunk size must be at least this much faster (percentage) to be picked
+
+// Picks the chunk size with the highest throughput by measuring each candidate over a warm-up window at the beginning of a dump
+// Timings are provided by the caller, so the tuner doesn't depend on any particular storage or clock
+typedef struct {
+    bool tuning;
+    u64 chunk_size;                                 // Chunk size that should be used for the next read. Fixed once tuning is over
+    u32 candidate_cnt;
+    u32 candidate_idx;
+    u64 candidates[CHUNK_TUNER_MAX_CANDIDATES];
+    u64 measured_size[CHUNK_TUNER_MAX_CANDIDATES];
+    u64 measured_ns[CHUNK_TUNER_MAX_CANDIDATES];
+    bool warm;                                      // The first chunk read with each candidate isn't measured
+} chunk_tuner_ctx_t;
+
+// Returns true if 'size' is a chunk size the tuner could have picked with the provided memory cap
+bool chunkTunerIsValidSize(u64 size, u64 maxSize);
+
+// Candidates go from CHUNK_TUNER_MIN_SIZE up to 'maxSize' (doubling each time). No measurements are taken if 'storedSize' is a valid chunk size
+void chunkTunerInit(chunk_tuner_ctx_t *ctx, u64 storedSize, u64 maxSize);
+
+static inline u64 chunkTunerGetChunkSize(const chunk_tuner_ctx_t *ctx)
+{
+    return ctx->chunk_size;
+}
+
+// Registers the time it took to read and write a 'size' bytes chunk. Returns true once the last candidate has been measured, at which point 'chunk_size' holds the picked value
+bool chunkTunerUpdate(chunk_tuner_ctx_t *ctx, u64 size, u64 elapsedNs);
+
+#endif
@@ -0,0 +1,358 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dump_index.h"
+#include "crc32_fast.h"
+
+#define DUMP_INDEX_TMP_PATH             DUMP_INDEX_PATH ".tmp"
+
+/* Extern variables */
+
+extern u32 titleAppCount, titlePatchCount, titleAddOnCount;
+
+extern base_app_ctx_t *baseAppEntries;
+extern patch_addon_ctx_t *patchEntries, *addOnEntries;
+
+static dump_index_entry_t *indexEntries = NULL;
+static u32 indexEntryCnt = 0, indexEntryCapacity = 0;
+static u32 indexFlags = 0;
+static bool indexLoaded = false, indexDirty = false;
+
+static int dumpIndexKeyCmp(u64 titleId, u32 version, u8 type, const dump_index_entry_t *entry)
+{
+    if (titleId != entry->titleId) return (titleId < entry->titleId ? -1 : 1);
+    if (type != entry->type) return (type < entry->type ? -1 : 1);
+    if (version != entry->version) return (version < entry->version ? -1 : 1);
+    return 0;
+}
+
+static int dumpIndexEntryCmp(const void *a, const void *b)
+{
+    const dump_index_entry_t *entryA = (const dump_index_entry_t*)a;
+    const dump_index_entry_t *entryB = (const dump_index_entry_t*)b;
+    
+    return dumpIndexKeyCmp(entryA->titleId, entryA->version, entryA->type, entryB);
+}
+
+// Returns the position of the entry for the provided key, or the position at which it would have to be inserted
+static u32 dumpIndexSearch(u64 titleId, u32 version, u8 type, bool *outFound)
+{
+    u32 low = 0, high = indexEntryCnt, mid;
+    int cmp;
+    
+    *outFound = false;
+    
+    while(low < high)
+    {
+        mid = (low + ((high - low) / 2));
+        
+        cmp = dumpIndexKeyCmp(titleId, version, type, &(indexEntries[mid]));
+        if (!cmp)
+        {
+            *outFound = true;
+            return mid;
+        }
+        
+        if (cmp < 0)
+        {
+            high = mid;
+        } else {
+            low = (mid + 1);
+        }
+    }
+    
+    return low;
+}
+
+static bool dumpIndexReserve(u32 count)
+{
+    if (count <= indexEntryCapacity) return true;
+    
+    u32 newCapacity = (((count + DUMP_INDEX_ALLOC_STEP - 1) / DUMP_INDEX_ALLOC_STEP) * DUMP_INDEX_ALLOC_STEP);
+    
+    dump_index_entry_t *tmpEntries = realloc(indexEntries, newCapacity * sizeof(dump_index_entry_t));
+    if (!tmpEntries) return false;
+    
+    indexEntries = tmpEntries;
+    indexEntryCapacity = newCapacity;
+    
+    return true;
+}
+
+static bool dumpIndexReadFile(const char *path)
+{
+    FILE *indexFile = fopen(path, "rb");
+    if (!indexFile) return false;
+    
+    bool success = false;
+    size_t read_res;
+    u64 indexFileSize;
+    u32 crc = 0;
+    dump_index_header_t header;
+    
+    fseek(indexFile, 0, SEEK_END);
+    indexFileSize = ftell(indexFile);
+    rewind(indexFile);
+    
+    read_res = fread(&header, 1, sizeof(dump_index_header_t), indexFile);
+    if (read_res != sizeof(dump_index_header_t) || header.magic != DUMP_INDEX_MAGIC || header.formatVersion != DUMP_INDEX_FORMAT_VERSION) goto out;
+    
+    if (indexFileSize != (sizeof(dump_index_header_t) + ((u64)header.entryCount * sizeof(dump_index_entry_t)))) goto out;
+    
+    if (!dumpIndexReserve(header.entryCount)) goto out;
+    
+    read_res = fread(indexEntries, 1, (u64)header.entryCount * sizeof(dump_index_entry_t), indexFile);
+    if (read_res != ((u64)header.entryCount * sizeof(dump_index_entry_t))) goto out;
+    
+    crc32(indexEntries, (u64)header.entryCount * sizeof(dump_index_entry_t), &crc);
+    if (crc != header.entryCrc) goto out;
+    
+    indexEntryCnt = header.entryCount;
+    indexFlags = header.flags;
+    
+    // Just in case the file was modified by hand
+    if (indexEntryCnt > 1) qsort(indexEntries, indexEntryCnt, sizeof(dump_index_entry_t), dumpIndexEntryCmp);
+    
+    success = true;
+    
+out:
+    fclose(indexFile);
+    
+    return success;
+}
+
+void dumpIndexLoad()
+{
+    dumpIndexFree();
+    
+    indexLoaded = true;
+    
+    // Fall back to the temporary file if writing the index was interrupted right after the previous one was removed
+    if (!dumpIndexReadFile(DUMP_INDEX_PATH) && !dumpIndexReadFile(DUMP_INDEX_TMP_PATH))
+    {
+        indexEntryCnt = 0;
+        indexFlags = 0;
+    }
+}
+
+bool dumpIndexNeedsLegacyScan()
+{
+    if (!indexLoaded) dumpIndexLoad();
+    return !(indexFlags & DUMP_INDEX_HEADER_FLAG_LEGACY_SCAN_DONE);
+}
+
+void dumpIndexSetLegacyScanDone()
+{
+    if (!indexLoaded) dumpIndexLoad();
+    
+    if (indexFlags & DUMP_INDEX_HEADER_FLAG_LEGACY_SCAN_DONE) return;
+    
+    indexFlags |= DUMP_INDEX_HEADER_FLAG_LEGACY_SCAN_DONE;
+    indexDirty = true;
+}
+
+// Retrieves the index key for a title from the current title lists
+static bool dumpIndexGetNspTitleKey(nspDumpType selectedNspDumpType, u32 titleIndex, u64 *outTitleId, u32 *outVersion, const u8 **outContentHash)
+{
+    switch(selectedNspDumpType)
+    {
+        case DUMP_APP_NSP:
+            if (!baseAppEntries || titleIndex >= titleAppCount) return false;
+            *outTitleId = baseAppEntries[titleIndex].titleId;
+            *outVersion = baseAppEntries[titleIndex].version;
+            *outContentHash = baseAppEntries[titleIndex].contentHash;
+            break;
+        case DUMP_PATCH_NSP:
+            if (!patchEntries || titleIndex >= titlePatchCount) return false;
+            *outTitleId = patchEntries[titleIndex].titleId;
+            *outVersion = patchEntries[titleIndex].version;
+            *outContentHash = patchEntries[titleIndex].contentHash;
+            break;
+        case DUMP_ADDON_NSP:
+            if (!addOnEntries || titleIndex >= titleAddOnCount) return false;
+            *outTitleId = addOnEntries[titleIndex].titleId;
+            *outVersion = addOnEntries[titleIndex].version;
+            *outContentHash = addOnEntries[titleIndex].contentHash;
+            break;
+        default:
+            return false;
+    }
+    
+    return true;
+}
+
+// Looks for the output NSP from a recorded dump using both naming schemes. Dumps made in NCA store mode are looked up using their file list
+// The output is assumed to be available if no dump name can be generated
+static bool dumpIndexCheckNspTitleOutput(nspDumpType selectedNspDumpType, u32 titleIndex, u8 flags)
+{
+    u32 i;
+    char *dumpName = NULL;
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    bool named = false, found = false;
+    
+    for(i = 0; i < 2 && !found; i++)
+    {
+        dumpName = generateNSPDumpName(selectedNspDumpType, titleIndex, (i == 1));
+        if (!dumpName) continue;
+        
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp%s", NSP_DUMP_PATH, dumpName, ((flags & DUMP_INDEX_FLAG_NCA_STORE) ? ".lst" : ""));
+        
+        free(dumpName);
+        dumpName = NULL;
+        
+        named = true;
+        found = checkIfFileExists(dumpPath);
+    }
+    
+    return (found || !named);
+}
+
+bool dumpIndexCheckNspTitle(nspDumpType selectedNspDumpType, u32 titleIndex, u8 *outFlags, bool *outAvailable)
+{
+    u64 titleId = 0;
+    u32 version = 0, pos;
+    const u8 *contentHash = NULL;
+    bool found = false, available;
+    
+    if (outAvailable) *outAvailable = false;
+    
+    if (!dumpIndexGetNspTitleKey(selectedNspDumpType, titleIndex, &titleId, &version, &contentHash)) return false;
+    
+    if (!indexLoaded) dumpIndexLoad();
+    
+    pos = dumpIndexSearch(titleId, version, (u8)selectedNspDumpType, &found);
+    if (!found || memcmp(indexEntries[pos].contentHash, contentHash, SHA256_HASH_SIZE) != 0) return false;
+    
+    // Make sure the output NSP is still there. Remembered titles are kept, since they must be excluded from batch dumps anyway
+    available = dumpIndexCheckNspTitleOutput(selectedNspDumpType, titleIndex, indexEntries[pos].flags);
+    if (!available && !(indexEntries[pos].flags & DUMP_INDEX_FLAG_REMEMBERED))
+    {
+        if (pos < (indexEntryCnt - 1)) memmove(&(indexEntries[pos]), &(indexEntries[pos + 1]), (indexEntryCnt - pos - 1) * sizeof(dump_index_entry_t));
+        indexEntryCnt--;
+        indexDirty = true;
+        return false;
+    }
+    
+    if (outFlags) *outFlags = indexEntries[pos].flags;
+    if (outAvailable) *outAvailable = available;
+    
+    return true;
+}
+
+bool dumpIndexRecordNspTitle(nspDumpType selectedNspDumpType, u32 titleIndex, u8 flags, const u8 *manifestHash, u64 dumpSize)
+{
+    u64 titleId = 0;
+    u32 version = 0, pos;
+    const u8 *contentHash = NULL;
+    bool found = false;
+    dump_index_entry_t entry;
+    
+    if (!dumpIndexGetNspTitleKey(selectedNspDumpType, titleIndex, &titleId, &version, &contentHash)) return false;
+    
+    if (!indexLoaded) dumpIndexLoad();
+    
+    memset(&entry, 0, sizeof(dump_index_entry_t));
+    entry.titleId = titleId;
+    entry.version = version;
+    entry.type = (u8)selectedNspDumpType;
+    entry.flags = flags;
+    memcpy(entry.contentHash, contentHash, SHA256_HASH_SIZE);
+    if (manifestHash) memcpy(entry.manifestHash, manifestHash, SHA256_HASH_SIZE);
+    entry.dumpSize = dumpSize;
+    entry.timestamp = (u64)time(NULL);
+    
+    pos = dumpIndexSearch(titleId, version, entry.type, &found);
+    
+    if (found)
+    {
+        entry.flags |= (indexEntries[pos].flags & DUMP_INDEX_FLAG_REMEMBERED);
+    } else {
+        if (!dumpIndexReserve(indexEntryCnt + 1)) return false;
+        
+        if (pos < indexEntryCnt) memmove(&(indexEntries[pos + 1]), &(indexEntries[pos]), (indexEntryCnt - pos) * sizeof(dump_index_entry_t));
+        indexEntryCnt++;
+    }
+    
+    memcpy(&(indexEntries[pos]), &entry, sizeof(dump_index_entry_t));
+    
+    indexDirty = true;
+    
+    return true;
+}
+
+void dumpIndexRememberNspTitle(nspDumpType selectedNspDumpType, u32 titleIndex)
+{
+    u64 titleId = 0;
+    u32 version = 0, pos;
+    const u8 *contentHash = NULL;
+    bool found = false;
+    
+    if (!dumpIndexGetNspTitleKey(selectedNspDumpType, titleIndex, &titleId, &version, &contentHash)) return;
+    
+    if (!indexLoaded) dumpIndexLoad();
+    
+    pos = dumpIndexSearch(titleId, version, (u8)selectedNspDumpType, &found);
+    if (!found || (indexEntries[pos].flags & DUMP_INDEX_FLAG_REMEMBERED)) return;
+    
+    indexEntries[pos].flags |= DUMP_INDEX_FLAG_REMEMBERED;
+    indexDirty = true;
+}
+
+bool dumpIndexSave()
+{
+    if (!indexLoaded || !indexDirty) return true;
+    
+    FILE *indexFile = fopen(DUMP_INDEX_TMP_PATH, "wb");
+    if (!indexFile) return false;
+    
+    size_t write_res;
+    bool success = false;
+    u32 crc = 0;
+    dump_index_header_t header;
+    
+    memset(&header, 0, sizeof(dump_index_header_t));
+    header.magic = DUMP_INDEX_MAGIC;
+    header.formatVersion = DUMP_INDEX_FORMAT_VERSION;
+    header.flags = indexFlags;
+    header.entryCount = indexEntryCnt;
+    
+    if (indexEntryCnt) crc32(indexEntries, (u64)indexEntryCnt * sizeof(dump_index_entry_t), &crc);
+    header.entryCrc = crc;
+    
+    write_res = fwrite(&header, 1, sizeof(dump_index_header_t), indexFile);
+    if (write_res == sizeof(dump_index_header_t) && indexEntryCnt) write_res = fwrite(indexEntries, 1, (u64)indexEntryCnt * sizeof(dump_index_entry_t), indexFile);
+    
+    success = (write_res == (indexEntryCnt ? ((u64)indexEntryCnt * sizeof(dump_index_entry_t)) : sizeof(dump_index_header_t)));
+    
+    if (fclose(indexFile) != 0) success = false;
+    
+    if (!success)
+    {
+        remove(DUMP_INDEX_TMP_PATH);
+        return false;
+    }
+    
+    // The SD card filesystem driver can't rename a file on top of an existing one
+    remove(DUMP_INDEX_PATH);
+    
+    if (rename(DUMP_INDEX_TMP_PATH, DUMP_INDEX_PATH) != 0) return false;
+    
+    indexDirty = false;
+    
+    return true;
+}
+
+void dumpIndexFree()
+{
+    if (indexEntries)
+    {
+        free(indexEntries);
+        indexEntries = NULL;
+    }
+    
+    indexEntryCnt = indexEntryCapacity = 0;
+    indexFlags = 0;
+    indexLoaded = indexDirty = false;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef __DUMP_INDEX_H__
+#define __DUMP_INDEX_H__
+
+#include <switch.h>
+#include "util.h"
+
+#define DUMP_INDEX_MAGIC                0x58444944                  // "DIDX"
+#define DUMP_INDEX_FORMAT_VERSION       1
+#define DUMP_INDEX_ALLOC_STEP           256                         // Growth step for the in-memory entry list
+
+typedef enum {
+    DUMP_INDEX_FLAG_REMOVE_CONSOLE_DATA     = BIT(0),               // "Remove console specific data" option used for the dump
+    DUMP_INDEX_FLAG_TIKLESS_DUMP            = BIT(1),               // "Generate ticket-less dump" option used for the dump
+    DUMP_INDEX_FLAG_NPDM_ACID_RSA_PATCH     = BIT(2),               // "Change NPDM RSA key/sig in Program NCA" option used for the dump
+    DUMP_INDEX_FLAG_DELTA_FRAGMENTS         = BIT(3),               // "Dump delta fragments" option used for the dump
+    DUMP_INDEX_FLAG_CONSOLE_DATA            = BIT(4),               // The output NSP holds a personalized ticket
+    DUMP_INDEX_FLAG_REMEMBERED              = BIT(5),               // Excluded from batch dumps even if the output NSP is no longer available ("Remember dumped titles")
+    DUMP_INDEX_FLAG_IMPORTED                = BIT(6),               // Imported from an existing NSP or batch override file. Options, console data and manifest digest are unknown
+    DUMP_INDEX_FLAG_NCA_STORE               = BIT(7)                // Dumped in NCA store mode. The NSP has to be assembled using its ".nsp.lst" file
+} dumpIndexFlag;
+
+// Each completed NSP dump is recorded using its title ID, version and type, so dumped titles can be looked up without touching the output directory
+// 'contentHash' identifies the set of contents the title had when it was dumped (see calculateSizeFromContentRecords())
+typedef struct {
+    u64 titleId;
+    u32 version;
+    u8 type;                                        // nspDumpType
+    u8 flags;                                       // dumpIndexFlag
+    u8 reserved[2];
+    u8 contentHash[SHA256_HASH_SIZE];
+    u8 manifestHash[SHA256_HASH_SIZE];              // SHA-256 checksum of the full PFS0 header from the output NSP (all NCA IDs, file names and sizes)
+    u64 dumpSize;
+    u64 timestamp;                                  // POSIX time at which the dump was completed
+} PACKED dump_index_entry_t;
+
+typedef enum {
+    DUMP_INDEX_HEADER_FLAG_LEGACY_SCAN_DONE = BIT(0)                // Dumps made before the index existed have already been imported
+} dumpIndexHeaderFlag;
+
+typedef struct {
+    u32 magic;                                      // DUMP_INDEX_MAGIC
+    u32 formatVersion;                              // DUMP_INDEX_FORMAT_VERSION
+    u32 flags;                                      // dumpIndexHeaderFlag
+    u32 entryCount;
+    u32 entryCrc;                                   // CRC32 checksum of all entries
+} PACKED dump_index_header_t;
+
+// Reads the index from the SD card. Called on demand by all other functions, so it only needs to be used to reload the index
+// Entries are kept sorted by title ID, type and version. A missing, outdated or corrupted index file is treated as an empty index
+void dumpIndexLoad();
+
+// Returns true if dumps made before the index existed (NSP files and batch override files) still have to be looked up in the output directory and imported
+// This only has to be done once: dumpIndexSetLegacyScanDone() must be called afterwards
+bool dumpIndexNeedsLegacyScan();
+
+void dumpIndexSetLegacyScanDone();
+
+// Returns true if a title from the current title lists has been recorded with the same title ID, version, type and content set
+// The output NSP is looked up as well. Entries whose NSP has been removed from the SD card are dropped from the index, unless DUMP_INDEX_FLAG_REMEMBERED is set
+// 'outFlags' may be used to retrieve the entry flags, and 'outAvailable' to know whether the output NSP is still available (only false for remembered titles)
+bool dumpIndexCheckNspTitle(nspDumpType selectedNspDumpType, u32 titleIndex, u8 *outFlags, bool *outAvailable);
+
+// Records a completed dump for a title from the current title lists, replacing the previous entry for it. DUMP_INDEX_FLAG_REMEMBERED is kept from the previous entry
+// 'manifestHash' may be NULL. Changes are kept in memory until dumpIndexSave() is called
+bool dumpIndexRecordNspTitle(nspDumpType selectedNspDumpType, u32 titleIndex, u8 flags, const u8 *manifestHash, u64 dumpSize);
+
+// Sets DUMP_INDEX_FLAG_REMEMBERED on the entry for a title from the current title lists
+void dumpIndexRememberNspTitle(nspDumpType selectedNspDumpType, u32 titleIndex);
+
+// Writes the index to the SD card if it has been modified. A temporary file is written first, so the previous index is kept if writing fails
+bool dumpIndexSave();
+
+// Frees the in-memory index. Unsaved changes are discarded
+void dumpIndexFree();
+
+#endif
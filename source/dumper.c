@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <dirent.h>
 #include <memory.h>
 #include <limits.h>
@@ -13,8 +14,22 @@
 #include "fs_ext.h"
 #include "ui.h"
 #include "nca.h"
+#include "nso.h"
 #include "keys.h"
 #include "save.h"
+#include "write_pool.h"
+#include "tar_writer.h"
+#include "romfs_filter.h"
+#include "ivfc_verify.h"
+#include "pfs0_verify.h"
+#include "patch_overlay.h"
+#include "split_writer.h"
+#include "chunk_tuner.h"
+#include "title_prefetch.h"
+#include "batch_plan.h"
+#include "dump_index.h"
+#include "nca_store.h"
+#include "store_worker.h"
 
 /* Extern variables */
 
@@ -48,6 +63,9 @@ extern u8 *disabledNormalIconBuf;
 extern u8 *disabledHighlightIconBuf;
 
 extern u8 *dumpBuf;
+extern u64 dumpBufSize;
+
+extern dumpOptions dumpCfg;
 
 extern char strbuf[NAME_BUF_LEN];
 
@@ -56,12 +74,239 @@ extern char freeSpaceStr[32];
 
 extern char cfwDirStr[32];
 
+/* Statically allocated variables */
+
+static ivfc_verify_ctx_t romFsVerifyCtx;    // Only initialized while RomFS data is being dumped with hash verification enabled
+static pfs0_verify_ctx_t exeFsVerifyCtx;    // Only initialized while ExeFS data is being dumped with hash verification enabled
+static title_prefetch_ctx_t batchPrefetchCtx[2];   // Metadata from the next title in batch mode, retrieved while the current one is being dumped. Slots are used alternately
+static store_worker_ctx_t batchStoreWorker;         // Copies NCAs from a title located at the other storage into the NCA store while the current title is being dumped in batch mode
+static int batchStoreWorkerLine = -1;               // Screen line used to display the background copy progress. Set to -1 if the worker isn't being used
+static char batchStoreWorkerTitle[NAME_BUF_LEN] = {'\0'};
+
 static void dumpStartMsg()
 {
     uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Dump procedure started. Hold " NINTENDO_FONT_B " to cancel.");
     breaks++;
 }
 
+static void getSequentialDumpCheckpointPath(const char *seqDumpFilename, bool tmp, char *outPath, size_t outPathSize)
+{
+    snprintf(outPath, outPathSize, "%s.ckpt%s", seqDumpFilename, (tmp ? ".tmp" : ""));
+}
+
+static bool getSequentialDumpPartTail(const char *partPath, u64 *outPartSize, u32 *outTailCrc)
+{
+    FILE *partFile = fopen(partPath, "rb");
+    if (!partFile) return false;
+    
+    bool success = false;
+    u64 partSize, tailSize;
+    u8 *tailBuf = NULL;
+    u32 tailCrc = 0;
+    
+    fseek(partFile, 0, SEEK_END);
+    partSize = ftell(partFile);
+    
+    tailSize = (partSize < SEQ_DUMP_CHECKPOINT_TAIL_SIZE ? partSize : SEQ_DUMP_CHECKPOINT_TAIL_SIZE);
+    if (!tailSize) goto out;
+    
+    tailBuf = malloc(tailSize);
+    if (!tailBuf) goto out;
+    
+    if (fseek(partFile, (long)(partSize - tailSize), SEEK_SET) != 0 || fread(tailBuf, 1, tailSize, partFile) != tailSize) goto out;
+    
+    crc32(tailBuf, tailSize, &tailCrc);
+    
+    *outPartSize = partSize;
+    *outTailCrc = tailCrc;
+    
+    success = true;
+    
+out:
+    if (tailBuf) free(tailBuf);
+    
+    fclose(partFile);
+    
+    return success;
+}
+
+static void removeSequentialDumpCheckpoint(const char *seqDumpFilename)
+{
+    if (!strlen(seqDumpFilename)) return;
+    
+    char ckptPath[NAME_BUF_LEN + 16] = {'\0'};
+    
+    getSequentialDumpCheckpointPath(seqDumpFilename, false, ckptPath, MAX_ELEMENTS(ckptPath));
+    remove(ckptPath);
+    
+    getSequentialDumpCheckpointPath(seqDumpFilename, true, ckptPath, MAX_ELEMENTS(ckptPath));
+    remove(ckptPath);
+}
+
+// Records the state of the current sequential dump session right after a part has been finished
+// The checkpoint is written to a temporary file which then replaces the previous checkpoint, so a complete one is always available if the console crashes in the middle of this
+// Failures aren't fatal: the dump can still be resumed from the previous checkpoint or from the start of the session
+static bool writeSequentialDumpCheckpoint(const char *seqDumpFilename, const char *lastPartPath, u32 lastPart, const void *seqCtx, u64 seqCtxSize, const void *ncaHashes, u64 ncaHashesSize)
+{
+    FILE *ckptFile = NULL;
+    char ckptPath[NAME_BUF_LEN + 16] = {'\0'}, tmpPath[NAME_BUF_LEN + 16] = {'\0'};
+    bool success = false;
+    u64 lastPartSize = 0;
+    u32 tailCrc = 0, crc = 0;
+    
+    if (!getSequentialDumpPartTail(lastPartPath, &lastPartSize, &tailCrc)) return false;
+    
+    sequentialDumpCheckpointFooter footer;
+    memset(&footer, 0, sizeof(sequentialDumpCheckpointFooter));
+    
+    footer.magic = SEQ_DUMP_CHECKPOINT_MAGIC;
+    footer.payloadSize = (u32)(seqCtxSize + ncaHashesSize);
+    footer.lastPart = lastPart;
+    footer.tailCrc = tailCrc;
+    footer.lastPartSize = lastPartSize;
+    
+    crc32(seqCtx, seqCtxSize, &crc);
+    if (ncaHashesSize) crc32(ncaHashes, ncaHashesSize, &crc);
+    crc32(&footer, offsetof(sequentialDumpCheckpointFooter, crc), &crc);
+    
+    footer.crc = crc;
+    
+    getSequentialDumpCheckpointPath(seqDumpFilename, false, ckptPath, MAX_ELEMENTS(ckptPath));
+    getSequentialDumpCheckpointPath(seqDumpFilename, true, tmpPath, MAX_ELEMENTS(tmpPath));
+    
+    ckptFile = fopen(tmpPath, "wb");
+    if (!ckptFile) return false;
+    
+    success = (fwrite(seqCtx, 1, seqCtxSize, ckptFile) == seqCtxSize && (!ncaHashesSize || fwrite(ncaHashes, 1, ncaHashesSize, ckptFile) == ncaHashesSize) && fwrite(&footer, 1, sizeof(sequentialDumpCheckpointFooter), ckptFile) == sizeof(sequentialDumpCheckpointFooter));
+    if (fclose(ckptFile) != 0) success = false;
+    
+    if (!success)
+    {
+        remove(tmpPath);
+        return false;
+    }
+    
+    // FAT can't rename a file over an existing one
+    remove(ckptPath);
+    
+    return (rename(tmpPath, ckptPath) == 0);
+}
+
+static u8 *loadSequentialDumpCheckpoint(const char *ckptPath, sequentialDumpCheckpointFooter *outFooter)
+{
+    FILE *ckptFile = fopen(ckptPath, "rb");
+    if (!ckptFile) return NULL;
+    
+    u8 *ckptData = NULL;
+    u64 ckptSize;
+    u32 crc = 0;
+    sequentialDumpCheckpointFooter footer;
+    
+    fseek(ckptFile, 0, SEEK_END);
+    ckptSize = ftell(ckptFile);
+    rewind(ckptFile);
+    
+    if (ckptSize <= sizeof(sequentialDumpCheckpointFooter) || ckptSize > SEQ_DUMP_CHECKPOINT_MAX_SIZE) goto out;
+    
+    ckptData = malloc(ckptSize);
+    if (!ckptData) goto out;
+    
+    if (fread(ckptData, 1, ckptSize, ckptFile) != ckptSize) goto out;
+    
+    memcpy(&footer, ckptData + (ckptSize - sizeof(sequentialDumpCheckpointFooter)), sizeof(sequentialDumpCheckpointFooter));
+    
+    // Torn writes are caught by the checksum
+    if (footer.magic != SEQ_DUMP_CHECKPOINT_MAGIC || ((u64)footer.payloadSize + sizeof(sequentialDumpCheckpointFooter)) != ckptSize) goto out;
+    
+    crc32(ckptData, footer.payloadSize, &crc);
+    crc32(&footer, offsetof(sequentialDumpCheckpointFooter, crc), &crc);
+    if (crc != footer.crc) goto out;
+    
+    memcpy(outFooter, &footer, sizeof(sequentialDumpCheckpointFooter));
+    
+    fclose(ckptFile);
+    
+    return ckptData;
+    
+out:
+    if (ckptData) free(ckptData);
+    
+    fclose(ckptFile);
+    
+    return NULL;
+}
+
+// Applies the checkpoint left behind by an interrupted sequential dump session to its reference file. 'partBasePath' is used to locate the output parts ("[partBasePath].%02u")
+// The checkpoint is discarded if the last part it refers to isn't available anymore or if its tail data doesn't match, in which case the dump resumes from the start of the interrupted session
+// Returns false only if the reference file couldn't be updated
+static bool replaySequentialDumpCheckpoint(const char *seqDumpFilename, const char *partBasePath)
+{
+    u32 i;
+    char ckptPath[NAME_BUF_LEN + 16] = {'\0'}, partPath[NAME_BUF_LEN + 8] = {'\0'};
+    u8 *ckptData = NULL, *curData = NULL;
+    sequentialDumpCheckpointFooter footer, curFooter;
+    u64 partSize = 0;
+    u32 tailCrc = 0;
+    FILE *seqDumpFile = NULL;
+    bool success = true;
+    
+    if (!checkIfFileExists(seqDumpFilename)) goto out;
+    
+    // The temporary file is only left behind if the console crashed while replacing the previous checkpoint with it. Use whichever valid checkpoint is the newest
+    for(i = 0; i < 2; i++)
+    {
+        getSequentialDumpCheckpointPath(seqDumpFilename, (i == 0), ckptPath, MAX_ELEMENTS(ckptPath));
+        
+        curData = loadSequentialDumpCheckpoint(ckptPath, &curFooter);
+        if (!curData) continue;
+        
+        if (!ckptData || curFooter.lastPart > footer.lastPart)
+        {
+            if (ckptData) free(ckptData);
+            ckptData = curData;
+            memcpy(&footer, &curFooter, sizeof(sequentialDumpCheckpointFooter));
+        } else {
+            free(curData);
+        }
+    }
+    
+    if (!ckptData) goto out;
+    
+    // Make sure the last part written before the interruption is still there and intact
+    snprintf(partPath, MAX_CHARACTERS(partPath), "%s.%02u", partBasePath, footer.lastPart);
+    if (!getSequentialDumpPartTail(partPath, &partSize, &tailCrc) || partSize != footer.lastPartSize || tailCrc != footer.tailCrc) goto out;
+    
+    seqDumpFile = fopen(seqDumpFilename, "rb+");
+    if (!seqDumpFile)
+    {
+        success = false;
+        goto out;
+    }
+    
+    fseek(seqDumpFile, 0, SEEK_END);
+    success = ((u64)ftell(seqDumpFile) >= footer.payloadSize);
+    rewind(seqDumpFile);
+    
+    if (success && fwrite(ckptData, 1, footer.payloadSize, seqDumpFile) != footer.payloadSize) success = false;
+    if (fclose(seqDumpFile) != 0) success = false;
+    
+    if (success)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Restored progress from an interrupted sequential dump session (last completed part: #%02u).", footer.lastPart);
+        breaks++;
+    } else {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to apply checkpoint to the sequential dump reference file!", __func__);
+    }
+    
+out:
+    if (ckptData) free(ckptData);
+    
+    // Keep the checkpoint around if it couldn't be applied, so it can be retried
+    if (success) removeSequentialDumpCheckpoint(seqDumpFilename);
+    
+    return success;
+}
+
 bool dumpNXCardImage(xciOptions *xciDumpCfg)
 {
     if (!xciDumpCfg)
@@ -78,6 +323,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     bool calcCrc = xciDumpCfg->calcCrc;
     bool useNoIntroLookup = xciDumpCfg->useNoIntroLookup;
     bool useBrackets = xciDumpCfg->useBrackets;
+    bool verifyOutput = xciDumpCfg->verifyOutput;
     
     u64 partitionOffset = 0, xciDataSize = 0, n;
     u64 partitionSizes[ISTORAGE_PARTITION_CNT];
@@ -85,16 +331,17 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     u32 partition;
     Result result;
     bool proceed = true, success = false, fat32_error = false;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
+    split_writer_ctx_t outWriter;
+    splitWriterNaming splitNaming;
     u32 certCrc = 0, certlessCrc = 0;
     
+    memset(&outWriter, 0, sizeof(split_writer_ctx_t));
     memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
-    bool seqDumpMode = false, seqDumpFileRemove = false, seqDumpFinish = false;
+    bool seqDumpMode = false, seqDumpFileRemove = false, seqDumpFinish = false, seqDumpCheckpoint = false;
     char seqDumpFilename[NAME_BUF_LEN] = {'\0'};
     FILE *seqDumpFile = NULL;
     u64 seqDumpFileSize = 0, seqDumpSessionOffset = 0;
@@ -102,8 +349,6 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     sequentialXciCtx seqXciCtx;
     memset(&seqXciCtx, 0, sizeof(sequentialXciCtx));
     
-    char tmp_idx[5];
-    
     size_t read_res, write_res;
     
     char *dumpName = generateGameCardDumpName(useBrackets);
@@ -123,6 +368,11 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     
     // Check if we're dealing with a sequential dump
     snprintf(seqDumpFilename, MAX_CHARACTERS(seqDumpFilename), "%s%s.xci.seq", XCI_DUMP_PATH, dumpName);
+    
+    // Pick up where an interrupted session left off
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci", XCI_DUMP_PATH, dumpName);
+    if (!replaySequentialDumpCheckpoint(seqDumpFilename, dumpPath)) goto out;
+    
     seqDumpMode = checkIfFileExists(seqDumpFilename);
     if (seqDumpMode)
     {
@@ -171,7 +421,6 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         keepCert = seqXciCtx.keepCert;
         trimDump = seqXciCtx.trimDump;
         calcCrc = seqXciCtx.calcCrc;
-        splitIndex = seqXciCtx.partNumber;
         certCrc = seqXciCtx.certCrc;
         certlessCrc = seqXciCtx.certlessCrc;
         progressCtx.curOffset = ((u64)seqXciCtx.partNumber * SPLIT_FILE_SEQUENTIAL_SIZE);
@@ -312,10 +561,8 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         }
     }
     
-    if (seqDumpMode)
+    if (!seqDumpMode)
     {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci.%02u", XCI_DUMP_PATH, dumpName, splitIndex);
-    } else {
         if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
         {
             if (setXciArchiveBit)
@@ -323,7 +570,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
                 // Temporary, we'll use this to check if the dump already exists (it should have the archive bit set if so)
                 snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci", XCI_DUMP_PATH, dumpName);
             } else {
-                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xc%u", XCI_DUMP_PATH, dumpName, splitIndex);
+                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xc0", XCI_DUMP_PATH, dumpName);
             }
         } else {
             snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci", XCI_DUMP_PATH, dumpName);
@@ -354,21 +601,32 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
             // Better safe than sorry
             remove(dumpPath);
             fsdevDeleteDirectoryRecursively(dumpPath);
-            
-            mkdir(dumpPath, 0744);
-            
-            sprintf(tmp_idx, "/%02u", splitIndex);
-            strcat(dumpPath, tmp_idx);
         }
     }
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
+    if (seqDumpMode || (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
-        goto out;
+        if (seqDumpMode)
+        {
+            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci", XCI_DUMP_PATH, dumpName);
+            splitNaming = SPLIT_WRITER_NAMING_DOT_INDEX;
+        } else
+        if (setXciArchiveBit)
+        {
+            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci", XCI_DUMP_PATH, dumpName);
+            splitNaming = SPLIT_WRITER_NAMING_DIRECTORY;
+        } else {
+            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", XCI_DUMP_PATH, dumpName);
+            splitNaming = SPLIT_WRITER_NAMING_XCI;
+        }
+        
+        if (!splitWriterOpen(&outWriter, dumpPath, (progressCtx.totalSize - progressCtx.curOffset), partSize, splitNaming, (seqDumpMode ? seqXciCtx.partNumber : 0))) goto out;
+    } else {
+        if (!splitWriterOpen(&outWriter, dumpPath, progressCtx.totalSize, 0, SPLIT_WRITER_NAMING_DOT_INDEX, 0)) goto out;
     }
     
+    if (verifyOutput) splitWriterEnableVerification(&outWriter);
+    
     // Start dump process
     dumpStartMsg();
     appletModeOperationWarning();
@@ -383,10 +641,14 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     u32 startPartitionIndex = (seqDumpMode ? seqXciCtx.partitionIndex : 0);
     u64 startPartitionOffset;
     
+    // Measure gamecard read sizes over the first chunks if the best one isn't known yet
+    chunk_tuner_ctx_t chunkTuner;
+    u64 chunkStartTick = 0;
+    
+    chunkTunerInit(&chunkTuner, dumpCfg.chunkSizeCfg.chunkSize[DUMP_SOURCE_GAMECARD], dumpBufSize);
+    
     for(partition = startPartitionIndex; partition < ISTORAGE_PARTITION_CNT; partition++)
     {
-        n = DUMP_BUFFER_SIZE;
-        
         startPartitionOffset = ((seqDumpMode && partition == startPartitionIndex) ? seqXciCtx.partitionOffset : 0);
         
         openIStoragePartition idx = (openIStoragePartition)(partition + 1);
@@ -403,18 +665,46 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         {
             if (seqDumpMode && seqDumpFinish) break;
             
+            if (seqDumpCheckpoint)
+            {
+                seqDumpCheckpoint = false;
+                
+                breaks = (progressCtx.line_offset + 2);
+                
+                if (!splitWriterFinishPart(&outWriter))
+                {
+                    proceed = false;
+                    break;
+                }
+                
+                breaks = (progressCtx.line_offset - 4);
+                
+                seqXciCtx.partNumber = (outWriter.part_index + 1);
+                seqXciCtx.partitionIndex = partition;
+                seqXciCtx.partitionOffset = partitionOffset;
+                
+                if (calcCrc)
+                {
+                    seqXciCtx.certCrc = certCrc;
+                    seqXciCtx.certlessCrc = certlessCrc;
+                }
+                
+                writeSequentialDumpCheckpoint(seqDumpFilename, outWriter.path, outWriter.part_index, &seqXciCtx, sizeof(sequentialXciCtx), NULL, 0);
+            }
+            
             uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
             
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/' ) + 1);
             
             uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Dumping IStorage partition #%u...", partition);
             
+            n = chunkTunerGetChunkSize(&chunkTuner);
             if (n > (partitionSizes[partition] - partitionOffset)) n = (partitionSizes[partition] - partitionOffset);
             
             // Check if the next read chunk will exceed the size of the current part file
-            if (seqDumpMode && (seqDumpSessionOffset + n) >= (((splitIndex - seqXciCtx.partNumber) + 1) * partSize))
+            if (seqDumpMode && (seqDumpSessionOffset + n) >= (((seqDumpSessionOffset / partSize) + 1) * partSize))
             {
-                u64 new_file_chunk_size = ((seqDumpSessionOffset + n) - (((splitIndex - seqXciCtx.partNumber) + 1) * partSize));
+                u64 new_file_chunk_size = ((seqDumpSessionOffset + n) - (((seqDumpSessionOffset / partSize) + 1) * partSize));
                 u64 old_file_chunk_size = (n - new_file_chunk_size);
                 
                 u64 remainderDumpSize = (progressCtx.totalSize - (progressCtx.curOffset + old_file_chunk_size));
@@ -426,9 +716,17 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
                 {
                     n = old_file_chunk_size;
                     seqDumpFinish = true;
+                } else
+                if (remainderDumpSize && !((outWriter.first_part + (u32)(seqDumpSessionOffset / partSize) + 1) % SEQ_DUMP_CHECKPOINT_PART_INTERVAL))
+                {
+                    // Stop at the end of the current part, so a checkpoint can be taken before the next one is created
+                    n = old_file_chunk_size;
+                    seqDumpCheckpoint = true;
                 }
             }
             
+            chunkStartTick = armGetSystemTick();
+            
             result = readGameCardStoragePartition(partitionOffset, dumpBuf, n);
             if (R_FAILED(result))
             {
@@ -480,77 +778,24 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
                 }
             }
             
-            if ((seqDumpMode || (!seqDumpMode && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)) && (progressCtx.curOffset + n) >= ((splitIndex + 1) * partSize))
+            breaks = (progressCtx.line_offset + 2);
+            
+            if (!splitWriterWrite(&outWriter, dumpBuf, n))
             {
-                u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * partSize));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
-                
-                if (old_file_chunk_size > 0)
+                if (!outWriter.part_size && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
                 {
-                    write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                    if (write_res != old_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
-                        proceed = false;
-                        break;
-                    }
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable the \"Split output dump\" option.");
+                    fat32_error = true;
                 }
                 
-                fclose(outFile);
-                outFile = NULL;
-                
-                if (((seqDumpMode && !seqDumpFinish) || !seqDumpMode) && (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize))
-                {
-                    splitIndex++;
-                    
-                    if (seqDumpMode)
-                    {
-                        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci.%02u", XCI_DUMP_PATH, dumpName, splitIndex);
-                    } else {
-                        if (setXciArchiveBit)
-                        {
-                            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci/%02u", XCI_DUMP_PATH, dumpName, splitIndex);
-                        } else {
-                            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xc%u", XCI_DUMP_PATH, dumpName, splitIndex);
-                        }
-                    }
-                    
-                    outFile = fopen(dumpPath, "wb");
-                    if (!outFile)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                        proceed = false;
-                        break;
-                    }
-                    
-                    if (new_file_chunk_size > 0)
-                    {
-                        write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                        if (write_res != new_file_chunk_size)
-                        {
-                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                            proceed = false;
-                            break;
-                        }
-                    }
-                }
-            } else {
-                write_res = fwrite(dumpBuf, 1, n, outFile);
-                if (write_res != n)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                    
-                    if (!seqDumpMode && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable the \"Split output dump\" option.");
-                        fat32_error = true;
-                    }
-                    
-                    proceed = false;
-                    break;
-                }
+                proceed = false;
+                break;
             }
             
+            breaks = (progressCtx.line_offset - 4);
+            
+            if (chunkTunerUpdate(&chunkTuner, n, armTicksToNs(armGetSystemTick() - chunkStartTick))) dumpCfg.chunkSizeCfg.chunkSize[DUMP_SOURCE_GAMECARD] = chunkTunerGetChunkSize(&chunkTuner);
+            
             if (seqDumpMode) progressCtx.seqDumpCurOffset = seqDumpSessionOffset;
             printProgressBar(&progressCtx, true, n);
             
@@ -575,7 +820,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
         {
             uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
             
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/' ) + 1);
             
             uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Dumping IStorage partition #%u...", partition);
             
@@ -592,7 +837,18 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
     breaks = (progressCtx.line_offset + 2);
     if (fat32_error) breaks += 2;
     
-    if (outFile) fclose(outFile);
+    if (success && !splitWriterClose(&outWriter)) success = false;
+    splitWriterAbort(&outWriter);
+    
+    // Read back all parts written during this session
+    if (success && verifyOutput && !splitWriterVerify(&outWriter, dumpBuf, dumpBufSize))
+    {
+        setProgressBarError(&progressCtx);
+        success = false;
+        if (seqDumpMode) seqDumpFileRemove = true;
+    }
+    
+    splitWriterFreeVerification(&outWriter);
     
     if (success)
     {
@@ -601,7 +857,7 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
             if (seqDumpFinish)
             {
                 // Update the sequence reference file in the SD card
-                seqXciCtx.partNumber = (splitIndex + 1);
+                seqXciCtx.partNumber = (outWriter.part_index + 1);
                 seqXciCtx.partitionIndex = partition;
                 seqXciCtx.partitionOffset = partitionOffset;
                 
@@ -685,31 +941,9 @@ bool dumpNXCardImage(xciOptions *xciDumpCfg)
             }
         }
     } else {
-        if (seqDumpMode)
-        {
-            for(u8 i = 0; i <= splitIndex; i++)
-            {
-                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci.%02u", XCI_DUMP_PATH, dumpName, i);
-                remove(dumpPath);
-            }
-        } else {
-            if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
-            {
-                if (setXciArchiveBit)
-                {
-                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xci", XCI_DUMP_PATH, dumpName);
-                    fsdevDeleteDirectoryRecursively(dumpPath);
-                } else {
-                    for(u8 i = 0; i <= splitIndex; i++)
-                    {
-                        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.xc%u", XCI_DUMP_PATH, dumpName, i);
-                        remove(dumpPath);
-                    }
-                }
-            } else {
-                remove(dumpPath);
-            }
-        }
+        // Parts from previous sequential dump sessions are removed as well
+        if (seqDumpMode) outWriter.first_part = 0;
+        splitWriterDelete(&outWriter);
     }
     
 out:
@@ -719,6 +953,9 @@ out:
     
     if (seqDumpFileRemove) remove(seqDumpFilename);
     
+    // Checkpoints are only needed if the session doesn't get to this point
+    if (seqDumpMode || seqDumpFileRemove) removeSequentialDumpCheckpoint(seqDumpFilename);
+    
     breaks += 2;
     
     changeHomeButtonBlockStatus(false);
@@ -726,36 +963,180 @@ out:
     return success;
 }
 
-int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleIndex, nspOptions *nspDumpCfg, bool batch)
+// Retrieves the parameters needed to look up a title in the ncm content meta database. 'titleIndex' must have been validated by the caller
+static void getNspTitleNcmInfo(nspDumpType selectedNspDumpType, u32 titleIndex, NcmStorageId *outStorageId, NcmContentMetaType *outMetaType, u32 *outNcmTitleIndex, u32 *outTitleCount)
 {
-    int ret = -1;
+    NcmStorageId storageId = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].storageId : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
+    u32 titleCount = 0;
     
-    if (!nspDumpCfg)
+    switch(storageId)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NSP configuration struct!", __func__);
-        breaks += 2;
-        return ret;
+        case NcmStorageId_GameCard:
+            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? titleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? titlePatchCount : titleAddOnCount));
+            break;
+        case NcmStorageId_SdCard:
+            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? sdCardTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
+            break;
+        case NcmStorageId_BuiltInUser:
+            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? emmcTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? emmcTitlePatchCount : emmcTitleAddOnCount));
+            break;
+        default:
+            break;
     }
     
-    bool isFat32 = nspDumpCfg->isFat32;
-    bool useNoIntroLookup = nspDumpCfg->useNoIntroLookup;
-    bool removeConsoleData = nspDumpCfg->removeConsoleData;
-    bool tiklessDump = nspDumpCfg->tiklessDump;
-    bool npdmAcidRsaPatch = nspDumpCfg->npdmAcidRsaPatch;
-    bool dumpDeltaFragments = nspDumpCfg->dumpDeltaFragments;
-    bool useBrackets = nspDumpCfg->useBrackets;
-    bool preInstall = false;
+    *outStorageId = storageId;
+    *outMetaType = (selectedNspDumpType == DUMP_APP_NSP ? NcmContentMetaType_Application : (selectedNspDumpType == DUMP_PATCH_NSP ? NcmContentMetaType_Patch : NcmContentMetaType_AddOnContent));
+    *outNcmTitleIndex = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].ncmIndex : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].ncmIndex : addOnEntries[titleIndex].ncmIndex));
+    *outTitleCount = titleCount;
+}
+
+// Displays the progress from the batch mode NCA store worker, so both storages can be followed at once
+static void printBatchStoreWorkerStatus()
+{
+    if (batchStoreWorkerLine < 0) return;
     
-    Result result;
-    u32 i = 0, j = 0;
+    u64 curOffset = 0, totalSize = 0;
     
-    NcmStorageId curStorageId;
-    NcmContentMetaType metaType;
-    u32 titleCount = 0, ncmTitleIndex = 0;
+    uiFill(0, (batchStoreWorkerLine * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT, BG_COLOR_RGB);
+    
+    if (!batchStoreWorker.running)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(batchStoreWorkerLine), FONT_COLOR_RGB, "Background copy: no pending titles from the other storage.");
+        return;
+    }
+    
+    storeWorkerGetProgress(&batchStoreWorker, &curOffset, &totalSize);
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(batchStoreWorkerLine), FONT_COLOR_RGB, "Background copy (%s): %s - %u%%.", (batchStoreWorker.storage_id == NcmStorageId_SdCard ? "SD card" : "eMMC"), batchStoreWorkerTitle, (totalSize ? (u32)((curOffset * 100) / totalSize) : (storeWorkerIsBusy(&batchStoreWorker) ? 0 : 100)));
+}
+
+// Writes the PFS0 header file from a NSP dumped in NCA store mode, along with a list of all the files that must be concatenated to get the full NSP
+// Paths in the list are relative to NSP_DUMP_PATH. Parts from NCAs stored as split files are listed individually
+static bool writeNcaStoreNspFiles(const char *pfs0HeaderFilename, const char *listFilename, const char *tailFilename, const u8 *pfs0Header, u64 pfs0HeaderSize, const cnmt_xml_content_info *xml_content_info, u32 ncaCnt, const u64 *ncaPartSizes)
+{
+    bool success = false;
+    FILE *outFile = NULL;
+    size_t write_res;
+    u32 i, j, partCnt;
+    char ncaPath[NAME_BUF_LEN] = {'\0'};
+    
+    str_builder_t list;
+    memset(&list, 0, sizeof(str_builder_t));
+    
+    outFile = fopen(pfs0HeaderFilename, "wb");
+    if (!outFile)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to create PFS0 header file!", __func__);
+        goto out;
+    }
+    
+    write_res = fwrite(pfs0Header, 1, pfs0HeaderSize, outFile);
+    if (fclose(outFile) != 0) write_res = 0;
+    
+    if (write_res != pfs0HeaderSize)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes PFS0 header file! (wrote %lu bytes)", __func__, pfs0HeaderSize, write_res);
+        goto out;
+    }
+    
+    if (!strBuilderInit(&list, 0))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the NSP file list!", __func__);
+        goto out;
+    }
+    
+    strBuilderAppendFormat(&list, "%s\n", strrchr(pfs0HeaderFilename, '/') + 1);
+    
+    // The CNMT NCA is always the last one, and it's saved to the tail file
+    for(i = 0; i < (ncaCnt - 1); i++)
+    {
+        ncaStoreGetNcaPath(xml_content_info[i].nca_id, ncaPath, MAX_CHARACTERS(ncaPath));
+        
+        if (!ncaPartSizes[i])
+        {
+            strBuilderAppendFormat(&list, "%s\n", ncaPath + strlen(NSP_DUMP_PATH));
+            continue;
+        }
+        
+        partCnt = (u32)((xml_content_info[i].size + ncaPartSizes[i] - 1) / ncaPartSizes[i]);
+        for(j = 0; j < partCnt; j++) strBuilderAppendFormat(&list, "%s/%02u\n", ncaPath + strlen(NSP_DUMP_PATH), j);
+    }
+    
+    strBuilderAppendFormat(&list, "%s\n", strrchr(tailFilename, '/') + 1);
+    
+    if (list.error)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the NSP file list!", __func__);
+        goto out;
+    }
+    
+    outFile = fopen(listFilename, "wb");
+    if (!outFile)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to create NSP file list!", __func__);
+        goto out;
+    }
+    
+    write_res = fwrite(list.str, 1, list.len, outFile);
+    if (fclose(outFile) != 0) write_res = 0;
+    
+    if (write_res != list.len)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes NSP file list! (wrote %lu bytes)", __func__, list.len, write_res);
+        goto out;
+    }
+    
+    success = true;
+    
+out:
+    strBuilderFree(&list);
+    
+    if (!success)
+    {
+        remove(pfs0HeaderFilename);
+        remove(listFilename);
+    }
+    
+    return success;
+}
+
+int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleIndex, nspOptions *nspDumpCfg, bool batch)
+{
+    int ret = -1;
+    
+    if (!nspDumpCfg)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NSP configuration struct!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    bool isFat32 = nspDumpCfg->isFat32;
+    bool useNoIntroLookup = nspDumpCfg->useNoIntroLookup;
+    bool removeConsoleData = nspDumpCfg->removeConsoleData;
+    bool tiklessDump = nspDumpCfg->tiklessDump;
+    bool npdmAcidRsaPatch = nspDumpCfg->npdmAcidRsaPatch;
+    bool dumpDeltaFragments = nspDumpCfg->dumpDeltaFragments;
+    bool useBrackets = nspDumpCfg->useBrackets;
+    bool verifyExeFsHashes = nspDumpCfg->verifyExeFsHashes;
+    bool verifyOutput = nspDumpCfg->verifyOutput;
+    bool preInstall = false;
+    bool outputConsoleData = false;
+    bool useNcaStore = (batch && nspDumpCfg->useNcaStore);
+    
+    Result result;
+    u32 i = 0, j = 0;
+    
+    NcmStorageId curStorageId;
+    NcmContentMetaType metaType;
+    u32 titleCount = 0, ncmTitleIndex = 0;
     
     char dumpPath[NAME_BUF_LEN] = {'\0'};
     
     NcmContentInfo *titleContentInfos = NULL;
+    title_prefetch_data_t prefetchData;
+    memset(&prefetchData, 0, sizeof(title_prefetch_data_t));
+    bool prefetched = false;
     u32 titleContentInfoCnt = 0;
     
     NcmContentStorage ncmStorage;
@@ -780,7 +1161,8 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     u32 cnmtNcaIndex = 0;
     u8 *cnmtNcaBuf = NULL;
     bool cnmtFound = false;
-    char *cnmtXml = NULL;
+    str_builder_t cnmtXml;
+    memset(&cnmtXml, 0, sizeof(str_builder_t));
     
     u32 xml_rec_cnt = 0;
     xml_record_info *xml_records = NULL, *tmp_xml_rec = NULL;
@@ -795,22 +1177,27 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     u64 nspPfs0StrTableSize = 0;
     
     u64 fullPfs0HeaderSize = 0;
+    u8 fullPfs0HeaderHash[SHA256_HASH_SIZE] = {0};
+    
+    nspFileSource *nspPfs0FileSrcs = NULL;
+    u32 cnmtXmlSrcIdx = 0;
     
-    u8 **nspPfs0FilePtrs = NULL;
+    // Modified data from the NCA being dumped
+    patch_overlay_t ncaPatchOverlay;
+    patchOverlayInit(&ncaPatchOverlay);
     
     Sha256Context nca_hash_ctx;
     sha256ContextCreate(&nca_hash_ctx);
     
     u64 n, fileOffset;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
+    split_writer_ctx_t outWriter;
     u32 crc = 0;
     bool proceed = true, dumping = false, fat32_error = false, removeFile = true;
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
-    bool seqDumpMode = false, seqDumpFileRemove = false, seqDumpFinish = false;
+    bool seqDumpMode = false, seqDumpFileRemove = false, seqDumpFinish = false, seqDumpCheckpoint = false;
     char seqDumpFilename[NAME_BUF_LEN] = {'\0'};
     FILE *seqDumpFile = NULL;
     u64 seqDumpFileSize = 0, seqDumpSessionOffset = 0;
@@ -822,7 +1209,15 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     char pfs0HeaderFilename[NAME_BUF_LEN] = {'\0'};
     FILE *pfs0HeaderFile = NULL;
     
-    char tmp_idx[5];
+    // NCA store mode: all NCAs but the CNMT NCA are written to the shared NCA store, while the rest of the NSP goes to a ".nsp.tail" file
+    split_writer_ctx_t ncaWriter;
+    char ncaStoreTmpPath[NAME_BUF_LEN] = {'\0'};
+    char ncaStoreListFilename[NAME_BUF_LEN] = {'\0'};
+    u64 *ncaStorePartSizes = NULL;
+    u64 ncaStoreSkipSize = 0, ncaStoreTailSize = 0;
+    
+    memset(&outWriter, 0, sizeof(split_writer_ctx_t));
+    memset(&ncaWriter, 0, sizeof(split_writer_ctx_t));
     
     size_t read_res, write_res;
     
@@ -840,26 +1235,7 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         return ret;
     }
     
-    curStorageId = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].storageId : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].storageId : addOnEntries[titleIndex].storageId));
-    
-    ncmTitleIndex = (selectedNspDumpType == DUMP_APP_NSP ? baseAppEntries[titleIndex].ncmIndex : (selectedNspDumpType == DUMP_PATCH_NSP ? patchEntries[titleIndex].ncmIndex : addOnEntries[titleIndex].ncmIndex));
-    
-    metaType = (selectedNspDumpType == DUMP_APP_NSP ? NcmContentMetaType_Application : (selectedNspDumpType == DUMP_PATCH_NSP ? NcmContentMetaType_Patch : NcmContentMetaType_AddOnContent));
-    
-    switch(curStorageId)
-    {
-        case NcmStorageId_GameCard:
-            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? titleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? titlePatchCount : titleAddOnCount));
-            break;
-        case NcmStorageId_SdCard:
-            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? sdCardTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? sdCardTitlePatchCount : sdCardTitleAddOnCount));
-            break;
-        case NcmStorageId_BuiltInUser:
-            titleCount = (selectedNspDumpType == DUMP_APP_NSP ? emmcTitleAppCount : (selectedNspDumpType == DUMP_PATCH_NSP ? emmcTitlePatchCount : emmcTitleAddOnCount));
-            break;
-        default:
-            break;
-    }
+    getNspTitleNcmInfo(selectedNspDumpType, titleIndex, &curStorageId, &metaType, &ncmTitleIndex, &titleCount);
     
     char *dumpName = generateNSPDumpName(selectedNspDumpType, titleIndex, useBrackets);
     if (!dumpName)
@@ -874,6 +1250,10 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         snprintf(seqDumpFilename, MAX_CHARACTERS(seqDumpFilename), "%s%s.nsp.seq", NSP_DUMP_PATH, dumpName);
         snprintf(pfs0HeaderFilename, MAX_CHARACTERS(pfs0HeaderFilename), "%s%s.nsp.hdr", NSP_DUMP_PATH, dumpName);
         
+        // Pick up where an interrupted session left off
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
+        if (!replaySequentialDumpCheckpoint(seqDumpFilename, dumpPath)) goto out;
+        
         // Check if we're dealing with a sequential dump
         seqDumpMode = checkIfFileExists(seqDumpFilename);
         if (seqDumpMode)
@@ -944,11 +1324,16 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
             tiklessDump = seqNspCtx.tiklessDump;
             npdmAcidRsaPatch = seqNspCtx.npdmAcidRsaPatch;
             preInstall = seqNspCtx.preInstall;
-            splitIndex = seqNspCtx.partNumber;
             progressCtx.curOffset = ((u64)seqNspCtx.partNumber * SPLIT_FILE_SEQUENTIAL_SIZE);
         }
     }
     
+    if (useNcaStore)
+    {
+        snprintf(pfs0HeaderFilename, MAX_CHARACTERS(pfs0HeaderFilename), "%s%s.nsp.hdr", NSP_DUMP_PATH, dumpName);
+        snprintf(ncaStoreListFilename, MAX_CHARACTERS(ncaStoreListFilename), "%s%s.nsp.lst", NSP_DUMP_PATH, dumpName);
+    }
+    
     u64 partSize = (seqDumpMode ? SPLIT_FILE_SEQUENTIAL_SIZE : SPLIT_FILE_NSP_PART_SIZE);
     
     if (!batch)
@@ -958,7 +1343,26 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         breaks += 2;
     }
     
-    if (!retrieveContentInfosFromTitle(curStorageId, metaType, titleCount, ncmTitleIndex, &titleContentInfos, &titleContentInfoCnt))
+    // Batch mode may have already retrieved this data in the background while the previous title was being dumped
+    if (batch)
+    {
+        for(i = 0; i < MAX_ELEMENTS(batchPrefetchCtx) && !prefetched; i++) prefetched = titlePrefetchTake(&(batchPrefetchCtx[i]), curStorageId, metaType, ncmTitleIndex, &prefetchData);
+        
+        if (prefetched)
+        {
+            titleContentInfos = prefetchData.content_infos;
+            titleContentInfoCnt = prefetchData.content_info_cnt;
+            prefetchData.content_infos = NULL;
+            
+            // The ticket is copied over by decryptNcaHeader() / processDecryptedNcaHeader() as soon as the first NCA with a populated Rights ID field is found
+            if (prefetchData.rights_info.has_rights_id) memcpy(&rights_info, &(prefetchData.rights_info), sizeof(title_rights_ctx));
+            
+            // Reads from the CNMT, NACP and legal information NCAs are served from memory
+            if (prefetchData.nca_data) setNcaMemoryData(titleContentInfos, prefetchData.nca_data, titleContentInfoCnt);
+        }
+    }
+    
+    if (!prefetched && !retrieveContentInfosFromTitle(curStorageId, metaType, titleCount, ncmTitleIndex, &titleContentInfos, &titleContentInfoCnt))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
         goto out;
@@ -1031,6 +1435,10 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         
         memcpy(&ncaId, &(titleContentInfos[titleContentInfoIndex].content_id), sizeof(NcmContentId));
         
+        if (prefetchData.nca_headers)
+        {
+            memcpy(ncaHeader, prefetchData.nca_headers + ((u64)titleContentInfoIndex * NCA_FULL_HEADER_LENGTH), NCA_FULL_HEADER_LENGTH);
+        } else
         if (!readNcaDataByContentId(&ncmStorage, &ncaId, 0, ncaHeader, NCA_FULL_HEADER_LENGTH))
         {
             breaks++;
@@ -1041,12 +1449,16 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         
         // Decrypt the NCA header
         // Don't retrieve the ticket and/or titlekey if we're dealing with a Patch with titlekey crypto bundled with the inserted gamecard
-        if (!decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, xml_content_info[i].decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard)))
+        if (prefetchData.dec_nca_headers)
         {
-            proceed = false;
-            break;
+            memcpy(&dec_nca_header, &(prefetchData.dec_nca_headers[titleContentInfoIndex]), sizeof(nca_header_t));
+            proceed = processDecryptedNcaHeader(&dec_nca_header, &rights_info, xml_content_info[i].decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard));
+        } else {
+            proceed = decryptNcaHeader(ncaHeader, NCA_FULL_HEADER_LENGTH, &dec_nca_header, &rights_info, xml_content_info[i].decrypted_nca_keys, (curStorageId != NcmStorageId_GameCard));
         }
         
+        if (!proceed) break;
+        
         // Check if this particular content has a populated Rights ID field
         bool has_rights_id = false;
         
@@ -1225,7 +1637,7 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
             // Retrieve NACP data (XML and icons)
             if (xml_content_info[i].type == NcmContentType_Control)
             {
-                if (!retrieveNacpDataFromNca(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, &(xml_records[xml_rec_cnt - 1].xml_data), &(xml_records[xml_rec_cnt - 1].xml_size), &(xml_records[xml_rec_cnt - 1].nacp_icons), &(xml_records[xml_rec_cnt - 1].nacp_icon_cnt)))
+                if (!retrieveNacpDataFromNca(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, &(xml_records[xml_rec_cnt - 1].xml_data), &(xml_records[xml_rec_cnt - 1].xml_size), &(xml_records[xml_rec_cnt - 1].nacp_icons), &(xml_records[xml_rec_cnt - 1].nacp_icon_cnt), &(xml_records[xml_rec_cnt - 1].nacp_icon_data), &(xml_records[xml_rec_cnt - 1].nacp_icon_data_cnt)))
                 {
                     proceed = false;
                     break;
@@ -1235,11 +1647,29 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
             // Retrieve legalinfo.xml
             if (xml_content_info[i].type == NcmContentType_LegalInformation)
             {
-                if (!retrieveLegalInfoXmlFromNca(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, &(xml_records[xml_rec_cnt - 1].xml_data), &(xml_records[xml_rec_cnt - 1].xml_size)))
+                if (!retrieveLegalInfoXmlFromNca(&ncmStorage, &ncaId, &dec_nca_header, xml_content_info[i].decrypted_nca_keys, &(xml_records[xml_rec_cnt - 1].xml_ref)))
                 {
                     proceed = false;
                     break;
                 }
+                
+                xml_records[xml_rec_cnt - 1].xml_size = xml_records[xml_rec_cnt - 1].xml_ref.size;
+            }
+        }
+        
+        // Keep the ExeFS section information from Program NCAs, in order to verify it while the NCA is being dumped
+        // The decrypted key area can only be used if the titlekey was retrieved
+        if (verifyExeFsHashes && xml_content_info[i].type == NcmContentType_Program && (!has_rights_id || (has_rights_id && rights_info.retrieved_tik)))
+        {
+            for(j = 0; j < 4; j++)
+            {
+                if (dec_nca_header.fs_headers[j].partition_type != NCA_FS_HEADER_PARTITION_PFS0 || dec_nca_header.fs_headers[j].fs_type != NCA_FS_HEADER_FSTYPE_PFS0 || !dec_nca_header.fs_headers[j].pfs0_superblock.pfs0_size || dec_nca_header.fs_headers[j].crypt_type != NCA_FS_HEADER_CRYPT_CTR) continue;
+                
+                xml_content_info[i].exefs_section_offset = ((u64)dec_nca_header.section_entries[j].media_start_offset * (u64)MEDIA_UNIT_SIZE);
+                xml_content_info[i].exefs_section_size = (((u64)dec_nca_header.section_entries[j].media_end_offset * (u64)MEDIA_UNIT_SIZE) - xml_content_info[i].exefs_section_offset);
+                memcpy(&(xml_content_info[i].exefs_fs_header), &(dec_nca_header.fs_headers[j]), sizeof(nca_fs_header_t));
+                xml_content_info[i].verify_exefs = true;
+                break;
             }
         }
         
@@ -1249,8 +1679,19 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
             proceed = false;
             break;
         }
+        
+        // NCAs dumped as-is keep their content ID, so the NCA store can recognize them without reading any data
+        xml_content_info[i].unmodified = !memcmp(xml_content_info[i].encrypted_header_mod, ncaHeader, NCA_FULL_HEADER_LENGTH);
+        
+        for(j = 0; j < ncaProgramModCnt && xml_content_info[i].unmodified; j++)
+        {
+            if (ncaProgramMod[j].nca_index == i) xml_content_info[i].unmodified = false;
+        }
     }
     
+    // All programinfo.xml files have been generated at this point
+    freeNsoImageCache();
+    
     if (!proceed) goto out;
     
     if (proceed && !cnmtFound)
@@ -1293,17 +1734,12 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     if (!retrieveCnmtNcaData(curStorageId, cnmtNcaBuf, &xml_program_info, xml_content_info, cnmtNcaIndex, &ncaCnmtMod, &rights_info)) goto out;
     
     // Generate a placeholder CNMT XML. It's length will be used to calculate the final output dump size
-    
-    // Make sure that the output buffer for our CNMT XML is big enough
-    cnmtXml = calloc(NSP_XML_BUFFER_SIZE, sizeof(char));
-    if (!cnmtXml)
+    if (!strBuilderInit(&cnmtXml, 0) || !generateCnmtXml(&xml_program_info, xml_content_info, &cnmtXml))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the CNMT XML!", __func__);
         goto out;
     }
     
-    generateCnmtXml(&xml_program_info, xml_content_info, cnmtXml);
-    
     bool includeTikAndCert = (rights_info.retrieved_tik && !tiklessDump);
     
     if (includeTikAndCert)
@@ -1312,6 +1748,8 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         // Ticket files from Patch titles bundled with gamecards always use common titlekey crypto
         if ((curStorageId == NcmStorageId_SdCard || curStorageId == NcmStorageId_BuiltInUser) && removeConsoleData) removeConsoleDataFromTicket(&rights_info);
         
+        outputConsoleData = checkIfTicketContainsConsoleData(&(rights_info.tik_data));
+        
         // Retrieve cert file
         if (!retrieveCertData(rights_info.cert_data, (rights_info.tik_data.titlekey_type == ETICKET_TITLEKEY_PERSONALIZED)))
         {
@@ -1337,7 +1775,7 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     {
         for(i = 0; i < xml_rec_cnt; i++)
         {
-            if (!xml_records[i].xml_data || !xml_records[i].xml_size) continue;
+            if (!xml_records[i].xml_size) continue;
             
             nspPfs0Header.file_cnt++;
             u8 type = xml_content_info[xml_records[i].nca_index].type;
@@ -1351,7 +1789,7 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                 {
                     nspPfs0Header.file_cnt++;
                     nspPfs0StrTableSize += (u32)(strlen(xml_records[i].nacp_icons[j].filename) + 1);
-                    progressCtx.totalSize += xml_records[i].nacp_icons[j].icon_size;
+                    progressCtx.totalSize += xml_records[i].nacp_icon_data[xml_records[i].nacp_icons[j].data_idx].size;
                 }
             }
         }
@@ -1383,11 +1821,11 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     // Determine our String Table size
     nspPfs0Header.str_table_size = (fullPfs0HeaderSize - (sizeof(pfs0_header) + ((u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry))));
     
-    // Allocate memory for PFS0 file data pointer array. Exclude all NCAs but the CNMT NCA
-    nspPfs0FilePtrs = calloc(nspPfs0Header.file_cnt - (titleContentInfoCnt - 1), sizeof(u8*));
-    if (!nspPfs0FilePtrs)
+    // Allocate memory for PFS0 file data source array. Exclude all NCAs but the CNMT NCA
+    nspPfs0FileSrcs = calloc(nspPfs0Header.file_cnt - (titleContentInfoCnt - 1), sizeof(nspFileSource));
+    if (!nspPfs0FileSrcs)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 file data pointer array!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the PFS0 file data source array!", __func__);
         goto out;
     }
     
@@ -1406,15 +1844,16 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         if (i < titleContentInfoCnt)
         {
             // Always reserve the first titleContentInfoCnt entries for our NCAs
-            // Only save the CNMT NCA buffer pointer to the PFS0 file data pointer array. We don't have any other pointers to raw NCA data, so we leave the rest untouched
+            // Only save the CNMT NCA buffer pointer to the PFS0 file data source array. We don't have any other pointers to raw NCA data, so we leave the rest untouched
             entrySize = xml_content_info[i].size;
             entryFilenameSize = (i == cnmtNcaIndex ? NSP_CNMT_FILENAME_LENGTH : NSP_NCA_FILENAME_LENGTH);
-            if (i == cnmtNcaIndex) nspPfs0FilePtrs[ptrIdx++] = cnmtNcaBuf;
+            if (i == cnmtNcaIndex) nspPfs0FileSrcs[ptrIdx++].data = cnmtNcaBuf;
         } else {
             // Reserve the entry right after our NCAs for the CNMT XML
-            entrySize = strlen(cnmtXml);
+            entrySize = cnmtXml.len;
             entryFilenameSize = NSP_CNMT_FILENAME_LENGTH;
-            nspPfs0FilePtrs[ptrIdx++] = (u8*)cnmtXml;
+            cnmtXmlSrcIdx = ptrIdx;
+            nspPfs0FileSrcs[ptrIdx++].data = (u8*)cnmtXml.str;
         }
         
         nspPfs0EntryTable[i].file_size = entrySize;
@@ -1434,9 +1873,9 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
             // Process all icons at once
             for(j = 0; j < xml_records[i].nacp_icon_cnt; j++, entryIdx++)
             {
-                entrySize = xml_records[i].nacp_icons[j].icon_size;
+                entrySize = xml_records[i].nacp_icon_data[xml_records[i].nacp_icons[j].data_idx].size;
                 entryFilenameSize = (u32)(strlen(xml_records[i].nacp_icons[j].filename) + 1); // This is the only entry type with variable filename length
-                nspPfs0FilePtrs[ptrIdx++] = xml_records[i].nacp_icons[j].icon_data;
+                nspPfs0FileSrcs[ptrIdx++].ref = &(xml_records[i].nacp_icon_data[xml_records[i].nacp_icons[j].data_idx]);
                 
                 nspPfs0EntryTable[entryIdx].file_size = entrySize;
                 nspPfs0EntryTable[entryIdx].file_offset = curFileOffset;
@@ -1450,7 +1889,12 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         // XML entry
         entrySize = xml_records[i].xml_size;
         entryFilenameSize = (type == NcmContentType_Program ? NSP_PROGRAM_XML_FILENAME_LENGTH : (type == NcmContentType_Control ? NSP_NACP_XML_FILENAME_LENGTH : NSP_LEGAL_XML_FILENAME_LENGTH));
-        nspPfs0FilePtrs[ptrIdx++] = (u8*)xml_records[i].xml_data;
+        if (xml_records[i].xml_data)
+        {
+            nspPfs0FileSrcs[ptrIdx++].data = (u8*)xml_records[i].xml_data;
+        } else {
+            nspPfs0FileSrcs[ptrIdx++].ref = &(xml_records[i].xml_ref);
+        }
         
         nspPfs0EntryTable[entryIdx].file_size = entrySize;
         nspPfs0EntryTable[entryIdx].file_offset = curFileOffset;
@@ -1466,7 +1910,7 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         {
             entrySize = (i == 0 ? ETICKET_TIK_FILE_SIZE : ETICKET_CERT_FILE_SIZE);
             entryFilenameSize = (i == 0 ? NSP_TIK_FILENAME_LENGTH : NSP_CERT_FILENAME_LENGTH);
-            nspPfs0FilePtrs[ptrIdx++] = (i == 0 ? (u8*)(&(rights_info.tik_data)) : rights_info.cert_data);
+            nspPfs0FileSrcs[ptrIdx++].data = (i == 0 ? (u8*)(&(rights_info.tik_data)) : rights_info.cert_data);
             
             nspPfs0EntryTable[entryIdx].file_size = entrySize;
             nspPfs0EntryTable[entryIdx].file_offset = curFileOffset;
@@ -1480,7 +1924,7 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     // Calculate total dump size
     progressCtx.totalSize += fullPfs0HeaderSize;
     for(i = 0; i < titleContentInfoCnt; i++) progressCtx.totalSize += xml_content_info[i].size;
-    progressCtx.totalSize += strlen(cnmtXml);
+    progressCtx.totalSize += cnmtXml.len;
     if (includeTikAndCert) progressCtx.totalSize += (ETICKET_TIK_FILE_SIZE + ETICKET_CERT_FILE_SIZE);
     
     convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
@@ -1723,21 +2167,39 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
             }
         }
     } else {
-        if (progressCtx.totalSize > freeSpace)
+        if (useNcaStore)
+        {
+            ncaStorePartSizes = calloc(titleContentInfoCnt, sizeof(u64));
+            if (!ncaStorePartSizes)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the NCA store part sizes!", __func__);
+                goto out;
+            }
+            
+            // The tail file holds the CNMT NCA and everything that comes after it
+            ncaStoreTailSize = (progressCtx.totalSize - fullPfs0HeaderSize);
+            
+            for(i = 0; i < (titleContentInfoCnt - 1); i++)
+            {
+                ncaStoreTailSize -= xml_content_info[i].size;
+                
+                // NCAs that are already available in the NCA store won't be written again
+                if (xml_content_info[i].unmodified && ncaStoreLookup(xml_content_info[i].nca_id, xml_content_info[i].size, NULL, NULL)) ncaStoreSkipSize += xml_content_info[i].size;
+            }
+        }
+        
+        if ((progressCtx.totalSize - ncaStoreSkipSize) > freeSpace)
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
             goto out;
         }
     }
     
-    if (seqDumpMode)
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp%s", NSP_DUMP_PATH, dumpName, (useNcaStore ? ".tail" : ""));
+    
+    if (!seqDumpMode)
     {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp.%02u", NSP_DUMP_PATH, dumpName, splitIndex);
-    } else {
-        // Temporary, we'll use this to check if the dump already exists (it should have the archive bit set if so)
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-        
-        // Check if the dump already exists
+        // Check if the dump already exists (it should have the archive bit set if so)
         if (!batch && checkIfFileExists(dumpPath))
         {
             // Ask the user if they want to proceed anyway
@@ -1760,23 +2222,21 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         // Better safe than sorry
         remove(dumpPath);
         fsdevDeleteDirectoryRecursively(dumpPath);
-        
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            mkdir(dumpPath, 0744);
-            
-            sprintf(tmp_idx, "/%02u", splitIndex);
-            strcat(dumpPath, tmp_idx);
-        }
     }
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
+    if (seqDumpMode)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
-        goto out;
+        if (!splitWriterOpen(&outWriter, dumpPath, (progressCtx.totalSize - progressCtx.curOffset), partSize, SPLIT_WRITER_NAMING_DOT_INDEX, seqNspCtx.partNumber)) goto out;
+    } else
+    if (useNcaStore)
+    {
+        if (!splitWriterOpen(&outWriter, dumpPath, ncaStoreTailSize, 0, SPLIT_WRITER_NAMING_DIRECTORY, 0)) goto out;
+    } else {
+        if (!splitWriterOpen(&outWriter, dumpPath, progressCtx.totalSize, ((progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32) ? partSize : 0), SPLIT_WRITER_NAMING_DIRECTORY, 0)) goto out;
     }
     
+    if (verifyOutput) splitWriterEnableVerification(&outWriter);
+    
     // Start dump process
     if (!batch) dumpStartMsg();
     appletModeOperationWarning();
@@ -1792,15 +2252,15 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     {
         // Skip the PFS0 header in the first part file
         // It will be saved to an additional ".nsp.hdr" file
-        if (!seqNspCtx.partNumber) progressCtx.curOffset = seqDumpSessionOffset = fullPfs0HeaderSize;
-    } else {
-        // Write placeholder zeroes
-        write_res = fwrite(dumpBuf, 1, fullPfs0HeaderSize, outFile);
-        if (write_res != fullPfs0HeaderSize)
+        if (!seqNspCtx.partNumber)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes placeholder data to file offset 0x%016lX! (wrote %lu bytes)", __func__, fullPfs0HeaderSize, (u64)0, write_res);
-            goto out;
+            if (!splitWriterSkip(&outWriter, fullPfs0HeaderSize)) goto out;
+            progressCtx.curOffset = seqDumpSessionOffset = fullPfs0HeaderSize;
         }
+    } else {
+        // Write placeholder zeroes
+        // Not needed in NCA store mode, since the PFS0 header is saved to an additional ".nsp.hdr" file
+        if (!useNcaStore && !splitWriterWrite(&outWriter, dumpBuf, fullPfs0HeaderSize)) goto out;
         
         // Advance our current offset
         progressCtx.curOffset = fullPfs0HeaderSize;
@@ -1814,10 +2274,18 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     u32 startFileIndex = (seqDumpMode ? seqNspCtx.fileIndex : 0);
     u64 startFileOffset;
     
+    // NCA reads use the chunk size that works best for the storage the title is located at. It gets measured over the first chunks if it isn't known yet
+    dumpSourceType chunkSource = (curStorageId == NcmStorageId_GameCard ? DUMP_SOURCE_GAMECARD : (curStorageId == NcmStorageId_SdCard ? DUMP_SOURCE_SDCARD : DUMP_SOURCE_EMMC));
+    chunk_tuner_ctx_t chunkTuner;
+    u64 chunkStartTick = 0;
+    
+    chunkTunerInit(&chunkTuner, dumpCfg.chunkSizeCfg.chunkSize[chunkSource], dumpBufSize);
+    
     // Write all PFS0 entries
     for(i = startFileIndex; i < nspPfs0Header.file_cnt; i++, startFileIndex++)
     {
         char *entryFilename = NULL;
+        split_writer_ctx_t *curWriter = ((useNcaStore && i < (titleContentInfoCnt - 1)) ? &ncaWriter : &outWriter);
         
         n = DUMP_BUFFER_SIZE;
         
@@ -1834,6 +2302,40 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                 // Copy NCA ID
                 memcpy(ncaId.c, xml_content_info[i].nca_id, SHA256_HASH_SIZE / 2);
                 
+                if (useNcaStore)
+                {
+                    // Skip NCAs that are already available in the NCA store
+                    if (xml_content_info[i].unmodified && ncaStoreLookup(xml_content_info[i].nca_id, xml_content_info[i].size, xml_content_info[i].hash, &(ncaStorePartSizes[i])))
+                    {
+                        convertDataToHexString(xml_content_info[i].hash, SHA256_HASH_SIZE, xml_content_info[i].hash_str, (SHA256_HASH_SIZE * 2) + 1);
+                        
+                        uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "NCA \"%s\" (%s) is already available in the NCA store.", xml_content_info[i].nca_id_str, getContentType(xml_content_info[i].type));
+                        
+                        progressCtx.curOffset += xml_content_info[i].size;
+                        if (batch) printBatchStoreWorkerStatus();
+                        printProgressBar(&progressCtx, true, 0);
+                        
+                        continue;
+                    }
+                    
+                    // The NCA is written to a temporary file until its content ID is known
+                    snprintf(ncaStoreTmpPath, MAX_CHARACTERS(ncaStoreTmpPath), "%s%s.nca.tmp", NCA_STORE_PATH, xml_content_info[i].nca_id_str);
+                    remove(ncaStoreTmpPath);
+                    fsdevDeleteDirectoryRecursively(ncaStoreTmpPath);
+                    
+                    breaks = (progressCtx.line_offset + 2);
+                    
+                    proceed = splitWriterOpen(&ncaWriter, ncaStoreTmpPath, xml_content_info[i].size, ((xml_content_info[i].size > FAT32_FILESIZE_LIMIT && isFat32) ? partSize : 0), SPLIT_WRITER_NAMING_DIRECTORY, 0);
+                    if (!proceed)
+                    {
+                        dumping = false;
+                        break;
+                    }
+                    
+                    breaks = (progressCtx.line_offset - 4);
+                }
+                
                 // Reset SHA-256 context if necessary
                 if (!seqDumpMode || (seqDumpMode && i != seqNspCtx.fileIndex)) sha256ContextCreate(&nca_hash_ctx);
                 
@@ -1849,6 +2351,41 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                         }
                     }
                 }
+                
+                // Register all modified data ranges from this NCA
+                patchOverlayReset(&ncaPatchOverlay);
+                
+                proceed = patchOverlayAddRange(&ncaPatchOverlay, 0, xml_content_info[i].encrypted_header_mod, NCA_FULL_HEADER_LENGTH);
+                
+                if (proceed && programModIdx != -1)
+                {
+                    proceed = patchOverlayAddRange(&ncaPatchOverlay, ncaProgramMod[programModIdx].hash_table_offset, ncaProgramMod[programModIdx].hash_table, ncaProgramMod[programModIdx].hash_table_size);
+                    
+                    for(j = 0; proceed && j < ncaProgramMod[programModIdx].block_mod_cnt; j++) proceed = patchOverlayAddRange(&ncaPatchOverlay, ncaProgramMod[programModIdx].block_offset[j], ncaProgramMod[programModIdx].block_data[j], ncaProgramMod[programModIdx].block_size[j]);
+                }
+                
+                if (!proceed)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to register the modified data ranges from NCA \"%s\"!", __func__, xml_content_info[i].nca_id_str);
+                    dumping = false;
+                    break;
+                }
+                
+                // Verify the ExeFS section while the NCA is being dumped
+                // Skipped if a sequential dump session resumes halfway through the NCA, since the hash table and the earlier blocks aren't available anymore
+                if (xml_content_info[i].verify_exefs && !startFileOffset)
+                {
+                    breaks = (progressCtx.line_offset + 2);
+                    
+                    proceed = pfs0VerifyStreamInit(&exeFsVerifyCtx, &(xml_content_info[i].exefs_fs_header), xml_content_info[i].exefs_section_offset, xml_content_info[i].exefs_section_size, xml_content_info[i].decrypted_nca_keys + (NCA_KEY_AREA_KEY_SIZE * 2));
+                    if (!proceed)
+                    {
+                        dumping = false;
+                        break;
+                    }
+                    
+                    breaks = (progressCtx.line_offset - 4);
+                }
             } else {
                 // Patch CNMT NCA
                 breaks = (progressCtx.line_offset + 2);
@@ -1863,7 +2400,27 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                 breaks = (progressCtx.line_offset - 4);
                 
                 // Generate proper CNMT XML
-                generateCnmtXml(&xml_program_info, xml_content_info, cnmtXml);
+                // Its size has already been written to the PFS0 header, so it must have the same length as the placeholder
+                u64 cnmtXmlPlaceholderLen = cnmtXml.len;
+                
+                proceed = generateCnmtXml(&xml_program_info, xml_content_info, &cnmtXml);
+                if (!proceed)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to generate the CNMT XML!", __func__);
+                    dumping = false;
+                    break;
+                }
+                
+                if (cnmtXml.len != cnmtXmlPlaceholderLen)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: CNMT XML length mismatch! (got %lu bytes, expected %lu bytes)", __func__, cnmtXml.len, cnmtXmlPlaceholderLen);
+                    proceed = false;
+                    dumping = false;
+                    break;
+                }
+                
+                // The string builder may have moved its buffer
+                nspPfs0FileSrcs[cnmtXmlSrcIdx].data = (u8*)cnmtXml.str;
                 
                 // Fill PFS0 string table
                 // This is done here because we'll need to display filenames for the rest of the PFS0 entries starting with the next loop iteration
@@ -1923,34 +2480,69 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                 break;
             }
             
-            uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
-            
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
-            
-            if (i < titleContentInfoCnt)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Dumping NCA \"%s\" (%s)...", xml_content_info[i].nca_id_str, getContentType(xml_content_info[i].type));
-            } else {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Writing \"%s\"...", entryFilename);
-            }
-            
-            if (n > (nspPfs0EntryTable[i].file_size - fileOffset)) n = (nspPfs0EntryTable[i].file_size - fileOffset);
-            
-            // Check if the next read chunk will exceed the size of the current part file
-            if (seqDumpMode && (seqDumpSessionOffset + n) >= (((splitIndex - seqNspCtx.partNumber) + 1) * partSize))
+            if (seqDumpCheckpoint)
             {
-                u64 new_file_chunk_size = ((seqDumpSessionOffset + n) - (((splitIndex - seqNspCtx.partNumber) + 1) * partSize));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
+                seqDumpCheckpoint = false;
                 
-                u64 remainderDumpSize = (progressCtx.totalSize - (progressCtx.curOffset + old_file_chunk_size));
-                u64 remainderFreeSize = (freeSpace - (seqDumpSessionOffset + old_file_chunk_size));
+                breaks = (progressCtx.line_offset + 2);
                 
-                // Check if we have enough space for the next part
+                if (!splitWriterFinishPart(&outWriter))
+                {
+                    proceed = false;
+                    break;
+                }
+                
+                breaks = (progressCtx.line_offset - 4);
+                
+                seqNspCtx.partNumber = (outWriter.part_index + 1);
+                seqNspCtx.fileIndex = i;
+                seqNspCtx.fileOffset = fileOffset;
+                
+                if (i < titleContentInfoCnt && i != cnmtNcaIndex)
+                {
+                    memcpy(&(seqNspCtx.hashCtx), &nca_hash_ctx, sizeof(Sha256Context));
+                } else {
+                    memset(&(seqNspCtx.hashCtx), 0, sizeof(Sha256Context));
+                }
+                
+                writeSequentialDumpCheckpoint(seqDumpFilename, outWriter.path, outWriter.part_index, &seqNspCtx, sizeof(sequentialNspCtx), seqDumpNcaHashes, seqNspCtx.ncaCount * SHA256_HASH_SIZE);
+            }
+            
+            uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+            
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(curWriter->path, '/' ) + 1);
+            
+            if (i < titleContentInfoCnt)
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Dumping NCA \"%s\" (%s)...", xml_content_info[i].nca_id_str, getContentType(xml_content_info[i].type));
+            } else {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Writing \"%s\"...", entryFilename);
+            }
+            
+            if (i < (titleContentInfoCnt - 1)) n = chunkTunerGetChunkSize(&chunkTuner);
+            if (n > (nspPfs0EntryTable[i].file_size - fileOffset)) n = (nspPfs0EntryTable[i].file_size - fileOffset);
+            
+            // Check if the next read chunk will exceed the size of the current part file
+            if (seqDumpMode && (seqDumpSessionOffset + n) >= (((seqDumpSessionOffset / partSize) + 1) * partSize))
+            {
+                u64 new_file_chunk_size = ((seqDumpSessionOffset + n) - (((seqDumpSessionOffset / partSize) + 1) * partSize));
+                u64 old_file_chunk_size = (n - new_file_chunk_size);
+                
+                u64 remainderDumpSize = (progressCtx.totalSize - (progressCtx.curOffset + old_file_chunk_size));
+                u64 remainderFreeSize = (freeSpace - (seqDumpSessionOffset + old_file_chunk_size));
+                
+                // Check if we have enough space for the next part
                 // If so, set the chunk size to old_file_chunk_size
                 if ((remainderDumpSize <= partSize && remainderDumpSize > remainderFreeSize) || (remainderDumpSize > partSize && partSize > remainderFreeSize))
                 {
                     n = old_file_chunk_size;
                     seqDumpFinish = true;
+                } else
+                if (remainderDumpSize && !((outWriter.first_part + (u32)(seqDumpSessionOffset / partSize) + 1) % SEQ_DUMP_CHECKPOINT_PART_INTERVAL))
+                {
+                    // Stop at the end of the current part, so a checkpoint can be taken before the next one is created
+                    n = old_file_chunk_size;
+                    seqDumpCheckpoint = true;
                 }
             }
             
@@ -1958,6 +2550,8 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
             {
                 breaks = (progressCtx.line_offset + 2);
                 
+                chunkStartTick = armGetSystemTick();
+                
                 proceed = readNcaDataByContentId(&ncmStorage, &ncaId, fileOffset, dumpBuf, n);
                 if (!proceed)
                 {
@@ -1969,127 +2563,68 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
                 
                 breaks = (progressCtx.line_offset - 4);
                 
-                // Replace NCA header with our modified one
-                if (fileOffset < NCA_FULL_HEADER_LENGTH)
-                {
-                    u64 write_size = (NCA_FULL_HEADER_LENGTH - fileOffset);
-                    if (write_size > n) write_size = n;
-                    
-                    memcpy(dumpBuf, xml_content_info[i].encrypted_header_mod + fileOffset, write_size);
-                }
+                // Replace the NCA header and any modified Program NCA data blocks
+                patchOverlayApply(&ncaPatchOverlay, fileOffset, dumpBuf, n);
                 
-                // Replace modified Program NCA data blocks
-                if (programModIdx != -1)
+                // Check the ExeFS hash table and data blocks from the chunk we're about to write
+                if (exeFsVerifyCtx.initialized)
                 {
-                    u64 internal_block_offset;
-                    u64 internal_block_chunk_size;
-                    
-                    u64 buffer_offset;
-                    u64 buffer_chunk_size;
-                    
-                    if ((fileOffset + n) > ncaProgramMod[programModIdx].hash_table_offset && (ncaProgramMod[programModIdx].hash_table_offset + ncaProgramMod[programModIdx].hash_table_size) > fileOffset)
-                    {
-                        internal_block_offset = (fileOffset > ncaProgramMod[programModIdx].hash_table_offset ? (fileOffset - ncaProgramMod[programModIdx].hash_table_offset) : 0);
-                        internal_block_chunk_size = (ncaProgramMod[programModIdx].hash_table_size - internal_block_offset);
-                        
-                        buffer_offset = (fileOffset > ncaProgramMod[programModIdx].hash_table_offset ? 0 : (ncaProgramMod[programModIdx].hash_table_offset - fileOffset));
-                        buffer_chunk_size = ((n - buffer_offset) > internal_block_chunk_size ? internal_block_chunk_size : (n - buffer_offset));
-                        
-                        memcpy(dumpBuf + buffer_offset, ncaProgramMod[programModIdx].hash_table + internal_block_offset, buffer_chunk_size);
-                    }
+                    breaks = (progressCtx.line_offset + 2);
                     
-                    if ((fileOffset + n) > ncaProgramMod[programModIdx].block_offset[0] && (ncaProgramMod[programModIdx].block_offset[0] + ncaProgramMod[programModIdx].block_size[0]) > fileOffset)
+                    proceed = pfs0VerifyStreamUpdate(&exeFsVerifyCtx, fileOffset, dumpBuf, n);
+                    if (!proceed)
                     {
-                        internal_block_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[0] ? (fileOffset - ncaProgramMod[programModIdx].block_offset[0]) : 0);
-                        internal_block_chunk_size = (ncaProgramMod[programModIdx].block_size[0] - internal_block_offset);
-                        
-                        buffer_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[0] ? 0 : (ncaProgramMod[programModIdx].block_offset[0] - fileOffset));
-                        buffer_chunk_size = ((n - buffer_offset) > internal_block_chunk_size ? internal_block_chunk_size : (n - buffer_offset));
-                        
-                        memcpy(dumpBuf + buffer_offset, ncaProgramMod[programModIdx].block_data[0] + internal_block_offset, buffer_chunk_size);
+                        dumping = false;
+                        break;
                     }
                     
-                    if (ncaProgramMod[programModIdx].block_mod_cnt == 2 && (fileOffset + n) > ncaProgramMod[programModIdx].block_offset[1] && (ncaProgramMod[programModIdx].block_offset[1] + ncaProgramMod[programModIdx].block_size[1]) > fileOffset)
-                    {
-                        internal_block_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[1] ? (fileOffset - ncaProgramMod[programModIdx].block_offset[1]) : 0);
-                        internal_block_chunk_size = (ncaProgramMod[programModIdx].block_size[1] - internal_block_offset);
-                        
-                        buffer_offset = (fileOffset > ncaProgramMod[programModIdx].block_offset[1] ? 0 : (ncaProgramMod[programModIdx].block_offset[1] - fileOffset));
-                        buffer_chunk_size = ((n - buffer_offset) > internal_block_chunk_size ? internal_block_chunk_size : (n - buffer_offset));
-                        
-                        memcpy(dumpBuf + buffer_offset, ncaProgramMod[programModIdx].block_data[1] + internal_block_offset, buffer_chunk_size);
-                    }
+                    breaks = (progressCtx.line_offset - 4);
                 }
                 
                 // Update SHA-256 calculation
                 sha256ContextUpdate(&nca_hash_ctx, dumpBuf, n);
             } else {
-                // Copy data using pointer array
+                // Copy data using the source array
                 u32 ptrIdx = (i - (titleContentInfoCnt - 1));
-                memcpy(dumpBuf, nspPfs0FilePtrs[ptrIdx] + fileOffset, n);
-            }
-            
-            if ((seqDumpMode || (!seqDumpMode && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)) && (progressCtx.curOffset + n) >= ((splitIndex + 1) * partSize))
-            {
-                u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * partSize));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
-                
-                if (old_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                    if (write_res != old_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
-                        proceed = false;
-                        break;
-                    }
-                }
                 
-                fclose(outFile);
-                outFile = NULL;
-                
-                if (((seqDumpMode && !seqDumpFinish) || !seqDumpMode) && (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize))
+                if (nspPfs0FileSrcs[ptrIdx].data)
                 {
-                    splitIndex++;
-                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp%c%02u", NSP_DUMP_PATH, dumpName, (seqDumpMode ? '.' : '/'), splitIndex);
+                    memcpy(dumpBuf, nspPfs0FileSrcs[ptrIdx].data + fileOffset, n);
+                } else {
+                    breaks = (progressCtx.line_offset + 2);
                     
-                    outFile = fopen(dumpPath, "wb");
-                    if (!outFile)
+                    proceed = readNcaRomFsFileRef(&ncmStorage, nspPfs0FileSrcs[ptrIdx].ref, fileOffset, dumpBuf, n);
+                    if (!proceed)
                     {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                        proceed = false;
+                        dumping = false;
                         break;
                     }
                     
-                    if (new_file_chunk_size > 0)
-                    {
-                        write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                        if (write_res != new_file_chunk_size)
-                        {
-                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                            proceed = false;
-                            break;
-                        }
-                    }
+                    breaks = (progressCtx.line_offset - 4);
                 }
-            } else {
-                write_res = fwrite(dumpBuf, 1, n, outFile);
-                if (write_res != n)
+            }
+            
+            breaks = (progressCtx.line_offset + 2);
+            
+            if (!splitWriterWrite(curWriter, dumpBuf, n))
+            {
+                // Each NCA gets its own writer in NCA store mode, so the output size has to be taken from the writer itself
+                if (!curWriter->part_size && (curWriter->offset + n) > FAT32_FILESIZE_LIMIT)
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                    
-                    if (!seqDumpMode && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable the \"Split output dump\" option.");
-                        fat32_error = true;
-                    }
-                    
-                    proceed = false;
-                    break;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable the \"Split output dump\" option.");
+                    fat32_error = true;
                 }
+                
+                proceed = false;
+                break;
             }
             
+            breaks = (progressCtx.line_offset - 4);
+            
+            if (i < (titleContentInfoCnt - 1) && chunkTunerUpdate(&chunkTuner, n, armTicksToNs(armGetSystemTick() - chunkStartTick))) dumpCfg.chunkSizeCfg.chunkSize[chunkSource] = chunkTunerGetChunkSize(&chunkTuner);
+            
             if (seqDumpMode) progressCtx.seqDumpCurOffset = seqDumpSessionOffset;
+            if (batch) printBatchStoreWorkerStatus();
             printProgressBar(&progressCtx, true, n);
             
             if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
@@ -2108,7 +2643,7 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         {
             uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
             
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(curWriter->path, '/' ) + 1);
             
             if (i < titleContentInfoCnt)
             {
@@ -2120,6 +2655,17 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
             printProgressBar(&progressCtx, false, 0);
         }
         
+        if (exeFsVerifyCtx.initialized)
+        {
+            breaks = (progressCtx.line_offset + 2);
+            
+            proceed = pfs0VerifyStreamFinish(&exeFsVerifyCtx);
+            pfs0VerifyClose(&exeFsVerifyCtx);
+            if (!proceed) break;
+            
+            breaks = (progressCtx.line_offset - 4);
+        }
+        
         // Check if we're not dealing with the CNMT NCA
         if (i < (titleContentInfoCnt - 1))
         {
@@ -2131,6 +2677,30 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
             
             // If we're doing a sequential dump and we just finished dumping a NCA, copy its calculated hash
             if (seqDumpMode) memcpy(seqDumpNcaHashes + (i * SHA256_HASH_SIZE), xml_content_info[i].hash, SHA256_HASH_SIZE);
+            
+            // Move the NCA into the NCA store now that its content ID is known
+            if (useNcaStore)
+            {
+                breaks = (progressCtx.line_offset + 2);
+                
+                proceed = splitWriterClose(&ncaWriter);
+                splitWriterAbort(&ncaWriter);
+                
+                if (proceed)
+                {
+                    if (ncaWriter.part_size) fsdevSetConcatenationFileAttribute(ncaStoreTmpPath);
+                    
+                    proceed = ncaStoreAdd(ncaStoreTmpPath, xml_content_info[i].hash, xml_content_info[i].size, ncaWriter.part_size);
+                    if (!proceed) uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to move NCA \"%s\" into the NCA store!", __func__, xml_content_info[i].nca_id_str);
+                }
+                
+                if (!proceed) break;
+                
+                breaks = (progressCtx.line_offset - 4);
+                
+                ncaStorePartSizes[i] = ncaWriter.part_size;
+                memset(&ncaWriter, 0, sizeof(split_writer_ctx_t));
+            }
         }
     }
     
@@ -2147,7 +2717,7 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     
     uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
     
-    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/' ) + 1);
     
     uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Writing PFS0 header...");
     
@@ -2158,6 +2728,9 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     memcpy(dumpBuf + sizeof(pfs0_header), nspPfs0EntryTable, (u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry));
     memcpy(dumpBuf + sizeof(pfs0_header) + ((u64)nspPfs0Header.file_cnt * sizeof(pfs0_file_entry)), nspPfs0StrTable, nspPfs0Header.str_table_size);
     
+    // Recorded in the dump index, so the output can be identified without reading it back
+    sha256CalculateHash(fullPfs0HeaderHash, dumpBuf, fullPfs0HeaderSize);
+    
     if (seqDumpMode)
     {
         // Just in case
@@ -2199,32 +2772,29 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
         // Update free space
         freeSpace -= fullPfs0HeaderSize;
     } else {
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+        breaks = (progressCtx.line_offset + 2);
+        
+        if (useNcaStore)
         {
-            if (outFile)
+            // Save the PFS0 header along with the list of files that make up the full NSP
+            if (!writeNcaStoreNspFiles(pfs0HeaderFilename, ncaStoreListFilename, dumpPath, dumpBuf, fullPfs0HeaderSize, xml_content_info, titleContentInfoCnt, ncaStorePartSizes))
             {
-                fclose(outFile);
-                outFile = NULL;
+                setProgressBarError(&progressCtx);
+                goto out;
             }
-            
-            snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp/%02u", NSP_DUMP_PATH, dumpName, 0);
-            
-            outFile = fopen(dumpPath, "rb+");
-            if (!outFile)
+        } else {
+            // Replace the placeholder zeroes from the first part
+            if (!splitWriterRewrite(&outWriter, 0, dumpBuf, fullPfs0HeaderSize))
             {
                 setProgressBarError(&progressCtx);
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to re-open output file for part #0!", __func__);
                 goto out;
             }
-        } else {
-            rewind(outFile);
         }
         
-        write_res = fwrite(dumpBuf, 1, fullPfs0HeaderSize, outFile);
-        if (write_res != fullPfs0HeaderSize)
+        // Flush the last part before setting the archive bit
+        if (!splitWriterClose(&outWriter))
         {
             setProgressBarError(&progressCtx);
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes PFS0 header to file offset 0x%016lX! (wrote %lu bytes)", __func__, fullPfs0HeaderSize, (u64)0, write_res);
             goto out;
         }
     }
@@ -2244,9 +2814,8 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     }
     
     // Set archive bit (only for FAT32)
-    if (!seqDumpMode && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+    if (!seqDumpMode && !useNcaStore && progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
     {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
         result = fsdevSetConcatenationFileAttribute(dumpPath);
         if (R_FAILED(result)) 
         {
@@ -2256,7 +2825,35 @@ int dumpNintendoSubmissionPackage(nspDumpType selectedNspDumpType, u32 titleInde
     }
     
 out:
-    if (outFile) fclose(outFile);
+    pfs0VerifyClose(&exeFsVerifyCtx);
+    
+    // Only sequential dumps reach this point with the last part still opened
+    if (ret >= 0 && outWriter.outFile)
+    {
+        breaks = (progressCtx.line_offset + 2);
+        
+        if (!splitWriterClose(&outWriter))
+        {
+            setProgressBarError(&progressCtx);
+            seqDumpFileRemove = true;
+            dumping = false;
+            ret = -1;
+        }
+    }
+    
+    splitWriterAbort(&outWriter);
+    splitWriterAbort(&ncaWriter);
+    
+    // Read back all parts written during this session
+    if (ret >= 0 && verifyOutput && outWriter.verify && !splitWriterVerify(&outWriter, dumpBuf, dumpBufSize))
+    {
+        setProgressBarError(&progressCtx);
+        if (seqDumpMode) seqDumpFileRemove = true;
+        dumping = false;
+        ret = -1;
+    }
+    
+    splitWriterFreeVerification(&outWriter);
     
     if (ret >= 0)
     {
@@ -2268,7 +2865,7 @@ out:
                 breaks = (progressCtx.line_offset + 2);
                 
                 // Update the sequence reference file
-                seqNspCtx.partNumber = (splitIndex + 1);
+                seqNspCtx.partNumber = (outWriter.part_index + 1);
                 seqNspCtx.fileIndex = startFileIndex;
                 seqNspCtx.fileOffset = fileOffset;
                 
@@ -2304,6 +2901,21 @@ out:
             }
         }
         
+        // Record the completed dump
+        if (ret >= 0 && (!seqDumpMode || !seqDumpFinish))
+        {
+            u8 indexFlags = 0;
+            
+            if (removeConsoleData) indexFlags |= DUMP_INDEX_FLAG_REMOVE_CONSOLE_DATA;
+            if (tiklessDump) indexFlags |= DUMP_INDEX_FLAG_TIKLESS_DUMP;
+            if (npdmAcidRsaPatch) indexFlags |= DUMP_INDEX_FLAG_NPDM_ACID_RSA_PATCH;
+            if (dumpDeltaFragments) indexFlags |= DUMP_INDEX_FLAG_DELTA_FRAGMENTS;
+            if (outputConsoleData) indexFlags |= DUMP_INDEX_FLAG_CONSOLE_DATA;
+            if (useNcaStore) indexFlags |= DUMP_INDEX_FLAG_NCA_STORE;
+            
+            if (dumpIndexRecordNspTitle(selectedNspDumpType, titleIndex, indexFlags, fullPfs0HeaderHash, progressCtx.totalSize)) dumpIndexSave();
+        }
+        
         if (ret >= 0 && !batch)
         {
             timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
@@ -2378,33 +2990,35 @@ out:
         
         if (removeFile)
         {
-            if (seqDumpMode)
+            // Parts from previous sequential dump sessions are removed as well
+            if (seqDumpMode) outWriter.first_part = 0;
+            splitWriterDelete(&outWriter);
+            
+            // NCAs that were already moved into the NCA store are kept
+            if (useNcaStore)
             {
-                for(u8 i = 0; i <= splitIndex; i++)
-                {
-                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp.%02u", NSP_DUMP_PATH, dumpName, i);
-                    remove(dumpPath);
-                }
-            } else {
-                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-                
-                if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
-                {
-                    fsdevDeleteDirectoryRecursively(dumpPath);
-                } else {
-                    remove(dumpPath);
-                }
+                splitWriterDelete(&ncaWriter);
+                remove(pfs0HeaderFilename);
+                remove(ncaStoreListFilename);
             }
         }
     }
     
-    if (nspPfs0FilePtrs) free(nspPfs0FilePtrs);
+    if (useNcaStore)
+    {
+        ncaStoreSave();
+        if (ncaStorePartSizes) free(ncaStorePartSizes);
+    }
+    
+    if (nspPfs0FileSrcs) free(nspPfs0FileSrcs);
     
     if (nspPfs0StrTable) free(nspPfs0StrTable);
     
     if (nspPfs0EntryTable) free(nspPfs0EntryTable);
     
-    if (cnmtXml) free(cnmtXml);
+    strBuilderFree(&cnmtXml);
+    
+    patchOverlayFree(&ncaPatchOverlay);
     
     if (cnmtNcaBuf) free(cnmtNcaBuf);
     
@@ -2426,6 +3040,7 @@ out:
         {
             if (xml_records[i].xml_data) free(xml_records[i].xml_data);
             if (xml_records[i].nacp_icons) free(xml_records[i].nacp_icons);
+            if (xml_records[i].nacp_icon_data) free(xml_records[i].nacp_icon_data);
         }
         
         free(xml_records);
@@ -2437,14 +3052,21 @@ out:
     
     if (curStorageId == NcmStorageId_GameCard) closeGameCardStoragePartition();
     
+    setNcaMemoryData(NULL, NULL, 0);
+    
     if (titleContentInfos) free(titleContentInfos);
     
+    titlePrefetchFreeData(&prefetchData);
+    
     if (seqDumpNcaHashes) free(seqDumpNcaHashes);
     
     if (seqDumpFile) fclose(seqDumpFile);
     
     if (seqDumpFileRemove) remove(seqDumpFilename);
     
+    // Checkpoints are only needed if the session doesn't get to this point
+    if (seqDumpMode || seqDumpFileRemove) removeSequentialDumpCheckpoint(seqDumpFilename);
+    
     if (dumpName) free(dumpName);
     
     if (!batch) changeHomeButtonBlockStatus(false);
@@ -2460,91 +3082,377 @@ int batchEntryCmp(const void *a, const void *b)
 	return strcasecmp(batchEntry1->nspFilename, batchEntry2->nspFilename);
 }
 
-int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
+static dumpSourceType getNspTitleDumpSource(nspDumpType selectedNspDumpType, u32 titleIndex)
 {
-    int ret = -1;
+    NcmStorageId storageId = NcmStorageId_None;
+    NcmContentMetaType metaType = NcmContentMetaType_Unknown;
+    u32 ncmTitleIndex = 0, titleCount = 0;
     
-    if (!batchDumpCfg)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid batch dump configuration struct!", __func__);
-        breaks += 2;
-        return ret;
-    }
+    getNspTitleNcmInfo(selectedNspDumpType, titleIndex, &storageId, &metaType, &ncmTitleIndex, &titleCount);
     
-    bool dumpAppTitles = batchDumpCfg->dumpAppTitles;
-    bool dumpPatchTitles = batchDumpCfg->dumpPatchTitles;
-    bool dumpAddOnTitles = batchDumpCfg->dumpAddOnTitles;
-    bool isFat32 = batchDumpCfg->isFat32;
-    bool removeConsoleData = batchDumpCfg->removeConsoleData;
-    bool tiklessDump = batchDumpCfg->tiklessDump;
-    bool npdmAcidRsaPatch = batchDumpCfg->npdmAcidRsaPatch;
-    bool dumpDeltaFragments = batchDumpCfg->dumpDeltaFragments;
-    bool skipDumpedTitles = batchDumpCfg->skipDumpedTitles;
-    bool rememberDumpedTitles = batchDumpCfg->rememberDumpedTitles;
-    bool haltOnErrors = batchDumpCfg->haltOnErrors;
-    bool useBrackets = batchDumpCfg->useBrackets;
-    batchModeSourceStorage batchModeSrc = batchDumpCfg->batchModeSrc;
+    return (storageId == NcmStorageId_GameCard ? DUMP_SOURCE_GAMECARD : (storageId == NcmStorageId_SdCard ? DUMP_SOURCE_SDCARD : DUMP_SOURCE_EMMC));
+}
+
+// Starts copying the NCAs from the last pending batch entry located at the other storage (SD card or eMMC) into the NCA store
+// Picking the last one keeps the worker as far ahead of the UI thread as possible
+static void startBatchStoreWorker(batchEntry *batchEntries, u32 totalTitleCount, u32 curEntryIndex, bool isFat32, bool npdmAcidRsaPatch, bool dumpDeltaFragments)
+{
+    NcmStorageId curStorageId = NcmStorageId_None, storageId = NcmStorageId_None;
+    NcmContentMetaType metaType = NcmContentMetaType_Unknown;
+    u32 k, ncmTitleIndex = 0, titleCount = 0;
     
-    if ((!dumpAppTitles && !dumpPatchTitles && !dumpAddOnTitles) || (batchModeSrc == BATCH_SOURCE_ALL && ((dumpAppTitles && !titleAppCount) || (dumpPatchTitles && !titlePatchCount) || (dumpAddOnTitles && !titleAddOnCount))) || (batchModeSrc == BATCH_SOURCE_SDCARD && ((dumpAppTitles && !sdCardTitleAppCount) || (dumpPatchTitles && !sdCardTitlePatchCount) || (dumpAddOnTitles && !sdCardTitleAddOnCount))) || (batchModeSrc == BATCH_SOURCE_EMMC && ((dumpAppTitles && !emmcTitleAppCount) || (dumpPatchTitles && !emmcTitlePatchCount) || (dumpAddOnTitles && !emmcTitleAddOnCount))) || batchModeSrc >= BATCH_SOURCE_CNT)
+    getNspTitleNcmInfo(batchEntries[curEntryIndex].titleType, batchEntries[curEntryIndex].titleIndex, &curStorageId, &metaType, &ncmTitleIndex, &titleCount);
+    if (curStorageId != NcmStorageId_SdCard && curStorageId != NcmStorageId_BuiltInUser) return;
+    
+    for(k = (totalTitleCount - 1); k > curEntryIndex; k--)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to perform batch NSP dump!", __func__);
-        breaks += 2;
-        return ret;
+        if (!batchEntries[k].enabled || batchEntries[k].backgroundCopied) continue;
+        
+        getNspTitleNcmInfo(batchEntries[k].titleType, batchEntries[k].titleIndex, &storageId, &metaType, &ncmTitleIndex, &titleCount);
+        if ((storageId != NcmStorageId_SdCard && storageId != NcmStorageId_BuiltInUser) || storageId == curStorageId) continue;
+        
+        if (!storeWorkerStart(&batchStoreWorker, k, storageId, metaType, titleCount, ncmTitleIndex, isFat32, npdmAcidRsaPatch, !dumpDeltaFragments)) return;
+        
+        batchEntries[k].backgroundCopied = true;
+        snprintf(batchStoreWorkerTitle, MAX_CHARACTERS(batchStoreWorkerTitle), "%.*s", (int)strlen(batchEntries[k].nspFilename) - 4, batchEntries[k].nspFilename);
+        
+        break;
     }
+}
+
+// Calculates how much data from a batch entry is already available in the NCA store, and therefore won't be written again
+// Only NCAs that are guaranteed to be left untouched at dump time are considered: Meta NCAs are always regenerated, Program NCAs may be patched, gamecard NCAs get their distribution type changed and NCAs with a populated Rights ID field may be modified for ticketless dumps
+static u64 getBatchEntryStoredSize(batchEntry *entry, nspOptions *nspDumpCfg)
+{
+    NcmStorageId storageId = NcmStorageId_None;
+    NcmContentMetaType metaType = NcmContentMetaType_Unknown;
+    u32 i, ncmTitleIndex = 0, titleCount = 0, contentInfoCnt = 0;
+    NcmContentInfo *contentInfos = NULL;
+    u64 ncaSize, storedSize = 0;
+    char errorStr[256] = {'\0'};
     
-    u32 i, j;
-    
-    u32 totalTitleCount = 0, totalAppCount = 0, totalPatchCount = 0, totalAddOnCount = 0;
-    
-    u32 titleCount = 0, titleIndex = 0;
-    
-    char *dumpName = NULL;
-    char summary_str[128] = {'\0'};
-    
-    int initial_breaks = breaks, cur_breaks;
+    if (!nspDumpCfg->useNcaStore || (nspDumpCfg->removeConsoleData && nspDumpCfg->tiklessDump)) return 0;
     
-    const u32 maxSummaryFileCount = 8;
-    u32 summaryPage = 0, selectedSummaryEntry = 0;
-    u32 xpos = 0, ypos = 0;
-    u64 keysDown = 0, keysHeld = 0;
+    getNspTitleNcmInfo(entry->titleType, entry->titleIndex, &storageId, &metaType, &ncmTitleIndex, &titleCount);
+    if (storageId != NcmStorageId_SdCard && storageId != NcmStorageId_BuiltInUser) return 0;
     
-    u32 maxEntryCount = 0, batchEntryIndex = 0, disabledEntryCount = 0;
-    batchEntry *batchEntries = NULL, *tmpBatchEntries = NULL;
+    // Errors aren't reported: the entry is just planned with its full size
+    if (!retrieveContentInfosFromTitleEx(storageId, metaType, titleCount, ncmTitleIndex, &contentInfos, &contentInfoCnt, errorStr, MAX_CHARACTERS(errorStr))) return 0;
     
-    bool proceed = true;
+    for(i = 0; i < contentInfoCnt; i++)
+    {
+        // Delta fragments aren't part of the content size
+        if (contentInfos[i].content_type == NcmContentType_Meta || contentInfos[i].content_type >= NcmContentType_DeltaFragment) continue;
+        if (contentInfos[i].content_type == NcmContentType_Program && nspDumpCfg->npdmAcidRsaPatch) continue;
+        
+        convertNcaSizeToU64(contentInfos[i].size, &ncaSize);
+        if (ncaStoreLookup(contentInfos[i].content_id.c, ncaSize, NULL, NULL)) storedSize += ncaSize;
+    }
     
-    // Generate NSP configuration struct
-    nspOptions nspDumpCfg;
+    free(contentInfos);
     
-    nspDumpCfg.isFat32 = isFat32;
-    nspDumpCfg.useNoIntroLookup = false;
-    nspDumpCfg.removeConsoleData = removeConsoleData;
-    nspDumpCfg.tiklessDump = tiklessDump;
-    nspDumpCfg.npdmAcidRsaPatch = npdmAcidRsaPatch;
-    nspDumpCfg.dumpDeltaFragments = dumpDeltaFragments;
-    nspDumpCfg.useBrackets = useBrackets;
+    return (storedSize < entry->contentSize ? storedSize : entry->contentSize);
+}
+
+// Reorders the enabled batch entries so the largest possible number of titles can be completed with the available free space, disabling the ones that don't fit
+// NCAs already available in the NCA store don't take any additional space, so they're subtracted from each title if the store is being used
+// Displays the resulting plan along with a time estimate based on previous batch dumps, and asks the user for confirmation
+static bool planBatchDump(batchEntry *batchEntries, u32 totalTitleCount, nspOptions *nspDumpCfg)
+{
+    u32 i, j, itemCnt = 0, fitCnt = 0, deferredCnt = 0;
+    u32 sourceTitleCnt[DUMP_SOURCE_CNT] = {0};
+    u64 plannedSize = 0, deferredSize = 0, storedSize = 0, estimate = 0, sourceEstimate = 0;
+    u64 sourceSize[DUMP_SOURCE_CNT] = {0};
+    char plannedSizeStr[32] = {'\0'}, deferredSizeStr[32] = {'\0'}, storedSizeStr[32] = {'\0'}, estimateStr[32] = {'\0'};
+    bool estimateAvailable = true, success = false;
+    batchTimingStats stats;
+    dumpSourceType source;
     
-    // Allocate memory for the batch entries
-    if (dumpAppTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titleAppCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAppCount : emmcTitleAppCount));
-    if (dumpPatchTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titlePatchCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitlePatchCount : emmcTitlePatchCount));
-    if (dumpAddOnTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titleAddOnCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAddOnCount : emmcTitleAddOnCount));
+    batch_plan_item_t *items = calloc(totalTitleCount, sizeof(batch_plan_item_t));
+    batchEntry *plannedEntries = calloc(totalTitleCount, sizeof(batchEntry));
     
-    batchEntries = calloc(maxEntryCount, sizeof(batchEntry));
-    if (!batchEntries)
+    if (!items || !plannedEntries)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for batch entries!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the batch plan!", __func__);
         breaks += 2;
-        return ret;
+        goto out;
     }
     
-    for(i = 0; i < 3; i++)
+    if (nspDumpCfg->useNcaStore)
     {
-        if ((i == 0 && !dumpAppTitles) || (i == 1 && !dumpPatchTitles) || (i == 2 && !dumpAddOnTitles)) continue;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Looking up the selected titles in the NCA store, please wait...");
+        uiRefreshDisplay();
+    }
+    
+    for(i = 0; i < totalTitleCount; i++)
+    {
+        if (!batchEntries[i].enabled) continue;
         
-        u32 emmcRefTitleCount = 0;
-        nspDumpType curNspDumpType = DUMP_APP_NSP;
+        items[itemCnt].index = i;
+        items[itemCnt].size = batchEntries[i].contentSize;
         
-        switch(i)
+        if (nspDumpCfg->useNcaStore)
+        {
+            u64 entryStoredSize = getBatchEntryStoredSize(&(batchEntries[i]), nspDumpCfg);
+            items[itemCnt].size -= entryStoredSize;
+            storedSize += entryStoredSize;
+        }
+        
+        itemCnt++;
+    }
+    
+    if (nspDumpCfg->useNcaStore)
+    {
+        uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, LINE_HEIGHT, BG_COLOR_RGB);
+        uiRefreshDisplay();
+    }
+    
+    fitCnt = batchPlanCreate(items, itemCnt, freeSpace, &plannedSize);
+    deferredCnt = (itemCnt - fitCnt);
+    
+    if (!fitCnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Not enough free space to dump any of the selected titles!");
+        breaks += 2;
+        goto out;
+    }
+    
+    // Titles planned for this session go first, followed by the ones that don't fit (disabled for this session) and the entries disabled by the user
+    for(i = 0; i < itemCnt; i++)
+    {
+        memcpy(&(plannedEntries[i]), &(batchEntries[items[i].index]), sizeof(batchEntry));
+        
+        if (items[i].fits)
+        {
+            source = getNspTitleDumpSource(plannedEntries[i].titleType, plannedEntries[i].titleIndex);
+            sourceSize[source] += plannedEntries[i].contentSize;
+            sourceTitleCnt[source]++;
+        } else {
+            plannedEntries[i].enabled = false;
+            deferredSize += items[i].size;
+        }
+    }
+    
+    for(i = 0, j = itemCnt; i < totalTitleCount; i++)
+    {
+        if (!batchEntries[i].enabled) memcpy(&(plannedEntries[j++]), &(batchEntries[i]), sizeof(batchEntry));
+    }
+    
+    memcpy(batchEntries, plannedEntries, totalTitleCount * sizeof(batchEntry));
+    
+    // Each storage has its own throughput and per-title setup time
+    for(i = 0; i < DUMP_SOURCE_CNT; i++)
+    {
+        if (!sourceTitleCnt[i]) continue;
+        
+        stats = dumpCfg.batchTimingCfg.stats[i];
+        
+        if (!batchPlanEstimateTime(&stats, sourceSize[i], sourceTitleCnt[i], &sourceEstimate))
+        {
+            estimateAvailable = false;
+            break;
+        }
+        
+        estimate += sourceEstimate;
+    }
+    
+    convertSize(plannedSize, plannedSizeStr, MAX_CHARACTERS(plannedSizeStr));
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Batch plan: %u out of %u selected title(s) fit in the available free space (%s needed, %s free).", fitCnt, itemCnt, plannedSizeStr, freeSpaceStr);
+    breaks++;
+    
+    if (deferredCnt)
+    {
+        convertSize(deferredSize, deferredSizeStr, MAX_CHARACTERS(deferredSizeStr));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%u title(s) (%s) won't be dumped in this session. They'll still be available in the next batch dump.", deferredCnt, deferredSizeStr);
+        breaks++;
+    }
+    
+    if (nspDumpCfg->useNcaStore)
+    {
+        convertSize(storedSize, storedSizeStr, MAX_CHARACTERS(storedSizeStr));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%s from the selected titles is already available in the NCA store. NCAs shared by titles from this batch aren't accounted for, so the needed space is a conservative estimate.", storedSizeStr);
+        breaks++;
+    }
+    
+    if (estimateAvailable)
+    {
+        formatETAString(estimate, estimateStr, MAX_CHARACTERS(estimateStr));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Estimated dump time: %s (based on previous batch dumps).", estimateStr);
+    } else {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Estimated dump time: unavailable (no batch dump has been completed from this storage yet).");
+    }
+    
+    breaks += 2;
+    
+    success = yesNoPrompt("Do you want to proceed with the batch dump process?");
+    if (!success)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+        breaks += 2;
+    }
+    
+out:
+    if (plannedEntries) free(plannedEntries);
+    
+    if (items) free(items);
+    
+    return success;
+}
+
+// Records NSPs and batch override files created before the dump index existed, looking for both output naming schemes
+// Their console data status isn't checked here, since that would require parsing every NSP
+static void importLegacyDumpedTitles()
+{
+    u32 i, j, k, titleCount;
+    nspDumpType curNspDumpType;
+    char *dumpName = NULL;
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    bool dumped, remembered;
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Importing existing NSP dumps into the dump index, please wait...");
+    uiRefreshDisplay();
+    
+    for(i = 0; i < 3; i++)
+    {
+        curNspDumpType = (i == 0 ? DUMP_APP_NSP : (i == 1 ? DUMP_PATCH_NSP : DUMP_ADDON_NSP));
+        titleCount = (i == 0 ? titleAppCount : (i == 1 ? titlePatchCount : titleAddOnCount));
+        
+        for(j = 0; j < titleCount; j++)
+        {
+            dumped = remembered = false;
+            
+            for(k = 0; k < 2 && !dumped; k++)
+            {
+                dumpName = generateNSPDumpName(curNspDumpType, j, (k == 1));
+                if (!dumpName) continue;
+                
+                // Override files always use the name without brackets
+                if (k == 0)
+                {
+                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", BATCH_OVERRIDES_PATH, dumpName);
+                    remembered = checkIfFileExists(dumpPath);
+                }
+                
+                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
+                dumped = checkIfFileExists(dumpPath);
+                
+                free(dumpName);
+                dumpName = NULL;
+            }
+            
+            if (!dumped && !remembered) continue;
+            
+            if (dumpIndexRecordNspTitle(curNspDumpType, j, DUMP_INDEX_FLAG_IMPORTED, NULL, 0) && remembered) dumpIndexRememberNspTitle(curNspDumpType, j);
+        }
+    }
+    
+    dumpIndexSetLegacyScanDone();
+    dumpIndexSave();
+    
+    uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, LINE_HEIGHT, BG_COLOR_RGB);
+    uiRefreshDisplay();
+}
+
+int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
+{
+    int ret = -1;
+    
+    if (!batchDumpCfg)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid batch dump configuration struct!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    bool dumpAppTitles = batchDumpCfg->dumpAppTitles;
+    bool dumpPatchTitles = batchDumpCfg->dumpPatchTitles;
+    bool dumpAddOnTitles = batchDumpCfg->dumpAddOnTitles;
+    bool isFat32 = batchDumpCfg->isFat32;
+    bool removeConsoleData = batchDumpCfg->removeConsoleData;
+    bool tiklessDump = batchDumpCfg->tiklessDump;
+    bool npdmAcidRsaPatch = batchDumpCfg->npdmAcidRsaPatch;
+    bool dumpDeltaFragments = batchDumpCfg->dumpDeltaFragments;
+    bool skipDumpedTitles = batchDumpCfg->skipDumpedTitles;
+    bool rememberDumpedTitles = batchDumpCfg->rememberDumpedTitles;
+    bool haltOnErrors = batchDumpCfg->haltOnErrors;
+    bool useBrackets = batchDumpCfg->useBrackets;
+    batchModeSourceStorage batchModeSrc = batchDumpCfg->batchModeSrc;
+    
+    if ((!dumpAppTitles && !dumpPatchTitles && !dumpAddOnTitles) || (batchModeSrc == BATCH_SOURCE_ALL && ((dumpAppTitles && !titleAppCount) || (dumpPatchTitles && !titlePatchCount) || (dumpAddOnTitles && !titleAddOnCount))) || (batchModeSrc == BATCH_SOURCE_SDCARD && ((dumpAppTitles && !sdCardTitleAppCount) || (dumpPatchTitles && !sdCardTitlePatchCount) || (dumpAddOnTitles && !sdCardTitleAddOnCount))) || (batchModeSrc == BATCH_SOURCE_EMMC && ((dumpAppTitles && !emmcTitleAppCount) || (dumpPatchTitles && !emmcTitlePatchCount) || (dumpAddOnTitles && !emmcTitleAddOnCount))) || batchModeSrc >= BATCH_SOURCE_CNT)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to perform batch NSP dump!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    u32 i, j, k;
+    
+    u32 totalTitleCount = 0, totalAppCount = 0, totalPatchCount = 0, totalAddOnCount = 0;
+    
+    NcmStorageId nextStorageId = NcmStorageId_None;
+    NcmContentMetaType nextMetaType = NcmContentMetaType_Unknown;
+    u32 nextNcmTitleIndex = 0, nextTitleCount = 0;
+    
+    u64 titleStartTick = 0;
+    dumpSourceType source;
+    
+    u32 titleCount = 0, titleIndex = 0;
+    u8 indexFlags = 0;
+    
+    char *dumpName = NULL;
+    char summary_str[128] = {'\0'};
+    
+    int initial_breaks = breaks, cur_breaks;
+    
+    const u32 maxSummaryFileCount = 8;
+    u32 summaryPage = 0, selectedSummaryEntry = 0;
+    u32 xpos = 0, ypos = 0;
+    u64 keysDown = 0, keysHeld = 0;
+    
+    u32 maxEntryCount = 0, batchEntryIndex = 0, disabledEntryCount = 0;
+    batchEntry *batchEntries = NULL, *tmpBatchEntries = NULL;
+    
+    bool proceed = true, useStoreWorker = false;
+    
+    // Generate NSP configuration struct
+    nspOptions nspDumpCfg;
+    
+    nspDumpCfg.isFat32 = isFat32;
+    nspDumpCfg.useNoIntroLookup = false;
+    nspDumpCfg.removeConsoleData = removeConsoleData;
+    nspDumpCfg.tiklessDump = tiklessDump;
+    nspDumpCfg.npdmAcidRsaPatch = npdmAcidRsaPatch;
+    nspDumpCfg.dumpDeltaFragments = dumpDeltaFragments;
+    nspDumpCfg.useBrackets = useBrackets;
+    nspDumpCfg.verifyExeFsHashes = false;
+    nspDumpCfg.verifyOutput = false;
+    nspDumpCfg.useNcaStore = batchDumpCfg->useNcaStore;
+    
+    // Allocate memory for the batch entries
+    if (dumpAppTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titleAppCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAppCount : emmcTitleAppCount));
+    if (dumpPatchTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titlePatchCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitlePatchCount : emmcTitlePatchCount));
+    if (dumpAddOnTitles) maxEntryCount += (batchModeSrc == BATCH_SOURCE_ALL ? titleAddOnCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAddOnCount : emmcTitleAddOnCount));
+    
+    batchEntries = calloc(maxEntryCount, sizeof(batchEntry));
+    if (!batchEntries)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for batch entries!", __func__);
+        breaks += 2;
+        return ret;
+    }
+    
+    // Dumped titles are looked up in the dump index. Dumps made before it existed only need to be imported once
+    if (dumpIndexNeedsLegacyScan()) importLegacyDumpedTitles();
+    
+    for(i = 0; i < 3; i++)
+    {
+        if ((i == 0 && !dumpAppTitles) || (i == 1 && !dumpPatchTitles) || (i == 2 && !dumpAddOnTitles)) continue;
+        
+        u32 emmcRefTitleCount = 0;
+        nspDumpType curNspDumpType = DUMP_APP_NSP;
+        
+        switch(i)
         {
             case 0:
                 titleCount = (batchModeSrc == BATCH_SOURCE_ALL ? titleAppCount : (batchModeSrc == BATCH_SOURCE_SDCARD ? sdCardTitleAppCount : emmcTitleAppCount));
@@ -2569,6 +3477,9 @@ int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
         {
             titleIndex = ((batchModeSrc == BATCH_SOURCE_ALL || batchModeSrc == BATCH_SOURCE_SDCARD) ? j : (j + emmcRefTitleCount));
             
+            // Check if this title has already been dumped. Titles remembered by previous batch dumps are always skipped
+            if (dumpIndexCheckNspTitle(curNspDumpType, titleIndex, &indexFlags, NULL) && (skipDumpedTitles || (indexFlags & DUMP_INDEX_FLAG_REMEMBERED))) continue;
+            
             dumpName = generateNSPDumpName(curNspDumpType, titleIndex, false);
             if (!dumpName)
             {
@@ -2577,42 +3488,12 @@ int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
                 goto out;
             }
             
-            // Check if an override file already exists for this dump
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s.nsp", BATCH_OVERRIDES_PATH, dumpName);
-            
-            if (checkIfFileExists(strbuf))
-            {
-                free(dumpName);
-                dumpName = NULL;
-                continue;
-            }
-            
-            snprintf(batchEntries[batchEntryIndex].nspFilename, MAX_CHARACTERS(batchEntries[batchEntryIndex].nspFilename), strrchr(strbuf, '/') + 1);
+            snprintf(batchEntries[batchEntryIndex].nspFilename, MAX_CHARACTERS(batchEntries[batchEntryIndex].nspFilename), "%s.nsp", dumpName);
             snprintf(batchEntries[batchEntryIndex].truncatedNspFilename, MAX_CHARACTERS(batchEntries[batchEntryIndex].truncatedNspFilename), batchEntries[batchEntryIndex].nspFilename);
             
-            if (useBrackets)
-            {
-                // Generate output name with brackets
-                free(dumpName);
-                dumpName = NULL;
-                
-                dumpName = generateNSPDumpName(curNspDumpType, titleIndex, true);
-                if (!dumpName)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name with brackets!", __func__);
-                    breaks += 2;
-                    goto out;
-                }
-            }
-            
-            // Check if this title has already been dumped
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-            
             free(dumpName);
             dumpName = NULL;
             
-            if (skipDumpedTitles && checkIfFileExists(strbuf)) continue;
-            
             // Save title properties
             batchEntries[batchEntryIndex].enabled = true;
             batchEntries[batchEntryIndex].titleType = curNspDumpType;
@@ -2637,6 +3518,9 @@ int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
         }
     }
     
+    // Entries from removed NSPs may have been dropped from the dump index
+    dumpIndexSave();
+    
     // Calculate total title count
     totalTitleCount = (totalAppCount + totalPatchCount + totalAddOnCount);
     if (!totalTitleCount)
@@ -2921,6 +3805,12 @@ int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
         goto out;
     }
     
+    // Plan this session around the available free space
+    if (!planBatchDump(batchEntries, totalTitleCount, &nspDumpCfg)) goto out;
+    
+    breaks = initial_breaks;
+    uiFill(0, 8 + (breaks * LINE_HEIGHT), FB_WIDTH, FB_HEIGHT - (8 + (breaks * LINE_HEIGHT)), BG_COLOR_RGB);
+    
     // Calculate the disabled entry count
     for(i = 0; i < totalTitleCount; i++)
     {
@@ -2936,6 +3826,10 @@ int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
     
     initial_breaks = breaks;
     
+    // Titles from the SD card and the eMMC are read at the same time using the NCA store: NCAs from a title located at the other storage are copied into it on a background thread
+    // Meta NCAs and any NCAs modified at dump time are still handled by the UI thread. The worker buffer is sized so both buffers fit within STORE_WORKER_MEMORY_LIMIT
+    if (nspDumpCfg.useNcaStore && batchModeSrc == BATCH_SOURCE_ALL && !tiklessDump) useStoreWorker = storeWorkerInit(&batchStoreWorker, dumpBufSize);
+    
     j = 0;
     
     for(i = 0; i < totalTitleCount; i++)
@@ -2952,18 +3846,75 @@ int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Free SD card space: %s (%lu bytes).", freeSpaceStr, freeSpace);
         breaks++;
         
+        if (useStoreWorker)
+        {
+            batchStoreWorkerLine = breaks;
+            breaks++;
+            
+            // Let the worker finish if it's copying this very title, so its NCAs don't get read twice
+            // The cancel button is checked the same way it is while dumping, since this may take as long as dumping the whole title
+            if (storeWorkerIsBusy(&batchStoreWorker) && batchStoreWorker.entry_index == i)
+            {
+                progress_ctx_t waitProgressCtx;
+                memset(&waitProgressCtx, 0, sizeof(progress_ctx_t));
+                
+                while(storeWorkerIsBusy(&batchStoreWorker) && batchStoreWorker.entry_index == i)
+                {
+                    if (cancelProcessCheck(&waitProgressCtx))
+                    {
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                        breaks += 2;
+                        goto out;
+                    }
+                    
+                    printBatchStoreWorkerStatus();
+                    uiRefreshDisplay();
+                    svcSleepThread(100000000);
+                }
+            }
+            
+            if (!storeWorkerIsBusy(&batchStoreWorker))
+            {
+                storeWorkerJoin(&batchStoreWorker);
+                startBatchStoreWorker(batchEntries, totalTitleCount, i, isFat32, npdmAcidRsaPatch, dumpDeltaFragments);
+            }
+            
+            printBatchStoreWorkerStatus();
+        }
+        
         uiRefreshDisplay();
         
+        // Start retrieving metadata from the next title, so it's ready by the time this one has been dumped
+        for(k = (i + 1); k < totalTitleCount && !batchEntries[k].enabled; k++);
+        
+        if (k < totalTitleCount)
+        {
+            getNspTitleNcmInfo(batchEntries[k].titleType, batchEntries[k].titleIndex, &nextStorageId, &nextMetaType, &nextNcmTitleIndex, &nextTitleCount);
+            titlePrefetchStart(&(batchPrefetchCtx[(j + 1) % MAX_ELEMENTS(batchPrefetchCtx)]), nextStorageId, nextMetaType, nextTitleCount, nextNcmTitleIndex);
+        }
+        
         // Dump title
+        titleStartTick = armGetSystemTick();
+        
         int nspRet = dumpNintendoSubmissionPackage(batchEntries[i].titleType, batchEntries[i].titleIndex, &nspDumpCfg, true);
         if (nspRet >= 0)
         {
-            // Create override file if necessary
+            // Update the timing history used to estimate the duration of future batch dumps
+            // Titles partially copied by the NCA store worker would make the estimates too optimistic
+            if (batchEntries[i].contentSize && !batchEntries[i].backgroundCopied)
+            {
+                source = getNspTitleDumpSource(batchEntries[i].titleType, batchEntries[i].titleIndex);
+                
+                batchTimingStats stats = dumpCfg.batchTimingCfg.stats[source];
+                batchPlanAddSample(&stats, batchEntries[i].contentSize, armTicksToNs(armGetSystemTick() - titleStartTick));
+                dumpCfg.batchTimingCfg.stats[source] = stats;
+            }
+            
+            // Keep this title out of future batch dumps even if the output NSP is moved somewhere else
             if (rememberDumpedTitles)
             {
-                snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s%s", BATCH_OVERRIDES_PATH, batchEntries[i].nspFilename);
-                FILE *overrideFile = fopen(strbuf, "wb");
-                if (overrideFile) fclose(overrideFile);
+                dumpIndexRememberNspTitle(batchEntries[i].titleType, batchEntries[i].titleIndex);
+                dumpIndexSave();
             }
         } else {
             // If "Halt dump process on errors" is disabled, just wait a little bit and keep going (unless the process was truly canceled by the user)
@@ -2987,6 +3938,11 @@ int dumpNintendoSubmissionPackageBatch(batchOptions *batchDumpCfg)
     ret = 0;
     
 out:
+    for(i = 0; i < MAX_ELEMENTS(batchPrefetchCtx); i++) titlePrefetchFree(&(batchPrefetchCtx[i]));
+    
+    storeWorkerFree(&batchStoreWorker);
+    batchStoreWorkerLine = -1;
+    
     if (batchEntries) free(batchEntries);
     
     changeHomeButtonBlockStatus(false);
@@ -3008,17 +3964,15 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
     bool success = false, fat32_error = false;
     u64 n = DUMP_BUFFER_SIZE;
     char dumpPath[NAME_BUF_LEN] = {'\0'};
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
+    split_writer_ctx_t outWriter;
     openIStoragePartition storageIndex;
     
+    memset(&outWriter, 0, sizeof(split_writer_ctx_t));
     memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
-    size_t write_res;
-    
     char *dumpName = generateGameCardDumpName(false);
     if (!dumpName)
     {
@@ -3048,12 +4002,9 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
         goto out;
     }
     
-    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting)
-    {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), splitIndex);
-    } else {
-        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition));
-    }
+    if (progressCtx.totalSize <= FAT32_FILESIZE_LIMIT) doSplitting = false;
+    
+    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0%s", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), (doSplitting ? ".00" : ""));
     
     // Check if the dump already exists
     if (checkIfFileExists(dumpPath))
@@ -3079,12 +4030,10 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
         goto out;
     }
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
-        goto out;
-    }
+    // Strip the part index used to look for an existing dump
+    if (doSplitting) dumpPath[strlen(dumpPath) - 3] = '\0';
+    
+    if (!splitWriterOpen(&outWriter, dumpPath, progressCtx.totalSize, (doSplitting ? SPLIT_FILE_GENERIC_PART_SIZE : 0), SPLIT_WRITER_NAMING_DOT_INDEX, 0)) goto out;
     
     // Start dump process
     dumpStartMsg();
@@ -3101,7 +4050,7 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
     {
         uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/' ) + 1);
         
         if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
         
@@ -3112,62 +4061,21 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
             break;
         }
         
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting && (progressCtx.curOffset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
+        breaks = (progressCtx.line_offset + 2);
+        
+        if (!splitWriterWrite(&outWriter, dumpBuf, n))
         {
-            u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-            u64 old_file_chunk_size = (n - new_file_chunk_size);
-            
-            if (old_file_chunk_size > 0)
+            if (!doSplitting && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
             {
-                write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                if (write_res != old_file_chunk_size)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
-                    break;
-                }
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                fat32_error = true;
             }
             
-            fclose(outFile);
-            outFile = NULL;
-            
-            if (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize)
-            {
-                splitIndex++;
-                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), splitIndex);
-                
-                outFile = fopen(dumpPath, "wb");
-                if (!outFile)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                    break;
-                }
-                
-                if (new_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                    if (write_res != new_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                        break;
-                    }
-                }
-            }
-        } else {
-            write_res = fwrite(dumpBuf, 1, n, outFile);
-            if (write_res != n)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                
-                if ((progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                    fat32_error = true;
-                }
-                
-                break;
-            }
+            break;
         }
         
+        breaks = (progressCtx.line_offset - 2);
+        
         printProgressBar(&progressCtx, true, n);
         
         if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
@@ -3177,22 +4085,22 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
         }
     }
     
-    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
+    breaks = (progressCtx.line_offset + 2);
+    
+    if (progressCtx.curOffset >= progressCtx.totalSize && splitWriterClose(&outWriter)) success = true;
     
     // Support empty files
     if (!progressCtx.totalSize)
     {
         uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/' ) + 1);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/' ) + 1);
         
         progressCtx.progress = 100;
         
         printProgressBar(&progressCtx, false, 0);
     }
     
-    breaks = (progressCtx.line_offset + 2);
-    
     if (success)
     {
         timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
@@ -3206,21 +4114,8 @@ bool dumpRawHfs0Partition(u32 partition, bool doSplitting)
     }
     
 out:
-    if (outFile) fclose(outFile);
-    
-    if (!success)
-    {
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && doSplitting)
-        {
-            for(u8 i = 0; i <= splitIndex; i++)
-            {
-                snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s - Partition %u (%s).hfs0.%02u", HFS0_DUMP_PATH, dumpName, partition, GAMECARD_PARTITION_NAME(gameCardInfo.hfs0PartitionCnt, partition), i);
-                remove(dumpPath);
-            }
-        } else {
-            remove(dumpPath);
-        }
-    }
+    splitWriterAbort(&outWriter);
+    if (!success) splitWriterDelete(&outWriter);
     
     closeGameCardStoragePartition();
     
@@ -3251,41 +4146,30 @@ bool copyFileFromHfs0Partition(u32 partition, const char *dest, const char *sour
     
     Result result;
     bool success = false, fat32_error = false;
-    char splitFilename[NAME_BUF_LEN * 3] = {'\0'};
-    size_t destLen = strlen(dest);
-    FILE *outFile = NULL;
-    u64 off, n = DUMP_BUFFER_SIZE;
-    u8 splitIndex = 0;
+    split_writer_ctx_t outWriter;
+    u64 off = 0, n = DUMP_BUFFER_SIZE;
     openIStoragePartition storageIndex = (openIStoragePartition)(HFS0_TO_ISTORAGE_IDX(gameCardInfo.hfs0PartitionCnt, partition) + 1);
     
-    size_t write_res;
-    
+    memset(&outWriter, 0, sizeof(split_writer_ctx_t));
     memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
     
     uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
     
     uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Copying \"%s\"...", source);
     
-    if ((destLen + 1) >= MAX_CHARACTERS(splitFilename))
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: destination path is too long! (%lu bytes)", __func__, destLen);
-        return false;
-    }
+    if (fileSize <= FAT32_FILESIZE_LIMIT) doSplitting = false;
     
-    if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting) snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, splitIndex);
+    breaks = (progressCtx->line_offset + 2);
     
-    outFile = fopen(((fileSize > FAT32_FILESIZE_LIMIT && doSplitting) ? splitFilename : dest), "wb");
-    if (!outFile)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file!", __func__);
-        goto out;
-    }
+    if (!splitWriterOpen(&outWriter, dest, fileSize, (doSplitting ? SPLIT_FILE_GENERIC_PART_SIZE : 0), SPLIT_WRITER_NAMING_DOT_INDEX, 0)) goto out;
+    
+    breaks = (progressCtx->line_offset - 4);
     
     for (off = 0; off < fileSize; off += n, progressCtx->curOffset += n)
     {
         uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", ((fileSize > FAT32_FILESIZE_LIMIT && doSplitting) ? (strrchr(splitFilename, '/') + 1) : (strrchr(dest, '/') + 1)));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/') + 1);
         
         uiRefreshDisplay();
         
@@ -3298,62 +4182,21 @@ bool copyFileFromHfs0Partition(u32 partition, const char *dest, const char *sour
             break;
         }
         
-        if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting && (off + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
+        breaks = (progressCtx->line_offset + 2);
+        
+        if (!splitWriterWrite(&outWriter, dumpBuf, n))
         {
-            u64 new_file_chunk_size = ((off + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-            u64 old_file_chunk_size = (n - new_file_chunk_size);
-            
-            if (old_file_chunk_size > 0)
+            if (!doSplitting && (off + n) > FAT32_FILESIZE_LIMIT)
             {
-                write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                if (write_res != old_file_chunk_size)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, off, splitIndex, write_res);
-                    break;
-                }
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                fat32_error = true;
             }
             
-            fclose(outFile);
-            outFile = NULL;
-            
-            if (new_file_chunk_size > 0 || (off + n) < fileSize)
-            {
-                splitIndex++;
-                snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, splitIndex);
-                
-                outFile = fopen(splitFilename, "wb");
-                if (!outFile)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                    break;
-                }
-                
-                if (new_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                    if (write_res != new_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, off + old_file_chunk_size, splitIndex, write_res);
-                        break;
-                    }
-                }
-            }
-        } else {
-            write_res = fwrite(dumpBuf, 1, n, outFile);
-            if (write_res != n)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, off, write_res);
-                
-                if ((off + n) > FAT32_FILESIZE_LIMIT)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                    fat32_error = true;
-                }
-                
-                break;
-            }
+            break;
         }
         
+        breaks = (progressCtx->line_offset - 4);
+        
         printProgressBar(progressCtx, true, n);
         
         if (((off + n) < fileSize || (progressCtx->curOffset + n) < progressCtx->totalSize) && cancelProcessCheck(progressCtx))
@@ -3363,7 +4206,12 @@ bool copyFileFromHfs0Partition(u32 partition, const char *dest, const char *sour
         }
     }
     
-    if (off >= fileSize) success = true;
+    if (off >= fileSize)
+    {
+        breaks = (progressCtx->line_offset + 2);
+        success = splitWriterClose(&outWriter);
+        breaks = (progressCtx->line_offset - 4);
+    }
     
     // Support empty files
     if (!fileSize)
@@ -3385,21 +4233,8 @@ bool copyFileFromHfs0Partition(u32 partition, const char *dest, const char *sour
     }
     
 out:
-    if (outFile) fclose(outFile);
-    
-    if (!success)
-    {
-        if (fileSize > FAT32_FILESIZE_LIMIT && doSplitting)
-        {
-            for(u8 i = 0; i <= splitIndex; i++)
-            {
-                snprintf(splitFilename, MAX_CHARACTERS(splitFilename), "%s.%02u", dest, i);
-                remove(splitFilename);
-            }
-        } else {
-            remove(dest);
-        }
-    }
+    splitWriterAbort(&outWriter);
+    if (!success) splitWriterDelete(&outWriter);
     
     breaks += 2;
     
@@ -3693,6 +4528,187 @@ out:
     return success;
 }
 
+// 'data_offset' is relative to the start of the ExeFS file data area
+static bool readExeFsFileData(u64 data_offset, void *outBuf, u64 bufSize)
+{
+    if (exeFsVerifyCtx.initialized) return pfs0VerifyReadData(&exeFsVerifyCtx, exeFsContext.exefs_data_offset + data_offset, outBuf, bufSize);
+    
+    return processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + data_offset, outBuf, bufSize, false);
+}
+
+// Returns true if the ExeFS file entry holds a NSO
+static bool readExeFsNsoHeader(u32 fileIndex, nso_header_t *outHeader)
+{
+    if (exeFsContext.exefs_entries[fileIndex].file_size < sizeof(nso_header_t)) return false;
+    
+    if (!readExeFsFileData(exeFsContext.exefs_entries[fileIndex].file_offset, outHeader, sizeof(nso_header_t))) return false;
+    
+    return (__builtin_bswap32(outHeader->magic) == NSO_MAGIC);
+}
+
+// Writes the decompressed image from a NSO in the ExeFS section as "[name].bin", next to the original file
+// 'nsoData' should hold the whole NSO as it was just dumped, so it doesn't have to be read and decrypted again. If it's NULL (e.g. not enough memory to keep a copy), the NSO is read from the NCA once more
+// Segments that couldn't be checked against their hashes are added to 'unverifiedCnt'
+static bool dumpExeFsNsoImage(u32 fileIndex, const char *dumpPath, nso_header_t *nsoHeader, const u8 *nsoData, progress_ctx_t *progressCtx, bool isFat32, u32 *unverifiedCnt)
+{
+    char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[fileIndex].filename_offset);
+    char nsoPath[NAME_BUF_LEN * 2] = {'\0'};
+    
+    u8 i, unverifiedMask = 0;
+    u64 n, offset, imageSize = 0;
+    const u8 *image = NULL;
+    split_writer_ctx_t outWriter;
+    bool proceed = false;
+    
+    memset(&outWriter, 0, sizeof(split_writer_ctx_t));
+    
+    snprintf(nsoPath, MAX_CHARACTERS(nsoPath), "%s/%s.bin", dumpPath, exeFsFilename);
+    removeIllegalCharacters(nsoPath + strlen(dumpPath) + 1);
+    
+    uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Decompressing and verifying \"%s\"...", exeFsFilename);
+    uiRefreshDisplay();
+    
+    breaks = (progressCtx->line_offset + 2);
+    
+    if (nsoData)
+    {
+        proceed = loadNsoBinaryDataFromMemory(nsoData, exeFsContext.exefs_entries[fileIndex].file_size, nsoHeader, &unverifiedMask);
+    } else {
+        proceed = loadNsoBinaryData(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[fileIndex].file_offset, nsoHeader, &unverifiedMask);
+    }
+    
+    if (!proceed) goto out;
+    
+    image = getNsoBinaryImage(&imageSize);
+    
+    // Overlapped segments are written like the rest, but they're reported as unverified
+    for(i = 0; i < NSO_SEGMENT_CNT; i++)
+    {
+        if (unverifiedMask & (1 << i)) (*unverifiedCnt)++;
+    }
+    
+    proceed = splitWriterOpen(&outWriter, nsoPath, imageSize, ((imageSize > FAT32_FILESIZE_LIMIT && isFat32) ? SPLIT_FILE_GENERIC_PART_SIZE : 0), SPLIT_WRITER_NAMING_DIRECTORY, 0);
+    if (!proceed) goto out;
+    
+    uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Writing decompressed \"%s\"...", exeFsFilename);
+    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/') + 1);
+    
+    for(offset = 0; offset < imageSize; offset += n, progressCtx->curOffset += n)
+    {
+        n = ((imageSize - offset) > DUMP_BUFFER_SIZE ? DUMP_BUFFER_SIZE : (imageSize - offset));
+        
+        breaks = (progressCtx->line_offset + 2);
+        proceed = splitWriterWrite(&outWriter, image + offset, n);
+        breaks = (progressCtx->line_offset - 4);
+        
+        if (!proceed) break;
+        
+        printProgressBar(progressCtx, true, n);
+        
+        if ((progressCtx->curOffset + n) < progressCtx->totalSize && cancelProcessCheck(progressCtx))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            proceed = false;
+            break;
+        }
+    }
+    
+    if (proceed)
+    {
+        breaks = (progressCtx->line_offset + 2);
+        proceed = splitWriterClose(&outWriter);
+        breaks = (progressCtx->line_offset - 4);
+    }
+    
+    splitWriterAbort(&outWriter);
+    
+    if (proceed && outWriter.part_size) fsdevSetConcatenationFileAttribute(nsoPath);
+    
+out:
+    freeNsoBinaryData();
+    
+    return proceed;
+}
+
+static bool dumpExeFsSectionDataToTarArchive(const char *output_path, u64 tarSize, progress_ctx_t *progressCtx, bool isFat32)
+{
+    u32 i;
+    u64 n, offset;
+    bool proceed = true;
+    tar_writer_ctx_t tar;
+    
+    breaks = (progressCtx->line_offset + 2);
+    
+    if (!tarWriterOpen(&tar, output_path, tarSize, ((isFat32 && tarSize > FAT32_FILESIZE_LIMIT) ? SPLIT_FILE_GENERIC_PART_SIZE : 0))) return false;
+    
+    for(i = 0; i < exeFsContext.exefs_header.file_cnt; i++)
+    {
+        char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[i].filename_offset);
+        
+        // Check if we're dealing with a nameless file
+        if (!strlen(exeFsFilename))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in ExeFS section!", __func__);
+            proceed = false;
+            break;
+        }
+        
+        uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Copying \"%s\"...", exeFsFilename);
+        
+        breaks = (progressCtx->line_offset + 2);
+        
+        proceed = tarWriterBeginFile(&tar, exeFsFilename, exeFsContext.exefs_entries[i].file_size);
+        if (!proceed) break;
+        
+        for(offset = 0, n = DUMP_BUFFER_SIZE; offset < exeFsContext.exefs_entries[i].file_size; offset += n, progressCtx->curOffset += n)
+        {
+            if (n > (exeFsContext.exefs_entries[i].file_size - offset)) n = (exeFsContext.exefs_entries[i].file_size - offset);
+            
+            breaks = (progressCtx->line_offset + 2);
+            
+            proceed = readExeFsFileData(exeFsContext.exefs_entries[i].file_offset + offset, dumpBuf, n);
+            if (!proceed) break;
+            
+            proceed = tarWriterWriteFileData(&tar, dumpBuf, n);
+            if (!proceed) break;
+            
+            breaks = (progressCtx->line_offset - 4);
+            
+            printProgressBar(progressCtx, true, n);
+            
+            if ((progressCtx->curOffset + n) < progressCtx->totalSize && cancelProcessCheck(progressCtx))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+                proceed = false;
+                break;
+            }
+        }
+        
+        if (!proceed) break;
+        
+        // Support empty files
+        if (!exeFsContext.exefs_entries[i].file_size)
+        {
+            if (progressCtx->totalSize == exeFsContext.exefs_entries[i].file_size) progressCtx->progress = 100;
+            printProgressBar(progressCtx, false, 0);
+        }
+    }
+    
+    if (proceed)
+    {
+        breaks = (progressCtx->line_offset + 2);
+        proceed = tarWriterClose(&tar);
+    }
+    
+    if (!proceed) tarWriterDelete(&tar);
+    
+    return proceed;
+}
+
 bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDumpCfg)
 {
     if (!exeFsDumpCfg)
@@ -3704,21 +4720,26 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
     
     bool isFat32 = exeFsDumpCfg->isFat32;
     bool useLayeredFSDir = exeFsDumpCfg->useLayeredFSDir;
+    bool useTarArchive = (exeFsDumpCfg->useTarArchive && !useLayeredFSDir);
+    bool verifyHashes = exeFsDumpCfg->verifyHashes;
+    bool exportNsoImages = (exeFsDumpCfg->exportNsoImages && !useTarArchive && !useLayeredFSDir);
     
     u32 i;
-    u64 n = 0, offset = 0;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    size_t write_res;
+    u64 n = 0, offset = 0, tarSize = 0, nsoImagesSize = 0;
+    nso_header_t nsoHeader;
+    u8 *nsoData = NULL;
+    bool isNso = false;
+    u32 nsoUnverifiedCnt = 0;
+    split_writer_ctx_t outWriter;
     bool proceed = true, success = false, fat32_error = false;
     
-    char tmp_idx[5] = {'\0'};
     char *dumpName = NULL;
     char dumpPath[NAME_BUF_LEN] = {'\0'}, curDumpPath[NAME_BUF_LEN * 2] = {'\0'};
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
+    memset(&outWriter, 0, sizeof(split_writer_ctx_t));
     memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
     
     if ((!usePatch && !titleAppCount) || (usePatch && !titlePatchCount))
@@ -3762,12 +4783,43 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
     uiRefreshDisplay();
     breaks++;
     
-    if (progressCtx.totalSize > freeSpace)
+    if (useTarArchive)
+    {
+        for(i = 0; i < exeFsContext.exefs_header.file_cnt; i++) tarSize += tarWriterGetEntrySize(strlen(exeFsContext.exefs_str_table + exeFsContext.exefs_entries[i].filename_offset), exeFsContext.exefs_entries[i].file_size, false);
+        tarSize += tarWriterGetTrailerSize();
+        
+        convertSize(tarSize, strbuf, MAX_CHARACTERS(strbuf));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Output TAR archive size: %s (%lu bytes).", strbuf, tarSize);
+        uiRefreshDisplay();
+        breaks++;
+    }
+    
+    if (exportNsoImages)
+    {
+        for(i = 0; i < exeFsContext.exefs_header.file_cnt; i++)
+        {
+            if (readExeFsNsoHeader(i, &nsoHeader)) nsoImagesSize += nsoGetBinaryImageSize(&nsoHeader);
+        }
+        
+        convertSize(nsoImagesSize, strbuf, MAX_CHARACTERS(strbuf));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Decompressed NSO images size: %s (%lu bytes).", strbuf, nsoImagesSize);
+        uiRefreshDisplay();
+        breaks++;
+        
+        // The images are written right after each NSO, so they're covered by the progress bar
+        progressCtx.totalSize += nsoImagesSize;
+        convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    }
+    
+    if ((useTarArchive ? tarSize : progressCtx.totalSize) > freeSpace)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
         goto out;
     }
     
+    // Check the hash table before creating any output files
+    if (verifyHashes && !pfs0VerifyInit(&exeFsVerifyCtx)) goto out;
+    
     // Generate output path
     if (!useLayeredFSDir)
     {
@@ -3788,7 +4840,12 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
         strcat(dumpPath, "/exefs");
     }
     
-    mkdir(dumpPath, 0744);
+    if (useTarArchive)
+    {
+        strcat(dumpPath, ".tar");
+    } else {
+        mkdir(dumpPath, 0744);
+    }
     
     // Start dump process
     breaks++;
@@ -3802,155 +4859,124 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
     progressCtx.line_offset = (breaks + 4);
     timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
     
-    for(i = 0; i < exeFsContext.exefs_header.file_cnt; i++)
+    if (useTarArchive)
     {
-        n = DUMP_BUFFER_SIZE;
-        outFile = NULL;
-        splitIndex = 0;
-        
-        char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[i].filename_offset);
-        
-        // Check if we're dealing with a nameless file
-        if (!strlen(exeFsFilename))
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in ExeFS section!", __func__);
-            break;
-        }
-        
-        snprintf(curDumpPath, MAX_CHARACTERS(curDumpPath), "%s/%s", dumpPath, exeFsFilename);
-        removeIllegalCharacters(curDumpPath + strlen(dumpPath) + 1);
-        
-        if (exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            mkdir(curDumpPath, 0744);
-            sprintf(tmp_idx, "/%02u", splitIndex);
-            strcat(curDumpPath, tmp_idx);
-        }
-        
-        outFile = fopen(curDumpPath, "wb");
-        if (!outFile)
+        proceed = dumpExeFsSectionDataToTarArchive(dumpPath, tarSize, &progressCtx, isFat32);
+    } else {
+        for(i = 0; i < exeFsContext.exefs_header.file_cnt; i++)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, curDumpPath);
-            break;
-        }
-        
-        uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
-        
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Copying \"%s\"...", exeFsFilename);
-        
-        for(offset = 0; offset < exeFsContext.exefs_entries[i].file_size; offset += n, progressCtx.curOffset += n)
-        {
-            uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+            n = DUMP_BUFFER_SIZE;
             
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(curDumpPath, '/') + 1);
+            char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[i].filename_offset);
             
-            uiRefreshDisplay();
+            // Check if we're dealing with a nameless file
+            if (!strlen(exeFsFilename))
+            {
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in ExeFS section!", __func__);
+                break;
+            }
             
-            if (n > (exeFsContext.exefs_entries[i].file_size - offset)) n = (exeFsContext.exefs_entries[i].file_size - offset);
+            snprintf(curDumpPath, MAX_CHARACTERS(curDumpPath), "%s/%s", dumpPath, exeFsFilename);
+            removeIllegalCharacters(curDumpPath + strlen(dumpPath) + 1);
             
             breaks = (progressCtx.line_offset + 2);
-            proceed = processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[i].file_offset + offset, dumpBuf, n, false);
+            proceed = splitWriterOpen(&outWriter, curDumpPath, exeFsContext.exefs_entries[i].file_size, ((exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32) ? SPLIT_FILE_GENERIC_PART_SIZE : 0), SPLIT_WRITER_NAMING_DIRECTORY, 0);
             breaks = (progressCtx.line_offset - 4);
             
             if (!proceed) break;
             
-            if (exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32 && (offset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
+            uiFill(0, ((progressCtx.line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+            
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 4), FONT_COLOR_RGB, "Copying \"%s\"...", exeFsFilename);
+            
+            for(offset = 0; offset < exeFsContext.exefs_entries[i].file_size; offset += n, progressCtx.curOffset += n)
             {
-                u64 new_file_chunk_size = ((offset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
+                uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
                 
-                if (old_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                    if (write_res != old_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, offset, splitIndex, write_res);
-                        proceed = false;
-                        break;
-                    }
-                }
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/') + 1);
                 
-                fclose(outFile);
-                outFile = NULL;
+                uiRefreshDisplay();
+                
+                if (n > (exeFsContext.exefs_entries[i].file_size - offset)) n = (exeFsContext.exefs_entries[i].file_size - offset);
+                
+                breaks = (progressCtx.line_offset + 2);
+                proceed = readExeFsFileData(exeFsContext.exefs_entries[i].file_offset + offset, dumpBuf, n);
+                breaks = (progressCtx.line_offset - 4);
+                
+                if (!proceed) break;
                 
-                if (new_file_chunk_size > 0 || (offset + n) < exeFsContext.exefs_entries[i].file_size)
+                // Keep a copy of each NSO while it's being dumped, so its decompressed image can be generated from the data that has already been decrypted
+                if (exportNsoImages && !offset && n >= sizeof(nso_header_t) && __builtin_bswap32(((nso_header_t*)dumpBuf)->magic) == NSO_MAGIC)
                 {
-                    char *tmp = strrchr(curDumpPath, '/');
-                    if (tmp != NULL) *tmp = '\0';
-                    
-                    splitIndex++;
-                    sprintf(tmp_idx, "/%02u", splitIndex);
-                    strcat(curDumpPath, tmp_idx);
-                    
-                    outFile = fopen(curDumpPath, "wb");
-                    if (!outFile)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                        proceed = false;
-                        break;
-                    }
-                    
-                    if (new_file_chunk_size > 0)
-                    {
-                        write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                        if (write_res != new_file_chunk_size)
-                        {
-                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, offset + old_file_chunk_size, splitIndex, write_res);
-                            proceed = false;
-                            break;
-                        }
-                    }
+                    memcpy(&nsoHeader, dumpBuf, sizeof(nso_header_t));
+                    isNso = true;
+                    nsoData = malloc(exeFsContext.exefs_entries[i].file_size);
                 }
-            } else {
-                write_res = fwrite(dumpBuf, 1, n, outFile);
-                if (write_res != n)
+                
+                if (nsoData) memcpy(nsoData + offset, dumpBuf, n);
+                
+                breaks = (progressCtx.line_offset + 2);
+                proceed = splitWriterWrite(&outWriter, dumpBuf, n);
+                breaks = (progressCtx.line_offset - 4);
+                
+                if (!proceed)
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, offset, write_res);
-                    
-                    if ((offset + n) > FAT32_FILESIZE_LIMIT)
+                    if (!outWriter.part_size && (offset + n) > FAT32_FILESIZE_LIMIT)
                     {
                         uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
                         fat32_error = true;
                     }
                     
+                    break;
+                }
+                
+                printProgressBar(&progressCtx, true, n);
+                
+                if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
                     proceed = false;
                     break;
                 }
             }
             
-            printProgressBar(&progressCtx, true, n);
+            if (proceed)
+            {
+                breaks = (progressCtx.line_offset + 2);
+                proceed = splitWriterClose(&outWriter);
+                breaks = (progressCtx.line_offset - 4);
+            }
             
-            if ((progressCtx.curOffset + n) < progressCtx.totalSize && cancelProcessCheck(&progressCtx))
+            splitWriterAbort(&outWriter);
+            
+            if (proceed && isNso) proceed = dumpExeFsNsoImage(i, dumpPath, &nsoHeader, nsoData, &progressCtx, isFat32, &nsoUnverifiedCnt);
+            
+            if (nsoData)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
-                proceed = false;
-                break;
+                free(nsoData);
+                nsoData = NULL;
             }
-        }
-        
-        if (outFile) fclose(outFile);
-        
-        if (!proceed) break;
-        
-        // Support empty files
-        if (!exeFsContext.exefs_entries[i].file_size)
-        {
-            uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
             
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(curDumpPath, '/') + 1);
+            isNso = false;
             
-            if (progressCtx.totalSize == exeFsContext.exefs_entries[i].file_size) progressCtx.progress = 100;
+            if (!proceed) break;
             
-            printProgressBar(&progressCtx, false, 0);
-        }
-        
-        // Set archive bit (only for FAT32)
-        if (exeFsContext.exefs_entries[i].file_size > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            char *tmp = strrchr(curDumpPath, '/');
-            if (tmp != NULL) *tmp = '\0';
-            fsdevSetConcatenationFileAttribute(curDumpPath);
+            // Support empty files
+            if (!exeFsContext.exefs_entries[i].file_size)
+            {
+                uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
+                
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/') + 1);
+                
+                if (progressCtx.totalSize == exeFsContext.exefs_entries[i].file_size) progressCtx.progress = 100;
+                
+                printProgressBar(&progressCtx, false, 0);
+            }
+            
+            // Set archive bit (only for FAT32)
+            if (outWriter.part_size) fsdevSetConcatenationFileAttribute(curDumpPath);
         }
+    
     }
     
     if (proceed)
@@ -3963,6 +4989,9 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
         }
     }
     
+    // Don't keep decompressed images from this NCA around
+    if (exportNsoImages) freeNsoImageCache();
+    
     breaks = (progressCtx.line_offset + 2);
     
     if (success)
@@ -3972,13 +5001,23 @@ bool dumpExeFsSectionData(u32 titleIndex, bool usePatch, ncaFsOptions *exeFsDump
         
         formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+        
+        if (nsoUnverifiedCnt)
+        {
+            breaks += 2;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "%u NSO segment(s) not verified: no hash available, or overlapped by the next segment.", nsoUnverifiedCnt);
+        }
     } else {
         setProgressBarError(&progressCtx);
         if (fat32_error) breaks += 2;
-        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
+        
+        // The output archive has already been deleted at this point
+        if (!useTarArchive) removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
     }
     
 out:
+    pfs0VerifyClose(&exeFsVerifyCtx);
+    
     freeExeFsContext();
     
     if (dumpName) free(dumpName);
@@ -4001,6 +5040,7 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
     
     bool isFat32 = exeFsDumpCfg->isFat32;
     bool useLayeredFSDir = exeFsDumpCfg->useLayeredFSDir;
+    bool verifyHashes = exeFsDumpCfg->verifyHashes;
     
     if (!exeFsContext.exefs_header.file_cnt || fileIndex > (exeFsContext.exefs_header.file_cnt - 1) || !exeFsContext.exefs_entries || !exeFsContext.exefs_str_table || exeFsContext.exefs_data_offset <= exeFsContext.exefs_offset || (!usePatch && titleIndex > (titleAppCount - 1)) || (usePatch && titleIndex > (titlePatchCount - 1)))
     {
@@ -4010,18 +5050,16 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
     }
     
     u64 n = DUMP_BUFFER_SIZE;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    size_t write_res;
+    split_writer_ctx_t outWriter;
     bool proceed = true, success = false, fat32_error = false, removeFile = true;
     
-    char tmp_idx[5];
     char *dumpName = NULL;
     char dumpPath[NAME_BUF_LEN] = {'\0'};
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
+    memset(&outWriter, 0, sizeof(split_writer_ctx_t));
     memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
     
     char *exeFsFilename = (exeFsContext.exefs_str_table + exeFsContext.exefs_entries[fileIndex].filename_offset);
@@ -4108,10 +5146,6 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
         // Better safe than sorry
         remove(dumpPath);
         fsdevDeleteDirectoryRecursively(dumpPath);
-        
-        mkdir(dumpPath, 0744);
-        sprintf(tmp_idx, "/%02u", splitIndex);
-        strcat(dumpPath, tmp_idx);
     }
     
     // Start dump process
@@ -4127,12 +5161,9 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
     
     uiRefreshDisplay();
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file!", __func__);
-        goto out;
-    }
+    if (verifyHashes && !pfs0VerifyInit(&exeFsVerifyCtx)) goto out;
+    
+    if (!splitWriterOpen(&outWriter, dumpPath, progressCtx.totalSize, ((progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32) ? SPLIT_FILE_GENERIC_PART_SIZE : 0), SPLIT_WRITER_NAMING_DIRECTORY, 0)) goto out;
     
     progressCtx.line_offset = (breaks + 2);
     timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
@@ -4141,76 +5172,33 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
     {
         uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/') + 1);
         
         uiRefreshDisplay();
         
         if (n > (progressCtx.totalSize - progressCtx.curOffset)) n = (progressCtx.totalSize - progressCtx.curOffset);
         
         breaks = (progressCtx.line_offset + 2);
-        proceed = processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), exeFsContext.exefs_data_offset + exeFsContext.exefs_entries[fileIndex].file_offset + progressCtx.curOffset, dumpBuf, n, false);
+        proceed = readExeFsFileData(exeFsContext.exefs_entries[fileIndex].file_offset + progressCtx.curOffset, dumpBuf, n);
         breaks = (progressCtx.line_offset - 2);
         
         if (!proceed) break;
         
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32 && (progressCtx.curOffset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
+        breaks = (progressCtx.line_offset + 2);
+        
+        proceed = splitWriterWrite(&outWriter, dumpBuf, n);
+        
+        breaks = (progressCtx.line_offset - 2);
+        
+        if (!proceed)
         {
-            u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-            u64 old_file_chunk_size = (n - new_file_chunk_size);
-            
-            if (old_file_chunk_size > 0)
+            if (!outWriter.part_size && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
             {
-                write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                if (write_res != old_file_chunk_size)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
-                    break;
-                }
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                fat32_error = true;
             }
             
-            fclose(outFile);
-            outFile = NULL;
-            
-            if (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize)
-            {
-                char *tmp = strrchr(dumpPath, '/');
-                if (tmp != NULL) *tmp = '\0';
-                
-                splitIndex++;
-                sprintf(tmp_idx, "/%02u", splitIndex);
-                strcat(dumpPath, tmp_idx);
-                
-                outFile = fopen(dumpPath, "wb");
-                if (!outFile)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                    break;
-                }
-                
-                if (new_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                    if (write_res != new_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                        break;
-                    }
-                }
-            }
-        } else {
-            write_res = fwrite(dumpBuf, 1, n, outFile);
-            if (write_res != n)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                
-                if ((progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                    fat32_error = true;
-                }
-                
-                break;
-            }
+            break;
         }
         
         printProgressBar(&progressCtx, true, n);
@@ -4222,22 +5210,22 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
         }
     }
     
-    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
+    breaks = (progressCtx.line_offset + 2);
+    
+    if (progressCtx.curOffset >= progressCtx.totalSize && splitWriterClose(&outWriter)) success = true;
     
     // Support empty files
     if (!progressCtx.totalSize)
     {
         uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/') + 1);
         
         progressCtx.progress = 100;
         
         printProgressBar(&progressCtx, false, 0);
     }
     
-    breaks = (progressCtx.line_offset + 2);
-    
     if (success)
     {
         timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
@@ -4251,22 +5239,16 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
     }
     
 out:
-    if (outFile) fclose(outFile);
+    pfs0VerifyClose(&exeFsVerifyCtx);
     
-    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+    splitWriterAbort(&outWriter);
+    
+    if (success)
     {
-        char *tmp = strrchr(dumpPath, '/');
-        if (tmp != NULL) *tmp = '\0';
-        
-        if (success)
-        {
-            // Set archive bit (only for FAT32)
-            fsdevSetConcatenationFileAttribute(dumpPath);
-        } else {
-            if (removeFile) fsdevDeleteDirectoryRecursively(dumpPath);
-        }
+        // Set archive bit (only for FAT32)
+        if (outWriter.part_size) fsdevSetConcatenationFileAttribute(dumpPath);
     } else {
-        if (!success && removeFile) remove(dumpPath);
+        if (removeFile) splitWriterDelete(&outWriter);
     }
     
     if (dumpName) free(dumpName);
@@ -4278,118 +5260,385 @@ out:
     return success;
 }
 
-bool recursiveDumpRomFsFile(u32 file_offset, char *romfs_path, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool isFat32)
+// 'data_offset' is relative to the start of the RomFS file data area
+static bool readRomFsFileData(u64 data_offset, void *outBuf, u64 bufSize, bool usePatch)
 {
-    if ((!usePatch && (!romFsContext.romfs_filetable_size || file_offset > romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_filetable_size || file_offset > bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || !romfs_path || !output_path || !progressCtx)
+    if (romFsVerifyCtx.initialized) return ivfcVerifyReadData(&romFsVerifyCtx, (!usePatch ? romFsContext.romfs_filedata_offset : bktrContext.romfs_filedata_offset) + data_offset, outBuf, bufSize);
+    
+    if (!usePatch) return processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + data_offset, outBuf, bufSize, false);
+    
+    return readBktrSectionBlock(bktrContext.romfs_filedata_offset + data_offset, outBuf, bufSize);
+}
+
+static bool recursiveCalculateRomFsTarArchiveSize(u32 dir_offset, size_t path_len, bool usePatch, bool dumpSiblingDir, u64 *out)
+{
+    if ((!usePatch && (!romFsContext.romfs_dirtable_size || dir_offset > romFsContext.romfs_dirtable_size || !romFsContext.romfs_dir_entries || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_dirtable_size || dir_offset > bktrContext.romfs_dirtable_size || !bktrContext.romfs_dir_entries || !bktrContext.romfs_file_entries)) || !out) return false;
+    
+    u32 file_offset;
+    romfs_file *fileEntry = NULL;
+    romfs_dir *dirEntry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + dir_offset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + dir_offset));
+    
+    size_t cur_path_len = (path_len + (dirEntry->nameLen ? (1 + dirEntry->nameLen) : 0));
+    
+    // Archive entry names don't include the leading slash
+    if (dirEntry->nameLen) *out += tarWriterGetEntrySize(cur_path_len - 1, 0, true);
+    
+    file_offset = dirEntry->childFile;
+    
+    while(file_offset != ROMFS_ENTRY_EMPTY)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from RomFS section!", __func__);
-        return false;
+        fileEntry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + file_offset));
+        *out += tarWriterGetEntrySize(cur_path_len + fileEntry->nameLen, fileEntry->dataSize, false);
+        file_offset = fileEntry->sibling;
     }
     
-    size_t orig_romfs_path_len = strlen(romfs_path);
-    size_t orig_output_path_len = strlen(output_path);
-    
-    u64 n = DUMP_BUFFER_SIZE;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    bool proceed = true, success = false, fat32_error = false;
+    if (dirEntry->childDir != ROMFS_ENTRY_EMPTY && !recursiveCalculateRomFsTarArchiveSize(dirEntry->childDir, cur_path_len, usePatch, true, out)) return false;
     
-    // Used to overcome issues related to the max entry count per directory in FAT32
-    int dir_limit_counter = -1;
+    if (dumpSiblingDir && dirEntry->sibling != ROMFS_ENTRY_EMPTY && !recursiveCalculateRomFsTarArchiveSize(dirEntry->sibling, path_len, usePatch, true, out)) return false;
     
-    u32 romfs_file_offset = file_offset;
-    romfs_file *entry = NULL;
+    return true;
+}
+
+static bool dumpRomFsFileToTarArchive(romfs_file *fileEntry, char *romfs_path, tar_writer_ctx_t *tar, progress_ctx_t *progressCtx, bool usePatch)
+{
+    u64 n, off;
+    bool proceed = true;
     
-    u64 off = 0;
+    uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
     
-    size_t write_res;
+    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Copying \"romfs:%s\"...", romfs_path);
     
-    char tmp_idx[16];
+    breaks = (progressCtx->line_offset + 2);
     
-    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    if (!tarWriterBeginFile(tar, romfs_path + 1, fileEntry->dataSize)) return false;
     
-    while(romfs_file_offset != ROMFS_ENTRY_EMPTY)
+    for(off = 0, n = DUMP_BUFFER_SIZE; off < fileEntry->dataSize; off += n, progressCtx->curOffset += n)
     {
-        romfs_path[orig_romfs_path_len] = '\0';
-        output_path[orig_output_path_len] = '\0';
+        if (n > (fileEntry->dataSize - off)) n = (fileEntry->dataSize - off);
         
-        n = DUMP_BUFFER_SIZE;
-        splitIndex = 0;
+        breaks = (progressCtx->line_offset + 2);
         
-        entry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + romfs_file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + romfs_file_offset));
+        proceed = readRomFsFileData(fileEntry->dataOff + off, dumpBuf, n, usePatch);
         
-        // Check if we're dealing with a nameless file
-        if (!entry->nameLen)
+        if (!proceed) break;
+        
+        proceed = tarWriterWriteFileData(tar, dumpBuf, n);
+        if (!proceed) break;
+        
+        breaks = (progressCtx->line_offset - 4);
+        
+        printProgressBar(progressCtx, true, n);
+        
+        if (((off + n) < fileEntry->dataSize || (progressCtx->curOffset + n) < progressCtx->totalSize) && cancelProcessCheck(progressCtx))
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+            proceed = false;
             break;
         }
+    }
+    
+    if (!proceed) return false;
+    
+    // Support empty files
+    if (!fileEntry->dataSize)
+    {
+        if (progressCtx->totalSize == fileEntry->dataSize) progressCtx->progress = 100;
+        printProgressBar(progressCtx, false, 0);
+    }
+    
+    return true;
+}
+
+static bool recursiveDumpRomFsDirToTarArchive(u32 dir_offset, char *romfs_path, tar_writer_ctx_t *tar, progress_ctx_t *progressCtx, bool usePatch, bool dumpSiblingDir)
+{
+    size_t orig_romfs_path_len = strlen(romfs_path);
+    
+    u32 file_offset;
+    bool proceed = true;
+    
+    romfs_file *fileEntry = NULL;
+    romfs_dir *dirEntry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + dir_offset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + dir_offset));
+    
+    // Check if we're dealing with a nameless directory that's not the root directory
+    if (!dirEntry->nameLen && dir_offset > 0)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: directory entry without name in RomFS section!", __func__);
+        return false;
+    }
+    
+    if ((orig_romfs_path_len + 1 + dirEntry->nameLen) >= (NAME_BUF_LEN * 2))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section directory path is too long!", __func__);
+        return false;
+    }
+    
+    breaks = (progressCtx->line_offset + 2);
+    
+    if (dirEntry->nameLen)
+    {
+        strcat(romfs_path, "/");
+        strncat(romfs_path, (char*)dirEntry->name, dirEntry->nameLen);
+        
+        if (!tarWriterAddDirectory(tar, romfs_path + 1))
+        {
+            romfs_path[orig_romfs_path_len] = '\0';
+            return false;
+        }
+    }
+    
+    size_t cur_romfs_path_len = strlen(romfs_path);
+    
+    file_offset = dirEntry->childFile;
+    
+    while(file_offset != ROMFS_ENTRY_EMPTY)
+    {
+        romfs_path[cur_romfs_path_len] = '\0';
         
-        if (dir_limit_counter >= 0)
+        fileEntry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + file_offset));
+        
+        // Check if we're dealing with a nameless file
+        if (!fileEntry->nameLen)
         {
-            sprintf(tmp_idx, "_%d", dir_limit_counter);
-        } else {
-            tmp_idx[0] = '\0';
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
+            proceed = false;
+            break;
         }
         
-        if ((orig_romfs_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2) || (orig_output_path_len + strlen(tmp_idx) + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2))
+        if ((cur_romfs_path_len + 1 + fileEntry->nameLen) >= (NAME_BUF_LEN * 2))
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section file path is too long!", __func__);
+            proceed = false;
             break;
         }
         
-        // Generate current path
         strcat(romfs_path, "/");
-        strncat(romfs_path, (char*)entry->name, entry->nameLen);
+        strncat(romfs_path, (char*)fileEntry->name, fileEntry->nameLen);
         
-        if (dir_limit_counter >= 0) strcat(output_path, tmp_idx);
-        strcat(output_path, "/");
-        strncat(output_path, (char*)entry->name, entry->nameLen);
-        removeIllegalCharacters(output_path + orig_output_path_len + strlen(tmp_idx) + 1);
+        if (!dumpRomFsFileToTarArchive(fileEntry, romfs_path, tar, progressCtx, usePatch))
+        {
+            proceed = false;
+            break;
+        }
+        
+        file_offset = fileEntry->sibling;
+    }
+    
+    romfs_path[cur_romfs_path_len] = '\0';
+    
+    if (proceed && dirEntry->childDir != ROMFS_ENTRY_EMPTY) proceed = recursiveDumpRomFsDirToTarArchive(dirEntry->childDir, romfs_path, tar, progressCtx, usePatch, true);
+    
+    romfs_path[orig_romfs_path_len] = '\0';
+    
+    if (proceed && dumpSiblingDir && dirEntry->sibling != ROMFS_ENTRY_EMPTY) proceed = recursiveDumpRomFsDirToTarArchive(dirEntry->sibling, romfs_path, tar, progressCtx, usePatch, true);
+    
+    return proceed;
+}
+
+static bool dumpRomFsDirToTarArchive(u32 dir_offset, char *romfs_path, const char *output_path, u64 tarSize, progress_ctx_t *progressCtx, bool usePatch, bool dumpSiblingDir, bool isFat32)
+{
+    bool success = false;
+    tar_writer_ctx_t tar;
+    
+    breaks = (progressCtx->line_offset + 2);
+    
+    if (!tarWriterOpen(&tar, output_path, tarSize, ((isFat32 && tarSize > FAT32_FILESIZE_LIMIT) ? SPLIT_FILE_GENERIC_PART_SIZE : 0))) return false;
+    
+    success = recursiveDumpRomFsDirToTarArchive(dir_offset, romfs_path, &tar, progressCtx, usePatch, dumpSiblingDir);
+    
+    if (success)
+    {
+        breaks = (progressCtx->line_offset + 2);
+        success = tarWriterClose(&tar);
+    }
+    
+    if (!success) tarWriterDelete(&tar);
+    
+    return success;
+}
+
+static bool submitRomFsFileToWritePool(romfs_file *entry, char *romfs_path, char *output_path, size_t dir_len, progress_ctx_t *progressCtx, bool usePatch, write_pool_ctx_t *writePool)
+{
+    bool proceed = true;
+    
+    write_pool_job_t *job = writePoolAcquireJob(writePool);
+    if (!job)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writePool->errorMsg);
+        return false;
+    }
+    
+    uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Copying \"romfs:%s\"...", romfs_path);
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(output_path, '/') + 1);
+    
+    if (entry->dataSize)
+    {
+        breaks = (progressCtx->line_offset + 2);
+        
+        proceed = readRomFsFileData(entry->dataOff, job->data, entry->dataSize, usePatch);
+        
+        breaks = (progressCtx->line_offset - 4);
         
-        if (entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32)
+        if (!proceed)
         {
-            mkdir(output_path, 0744);
-            sprintf(tmp_idx, "/%02u", splitIndex);
-            strcat(output_path, tmp_idx);
+            writePoolReleaseJob(writePool, job);
+            return false;
+        }
+    }
+    
+    // The writer thread takes care of creating the file, including the FAT32 directory entry limit workaround
+    snprintf(job->path, NAME_BUF_LEN * 2, "%s", output_path);
+    job->dir_len = dir_len;
+    job->name_offset = (size_t)((strrchr(output_path, '/') + 1) - output_path);
+    job->size = entry->dataSize;
+    
+    writePoolSubmitJob(writePool, job);
+    
+    if (entry->dataSize)
+    {
+        printProgressBar(progressCtx, true, entry->dataSize);
+        progressCtx->curOffset += entry->dataSize;
+    } else {
+        // Support empty files
+        if (progressCtx->totalSize == entry->dataSize) progressCtx->progress = 100;
+        printProgressBar(progressCtx, false, 0);
+    }
+    
+    if (progressCtx->curOffset < progressCtx->totalSize && cancelProcessCheck(progressCtx))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "Process canceled.");
+        return false;
+    }
+    
+    return true;
+}
+
+bool recursiveDumpRomFsFile(u32 file_offset, char *romfs_path, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool dumpSiblingFile, bool isFat32, write_pool_ctx_t *writePool)
+{
+    if ((!usePatch && (!romFsContext.romfs_filetable_size || file_offset > romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_filetable_size || file_offset > bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || !romfs_path || !output_path || !progressCtx)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to parse file entry from RomFS section!", __func__);
+        return false;
+    }
+    
+    size_t orig_romfs_path_len = strlen(romfs_path);
+    size_t orig_output_path_len = strlen(output_path);
+    
+    u64 n = DUMP_BUFFER_SIZE;
+    split_writer_ctx_t outWriter;
+    bool proceed = true, success = false, fat32_error = false;
+    
+    // Used to overcome issues related to the max entry count per directory in FAT32
+    // Shared with the writer threads through the write pool, if available
+    int dir_limit_counter = -1;
+    
+    u32 romfs_file_offset = file_offset;
+    romfs_file *entry = NULL;
+    
+    u64 off = 0;
+    
+    char tmp_idx[16];
+    
+    memset(&outWriter, 0, sizeof(split_writer_ctx_t));
+    memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
+    
+    while(romfs_file_offset != ROMFS_ENTRY_EMPTY)
+    {
+        romfs_path[orig_romfs_path_len] = '\0';
+        output_path[orig_output_path_len] = '\0';
+        
+        n = DUMP_BUFFER_SIZE;
+        
+        // The writer threads may have already moved on to a fallback directory
+        if (writePool) dir_limit_counter = writePoolGetDirFallback(writePool, output_path, orig_output_path_len);
+        
+        entry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + romfs_file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + romfs_file_offset));
+        
+        // Check if we're dealing with a nameless file
+        if (!entry->nameLen)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: file entry without name in RomFS section!", __func__);
+            break;
+        }
+        
+        if (dir_limit_counter >= 0)
+        {
+            sprintf(tmp_idx, "_%d", dir_limit_counter);
+        } else {
+            tmp_idx[0] = '\0';
+        }
+        
+        if ((orig_romfs_path_len + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2) || (orig_output_path_len + strlen(tmp_idx) + 1 + entry->nameLen) >= (NAME_BUF_LEN * 2))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section file path is too long!", __func__);
+            break;
+        }
+        
+        // Generate current path
+        strcat(romfs_path, "/");
+        strncat(romfs_path, (char*)entry->name, entry->nameLen);
+        
+        if (dir_limit_counter >= 0) strcat(output_path, tmp_idx);
+        strcat(output_path, "/");
+        strncat(output_path, (char*)entry->name, entry->nameLen);
+        removeIllegalCharacters(output_path + orig_output_path_len + strlen(tmp_idx) + 1);
+        
+        // Small files are read ahead and handed over to the writer threads, while bigger files are written right away
+        if (writePool && entry->dataSize <= WRITE_POOL_SLOT_SIZE)
+        {
+            if (!submitRomFsFileToWritePool(entry, romfs_path, output_path, orig_output_path_len, progressCtx, usePatch, writePool)) break;
+            
+            romfs_file_offset = (dumpSiblingFile ? entry->sibling : ROMFS_ENTRY_EMPTY);
+            if (romfs_file_offset == ROMFS_ENTRY_EMPTY) success = true;
+            
+            continue;
         }
         
+        u64 partSize = ((entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32) ? SPLIT_FILE_GENERIC_PART_SIZE : 0);
+        
         // Start dump process
         uiFill(0, ((progressCtx->line_offset - 4) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 4, BG_COLOR_RGB);
         
         uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 4), FONT_COLOR_RGB, "Copying \"romfs:%s\"...", romfs_path);
         
-        outFile = fopen(output_path, "wb");
-        if (!outFile)
+        breaks = (progressCtx->line_offset + 2);
+        
+        proceed = splitWriterOpen(&outWriter, output_path, entry->dataSize, partSize, SPLIT_WRITER_NAMING_DIRECTORY, 0);
+        if (!proceed && !partSize)
         {
-            if (entry->dataSize <= FAT32_FILESIZE_LIMIT || !isFat32)
-            {
-                output_path[orig_output_path_len] = '\0';
-                
-                dir_limit_counter++;
-                sprintf(tmp_idx, "_%d", dir_limit_counter);
-                strcat(output_path, tmp_idx);
-                mkdir(output_path, 0744);
-                
-                strcat(output_path, "/");
-                strncat(output_path, (char*)entry->name, entry->nameLen);
-                removeIllegalCharacters(output_path + orig_output_path_len + strlen(tmp_idx) + 1);
-                
-                outFile = fopen(output_path, "wb");
-            }
+            // FAT32 limits the number of entries per directory, so move on to a new directory
+            output_path[orig_output_path_len] = '\0';
+            
+            dir_limit_counter++;
+            sprintf(tmp_idx, "_%d", dir_limit_counter);
+            strcat(output_path, tmp_idx);
+            mkdir(output_path, 0744);
+            
+            strcat(output_path, "/");
+            strncat(output_path, (char*)entry->name, entry->nameLen);
+            removeIllegalCharacters(output_path + orig_output_path_len + strlen(tmp_idx) + 1);
             
-            if (!outFile)
+            proceed = splitWriterOpen(&outWriter, output_path, entry->dataSize, partSize, SPLIT_WRITER_NAMING_DIRECTORY, 0);
+            
+            // Remove the error message from the first attempt
+            if (proceed)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, output_path);
-                break;
+                uiFill(0, ((progressCtx->line_offset + 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT, BG_COLOR_RGB);
+                if (writePool) writePoolSetDirFallback(writePool, output_path, orig_output_path_len, dir_limit_counter);
             }
         }
         
+        breaks = (progressCtx->line_offset - 4);
+        
+        if (!proceed) break;
+        
         for(off = 0; off < entry->dataSize; off += n, progressCtx->curOffset += n)
         {
             uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
             
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(output_path, '/') + 1);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/') + 1);
             
             uiRefreshDisplay();
             
@@ -4397,79 +5646,27 @@ bool recursiveDumpRomFsFile(u32 file_offset, char *romfs_path, char *output_path
             
             breaks = (progressCtx->line_offset + 2);
             
-            if (!usePatch)
-            {
-                proceed = processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff + off, dumpBuf, n, false);
-            } else {
-                proceed = readBktrSectionBlock(bktrContext.romfs_filedata_offset + entry->dataOff + off, dumpBuf, n);
-            }
+            proceed = readRomFsFileData(entry->dataOff + off, dumpBuf, n, usePatch);
             
             breaks = (progressCtx->line_offset - 4);
             
             if (!proceed) break;
             
-            if (entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32 && (off + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
+            breaks = (progressCtx->line_offset + 2);
+            
+            proceed = splitWriterWrite(&outWriter, dumpBuf, n);
+            
+            breaks = (progressCtx->line_offset - 4);
+            
+            if (!proceed)
             {
-                u64 new_file_chunk_size = ((off + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-                u64 old_file_chunk_size = (n - new_file_chunk_size);
-                
-                if (old_file_chunk_size > 0)
+                if (!partSize && (off + n) > FAT32_FILESIZE_LIMIT)
                 {
-                    write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                    if (write_res != old_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, off, splitIndex, write_res);
-                        proceed = false;
-                        break;
-                    }
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                    fat32_error = true;
                 }
                 
-                fclose(outFile);
-                outFile = NULL;
-                
-                if (new_file_chunk_size > 0 || (off + n) < entry->dataSize)
-                {
-                    char *tmp = strrchr(output_path, '/');
-                    if (tmp != NULL) *tmp = '\0';
-                    
-                    splitIndex++;
-                    sprintf(tmp_idx, "/%02u", splitIndex);
-                    strcat(output_path, tmp_idx);
-                    
-                    outFile = fopen(output_path, "wb");
-                    if (!outFile)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                        proceed = false;
-                        break;
-                    }
-                    
-                    if (new_file_chunk_size > 0)
-                    {
-                        write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                        if (write_res != new_file_chunk_size)
-                        {
-                            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, off + old_file_chunk_size, splitIndex, write_res);
-                            proceed = false;
-                            break;
-                        }
-                    }
-                }
-            } else {
-                write_res = fwrite(dumpBuf, 1, n, outFile);
-                if (write_res != n)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, off, write_res);
-                    
-                    if ((off + n) > FAT32_FILESIZE_LIMIT)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                        fat32_error = true;
-                    }
-                    
-                    proceed = false;
-                    break;
-                }
+                break;
             }
             
             printProgressBar(progressCtx, true, n);
@@ -4482,12 +5679,15 @@ bool recursiveDumpRomFsFile(u32 file_offset, char *romfs_path, char *output_path
             }
         }
         
-        if (outFile)
+        if (proceed && off >= entry->dataSize)
         {
-            fclose(outFile);
-            outFile = NULL;
+            breaks = (progressCtx->line_offset + 2);
+            proceed = splitWriterClose(&outWriter);
+            breaks = (progressCtx->line_offset - 4);
         }
         
+        splitWriterAbort(&outWriter);
+        
         if (!proceed || off < entry->dataSize) break;
         
         // Support empty files
@@ -4495,7 +5695,7 @@ bool recursiveDumpRomFsFile(u32 file_offset, char *romfs_path, char *output_path
         {
             uiFill(0, ((progressCtx->line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
             
-            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(output_path, '/') + 1);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/') + 1);
             
             if (progressCtx->totalSize == entry->dataSize) progressCtx->progress = 100;
             
@@ -4503,14 +5703,9 @@ bool recursiveDumpRomFsFile(u32 file_offset, char *romfs_path, char *output_path
         }
         
         // Set archive bit (only for FAT32)
-        if (entry->dataSize > FAT32_FILESIZE_LIMIT && isFat32)
-        {
-            char *tmp = strrchr(output_path, '/');
-            if (tmp != NULL) *tmp = '\0';
-            fsdevSetConcatenationFileAttribute(output_path);
-        }
+        if (partSize) fsdevSetConcatenationFileAttribute(output_path);
         
-        romfs_file_offset = entry->sibling;
+        romfs_file_offset = (dumpSiblingFile ? entry->sibling : ROMFS_ENTRY_EMPTY);
         if (romfs_file_offset == ROMFS_ENTRY_EMPTY) success = true;
     }
     
@@ -4526,7 +5721,7 @@ bool recursiveDumpRomFsFile(u32 file_offset, char *romfs_path, char *output_path
     return success;
 }
 
-bool recursiveDumpRomFsDir(u32 dir_offset, char *romfs_path, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool dumpSiblingDir, bool isFat32)
+bool recursiveDumpRomFsDir(u32 dir_offset, char *romfs_path, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool dumpSiblingDir, bool isFat32, write_pool_ctx_t *writePool)
 {
     if ((!usePatch && (!romFsContext.romfs_dirtable_size || dir_offset > romFsContext.romfs_dirtable_size || !romFsContext.romfs_dir_entries || !romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_dirtable_size || dir_offset > bktrContext.romfs_dirtable_size || !bktrContext.romfs_dir_entries || !bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || !romfs_path || !output_path || !progressCtx)
     {
@@ -4566,7 +5761,7 @@ bool recursiveDumpRomFsDir(u32 dir_offset, char *romfs_path, char *output_path,
     
     if (entry->childFile != ROMFS_ENTRY_EMPTY)
     {
-        if (!recursiveDumpRomFsFile(entry->childFile, romfs_path, output_path, progressCtx, usePatch, isFat32))
+        if (!recursiveDumpRomFsFile(entry->childFile, romfs_path, output_path, progressCtx, usePatch, true, isFat32, writePool))
         {
             romfs_path[orig_romfs_path_len] = '\0';
             output_path[orig_output_path_len] = '\0';
@@ -4576,7 +5771,7 @@ bool recursiveDumpRomFsDir(u32 dir_offset, char *romfs_path, char *output_path,
     
     if (entry->childDir != ROMFS_ENTRY_EMPTY)
     {
-        if (!recursiveDumpRomFsDir(entry->childDir, romfs_path, output_path, progressCtx, usePatch, true, isFat32))
+        if (!recursiveDumpRomFsDir(entry->childDir, romfs_path, output_path, progressCtx, usePatch, true, isFat32, writePool))
         {
             romfs_path[orig_romfs_path_len] = '\0';
             output_path[orig_output_path_len] = '\0';
@@ -4589,7 +5784,7 @@ bool recursiveDumpRomFsDir(u32 dir_offset, char *romfs_path, char *output_path,
     
     if (dumpSiblingDir && entry->sibling != ROMFS_ENTRY_EMPTY)
     {
-        if (!recursiveDumpRomFsDir(entry->sibling, romfs_path, output_path, progressCtx, usePatch, true, isFat32)) return false;
+        if (!recursiveDumpRomFsDir(entry->sibling, romfs_path, output_path, progressCtx, usePatch, true, isFat32, writePool)) return false;
     }
     
     return true;
@@ -4606,6 +5801,8 @@ bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsO
     
     bool isFat32 = romFsDumpCfg->isFat32;
     bool useLayeredFSDir = romFsDumpCfg->useLayeredFSDir;
+    bool useTarArchive = (romFsDumpCfg->useTarArchive && !useLayeredFSDir);
+    bool verifyHashes = romFsDumpCfg->verifyHashes;
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
@@ -4613,6 +5810,11 @@ bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsO
     char *dumpName = NULL;
     char romFsPath[NAME_BUF_LEN * 2] = {'\0'}, dumpPath[NAME_BUF_LEN * 2] = {'\0'};
     
+    write_pool_ctx_t writePool;
+    bool useWritePool = false;
+    
+    u64 tarSize = 0;
+    
     bool success = false;
     
     if ((curRomFsType == ROMFS_TYPE_APP && !titleAppCount) || (curRomFsType == ROMFS_TYPE_PATCH && !titlePatchCount) || (curRomFsType == ROMFS_TYPE_ADDON && !titleAddOnCount))
@@ -4656,12 +5858,31 @@ bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsO
     uiRefreshDisplay();
     breaks++;
     
-    if (progressCtx.totalSize > freeSpace)
+    if (useTarArchive)
+    {
+        if (!recursiveCalculateRomFsTarArchiveSize(0, 0, (curRomFsType == ROMFS_TYPE_PATCH), true, &tarSize))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to calculate output archive size!", __func__);
+            goto out;
+        }
+        
+        tarSize += tarWriterGetTrailerSize();
+        
+        convertSize(tarSize, strbuf, MAX_CHARACTERS(strbuf));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Output TAR archive size: %s (%lu bytes).", strbuf, tarSize);
+        uiRefreshDisplay();
+        breaks++;
+    }
+    
+    if ((useTarArchive ? tarSize : progressCtx.totalSize) > freeSpace)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
         goto out;
     }
     
+    // Check the first hash level before creating any output files
+    if (verifyHashes && !ivfcVerifyInit(&romFsVerifyCtx, (curRomFsType == ROMFS_TYPE_PATCH))) goto out;
+    
     // Generate output path
     if (!useLayeredFSDir)
     {
@@ -4686,7 +5907,12 @@ bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsO
         strcat(dumpPath, "/romfs");
     }
     
-    mkdir(dumpPath, 0744);
+    if (useTarArchive)
+    {
+        strcat(dumpPath, ".tar");
+    } else {
+        mkdir(dumpPath, 0744);
+    }
     
     // Start dump process
     breaks++;
@@ -4700,7 +5926,28 @@ bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsO
     progressCtx.line_offset = (breaks + 4);
     timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
     
-    success = recursiveDumpRomFsDir(0, romFsPath, dumpPath, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), true, isFat32);
+    if (useTarArchive)
+    {
+        success = dumpRomFsDirToTarArchive(0, romFsPath, dumpPath, tarSize, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), true, isFat32);
+    } else {
+        // Writer threads are optional: if they can't be started, all files are written from this thread
+        useWritePool = writePoolInit(&writePool);
+        
+        success = recursiveDumpRomFsDir(0, romFsPath, dumpPath, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), true, isFat32, (useWritePool ? &writePool : NULL));
+        
+        if (useWritePool)
+        {
+            // Make sure all queued files have been written before checking the result
+            if (!writePoolWait(&writePool) && success)
+            {
+                breaks = (progressCtx.line_offset + 2);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writePool.errorMsg);
+                success = false;
+            }
+            
+            writePoolClose(&writePool);
+        }
+    }
     
     if (success)
     {
@@ -4713,10 +5960,14 @@ bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsO
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
     } else {
         setProgressBarError(&progressCtx);
-        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
+        
+        // The output archive has already been deleted at this point
+        if (!useTarArchive) removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
     }
     
 out:
+    ivfcVerifyClose(&romFsVerifyCtx);
+    
     if (curRomFsType == ROMFS_TYPE_PATCH) freeBktrContext();
     
     freeRomFsContext();
@@ -4741,6 +5992,7 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
     
     bool isFat32 = romFsDumpCfg->isFat32;
     bool useLayeredFSDir = romFsDumpCfg->useLayeredFSDir;
+    bool verifyHashes = romFsDumpCfg->verifyHashes;
     
     if ((curRomFsType != ROMFS_TYPE_PATCH && (!romFsContext.romfs_filetable_size || file_offset > romFsContext.romfs_filetable_size || !romFsContext.romfs_file_entries)) || (curRomFsType == ROMFS_TYPE_PATCH && (!bktrContext.romfs_filetable_size || file_offset > bktrContext.romfs_filetable_size || !bktrContext.romfs_file_entries)) || (curRomFsType == ROMFS_TYPE_APP && titleIndex > (titleAppCount - 1)) || (curRomFsType == ROMFS_TYPE_PATCH && titleIndex > (titlePatchCount - 1)) || (curRomFsType == ROMFS_TYPE_ADDON && titleIndex > (titleAddOnCount - 1)))
     {
@@ -4750,18 +6002,16 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
     }
     
     u64 n = DUMP_BUFFER_SIZE;
-    FILE *outFile = NULL;
-    u8 splitIndex = 0;
-    size_t write_res;
+    split_writer_ctx_t outWriter;
     bool proceed = true, success = false, fat32_error = false, removeFile = true;
     
-    char tmp_idx[5];
     char *dumpName = NULL;
     char dumpPath[NAME_BUF_LEN * 2] = {'\0'};
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
     
+    memset(&outWriter, 0, sizeof(split_writer_ctx_t));
     memset(dumpBuf, 0, DUMP_BUFFER_SIZE);
     
     romfs_file *entry = (curRomFsType != ROMFS_TYPE_PATCH ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + file_offset));
@@ -4886,10 +6136,6 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
         // Better safe than sorry
         remove(dumpPath);
         fsdevDeleteDirectoryRecursively(dumpPath);
-        
-        mkdir(dumpPath, 0744);
-        sprintf(tmp_idx, "/%02u", splitIndex);
-        strcat(dumpPath, tmp_idx);
     }
     
     // Start dump process
@@ -4909,12 +6155,9 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
     
     breaks += 2;
     
-    outFile = fopen(dumpPath, "wb");
-    if (!outFile)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, dumpPath);
-        goto out;
-    }
+    if (verifyHashes && !ivfcVerifyInit(&romFsVerifyCtx, (curRomFsType == ROMFS_TYPE_PATCH))) goto out;
+    
+    if (!splitWriterOpen(&outWriter, dumpPath, progressCtx.totalSize, ((progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32) ? SPLIT_FILE_GENERIC_PART_SIZE : 0), SPLIT_WRITER_NAMING_DIRECTORY, 0)) goto out;
     
     progressCtx.line_offset = (breaks + 2);
     timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
@@ -4923,7 +6166,7 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
     {
         uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/') + 1);
         
         uiRefreshDisplay();
         
@@ -4931,75 +6174,27 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
         
         breaks = (progressCtx.line_offset + 2);
         
-        if (curRomFsType != ROMFS_TYPE_PATCH)
-        {
-            proceed = processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff + progressCtx.curOffset, dumpBuf, n, false);
-        } else {
-            proceed = readBktrSectionBlock(bktrContext.romfs_filedata_offset + entry->dataOff + progressCtx.curOffset, dumpBuf, n);
-        }
+        proceed = readRomFsFileData(entry->dataOff + progressCtx.curOffset, dumpBuf, n, (curRomFsType == ROMFS_TYPE_PATCH));
         
         breaks = (progressCtx.line_offset - 2);
         
         if (!proceed) break;
         
-        if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32 && (progressCtx.curOffset + n) >= ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE))
-        {
-            u64 new_file_chunk_size = ((progressCtx.curOffset + n) - ((splitIndex + 1) * SPLIT_FILE_GENERIC_PART_SIZE));
-            u64 old_file_chunk_size = (n - new_file_chunk_size);
-            
-            if (old_file_chunk_size > 0)
-            {
-                write_res = fwrite(dumpBuf, 1, old_file_chunk_size, outFile);
-                if (write_res != old_file_chunk_size)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, old_file_chunk_size, progressCtx.curOffset, splitIndex, write_res);
-                    break;
-                }
-            }
-            
-            fclose(outFile);
-            outFile = NULL;
-            
-            if (new_file_chunk_size > 0 || (progressCtx.curOffset + n) < progressCtx.totalSize)
+        breaks = (progressCtx.line_offset + 2);
+        
+        proceed = splitWriterWrite(&outWriter, dumpBuf, n);
+        
+        breaks = (progressCtx.line_offset - 2);
+        
+        if (!proceed)
+        {
+            if (!outWriter.part_size && (progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
             {
-                char *tmp = strrchr(dumpPath, '/');
-                if (tmp != NULL) *tmp = '\0';
-                
-                splitIndex++;
-                sprintf(tmp_idx, "/%02u", splitIndex);
-                strcat(dumpPath, tmp_idx);
-                
-                outFile = fopen(dumpPath, "wb");
-                if (!outFile)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to open output file for part #%u!", __func__, splitIndex);
-                    break;
-                }
-                
-                if (new_file_chunk_size > 0)
-                {
-                    write_res = fwrite(dumpBuf + old_file_chunk_size, 1, new_file_chunk_size, outFile);
-                    if (write_res != new_file_chunk_size)
-                    {
-                        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, new_file_chunk_size, progressCtx.curOffset + old_file_chunk_size, splitIndex, write_res);
-                        break;
-                    }
-                }
-            }
-        } else {
-            write_res = fwrite(dumpBuf, 1, n, outFile);
-            if (write_res != n)
-            {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, n, progressCtx.curOffset, write_res);
-                
-                if ((progressCtx.curOffset + n) > FAT32_FILESIZE_LIMIT)
-                {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
-                    fat32_error = true;
-                }
-                
-                break;
+                uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset + 4), FONT_COLOR_RGB, "You're probably using a FAT32 partition. Make sure to enable file splitting.");
+                fat32_error = true;
             }
+            
+            break;
         }
         
         printProgressBar(&progressCtx, true, n);
@@ -5011,22 +6206,22 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
         }
     }
     
-    if (progressCtx.curOffset >= progressCtx.totalSize) success = true;
+    breaks = (progressCtx.line_offset + 2);
+    
+    if (progressCtx.curOffset >= progressCtx.totalSize && splitWriterClose(&outWriter)) success = true;
     
     // Support empty files
     if (!progressCtx.totalSize)
     {
         uiFill(0, ((progressCtx.line_offset - 2) * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT * 2, BG_COLOR_RGB);
         
-        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(dumpPath, '/') + 1);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx.line_offset - 2), FONT_COLOR_RGB, "Output file: \"%s\".", strrchr(outWriter.path, '/') + 1);
         
         progressCtx.progress = 100;
         
         printProgressBar(&progressCtx, false, 0);
     }
     
-    breaks = (progressCtx.line_offset + 2);
-    
     if (success)
     {
         timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
@@ -5040,22 +6235,16 @@ bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType
     }
     
 out:
-    if (outFile) fclose(outFile);
+    ivfcVerifyClose(&romFsVerifyCtx);
     
-    if (progressCtx.totalSize > FAT32_FILESIZE_LIMIT && isFat32)
+    splitWriterAbort(&outWriter);
+    
+    if (success)
     {
-        char *tmp = strrchr(dumpPath, '/');
-        if (tmp != NULL) *tmp = '\0';
-        
-        if (success)
-        {
-            // Set archive bit (only for FAT32)
-            fsdevSetConcatenationFileAttribute(dumpPath);
-        } else {
-            if (removeFile) fsdevDeleteDirectoryRecursively(dumpPath);
-        }
+        // Set archive bit (only for FAT32)
+        if (outWriter.part_size) fsdevSetConcatenationFileAttribute(dumpPath);
     } else {
-        if (!success && removeFile) remove(dumpPath);
+        if (removeFile) splitWriterDelete(&outWriter);
     }
     
     if (dumpName) free(dumpName);
@@ -5078,6 +6267,8 @@ bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsTy
     
     bool isFat32 = romFsDumpCfg->isFat32;
     bool useLayeredFSDir = romFsDumpCfg->useLayeredFSDir;
+    bool useTarArchive = (romFsDumpCfg->useTarArchive && !useLayeredFSDir);
+    bool verifyHashes = romFsDumpCfg->verifyHashes;
     
     progress_ctx_t progressCtx;
     memset(&progressCtx, 0, sizeof(progress_ctx_t));
@@ -5085,6 +6276,11 @@ bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsTy
     char *dumpName = NULL;
     char romFsPath[NAME_BUF_LEN * 2] = {'\0'}, dumpPath[NAME_BUF_LEN * 2] = {'\0'};
     
+    write_pool_ctx_t writePool;
+    bool useWritePool = false;
+    
+    u64 tarSize = 0;
+    
     bool success = false;
     
     if ((curRomFsType == ROMFS_TYPE_APP && !titleAppCount) || (curRomFsType == ROMFS_TYPE_PATCH && !titlePatchCount) || (curRomFsType == ROMFS_TYPE_ADDON && !titleAddOnCount))
@@ -5120,12 +6316,32 @@ bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsTy
     uiRefreshDisplay();
     breaks++;
     
-    if (progressCtx.totalSize > freeSpace)
+    if (useTarArchive)
+    {
+        // Archive entry names are relative to the RomFS root, even if we're only dumping a subdirectory
+        if (!recursiveCalculateRomFsTarArchiveSize(curRomFsDirOffset, (strlen(curRomFsPath) > 1 ? (size_t)(strrchr(curRomFsPath, '/') - curRomFsPath) : 0), (curRomFsType == ROMFS_TYPE_PATCH), false, &tarSize))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to calculate output archive size!", __func__);
+            goto out;
+        }
+        
+        tarSize += tarWriterGetTrailerSize();
+        
+        convertSize(tarSize, strbuf, MAX_CHARACTERS(strbuf));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Output TAR archive size: %s (%lu bytes).", strbuf, tarSize);
+        uiRefreshDisplay();
+        breaks++;
+    }
+    
+    if ((useTarArchive ? tarSize : progressCtx.totalSize) > freeSpace)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
         goto out;
     }
     
+    // Check the first hash level before creating any output files
+    if (verifyHashes && !ivfcVerifyInit(&romFsVerifyCtx, (curRomFsType == ROMFS_TYPE_PATCH))) goto out;
+    
     if (strlen(curRomFsPath) > 1)
     {
         // Copy the whole current path and remove the last element (current directory) from it
@@ -5159,13 +6375,18 @@ bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsTy
         strcat(dumpPath, "/romfs");
     }
     
-    mkdir(dumpPath, 0744);
+    if (useTarArchive)
+    {
+        strcat(dumpPath, ".tar");
+    } else {
+        mkdir(dumpPath, 0744);
+    }
     
-    // Create subdirectories
+    // Create subdirectories (not needed for archives)
     char *tmp1 = NULL, *tmp2 = NULL;
     size_t cur_len;
     
-    tmp1 = strchr(curRomFsPath, '/');
+    tmp1 = (!useTarArchive ? strchr(curRomFsPath, '/') : NULL);
     
     while(tmp1 != NULL)
     {
@@ -5205,7 +6426,28 @@ bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsTy
     progressCtx.line_offset = (breaks + 4);
     timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
     
-    success = recursiveDumpRomFsDir(curRomFsDirOffset, romFsPath, dumpPath, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), false, isFat32);
+    if (useTarArchive)
+    {
+        success = dumpRomFsDirToTarArchive(curRomFsDirOffset, romFsPath, dumpPath, tarSize, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), false, isFat32);
+    } else {
+        // Writer threads are optional: if they can't be started, all files are written from this thread
+        useWritePool = writePoolInit(&writePool);
+        
+        success = recursiveDumpRomFsDir(curRomFsDirOffset, romFsPath, dumpPath, &progressCtx, (curRomFsType == ROMFS_TYPE_PATCH), false, isFat32, (useWritePool ? &writePool : NULL));
+        
+        if (useWritePool)
+        {
+            // Make sure all queued files have been written before checking the result
+            if (!writePoolWait(&writePool) && success)
+            {
+                breaks = (progressCtx.line_offset + 2);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writePool.errorMsg);
+                success = false;
+            }
+            
+            writePoolClose(&writePool);
+        }
+    }
     
     if (success)
     {
@@ -5218,10 +6460,471 @@ bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsTy
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
     } else {
         setProgressBarError(&progressCtx);
-        removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
+        
+        // The output archive has already been deleted at this point
+        if (!useTarArchive) removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
+    }
+    
+out:
+    ivfcVerifyClose(&romFsVerifyCtx);
+    
+    if (dumpName) free(dumpName);
+    
+    breaks += 2;
+    
+    changeHomeButtonBlockStatus(false);
+    
+    return success;
+}
+
+static bool getRomFsFileFullPath(u32 file_offset, bool usePatch, char *out, size_t outSize)
+{
+    u32 dir_offset;
+    size_t path_len, cur_len;
+    
+    romfs_dir *dirEntry = NULL;
+    romfs_file *fileEntry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + file_offset));
+    
+    // Calculate the full path length first, since parent entries are retrieved from the innermost one
+    path_len = (1 + fileEntry->nameLen);
+    
+    for(dir_offset = fileEntry->parent; dir_offset != 0; dir_offset = dirEntry->parent)
+    {
+        dirEntry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + dir_offset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + dir_offset));
+        path_len += (1 + dirEntry->nameLen);
+    }
+    
+    if (path_len >= outSize) return false;
+    
+    out[path_len] = '\0';
+    
+    cur_len = (path_len - fileEntry->nameLen);
+    memcpy(out + cur_len, fileEntry->name, fileEntry->nameLen);
+    out[--cur_len] = '/';
+    
+    for(dir_offset = fileEntry->parent; dir_offset != 0; dir_offset = dirEntry->parent)
+    {
+        dirEntry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + dir_offset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + dir_offset));
+        
+        cur_len -= dirEntry->nameLen;
+        memcpy(out + cur_len, dirEntry->name, dirEntry->nameLen);
+        out[--cur_len] = '/';
+    }
+    
+    return true;
+}
+
+static bool recursiveCollectFilteredRomFsFiles(u32 dir_offset, char *romfs_path, const romfs_filter_t *filter, bool usePatch, bool dumpSiblingDir, u32 **fileOffsets, u32 *fileCount, u64 *dataSize, u64 *tarSize)
+{
+    if ((!usePatch && (!romFsContext.romfs_dirtable_size || dir_offset > romFsContext.romfs_dirtable_size || !romFsContext.romfs_dir_entries || !romFsContext.romfs_file_entries)) || (usePatch && (!bktrContext.romfs_dirtable_size || dir_offset > bktrContext.romfs_dirtable_size || !bktrContext.romfs_dir_entries || !bktrContext.romfs_file_entries)) || !romfs_path || !filter || !fileOffsets || !fileCount || !dataSize || !tarSize) return false;
+    
+    size_t orig_romfs_path_len = strlen(romfs_path);
+    size_t cur_romfs_path_len;
+    
+    u32 file_offset;
+    u32 *tmpOffsets = NULL;
+    bool proceed = true;
+    
+    romfs_file *fileEntry = NULL;
+    romfs_dir *dirEntry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + dir_offset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + dir_offset));
+    
+    if ((orig_romfs_path_len + 1 + dirEntry->nameLen) >= (NAME_BUF_LEN * 2)) return false;
+    
+    if (dirEntry->nameLen)
+    {
+        strcat(romfs_path, "/");
+        strncat(romfs_path, (char*)dirEntry->name, dirEntry->nameLen);
+    }
+    
+    cur_romfs_path_len = strlen(romfs_path);
+    
+    // Skip the whole directory if it has been excluded
+    if (!dirEntry->nameLen || !romFsFilterIsPathExcluded(filter, romfs_path))
+    {
+        file_offset = dirEntry->childFile;
+        
+        while(file_offset != ROMFS_ENTRY_EMPTY)
+        {
+            fileEntry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + file_offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + file_offset));
+            
+            if (!fileEntry->nameLen || (cur_romfs_path_len + 1 + fileEntry->nameLen) >= (NAME_BUF_LEN * 2))
+            {
+                proceed = false;
+                break;
+            }
+            
+            strcat(romfs_path, "/");
+            strncat(romfs_path, (char*)fileEntry->name, fileEntry->nameLen);
+            
+            if (romFsFilterMatchPath(filter, romfs_path))
+            {
+                // Grow the offset list in steps to avoid reallocating it for each matched file
+                if (!(*fileCount % ROMFS_FILTER_OFFSET_LIST_STEP))
+                {
+                    tmpOffsets = realloc(*fileOffsets, (*fileCount + ROMFS_FILTER_OFFSET_LIST_STEP) * sizeof(u32));
+                    if (!tmpOffsets)
+                    {
+                        proceed = false;
+                        break;
+                    }
+                    
+                    *fileOffsets = tmpOffsets;
+                    tmpOffsets = NULL;
+                }
+                
+                (*fileOffsets)[(*fileCount)++] = file_offset;
+                
+                *dataSize += fileEntry->dataSize;
+                
+                // Archive entry names don't include the leading slash
+                *tarSize += tarWriterGetEntrySize(strlen(romfs_path) - 1, fileEntry->dataSize, false);
+            }
+            
+            romfs_path[cur_romfs_path_len] = '\0';
+            
+            file_offset = fileEntry->sibling;
+        }
+        
+        if (proceed && dirEntry->childDir != ROMFS_ENTRY_EMPTY) proceed = recursiveCollectFilteredRomFsFiles(dirEntry->childDir, romfs_path, filter, usePatch, true, fileOffsets, fileCount, dataSize, tarSize);
+    }
+    
+    romfs_path[orig_romfs_path_len] = '\0';
+    
+    if (proceed && dumpSiblingDir && dirEntry->sibling != ROMFS_ENTRY_EMPTY) proceed = recursiveCollectFilteredRomFsFiles(dirEntry->sibling, romfs_path, filter, usePatch, true, fileOffsets, fileCount, dataSize, tarSize);
+    
+    return proceed;
+}
+
+static bool dumpFilteredRomFsFiles(u32 *fileOffsets, u32 fileCount, char *output_path, progress_ctx_t *progressCtx, bool usePatch, bool isFat32, write_pool_ctx_t *writePool)
+{
+    u32 i;
+    u32 prev_parent = ROMFS_ENTRY_EMPTY;
+    
+    size_t orig_output_path_len = strlen(output_path);
+    size_t dir_len = 0;
+    
+    char romfs_path[NAME_BUF_LEN * 2] = {'\0'};
+    char *tmp1 = NULL, *tmp2 = NULL;
+    
+    romfs_file *fileEntry = NULL;
+    
+    bool success = true;
+    
+    for(i = 0; i < fileCount; i++)
+    {
+        fileEntry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + fileOffsets[i]) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + fileOffsets[i]));
+        
+        if (!getRomFsFileFullPath(fileOffsets[i], usePatch, romfs_path, MAX_ELEMENTS(romfs_path)))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section file path is too long!", __func__);
+            success = false;
+            break;
+        }
+        
+        // Remove the filename. recursiveDumpRomFsFile() expects the path to its parent directory
+        tmp1 = strrchr(romfs_path, '/');
+        *tmp1 = '\0';
+        
+        // Files are sorted by parent directory, so we only need to create the output directories whenever it changes
+        if (fileEntry->parent != prev_parent)
+        {
+            output_path[orig_output_path_len] = '\0';
+            
+            tmp1 = romfs_path;
+            
+            while(*tmp1 == '/')
+            {
+                tmp1++;
+                tmp2 = strchr(tmp1, '/');
+                
+                dir_len = (tmp2 != NULL ? (size_t)(tmp2 - tmp1) : strlen(tmp1));
+                
+                if ((strlen(output_path) + 1 + dir_len) >= (NAME_BUF_LEN * 2))
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: output directory path is too long!", __func__);
+                    success = false;
+                    break;
+                }
+                
+                strcat(output_path, "/");
+                
+                size_t cur_len = strlen(output_path);
+                strncat(output_path, tmp1, dir_len);
+                removeIllegalCharacters(output_path + cur_len);
+                
+                mkdir(output_path, 0744);
+                
+                tmp1 += dir_len;
+            }
+            
+            if (!success) break;
+            
+            prev_parent = fileEntry->parent;
+        }
+        
+        if (!recursiveDumpRomFsFile(fileOffsets[i], romfs_path, output_path, progressCtx, usePatch, false, isFat32, writePool))
+        {
+            success = false;
+            break;
+        }
+    }
+    
+    output_path[orig_output_path_len] = '\0';
+    
+    return success;
+}
+
+static bool dumpFilteredRomFsFilesToTarArchive(u32 *fileOffsets, u32 fileCount, const char *output_path, u64 tarSize, progress_ctx_t *progressCtx, bool usePatch, bool isFat32)
+{
+    u32 i;
+    bool success = true;
+    tar_writer_ctx_t tar;
+    
+    char romfs_path[NAME_BUF_LEN * 2] = {'\0'};
+    romfs_file *fileEntry = NULL;
+    
+    breaks = (progressCtx->line_offset + 2);
+    
+    if (!tarWriterOpen(&tar, output_path, tarSize, ((isFat32 && tarSize > FAT32_FILESIZE_LIMIT) ? SPLIT_FILE_GENERIC_PART_SIZE : 0))) return false;
+    
+    for(i = 0; i < fileCount; i++)
+    {
+        fileEntry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + fileOffsets[i]) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + fileOffsets[i]));
+        
+        if (!getRomFsFileFullPath(fileOffsets[i], usePatch, romfs_path, MAX_ELEMENTS(romfs_path)))
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(progressCtx->line_offset + 2), FONT_COLOR_ERROR_RGB, "%s: RomFS section file path is too long!", __func__);
+            success = false;
+            break;
+        }
+        
+        if (!dumpRomFsFileToTarArchive(fileEntry, romfs_path, &tar, progressCtx, usePatch))
+        {
+            success = false;
+            break;
+        }
+    }
+    
+    if (success)
+    {
+        breaks = (progressCtx->line_offset + 2);
+        success = tarWriterClose(&tar);
+    }
+    
+    if (!success) tarWriterDelete(&tar);
+    
+    return success;
+}
+
+bool dumpFilteredRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg, romfs_filter_t *markedEntries)
+{
+    if (!romFsDumpCfg)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid RomFS configuration struct!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    bool isFat32 = romFsDumpCfg->isFat32;
+    bool useLayeredFSDir = romFsDumpCfg->useLayeredFSDir;
+    bool useTarArchive = (romFsDumpCfg->useTarArchive && !useLayeredFSDir);
+    bool verifyHashes = romFsDumpCfg->verifyHashes;
+    bool usePatch = (curRomFsType == ROMFS_TYPE_PATCH);
+    
+    progress_ctx_t progressCtx;
+    memset(&progressCtx, 0, sizeof(progress_ctx_t));
+    
+    char *dumpName = NULL;
+    char romFsPath[NAME_BUF_LEN * 2] = {'\0'}, dumpPath[NAME_BUF_LEN * 2] = {'\0'};
+    
+    romfs_filter_t filter;
+    u32 filterFileCount = 0;
+    
+    u32 *fileOffsets = NULL;
+    u32 fileCount = 0;
+    
+    write_pool_ctx_t writePool;
+    bool useWritePool = false;
+    
+    u64 tarSize = 0;
+    
+    bool success = false;
+    
+    romFsFilterInit(&filter);
+    
+    if ((curRomFsType == ROMFS_TYPE_APP && !titleAppCount) || (curRomFsType == ROMFS_TYPE_PATCH && !titlePatchCount) || (curRomFsType == ROMFS_TYPE_ADDON && !titleAddOnCount))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title count!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    if ((curRomFsType == ROMFS_TYPE_APP && titleIndex > (titleAppCount - 1)) || (curRomFsType == ROMFS_TYPE_PATCH && titleIndex > (titlePatchCount - 1)) || (curRomFsType == ROMFS_TYPE_ADDON && titleIndex > (titleAddOnCount - 1)))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid title index!", __func__);
+        breaks += 2;
+        return false;
+    }
+    
+    // Entries marked in the RomFS section browser are used as include patterns, and get combined with the patterns from the filter file
+    if (markedEntries && !romFsFilterAddPatternsFromFilter(&filter, markedEntries))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to copy marked RomFS entries!", __func__);
+        goto out;
+    }
+    
+    if (!romFsFilterLoadFile(&filter, ROMFS_FILTER_PATH, &filterFileCount))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to load patterns from \"%s\"! Max pattern count: %u.", __func__, strchr(ROMFS_FILTER_PATH, '/'), ROMFS_FILTER_MAX_PATTERNS);
+        goto out;
+    }
+    
+    if (!filter.entry_cnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: no marked entries and no patterns available in \"%s\"!", __func__, strchr(ROMFS_FILTER_PATH, '/'));
+        goto out;
+    }
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Marked entries: %u | Patterns loaded from \"%s\": %u.", (markedEntries ? markedEntries->entry_cnt : 0), strchr(ROMFS_FILTER_PATH, '/'), filterFileCount);
+    uiRefreshDisplay();
+    breaks++;
+    
+    // Resolve all matching files with a single walk through the RomFS tables
+    if (!recursiveCollectFilteredRomFsFiles(0, romFsPath, &filter, usePatch, true, &fileOffsets, &fileCount, &(progressCtx.totalSize), &tarSize))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to parse RomFS section entries!", __func__);
+        goto out;
+    }
+    
+    if (!fileCount)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: no RomFS section entries match the provided patterns!", __func__);
+        goto out;
+    }
+    
+    convertSize(progressCtx.totalSize, progressCtx.totalSizeStr, MAX_CHARACTERS(progressCtx.totalSizeStr));
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Matching files: %u | Extracted size: %s (%lu bytes).", fileCount, progressCtx.totalSizeStr, progressCtx.totalSize);
+    uiRefreshDisplay();
+    breaks++;
+    
+    if (useTarArchive)
+    {
+        tarSize += tarWriterGetTrailerSize();
+        
+        convertSize(tarSize, strbuf, MAX_CHARACTERS(strbuf));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Output TAR archive size: %s (%lu bytes).", strbuf, tarSize);
+        uiRefreshDisplay();
+        breaks++;
+    }
+    
+    if ((useTarArchive ? tarSize : progressCtx.totalSize) > freeSpace)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: not enough free space available in the SD card!", __func__);
+        goto out;
+    }
+    
+    // Check the first hash level before creating any output files
+    if (verifyHashes && !ivfcVerifyInit(&romFsVerifyCtx, (curRomFsType == ROMFS_TYPE_PATCH))) goto out;
+    
+    if (!useLayeredFSDir)
+    {
+        dumpName = generateNSPDumpName((curRomFsType == ROMFS_TYPE_APP ? DUMP_APP_NSP : (curRomFsType == ROMFS_TYPE_PATCH ? DUMP_PATCH_NSP : DUMP_ADDON_NSP)), titleIndex, false);
+        if (!dumpName)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to generate output dump name!", __func__);
+            goto out;
+        }
+    }
+    
+    // Generate output path
+    if (!useLayeredFSDir)
+    {
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s", ROMFS_DUMP_PATH, dumpName);
+        
+        if ((curRomFsType != ROMFS_TYPE_PATCH && romFsContext.idOffset > 0) || (curRomFsType == ROMFS_TYPE_PATCH && bktrContext.idOffset > 0))
+        {
+            sprintf(strbuf, " (ID offset #%u)", (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset));
+            strcat(dumpPath, strbuf);
+        }
+    } else {
+        mkdir(cfwDirStr, 0744);
+        
+        // Base applications and updates: always use the base application title ID
+        // DLCs: use DLC title ID
+        u64 titleId = (curRomFsType == ROMFS_TYPE_APP ? baseAppEntries[titleIndex].titleId : (curRomFsType == ROMFS_TYPE_PATCH ? (patchEntries[titleIndex].titleId & ~APPLICATION_PATCH_BITMASK) : addOnEntries[titleIndex].titleId));
+        titleId += (curRomFsType != ROMFS_TYPE_PATCH ? romFsContext.idOffset : bktrContext.idOffset);
+        
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%016lX", cfwDirStr, titleId);
+        mkdir(dumpPath, 0744);
+        
+        strcat(dumpPath, "/romfs");
+    }
+    
+    if (useTarArchive)
+    {
+        strcat(dumpPath, " (filtered).tar");
+    } else {
+        mkdir(dumpPath, 0744);
+    }
+    
+    // Start dump process
+    breaks++;
+    dumpStartMsg();
+    appletModeOperationWarning();
+    uiRefreshDisplay();
+    breaks++;
+    
+    changeHomeButtonBlockStatus(true);
+    
+    progressCtx.line_offset = (breaks + 4);
+    timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.start));
+    
+    if (useTarArchive)
+    {
+        success = dumpFilteredRomFsFilesToTarArchive(fileOffsets, fileCount, dumpPath, tarSize, &progressCtx, usePatch, isFat32);
+    } else {
+        // Writer threads are optional: if they can't be started, all files are written from this thread
+        useWritePool = writePoolInit(&writePool);
+        
+        success = dumpFilteredRomFsFiles(fileOffsets, fileCount, dumpPath, &progressCtx, usePatch, isFat32, (useWritePool ? &writePool : NULL));
+        
+        if (useWritePool)
+        {
+            // Make sure all queued files have been written before checking the result
+            if (!writePoolWait(&writePool) && success)
+            {
+                breaks = (progressCtx.line_offset + 2);
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s", __func__, writePool.errorMsg);
+                success = false;
+            }
+            
+            writePoolClose(&writePool);
+        }
+    }
+    
+    if (success)
+    {
+        breaks = (progressCtx.line_offset + 2);
+        
+        timeGetCurrentTime(TimeType_LocalSystemClock, &(progressCtx.now));
+        progressCtx.now -= progressCtx.start;
+        
+        formatETAString(progressCtx.now, progressCtx.etaInfo, MAX_CHARACTERS(progressCtx.etaInfo));
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, "Process successfully completed after %s!", progressCtx.etaInfo);
+    } else {
+        setProgressBarError(&progressCtx);
+        
+        // The output archive has already been deleted at this point
+        if (!useTarArchive) removeDirectoryWithVerbose(dumpPath, "Deleting output directory. Please wait...");
     }
     
 out:
+    ivfcVerifyClose(&romFsVerifyCtx);
+    
+    if (fileOffsets) free(fileOffsets);
+    
+    romFsFilterFree(&filter);
+    
     if (dumpName) free(dumpName);
     
     breaks += 2;
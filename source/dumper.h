@@ -5,6 +5,7 @@
 
 #include <switch.h>
 #include "util.h"
+#include "romfs_filter.h"
 
 #define FAT32_FILESIZE_LIMIT            (u64)0xFFFFFFFF             // 4 GiB - 1 (4294967295 bytes)
 
@@ -13,6 +14,11 @@
 #define SPLIT_FILE_GENERIC_PART_SIZE    SPLIT_FILE_NSP_PART_SIZE
 #define SPLIT_FILE_SEQUENTIAL_SIZE      (u64)0x40000000             // 1 GiB (used for sequential dumps when there's not enough storage space available)
 
+#define SEQ_DUMP_CHECKPOINT_PART_INTERVAL   1                           // Number of completed sequential dump parts between checkpoints
+#define SEQ_DUMP_CHECKPOINT_TAIL_SIZE       (u64)0x10000                // 64 KiB (65536 bytes). Data from the end of the last completed part used to validate a checkpoint
+#define SEQ_DUMP_CHECKPOINT_MAX_SIZE        (u64)0x100000               // 1 MiB (1048576 bytes)
+#define SEQ_DUMP_CHECKPOINT_MAGIC           0x54504B43                  // "CKPT"
+
 #define CERT_OFFSET                     0x7000
 #define CERT_SIZE                       0x200
 
@@ -44,6 +50,24 @@ typedef struct {
     Sha256Context hashCtx;                          // Current NCA SHA-256 checksum context. Only used when dealing with the same NCA between different parts
 } PACKED sequentialNspCtx;
 
+// Checkpoints are taken while a sequential dump session is running, so a session interrupted by a crash or power loss can be resumed from the last completed part
+// The checkpoint file holds the updated sequential dump context (plus the NCA hashes for NSP dumps) followed by this footer. On the next run, that data replaces the start of the sequential dump reference file
+typedef struct {
+    u32 magic;                                      // SEQ_DUMP_CHECKPOINT_MAGIC
+    u32 payloadSize;                                // Size of the data that precedes the footer
+    u32 lastPart;                                   // Last part that had been completely written when the checkpoint was taken
+    u32 tailCrc;                                    // CRC32 checksum of the last SEQ_DUMP_CHECKPOINT_TAIL_SIZE bytes from the last part
+    u64 lastPartSize;
+    u32 crc;                                        // CRC32 checksum of the payload and all the previous footer fields
+} PACKED sequentialDumpCheckpointFooter;
+
+// Data source for a PFS0 entry from an output NSP other than a regular NCA
+// Files generated at dump time are kept in memory, while files copied as-is from a NCA RomFS section are read when they're written
+typedef struct {
+    const u8 *data;                                 // In-memory file data. NULL if 'ref' is used instead
+    const nca_romfs_file_ref *ref;                  // NACP icons and legalinfo.xml
+} nspFileSource;
+
 typedef struct {
     bool enabled;
     nspDumpType titleType;
@@ -52,6 +76,7 @@ typedef struct {
     char *contentSizeStr;
     char nspFilename[NAME_BUF_LEN];
     char truncatedNspFilename[NAME_BUF_LEN];
+    bool backgroundCopied;                          // NCAs have been copied into the NCA store on a background thread while another title was being dumped
 } batchEntry;
 
 bool dumpNXCardImage(xciOptions *xciDumpCfg);
@@ -65,6 +90,7 @@ bool dumpFileFromExeFsSection(u32 titleIndex, u32 fileIndex, bool usePatch, ncaF
 bool dumpRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg);
 bool dumpFileFromRomFsSection(u32 titleIndex, u32 file_offset, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg);
 bool dumpCurrentDirFromRomFsSection(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg);
+bool dumpFilteredRomFsSectionData(u32 titleIndex, selectedRomFsType curRomFsType, ncaFsOptions *romFsDumpCfg, romfs_filter_t *markedEntries);
 bool dumpGameCardCertificate();
 bool dumpTicketFromTitle(u32 titleIndex, selectedTicketType curTikType, ticketOptions *tikDumpCfg);
 
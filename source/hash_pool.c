@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash_pool.h"
+
+// Must be called with the mutex locked
+static void hashPoolProcessJob(hash_pool_ctx_t *pool)
+{
+    u32 i, start, cnt;
+    
+    while(pool->job_next_block < pool->job_block_cnt)
+    {
+        start = pool->job_next_block;
+        cnt = (pool->job_block_cnt - start);
+        if (cnt > HASH_POOL_JOB_BLOCK_CNT) cnt = HASH_POOL_JOB_BLOCK_CNT;
+        
+        pool->job_next_block += cnt;
+        
+        pthread_mutex_unlock(&(pool->mutex));
+        
+        for(i = start; i < (start + cnt); i++) sha256CalculateHash(pool->job_hashes + (i * SHA256_HASH_SIZE), pool->job_data + (i * pool->job_block_size), (i == (pool->job_block_cnt - 1) ? pool->job_last_block_size : pool->job_block_size));
+        
+        pthread_mutex_lock(&(pool->mutex));
+        
+        pool->job_done_cnt += cnt;
+        if (pool->job_done_cnt == pool->job_block_cnt) pthread_cond_broadcast(&(pool->done_cond));
+    }
+}
+
+static void *hashPoolThreadFunc(void *arg)
+{
+    hash_pool_ctx_t *pool = (hash_pool_ctx_t*)arg;
+    
+    pthread_mutex_lock(&(pool->mutex));
+    
+    while(true)
+    {
+        while(pool->job_next_block >= pool->job_block_cnt && !pool->closing) pthread_cond_wait(&(pool->job_cond), &(pool->mutex));
+        
+        if (pool->closing) break;
+        
+        hashPoolProcessJob(pool);
+    }
+    
+    pthread_mutex_unlock(&(pool->mutex));
+    
+    return NULL;
+}
+
+bool hashPoolInit(hash_pool_ctx_t *pool)
+{
+    if (!pool) return false;
+    
+    u32 i;
+    
+    memset(pool, 0, sizeof(hash_pool_ctx_t));
+    
+    if (pthread_mutex_init(&(pool->mutex), NULL) != 0) return false;
+    
+    if (pthread_cond_init(&(pool->job_cond), NULL) != 0)
+    {
+        pthread_mutex_destroy(&(pool->mutex));
+        return false;
+    }
+    
+    if (pthread_cond_init(&(pool->done_cond), NULL) != 0)
+    {
+        pthread_cond_destroy(&(pool->job_cond));
+        pthread_mutex_destroy(&(pool->mutex));
+        return false;
+    }
+    
+    pool->initialized = true;
+    
+    for(i = 0; i < HASH_POOL_THREAD_CNT; i++)
+    {
+        if (pthread_create(&(pool->threads[i]), NULL, &hashPoolThreadFunc, pool) != 0) break;
+        pool->thread_cnt++;
+    }
+    
+    return true;
+}
+
+void hashPoolClose(hash_pool_ctx_t *pool)
+{
+    if (!pool || !pool->initialized) return;
+    
+    u32 i;
+    
+    pthread_mutex_lock(&(pool->mutex));
+    pool->closing = true;
+    pthread_cond_broadcast(&(pool->job_cond));
+    pthread_mutex_unlock(&(pool->mutex));
+    
+    for(i = 0; i < pool->thread_cnt; i++) pthread_join(pool->threads[i], NULL);
+    
+    pthread_cond_destroy(&(pool->done_cond));
+    pthread_cond_destroy(&(pool->job_cond));
+    pthread_mutex_destroy(&(pool->mutex));
+    
+    memset(pool, 0, sizeof(hash_pool_ctx_t));
+}
+
+void hashPoolHashBlocks(hash_pool_ctx_t *pool, const u8 *data, u64 blockSize, u32 blockCnt, u64 lastBlockSize, u8 *outHashes)
+{
+    if (!pool || !pool->initialized || !data || !blockSize || !blockCnt || !lastBlockSize || lastBlockSize > blockSize || !outHashes) return;
+    
+    pthread_mutex_lock(&(pool->mutex));
+    
+    pool->job_data = data;
+    pool->job_hashes = outHashes;
+    pool->job_block_size = blockSize;
+    pool->job_last_block_size = lastBlockSize;
+    pool->job_block_cnt = blockCnt;
+    pool->job_next_block = 0;
+    pool->job_done_cnt = 0;
+    
+    pthread_cond_broadcast(&(pool->job_cond));
+    
+    // Take part in the job instead of just waiting for the hashing threads
+    hashPoolProcessJob(pool);
+    
+    while(pool->job_done_cnt < pool->job_block_cnt) pthread_cond_wait(&(pool->done_cond), &(pool->mutex));
+    
+    pthread_mutex_unlock(&(pool->mutex));
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#ifndef __HASH_POOL_H__
+#define __HASH_POOL_H__
+
+#include <switch.h>
+#include <pthread.h>
+#include "util.h"
+
+#define HASH_POOL_THREAD_CNT            2                           // Hashing threads. The calling thread also hashes its own share of each job
+#define HASH_POOL_JOB_BLOCK_CNT         8                           // Blocks hashed by a thread each time it picks up work
+
+typedef struct {
+    bool initialized;
+    u32 thread_cnt;
+    pthread_t threads[HASH_POOL_THREAD_CNT];
+    pthread_mutex_t mutex;
+    pthread_cond_t job_cond;                        // Signaled when a new job is available or when the pool is being closed
+    pthread_cond_t done_cond;                       // Signaled when all blocks from the current job have been hashed
+    const u8 *job_data;
+    u8 *job_hashes;
+    u64 job_block_size;
+    u64 job_last_block_size;
+    u32 job_block_cnt;
+    u32 job_next_block;
+    u32 job_done_cnt;
+    bool closing;
+} hash_pool_ctx_t;
+
+// Starts the hashing threads. Returns false if the pool couldn't be set up at all
+// Hashing threads are optional: if they can't be started, all blocks are hashed by the calling thread
+bool hashPoolInit(hash_pool_ctx_t *pool);
+
+// Stops the hashing threads
+void hashPoolClose(hash_pool_ctx_t *pool);
+
+// Calculates the SHA-256 hash of each 'blockSize' bytes block from 'data', storing them consecutively in 'outHashes'
+// The last block is 'lastBlockSize' bytes long, which may be less than 'blockSize'
+void hashPoolHashBlocks(hash_pool_ctx_t *pool, const u8 *data, u64 blockSize, u32 blockCnt, u64 lastBlockSize, u8 *outHashes);
+
+#endif
@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash_tree.h"
+#include "ui.h"
+
+/* Extern variables */
+
+extern int breaks;
+extern int font_height;
+
+static hash_tree_block_t *hashTreeFindBlock(hash_tree_ctx_t *ctx, u32 level, u64 index)
+{
+    u32 i;
+    
+    for(i = 0; i < ctx->block_cnt; i++)
+    {
+        if (ctx->blocks[i].level == level && ctx->blocks[i].index == index) return &(ctx->blocks[i]);
+    }
+    
+    return NULL;
+}
+
+// Returns the rebuilt copy of a hash block, which is read and registered in the overlay the first time it's requested
+static u8 *hashTreeGetBlock(hash_tree_ctx_t *ctx, u32 level, u64 index)
+{
+    hash_tree_block_t *block = hashTreeFindBlock(ctx, level, index);
+    if (block) return block->data;
+    
+    u64 offset = (index * ctx->level_block_size[level]);
+    u64 size = (ctx->level_size[level] - offset);
+    if (size > ctx->level_block_size[level]) size = ctx->level_block_size[level];
+    
+    if (ctx->block_cnt == ctx->block_capacity)
+    {
+        hash_tree_block_t *tmpBlocks = realloc(ctx->blocks, (ctx->block_capacity + HASH_TREE_BLOCK_LIST_STEP) * sizeof(hash_tree_block_t));
+        if (!tmpBlocks)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to reallocate the hash block list!", __func__);
+            return NULL;
+        }
+        
+        ctx->blocks = tmpBlocks;
+        ctx->block_capacity += HASH_TREE_BLOCK_LIST_STEP;
+    }
+    
+    u8 *data = malloc(size);
+    if (!data)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for hash level #%u block #%lu!", __func__, level + 1, index);
+        return NULL;
+    }
+    
+    if (!hashTreeRead(ctx, ctx->level_offset[level] + offset, data, size))
+    {
+        free(data);
+        return NULL;
+    }
+    
+    if (!patchOverlayAddRange(&(ctx->overlay), ctx->level_offset[level] + offset, data, size))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to register hash level #%u block #%lu!", __func__, level + 1, index);
+        free(data);
+        return NULL;
+    }
+    
+    block = &(ctx->blocks[ctx->block_cnt++]);
+    block->level = level;
+    block->index = index;
+    block->data = data;
+    
+    return data;
+}
+
+// Collects the indexes from all blocks within 'level' that are touched by a registered range, in ascending order
+static bool hashTreeGetModifiedBlocks(hash_tree_ctx_t *ctx, u32 level, u64 **outIndexes, u64 *outCount)
+{
+    u32 i;
+    u64 j;
+    
+    u64 *indexes = NULL;
+    u64 cnt = 0, capacity = 0;
+    
+    u64 levelStart = ctx->level_offset[level];
+    u64 levelEnd = (levelStart + ctx->level_size[level]);
+    u64 blockSize = ctx->level_block_size[level];
+    
+    for(i = 0; i < ctx->overlay.range_cnt; i++)
+    {
+        const patch_overlay_range_t *range = &(ctx->overlay.ranges[i]);
+        
+        u64 start = (range->offset > levelStart ? range->offset : levelStart);
+        u64 end = ((range->offset + range->size) < levelEnd ? (range->offset + range->size) : levelEnd);
+        if (start >= end) continue;
+        
+        u64 firstBlock = ((start - levelStart) / blockSize);
+        u64 lastBlock = ((end - levelStart - 1) / blockSize);
+        
+        // Ranges are sorted, so a block shared with the previous range can only be the last one collected
+        if (cnt && firstBlock <= indexes[cnt - 1]) firstBlock = (indexes[cnt - 1] + 1);
+        
+        for(j = firstBlock; j <= lastBlock; j++)
+        {
+            if (cnt == capacity)
+            {
+                u64 *tmpIndexes = realloc(indexes, (capacity + HASH_TREE_BLOCK_LIST_STEP) * sizeof(u64));
+                if (!tmpIndexes)
+                {
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to reallocate the modified block list!", __func__);
+                    if (indexes) free(indexes);
+                    return false;
+                }
+                
+                indexes = tmpIndexes;
+                capacity += HASH_TREE_BLOCK_LIST_STEP;
+            }
+            
+            indexes[cnt++] = j;
+        }
+    }
+    
+    *outIndexes = indexes;
+    *outCount = cnt;
+    
+    return true;
+}
+
+static bool hashTreeValidateLevels(hash_tree_ctx_t *ctx)
+{
+    u32 i;
+    
+    for(i = 0; i < ctx->level_cnt; i++)
+    {
+        if (!ctx->level_size[i] || !ctx->level_block_size[i]) return false;
+        
+        // Each level must be fully covered by the hashes stored in the previous one
+        if (i > 0 && ((round_up(ctx->level_size[i], ctx->level_block_size[i]) / ctx->level_block_size[i]) * SHA256_HASH_SIZE) > ctx->level_size[i - 1]) return false;
+    }
+    
+    return true;
+}
+
+bool hashTreeInitPfs0(hash_tree_ctx_t *ctx, const pfs0_superblock_t *superblock, u64 sectionOffset, hash_tree_read_func read, void *userData)
+{
+    if (!ctx || !superblock || !read)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to initialize PFS0 hash tree!", __func__);
+        return false;
+    }
+    
+    memset(ctx, 0, sizeof(hash_tree_ctx_t));
+    
+    ctx->level_cnt = 2;
+    
+    ctx->level_offset[0] = (sectionOffset + superblock->hash_table_offset);
+    ctx->level_size[0] = superblock->hash_table_size;
+    ctx->level_block_size[0] = superblock->hash_table_size;
+    
+    ctx->level_offset[1] = (sectionOffset + superblock->pfs0_offset);
+    ctx->level_size[1] = superblock->pfs0_size;
+    ctx->level_block_size[1] = (u64)superblock->block_size;
+    
+    ctx->read = read;
+    ctx->read_user_data = userData;
+    
+    if (!hashTreeValidateLevels(ctx))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid PFS0 superblock!", __func__);
+        return false;
+    }
+    
+    patchOverlayInit(&(ctx->overlay));
+    
+    return true;
+}
+
+bool hashTreeInitIvfc(hash_tree_ctx_t *ctx, const ivfc_hdr_t *ivfcHeader, u64 sectionOffset, hash_tree_read_func read, void *userData)
+{
+    if (!ctx || !ivfcHeader || !read)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to initialize IVFC hash tree!", __func__);
+        return false;
+    }
+    
+    u32 i;
+    
+    memset(ctx, 0, sizeof(hash_tree_ctx_t));
+    
+    ctx->level_cnt = IVFC_MAX_LEVEL;
+    ctx->pad_blocks = true;
+    
+    for(i = 0; i < IVFC_MAX_LEVEL; i++)
+    {
+        ctx->level_offset[i] = (sectionOffset + ivfcHeader->level_headers[i].logical_offset);
+        ctx->level_size[i] = ivfcHeader->level_headers[i].hash_data_size;
+        ctx->level_block_size[i] = (ivfcHeader->level_headers[i].block_size < 32 ? ((u64)1 << ivfcHeader->level_headers[i].block_size) : 0);
+    }
+    
+    ctx->level_block_size[0] = ctx->level_size[0];
+    
+    ctx->read = read;
+    ctx->read_user_data = userData;
+    
+    if (__builtin_bswap32(ivfcHeader->magic) != IVFC_MAGIC || ivfcHeader->master_hash_size != SHA256_HASH_SIZE || !hashTreeValidateLevels(ctx))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid IVFC header!", __func__);
+        return false;
+    }
+    
+    patchOverlayInit(&(ctx->overlay));
+    
+    return true;
+}
+
+void hashTreeFree(hash_tree_ctx_t *ctx)
+{
+    if (!ctx) return;
+    
+    u32 i;
+    
+    if (ctx->blocks)
+    {
+        for(i = 0; i < ctx->block_cnt; i++)
+        {
+            if (ctx->blocks[i].data) free(ctx->blocks[i].data);
+        }
+        
+        free(ctx->blocks);
+    }
+    
+    patchOverlayFree(&(ctx->overlay));
+    
+    memset(ctx, 0, sizeof(hash_tree_ctx_t));
+}
+
+bool hashTreeAddModifiedRange(hash_tree_ctx_t *ctx, u64 offset, const void *data, u64 size)
+{
+    if (!ctx || !ctx->level_cnt || !data || !size)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to register modified hash tree data!", __func__);
+        return false;
+    }
+    
+    u32 dataLevel = (ctx->level_cnt - 1);
+    
+    // Hash levels are only modified by hashTreeUpdate()
+    if (offset < ctx->level_offset[dataLevel] || (offset + size) > (ctx->level_offset[dataLevel] + ctx->level_size[dataLevel]))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: modified range at offset 0x%016lX is located outside the hash tree data level!", __func__, offset);
+        return false;
+    }
+    
+    if (!patchOverlayAddRange(&(ctx->overlay), offset, data, size))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to register modified range at offset 0x%016lX!", __func__, offset);
+        return false;
+    }
+    
+    return true;
+}
+
+bool hashTreeUpdate(hash_tree_ctx_t *ctx, u8 *outMasterHash)
+{
+    if (!ctx || !ctx->level_cnt || !outMasterHash)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to update hash tree!", __func__);
+        return false;
+    }
+    
+    u32 level;
+    u64 i;
+    
+    u64 *indexes = NULL;
+    u64 indexCnt = 0;
+    
+    u8 *blockBuf = NULL;
+    u8 *parentBlock = NULL;
+    u8 blockHash[SHA256_HASH_SIZE];
+    
+    bool success = false;
+    
+    // Work from the data level upwards. Each rebuilt hash block is registered in the overlay, which marks it as modified for the next level
+    for(level = (ctx->level_cnt - 1); level > 0; level--)
+    {
+        u32 parent = (level - 1);
+        u64 blockSize = ctx->level_block_size[level];
+        
+        // The list has to be collected beforehand, since registering the parent blocks modifies the range list
+        if (!hashTreeGetModifiedBlocks(ctx, level, &indexes, &indexCnt)) goto out;
+        
+        if (!indexCnt) continue;
+        
+        blockBuf = malloc(blockSize);
+        if (!blockBuf)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for hash level #%u blocks!", __func__, level + 1);
+            goto out;
+        }
+        
+        for(i = 0; i < indexCnt; i++)
+        {
+            u64 blockOffset = (indexes[i] * blockSize);
+            u64 size = (ctx->level_size[level] - blockOffset);
+            if (size > blockSize) size = blockSize;
+            
+            if (!hashTreeRead(ctx, ctx->level_offset[level] + blockOffset, blockBuf, size)) goto out;
+            
+            if (ctx->pad_blocks && size < blockSize)
+            {
+                memset(blockBuf + size, 0, blockSize - size);
+                size = blockSize;
+            }
+            
+            sha256CalculateHash(blockHash, blockBuf, size);
+            
+            u64 hashOffset = (indexes[i] * SHA256_HASH_SIZE);
+            u64 parentBlockIndex = (hashOffset / ctx->level_block_size[parent]);
+            
+            parentBlock = hashTreeGetBlock(ctx, parent, parentBlockIndex);
+            if (!parentBlock) goto out;
+            
+            memcpy(parentBlock + (hashOffset % ctx->level_block_size[parent]), blockHash, SHA256_HASH_SIZE);
+        }
+        
+        free(blockBuf);
+        blockBuf = NULL;
+        
+        free(indexes);
+        indexes = NULL;
+    }
+    
+    // The first level always fits in a single block
+    parentBlock = hashTreeGetBlock(ctx, 0, 0);
+    if (!parentBlock) goto out;
+    
+    sha256CalculateHash(outMasterHash, parentBlock, ctx->level_size[0]);
+    
+    success = true;
+    
+out:
+    if (blockBuf) free(blockBuf);
+    
+    if (indexes) free(indexes);
+    
+    return success;
+}
+
+bool hashTreeRead(hash_tree_ctx_t *ctx, u64 offset, void *outBuf, u64 bufSize)
+{
+    if (!ctx || !ctx->read || !outBuf || !bufSize)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to read hash tree data!", __func__);
+        return false;
+    }
+    
+    // Skip the read if the whole chunk is about to be replaced
+    if (!patchOverlayCoversRange(&(ctx->overlay), offset, bufSize) && !ctx->read(ctx->read_user_data, offset, outBuf, bufSize)) return false;
+    
+    patchOverlayApply(&(ctx->overlay), offset, outBuf, bufSize);
+    
+    return true;
+}
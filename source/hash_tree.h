@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef __HASH_TREE_H__
+#define __HASH_TREE_H__
+
+#include <switch.h>
+#include "util.h"
+#include "patch_overlay.h"
+
+#define HASH_TREE_BLOCK_LIST_STEP       16                          // Growth step for the list of rebuilt hash blocks
+
+// Reads decrypted section data located at 'offset'. Uses the same base as the offsets stored in the hash tree context
+typedef bool (*hash_tree_read_func)(void *userData, u64 offset, void *outBuf, u64 bufSize);
+
+// Hash block rebuilt by hashTreeUpdate()
+typedef struct {
+    u32 level;
+    u64 index;
+    u8 *data;
+} hash_tree_block_t;
+
+typedef struct {
+    u32 level_cnt;                                  // Including the data level, which is always the last one
+    u64 level_offset[IVFC_MAX_LEVEL];
+    u64 level_size[IVFC_MAX_LEVEL];
+    u64 level_block_size[IVFC_MAX_LEVEL];           // Level 0 is always hashed as a whole to get the master hash
+    bool pad_blocks;                                // IVFC hashes the last block from each level zero-padded to the full block size. PFS0 only hashes the remaining data
+    hash_tree_read_func read;
+    void *read_user_data;
+    patch_overlay_t overlay;                        // Modified data ranges plus all rebuilt hash blocks
+    hash_tree_block_t *blocks;
+    u32 block_cnt;
+    u32 block_capacity;
+} hash_tree_ctx_t;
+
+// Sets up a single-level hash tree from a PFS0 superblock. 'sectionOffset' is added to all offsets from the superblock
+bool hashTreeInitPfs0(hash_tree_ctx_t *ctx, const pfs0_superblock_t *superblock, u64 sectionOffset, hash_tree_read_func read, void *userData);
+
+// Sets up a multi-level hash tree from an IVFC header. 'sectionOffset' is added to all offsets from the header
+bool hashTreeInitIvfc(hash_tree_ctx_t *ctx, const ivfc_hdr_t *ivfcHeader, u64 sectionOffset, hash_tree_read_func read, void *userData);
+
+// Frees the rebuilt hash blocks. Data from registered ranges isn't owned by the context
+void hashTreeFree(hash_tree_ctx_t *ctx);
+
+// Registers modified data from the data level. 'data' must stay valid until the context is freed
+bool hashTreeAddModifiedRange(hash_tree_ctx_t *ctx, u64 offset, const void *data, u64 size);
+
+// Rehashes every block touched by a modified range, followed by the parent hash blocks up to the first level, and calculates the new master hash
+// Blocks that weren't modified are never read
+bool hashTreeUpdate(hash_tree_ctx_t *ctx, u8 *outMasterHash);
+
+// Reads section data with all modified ranges and rebuilt hash blocks applied on top of it
+bool hashTreeRead(hash_tree_ctx_t *ctx, u64 offset, void *outBuf, u64 bufSize);
+
+#endif
@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ivfc_verify.h"
+#include "ui.h"
+
+/* Extern variables */
+
+extern int breaks;
+extern int font_height;
+
+extern romfs_ctx_t romFsContext;
+extern bktr_ctx_t bktrContext;
+
+static bool ivfcVerifyLoadHashBlock(ivfc_verify_ctx_t *ctx, u32 level, u64 blockIndex);
+
+static bool ivfcVerifyReadRaw(ivfc_verify_ctx_t *ctx, u64 offset, void *outBuf, u64 bufSize)
+{
+    if (!ctx->usePatch) return processNcaCtrSectionBlock(&(romFsContext.ncmStorage), &(romFsContext.ncaId), &(romFsContext.aes_ctx), offset, outBuf, bufSize, false);
+    
+    return readBktrSectionBlock(offset, outBuf, bufSize);
+}
+
+// Hashed blocks always span the full block size. The last block from each level is padded with zeroes
+static bool ivfcVerifyReadLevelBlock(ivfc_verify_ctx_t *ctx, u32 level, u64 blockIndex, u8 *outBuf)
+{
+    u64 blockSize = ctx->level_block_size[level];
+    u64 offset = (blockIndex * blockSize);
+    u64 size = (ctx->level_size[level] - offset);
+    
+    if (size > blockSize) size = blockSize;
+    
+    if (!ivfcVerifyReadRaw(ctx, ctx->level_offset[level] + offset, outBuf, size)) return false;
+    
+    if (size < blockSize) memset(outBuf + size, 0, blockSize - size);
+    
+    return true;
+}
+
+// Retrieves the stored hash for a block from 'level', which is taken from an already verified block from the previous level
+static bool ivfcVerifyGetExpectedHash(ivfc_verify_ctx_t *ctx, u32 level, u64 blockIndex, u8 *outHash)
+{
+    u32 parent = (level - 1);
+    u64 hashOffset = (blockIndex * SHA256_HASH_SIZE);
+    
+    if ((hashOffset + SHA256_HASH_SIZE) > ctx->level_size[parent])
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: IVFC level #%u block #%lu has no hash stored in the previous level!", __func__, level + 1, blockIndex);
+        return false;
+    }
+    
+    if (parent == 0)
+    {
+        memcpy(outHash, ctx->level0_data + hashOffset, SHA256_HASH_SIZE);
+        return true;
+    }
+    
+    if (!ivfcVerifyLoadHashBlock(ctx, parent, hashOffset / ctx->level_block_size[parent])) return false;
+    
+    memcpy(outHash, ctx->hash_block[parent] + (hashOffset % ctx->level_block_size[parent]), SHA256_HASH_SIZE);
+    
+    return true;
+}
+
+static bool ivfcVerifyLoadHashBlock(ivfc_verify_ctx_t *ctx, u32 level, u64 blockIndex)
+{
+    if (ctx->hash_block_index[level] == (s64)blockIndex) return true;
+    
+    u8 blockHash[SHA256_HASH_SIZE];
+    u8 expectedHash[SHA256_HASH_SIZE];
+    
+    ctx->hash_block_index[level] = -1;
+    
+    if (!ivfcVerifyReadLevelBlock(ctx, level, blockIndex, ctx->hash_block[level])) return false;
+    
+    sha256CalculateHash(blockHash, ctx->hash_block[level], ctx->level_block_size[level]);
+    
+    if (!ivfcVerifyGetExpectedHash(ctx, level, blockIndex, expectedHash)) return false;
+    
+    if (memcmp(blockHash, expectedHash, SHA256_HASH_SIZE) != 0)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: hash mismatch for IVFC level #%u block #%lu! Section data may be corrupted.", __func__, level + 1, blockIndex);
+        return false;
+    }
+    
+    ctx->hash_block_index[level] = (s64)blockIndex;
+    
+    return true;
+}
+
+static bool ivfcVerifyLoadWindow(ivfc_verify_ctx_t *ctx, u64 windowOffset)
+{
+    u32 i, blockCnt;
+    u64 blockSize = ctx->level_block_size[IVFC_DATA_LEVEL];
+    u64 firstBlock = (windowOffset / blockSize);
+    u64 size = (ctx->level_size[IVFC_DATA_LEVEL] - windowOffset);
+    u8 expectedHash[SHA256_HASH_SIZE];
+    
+    if (size > IVFC_VERIFY_WINDOW_SIZE) size = IVFC_VERIFY_WINDOW_SIZE;
+    
+    blockCnt = (u32)(round_up(size, blockSize) / blockSize);
+    
+    ctx->window_size = 0;
+    
+    if (!ivfcVerifyReadRaw(ctx, ctx->level_offset[IVFC_DATA_LEVEL] + windowOffset, ctx->window_data, size)) return false;
+    
+    if ((size % blockSize) > 0) memset(ctx->window_data + size, 0, ((u64)blockCnt * blockSize) - size);
+    
+    hashPoolHashBlocks(&(ctx->pool), ctx->window_data, blockSize, blockCnt, blockSize, ctx->window_hashes);
+    
+    for(i = 0; i < blockCnt; i++)
+    {
+        if (!ivfcVerifyGetExpectedHash(ctx, IVFC_DATA_LEVEL, firstBlock + i, expectedHash)) return false;
+        
+        if (memcmp(ctx->window_hashes + (i * SHA256_HASH_SIZE), expectedHash, SHA256_HASH_SIZE) != 0)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: hash mismatch for RomFS data block #%lu (offset 0x%016lX)! Section data may be corrupted.", __func__, firstBlock + i, ctx->level_offset[IVFC_DATA_LEVEL] + ((firstBlock + i) * blockSize));
+            return false;
+        }
+    }
+    
+    ctx->window_offset = windowOffset;
+    ctx->window_size = size;
+    
+    return true;
+}
+
+bool ivfcVerifyInit(ivfc_verify_ctx_t *ctx, bool usePatch)
+{
+    if (!ctx || (!usePatch && !romFsContext.section_size) || (usePatch && (!bktrContext.section_size || !bktrContext.relocation_block)))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to set up IVFC verification!", __func__);
+        return false;
+    }
+    
+    u32 i;
+    ivfc_hdr_t *ivfcHeader = (!usePatch ? &(romFsContext.ivfc_header) : &(bktrContext.superblock.ivfc_header));
+    u64 baseOffset = (!usePatch ? romFsContext.section_offset : 0);
+    u64 sectionSize = (!usePatch ? romFsContext.section_size : bktrContext.relocation_block->total_size);
+    u8 masterHash[SHA256_HASH_SIZE];
+    
+    memset(ctx, 0, sizeof(ivfc_verify_ctx_t));
+    
+    ctx->usePatch = usePatch;
+    memcpy(ctx->master_hash, ivfcHeader->master_hash, SHA256_HASH_SIZE);
+    
+    bool validHeader = (__builtin_bswap32(ivfcHeader->magic) == IVFC_MAGIC && ivfcHeader->master_hash_size == SHA256_HASH_SIZE);
+    
+    for(i = 0; validHeader && i < IVFC_MAX_LEVEL; i++)
+    {
+        ctx->level_offset[i] = (baseOffset + ivfcHeader->level_headers[i].logical_offset);
+        ctx->level_size[i] = ivfcHeader->level_headers[i].hash_data_size;
+        ctx->level_block_size[i] = (ivfcHeader->level_headers[i].block_size < 32 ? ((u64)1 << ivfcHeader->level_headers[i].block_size) : 0);
+        
+        if (!ctx->level_size[i] || ctx->level_block_size[i] < SHA256_HASH_SIZE || ctx->level_block_size[i] > IVFC_VERIFY_WINDOW_SIZE || \
+            (ivfcHeader->level_headers[i].logical_offset + ctx->level_size[i]) > sectionSize) validHeader = false;
+        
+        // Each level must be fully covered by the hashes stored in the previous one
+        if (validHeader && i > 0 && ((round_up(ctx->level_size[i], ctx->level_block_size[i]) / ctx->level_block_size[i]) * SHA256_HASH_SIZE) > ctx->level_size[i - 1]) validHeader = false;
+    }
+    
+    if (!validHeader || ctx->level_size[0] > IVFC_VERIFY_WINDOW_SIZE)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid IVFC header in %s RomFS section superblock!", __func__, (usePatch ? "BKTR" : "NCA"));
+        return false;
+    }
+    
+    if (!hashPoolInit(&(ctx->pool)))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize IVFC verification sync objects!", __func__);
+        return false;
+    }
+    
+    ctx->initialized = true;
+    
+    ctx->level0_data = malloc(ctx->level_size[0]);
+    ctx->window_data = malloc(IVFC_VERIFY_WINDOW_SIZE);
+    ctx->window_hashes = malloc((IVFC_VERIFY_WINDOW_SIZE / ctx->level_block_size[IVFC_DATA_LEVEL]) * SHA256_HASH_SIZE);
+    
+    bool allocated = (ctx->level0_data != NULL && ctx->window_data != NULL && ctx->window_hashes != NULL);
+    
+    for(i = 1; i < IVFC_DATA_LEVEL; i++)
+    {
+        ctx->hash_block[i] = malloc(ctx->level_block_size[i]);
+        ctx->hash_block_index[i] = -1;
+        if (!ctx->hash_block[i]) allocated = false;
+    }
+    
+    if (!allocated)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for IVFC verification buffers!", __func__);
+        goto out;
+    }
+    
+    // The first level is small enough to be kept in memory during the whole process
+    if (!ivfcVerifyReadRaw(ctx, ctx->level_offset[0], ctx->level0_data, ctx->level_size[0])) goto out;
+    
+    sha256CalculateHash(masterHash, ctx->level0_data, ctx->level_size[0]);
+    
+    if (memcmp(masterHash, ctx->master_hash, SHA256_HASH_SIZE) != 0)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: IVFC master hash mismatch! Section data may be corrupted.", __func__);
+        goto out;
+    }
+    
+    return true;
+    
+out:
+    ivfcVerifyClose(ctx);
+    
+    return false;
+}
+
+void ivfcVerifyClose(ivfc_verify_ctx_t *ctx)
+{
+    if (!ctx || !ctx->initialized) return;
+    
+    u32 i;
+    
+    hashPoolClose(&(ctx->pool));
+    
+    if (ctx->level0_data) free(ctx->level0_data);
+    if (ctx->window_data) free(ctx->window_data);
+    if (ctx->window_hashes) free(ctx->window_hashes);
+    
+    for(i = 0; i < IVFC_DATA_LEVEL; i++)
+    {
+        if (ctx->hash_block[i]) free(ctx->hash_block[i]);
+    }
+    
+    memset(ctx, 0, sizeof(ivfc_verify_ctx_t));
+}
+
+bool ivfcVerifyReadData(ivfc_verify_ctx_t *ctx, u64 offset, void *outBuf, u64 bufSize)
+{
+    if (!ctx || !ctx->initialized || !outBuf || !bufSize || offset < ctx->level_offset[IVFC_DATA_LEVEL] || (offset + bufSize) > (ctx->level_offset[IVFC_DATA_LEVEL] + ctx->level_size[IVFC_DATA_LEVEL]))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to read verified RomFS data!", __func__);
+        return false;
+    }
+    
+    u8 *out = (u8*)outBuf;
+    u64 blockSize = ctx->level_block_size[IVFC_DATA_LEVEL];
+    u64 dataOffset = (offset - ctx->level_offset[IVFC_DATA_LEVEL]);
+    u64 chunk;
+    
+    while(bufSize > 0)
+    {
+        // Consecutive reads (e.g. small files stored next to each other) are usually served from the current window
+        if (!ctx->window_size || dataOffset < ctx->window_offset || dataOffset >= (ctx->window_offset + ctx->window_size))
+        {
+            if (!ivfcVerifyLoadWindow(ctx, dataOffset - (dataOffset % blockSize))) return false;
+        }
+        
+        chunk = ((ctx->window_offset + ctx->window_size) - dataOffset);
+        if (chunk > bufSize) chunk = bufSize;
+        
+        memcpy(out, ctx->window_data + (dataOffset - ctx->window_offset), chunk);
+        
+        out += chunk;
+        dataOffset += chunk;
+        bufSize -= chunk;
+    }
+    
+    return true;
+}
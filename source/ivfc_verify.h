@@ -0,0 +1,43 @@
+#pragma once
+
+#ifndef __IVFC_VERIFY_H__
+#define __IVFC_VERIFY_H__
+
+#include <switch.h>
+#include "util.h"
+#include "hash_pool.h"
+
+#define IVFC_VERIFY_WINDOW_SIZE         DUMP_BUFFER_SIZE            // Max amount of RomFS data read and verified at once
+
+#define IVFC_DATA_LEVEL                 (IVFC_MAX_LEVEL - 1)        // Level holding the actual RomFS data. Levels below it only hold hashes
+
+typedef struct {
+    bool initialized;
+    bool usePatch;                                  // Read through the BKTR layer instead of the base RomFS section
+    u64 level_offset[IVFC_MAX_LEVEL];               // Relative to NCA start (base RomFS) or section start (BKTR)
+    u64 level_size[IVFC_MAX_LEVEL];
+    u64 level_block_size[IVFC_MAX_LEVEL];
+    u8 master_hash[SHA256_HASH_SIZE];
+    u8 *level0_data;                                // Whole first hash level, verified against the master hash
+    u8 *hash_block[IVFC_DATA_LEVEL];                // Last verified block from each of the remaining hash levels, indexed by level (entry 0 is unused)
+    s64 hash_block_index[IVFC_DATA_LEVEL];          // Index of the cached block from each hash level. -1 if nothing has been cached yet
+    u8 *window_data;                                // Verified RomFS data window
+    u64 window_offset;                              // Relative to the start of the data level
+    u64 window_size;
+    u8 *window_hashes;                              // Calculated hashes for each block from the current window
+    hash_pool_ctx_t pool;
+} ivfc_verify_ctx_t;
+
+// Sets up verified reads for the currently loaded RomFS section (romFsContext) or BKTR section (bktrContext), using the IVFC header from its superblock
+// The first hash level is read and checked against the master hash right away
+bool ivfcVerifyInit(ivfc_verify_ctx_t *ctx, bool usePatch);
+
+// Stops the hashing threads and frees all buffers
+void ivfcVerifyClose(ivfc_verify_ctx_t *ctx);
+
+// Drop-in replacement for processNcaCtrSectionBlock() / readBktrSectionBlock() calls that read RomFS data
+// 'offset' uses the same base as those functions and must be located within the data level
+// Every block covering the requested range is hashed and checked against the hash tree before any data is returned
+bool ivfcVerifyReadData(ivfc_verify_ctx_t *ctx, u64 offset, void *outBuf, u64 bufSize);
+
+#endif
@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "fatfs/ff.h"
 #include "keys.h"
@@ -15,10 +16,6 @@
 extern int breaks;
 extern int font_height;
 
-extern u8 *dumpBuf;
-
-extern char strbuf[NAME_BUF_LEN];
-
 /* Statically allocated variables */
 
 nca_keyset_t nca_keyset;
@@ -26,6 +23,11 @@ nca_keyset_t nca_keyset;
 static SetCalRsa2048DeviceKey eticket_data;
 static bool setcal_eticket_retrieved = false;
 
+// Serializes ticket lookups, which may be performed by the title prefetch thread. Guards the eTicket data above and the external keys
+// The ES savefiles are read with the savefile lock held as well (see save.h)
+static pthread_mutex_t ticketMutex = PTHREAD_MUTEX_INITIALIZER;
+static u8 ticketBuf[ETICKET_ENTRY_SIZE * 0x10];
+
 static keyLocation FSRodata = {
     FS_TID,
     SEG_RODATA,
@@ -664,7 +666,7 @@ int readKeysFromFile(FILE *f)
     return 1;
 }
 
-bool loadExternalKeys()
+static bool loadExternalKeysUnlocked()
 {
     // Check if the keyset has been already loaded
     if (nca_keyset.ext_key_cnt > 0) return true;
@@ -690,11 +692,20 @@ bool loadExternalKeys()
     return true;
 }
 
-bool testKeyPair(const void *E, const void *D, const void *N)
+bool loadExternalKeys()
+{
+    pthread_mutex_lock(&ticketMutex);
+    bool ret = loadExternalKeysUnlocked();
+    pthread_mutex_unlock(&ticketMutex);
+    
+    return ret;
+}
+
+static bool testKeyPair(const void *E, const void *D, const void *N, char *errorStr, size_t errorStrSize)
 {
     if (!E || !D || !N)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to test RSA key pair.", __func__);
+        snprintf(errorStr, errorStrSize, "%s: invalid parameters to test RSA key pair.", __func__);
         return false;
     }
     
@@ -711,14 +722,14 @@ bool testKeyPair(const void *E, const void *D, const void *N)
     result = splUserExpMod(X, N, D, 0x100, Y);
     if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: splUserExpMod failed! (testKeyPair #1) (0x%08X)", __func__, result);
+        snprintf(errorStr, errorStrSize, "%s: splUserExpMod failed! (testKeyPair #1) (0x%08X)", __func__, result);
         return false;
     }
     
     result = splUserExpMod(Y, N, E, 4, Z);
     if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: splUserExpMod failed! (testKeyPair #2) (0x%08X)", __func__, result);
+        snprintf(errorStr, errorStrSize, "%s: splUserExpMod failed! (testKeyPair #2) (0x%08X)", __func__, result);
         return false;
     }
     
@@ -726,7 +737,7 @@ bool testKeyPair(const void *E, const void *D, const void *N)
     {
         if (X[i] != Z[i])
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid RSA key pair!", __func__);
+            snprintf(errorStr, errorStrSize, "%s: invalid RSA key pair!", __func__);
             return false;
         }
     }
@@ -763,13 +774,13 @@ void mgf1(const u8 *data, size_t data_length, u8 *mask, size_t mask_length)
     free(data_counter);
 }
 
-int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key)
+static int retrieveNcaTikTitleKeyUnlocked(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key, bool loadKeys, char *errorStr, size_t errorStrSize)
 {
     int ret = -1;
     
     if (!dec_nca_header || dec_nca_header->kaek_ind > 2 || (!out_tik && !out_dec_key && !out_enc_key))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to retrieve NCA ticket and/or titlekey.", __func__);
+        snprintf(errorStr, errorStrSize, "%s: invalid parameters to retrieve NCA ticket and/or titlekey.", __func__);
         return ret;
     }
     
@@ -787,7 +798,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     
     if (!has_rights_id)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA doesn't use titlekey crypto.", __func__);
+        snprintf(errorStr, errorStrSize, "%s: NCA doesn't use titlekey crypto.", __func__);
         return ret;
     }
     
@@ -796,7 +807,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     
     if (crypto_type >= 0x20)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NCA keyblob index.", __func__);
+        snprintf(errorStr, errorStrSize, "%s: invalid NCA keyblob index.", __func__);
         return ret;
     }
     
@@ -824,8 +835,6 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     u32 br = buf_size;
     u64 total_br = 0;
     
-    char tmp[NAME_BUF_LEN / 2] = {'\0'};
-    
     bool foundEticket = false, proceed = true;
     
     u8 titlekey[0x10];
@@ -834,14 +843,14 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     result = esInitialize();
     if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize the ES service! (0x%08X)", __func__, result);
+        snprintf(errorStr, errorStrSize, "%s: failed to initialize the ES service! (0x%08X)", __func__, result);
         return ret;
     }
     
     result = esCountCommonTicket(&common_count);
     if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esCountCommonTicket failed! (0x%08X)", __func__, result);
+        snprintf(errorStr, errorStrSize, "%s: esCountCommonTicket failed! (0x%08X)", __func__, result);
         esExit();
         return ret;
     }
@@ -849,14 +858,14 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     result = esCountPersonalizedTicket(&personalized_count);
     if (R_FAILED(result))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esCountPersonalizedTicket failed! (0x%08X)", __func__, result);
+        snprintf(errorStr, errorStrSize, "%s: esCountPersonalizedTicket failed! (0x%08X)", __func__, result);
         esExit();
         return ret;
     }
     
     if (!common_count && !personalized_count)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: no tickets available!", __func__);
+        snprintf(errorStr, errorStrSize, "%s: no tickets available!", __func__);
         esExit();
         return ret;
     }
@@ -866,7 +875,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
         common_rights_ids = calloc(common_count, sizeof(FsRightsId));
         if (!common_rights_ids)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for common tickets' rights IDs!", __func__);
+            snprintf(errorStr, errorStrSize, "%s: failed to allocate memory for common tickets' rights IDs!", __func__);
             esExit();
             return ret;
         }
@@ -874,7 +883,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
         result = esListCommonTicket(&ids_written, common_rights_ids, common_count * sizeof(FsRightsId));
         if (R_FAILED(result))
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esListCommonTicket failed! (0x%08X)", __func__, result);
+            snprintf(errorStr, errorStrSize, "%s: esListCommonTicket failed! (0x%08X)", __func__, result);
             free(common_rights_ids);
             esExit();
             return ret;
@@ -898,7 +907,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
         personalized_rights_ids = calloc(personalized_count, sizeof(FsRightsId));
         if (!personalized_rights_ids)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for personalized tickets' rights IDs!", __func__);
+            snprintf(errorStr, errorStrSize, "%s: failed to allocate memory for personalized tickets' rights IDs!", __func__);
             esExit();
             return ret;
         }
@@ -906,7 +915,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
         result = esListPersonalizedTicket(&ids_written, personalized_rights_ids, personalized_count * sizeof(FsRightsId));
         if (R_FAILED(result))
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: esListPersonalizedTicket failed! (0x%08X)", __func__, result);
+            snprintf(errorStr, errorStrSize, "%s: esListPersonalizedTicket failed! (0x%08X)", __func__, result);
             free(personalized_rights_ids);
             esExit();
             return ret;
@@ -929,14 +938,17 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     
     if (!foundRightsId || (rightsIdType != 1 && rightsIdType != 2))
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: NCA rights ID unavailable in this console!", __func__);
-        breaks++;
+        snprintf(errorStr, errorStrSize, "%s: NCA rights ID unavailable in this console!", __func__);
         ret = -2;
         return ret;
     }
     
-    // Load external keys
-    if (!loadExternalKeys()) return ret;
+    // Load external keys. The keys file isn't parsed when errors can't be drawn right away
+    if (!nca_keyset.ext_key_cnt && (!loadKeys || !loadExternalKeysUnlocked()))
+    {
+        if (!loadKeys) snprintf(errorStr, errorStrSize, "%s: external keys haven't been loaded yet!", __func__);
+        return ret;
+    }
     
     if (rightsIdType == 2)
     {
@@ -948,7 +960,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
             result = setcalInitialize();
             if (R_FAILED(result))
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize the set:cal service! (0x%08X)", __func__, result);
+                snprintf(errorStr, errorStrSize, "%s: failed to initialize the set:cal service! (0x%08X)", __func__, result);
                 return ret;
             }
             
@@ -958,7 +970,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
             
             if (R_FAILED(result))
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: setcalGetEticketDeviceKey failed! (0x%08X)", __func__, result);
+                snprintf(errorStr, errorStrSize, "%s: setcalGetEticketDeviceKey failed! (0x%08X)", __func__, result);
                 return ret;
             }
             
@@ -971,7 +983,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
             // The value is stored use big endian byte order
             if (__builtin_bswap32(*((u32*)(eticket_data.key + ETICKET_DEVKEY_RSA_OFFSET + 0x200))) != SIGTYPE_RSA2048_SHA1)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid public RSA exponent for eTicket data! Wrong keys?\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__);
+                snprintf(errorStr, errorStrSize, "%s: invalid public RSA exponent for eTicket data! Wrong keys?\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__);
                 return ret;
             }
         }
@@ -982,7 +994,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
         
         if (!setcal_eticket_retrieved)
         {
-            if (!testKeyPair(E, D, N)) return ret;
+            if (!testKeyPair(E, D, N, errorStr, errorStrSize)) return ret;
             setcal_eticket_retrieved = true;
         }
     }
@@ -990,7 +1002,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     eTicketSave = calloc(1, sizeof(FIL));
     if (!eTicketSave)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for FatFs file descriptor!", __func__);
+        snprintf(errorStr, errorStrSize, "%s: unable to allocate memory for FatFs file descriptor!", __func__);
         return ret;
     }
     
@@ -998,7 +1010,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     fr = f_open(eTicketSave, (rightsIdType == 1 ? BIS_COMMON_TIK_SAVE_NAME : BIS_PERSONALIZED_TIK_SAVE_NAME), FA_READ | FA_OPEN_EXISTING);
     if (fr)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open ES %s eTicket save! (%u)", __func__, (rightsIdType == 1 ? "common" : "personalized"), fr);
+        snprintf(errorStr, errorStrSize, "%s: failed to open ES %s eTicket save! (%u)", __func__, (rightsIdType == 1 ? "common" : "personalized"), fr);
         free(eTicketSave);
         return ret;
     }
@@ -1006,7 +1018,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     save_ctx = calloc(1, sizeof(save_ctx_t));
     if (!save_ctx)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for ticket savefile context!");
+        snprintf(errorStr, errorStrSize, "%s: failed to allocate memory for ticket savefile context!", __func__);
         f_close(eTicketSave);
         free(eTicketSave);
         return ret;
@@ -1017,9 +1029,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     
     if (!save_process(save_ctx))
     {
-        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to process ticket savefile!", __func__);
-        strcat(strbuf, tmp);
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        snprintf(errorStr, errorStrSize, "%s\n%s: failed to process ticket savefile!", saveGetErrorStr(), __func__);
         free(save_ctx);
         f_close(eTicketSave);
         free(eTicketSave);
@@ -1028,9 +1038,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     
     if (!save_hierarchical_file_table_get_file_entry_by_path(&save_ctx->save_filesystem_core.file_table, ticket_bin_path, &entry))
     {
-        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to get file entry for \"%s\" in ticket savefile!", __func__, ticket_bin_path);
-        strcat(strbuf, tmp);
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        snprintf(errorStr, errorStrSize, "%s\n%s: failed to get file entry for \"%s\" in ticket savefile!", saveGetErrorStr(), __func__, ticket_bin_path);
         save_free_contexts(save_ctx);
         free(save_ctx);
         f_close(eTicketSave);
@@ -1040,9 +1048,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     
     if (!save_open_fat_storage(&save_ctx->save_filesystem_core, &fat_storage, entry.value.save_file_info.start_block))
     {
-        snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to open FAT storage at block 0x%X for \"%s\" in ticket savefile!", __func__, entry.value.save_file_info.start_block, ticket_bin_path);
-        strcat(strbuf, tmp);
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+        snprintf(errorStr, errorStrSize, "%s\n%s: failed to open FAT storage at block 0x%X for \"%s\" in ticket savefile!", saveGetErrorStr(), __func__, entry.value.save_file_info.start_block, ticket_bin_path);
         save_free_contexts(save_ctx);
         free(save_ctx);
         f_close(eTicketSave);
@@ -1052,17 +1058,15 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     
     while(br == buf_size && total_br < entry.value.save_file_info.length)
     {
-        br = save_allocation_table_storage_read(&fat_storage, dumpBuf, total_br, buf_size);
+        br = save_allocation_table_storage_read(&fat_storage, ticketBuf, total_br, buf_size);
         if (br != buf_size)
         {
-            snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read %u bytes chunk at offset 0x%lX from \"%s\" in ticket savefile!", __func__, buf_size, total_br, ticket_bin_path);
-            strcat(strbuf, tmp);
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, strbuf);
+            snprintf(errorStr, errorStrSize, "%s\n%s: failed to read %u bytes chunk at offset 0x%lX from \"%s\" in ticket savefile!", saveGetErrorStr(), __func__, buf_size, total_br, ticket_bin_path);
             proceed = false;
             break;
         }
         
-        if (dumpBuf[0] == 0) break;
+        if (ticketBuf[0] == 0) break;
         
         total_br += br;
         
@@ -1070,24 +1074,24 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
         {
             // Only read eTicket entries with RSA-2048 SHA-256 signature method
             // Also check if our current eTicket entry matches our rights ID
-            if (*((u32*)(dumpBuf + i)) != SIGTYPE_RSA2048_SHA256 || memcmp(dumpBuf + i + ETICKET_RIGHTSID_OFFSET, dec_nca_header->rights_id, 0x10) != 0) continue;
+            if (*((u32*)(ticketBuf + i)) != SIGTYPE_RSA2048_SHA256 || memcmp(ticketBuf + i + ETICKET_RIGHTSID_OFFSET, dec_nca_header->rights_id, 0x10) != 0) continue;
             
             foundEticket = true;
             
             if (rightsIdType == 1)
             {
                 // Common
-                memcpy(titlekey, dumpBuf + i + ETICKET_TITLEKEY_OFFSET, 0x10);
+                memcpy(titlekey, ticketBuf + i + ETICKET_TITLEKEY_OFFSET, 0x10);
             } else {
                 // Personalized
                 u8 M[0x100], salt[0x20], db[0xDF];
                 
-                u8 *titleKeyBlock = (dumpBuf + i + ETICKET_TITLEKEY_OFFSET);
+                u8 *titleKeyBlock = (ticketBuf + i + ETICKET_TITLEKEY_OFFSET);
                 
                 result = splUserExpMod(titleKeyBlock, N, D, 0x100, M);
                 if (R_FAILED(result))
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: splUserExpMod failed! (titleKeyBlock) (0x%08X)", __func__, result);
+                    snprintf(errorStr, errorStrSize, "%s: splUserExpMod failed! (titleKeyBlock) (0x%08X)", __func__, result);
                     proceed = false;
                     break;
                 }
@@ -1102,7 +1106,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
                 // Verify if it starts with a null string hash
                 if (memcmp(db, null_hash, 0x20) != 0)
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: titlekey decryption failed! Wrong keys?\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__);
+                    snprintf(errorStr, errorStrSize, "%s: titlekey decryption failed! Wrong keys?\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__);
                     proceed = false;
                     break;
                 }
@@ -1125,8 +1129,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     
     if (!foundEticket)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to find a matching eTicket entry for NCA rights ID!", __func__);
-        breaks++;
+        snprintf(errorStr, errorStrSize, "%s: unable to find a matching eTicket entry for NCA rights ID!", __func__);
         ret = -2;
         return ret;
     }
@@ -1134,7 +1137,7 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     ret = 0;
     
     // Copy ticket data to output pointer
-    if (out_tik != NULL) memcpy(out_tik, dumpBuf + i, ETICKET_TIK_FILE_SIZE);
+    if (out_tik != NULL) memcpy(out_tik, ticketBuf + i, ETICKET_TIK_FILE_SIZE);
     
     // Copy encrypted titlekey to output pointer
     // It is used in personalized -> common ticket conversion
@@ -1151,6 +1154,40 @@ int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_en
     return ret;
 }
 
+int retrieveNcaTikTitleKeyEx(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key, char *errorStr, size_t errorStrSize)
+{
+    pthread_mutex_lock(&ticketMutex);
+    saveLock();
+    
+    int ret = retrieveNcaTikTitleKeyUnlocked(dec_nca_header, out_tik, out_enc_key, out_dec_key, false, errorStr, errorStrSize);
+    
+    saveUnlock();
+    pthread_mutex_unlock(&ticketMutex);
+    
+    return ret;
+}
+
+int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key)
+{
+    char errorStr[NAME_BUF_LEN * 2] = {'\0'};
+    
+    pthread_mutex_lock(&ticketMutex);
+    saveLock();
+    
+    int ret = retrieveNcaTikTitleKeyUnlocked(dec_nca_header, out_tik, out_enc_key, out_dec_key, true, errorStr, MAX_CHARACTERS(errorStr));
+    
+    saveUnlock();
+    pthread_mutex_unlock(&ticketMutex);
+    
+    if (strlen(errorStr))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s", errorStr);
+        if (ret == -2) breaks++;
+    }
+    
+    return ret;
+}
+
 bool generateEncryptedNcaKeyAreaWithTitlekey(nca_header_t *dec_nca_header, u8 *decrypted_nca_keys)
 {
     if (!dec_nca_header || dec_nca_header->kaek_ind > 2 || !decrypted_nca_keys || !nca_keyset.ext_key_cnt)
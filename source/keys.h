@@ -60,6 +60,11 @@ bool loadMemoryKeys();
 bool decryptNcaKeyArea(nca_header_t *dec_nca_header, u8 *out);
 bool loadExternalKeys();
 int retrieveNcaTikTitleKey(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key);
+
+// Same as retrieveNcaTikTitleKey(), but errors are written to 'errorStr' instead of being drawn, so it can be used by background threads
+// The keys file isn't loaded by this function. It fails if loadExternalKeys() hasn't been successfully called beforehand
+int retrieveNcaTikTitleKeyEx(nca_header_t *dec_nca_header, u8 *out_tik, u8 *out_enc_key, u8 *out_dec_key, char *errorStr, size_t errorStrSize);
+
 bool generateEncryptedNcaKeyAreaWithTitlekey(nca_header_t *dec_nca_header, u8 *decrypted_nca_keys);
 
 #endif
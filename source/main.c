@@ -126,6 +126,9 @@ int main(int argc, char *argv[])
             case resultRomFsSectionBrowserCopyDir:
                 uiSetState(stateRomFsSectionBrowserCopyDir);
                 break;
+            case resultRomFsSectionBrowserDumpFiltered:
+                uiSetState(stateRomFsSectionBrowserDumpFiltered);
+                break;
             case resultDumpGameCardCertificate:
                 uiSetState(stateDumpGameCardCertificate);
                 break;
@@ -8,6 +8,7 @@
 #include "ui.h"
 #include "rsa.h"
 #include "nso.h"
+#include "hash_tree.h"
 
 /* Extern variables */
 
@@ -22,6 +23,40 @@ extern nca_keyset_t nca_keyset;
 
 extern u8 *ncaCtrBuf;
 
+/* Statically allocated variables */
+
+// Whole NCAs retrieved in advance by the title prefetch thread. See setNcaMemoryData()
+static const NcmContentInfo *ncaMemContentInfos = NULL;
+static u8 * const *ncaMemData = NULL;
+static u32 ncaMemCnt = 0;
+
+typedef struct {
+    NcmContentStorage *ncmStorage;
+    const NcmContentId *ncaId;
+    Aes128CtrContext *aes_ctx;
+} nca_ctr_section_reader_t;
+
+static bool readNcaCtrSectionForHashTree(void *userData, u64 offset, void *outBuf, u64 bufSize)
+{
+    nca_ctr_section_reader_t *reader = (nca_ctr_section_reader_t*)userData;
+    
+    if (!processNcaCtrSectionBlock(reader->ncmStorage, reader->ncaId, reader->aes_ctx, offset, outBuf, bufSize, false))
+    {
+        breaks++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read 0x%016lX bytes from NCA section at offset 0x%016lX!", __func__, bufSize, offset);
+        return false;
+    }
+    
+    return true;
+}
+
+// Used with NCAs that are fully loaded in memory and already decrypted
+static bool readNcaBufferForHashTree(void *userData, u64 offset, void *outBuf, u64 bufSize)
+{
+    memcpy(outBuf, (u8*)userData + offset, bufSize);
+    return true;
+}
+
 char *getTitleType(u8 type)
 {
     char *out = NULL;
@@ -124,66 +159,62 @@ char *getReferenceTitleIDType(u8 type)
     return out;
 }
 
-void generateCnmtXml(cnmt_xml_program_info *xml_program_info, cnmt_xml_content_info *xml_content_info, char *out)
+bool generateCnmtXml(cnmt_xml_program_info *xml_program_info, cnmt_xml_content_info *xml_content_info, str_builder_t *out)
 {
-    if (!xml_program_info || !xml_content_info || !xml_program_info->nca_cnt || !out) return;
+    if (!xml_program_info || !xml_content_info || !xml_program_info->nca_cnt || !out) return false;
     
     u32 i;
-    char tmp[NAME_BUF_LEN] = {'\0'};
     
-    sprintf(out, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n" \
-                 "<ContentMeta>\n" \
-                 "  <Type>%s</Type>\n" \
-                 "  <Id>0x%016lx</Id>\n" \
-                 "  <Version>%u</Version>\n" \
-                 "  <RequiredDownloadSystemVersion>%u</RequiredDownloadSystemVersion>\n", \
-                 getTitleType(xml_program_info->type), \
-                 xml_program_info->title_id, \
-                 xml_program_info->version, \
-                 xml_program_info->required_dl_sysver);
+    strBuilderReset(out);
+    
+    strBuilderAppendFormat(out, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n" \
+                                "<ContentMeta>\n" \
+                                "  <Type>%s</Type>\n" \
+                                "  <Id>0x%016lx</Id>\n" \
+                                "  <Version>%u</Version>\n" \
+                                "  <RequiredDownloadSystemVersion>%u</RequiredDownloadSystemVersion>\n", \
+                                getTitleType(xml_program_info->type), \
+                                xml_program_info->title_id, \
+                                xml_program_info->version, \
+                                xml_program_info->required_dl_sysver);
     
     for(i = 0; i < xml_program_info->nca_cnt; i++)
     {
-        sprintf(tmp, "  <Content>\n" \
-                     "    <Type>%s</Type>\n" \
-                     "    <Id>%s</Id>\n" \
-                     "    <Size>%lu</Size>\n" \
-                     "    <Hash>%s</Hash>\n" \
-                     "    <KeyGeneration>%u</KeyGeneration>\n" \
-                     "    <IdOffset>%u</IdOffset>\n" \
-                     "  </Content>\n",
-                     getContentType(xml_content_info[i].type), \
-                     xml_content_info[i].nca_id_str, \
-                     xml_content_info[i].size, \
-                     xml_content_info[i].hash_str, \
-                     xml_content_info[i].keyblob, \
-                     xml_content_info[i].id_offset);
-        
-        strcat(out, tmp);
-    }
-    
-    sprintf(tmp, "  <Digest>%s</Digest>\n" \
-                 "  <KeyGenerationMin>%u</KeyGenerationMin>\n" \
-                 "  <%s>%u</%s>\n" \
-                 "  <%s>0x%016lx</%s>\n", \
-                 xml_program_info->digest_str, \
-                 xml_program_info->min_keyblob, \
-                 getRequiredMinTitleType(xml_program_info->type), \
-                 xml_program_info->min_sysver, \
-                 getRequiredMinTitleType(xml_program_info->type), \
-                 getReferenceTitleIDType(xml_program_info->type), \
-                 xml_program_info->patch_tid, \
-                 getReferenceTitleIDType(xml_program_info->type));
-    
-    strcat(out, tmp);
+        strBuilderAppendFormat(out, "  <Content>\n" \
+                                    "    <Type>%s</Type>\n" \
+                                    "    <Id>%s</Id>\n" \
+                                    "    <Size>%lu</Size>\n" \
+                                    "    <Hash>%s</Hash>\n" \
+                                    "    <KeyGeneration>%u</KeyGeneration>\n" \
+                                    "    <IdOffset>%u</IdOffset>\n" \
+                                    "  </Content>\n",
+                                    getContentType(xml_content_info[i].type), \
+                                    xml_content_info[i].nca_id_str, \
+                                    xml_content_info[i].size, \
+                                    xml_content_info[i].hash_str, \
+                                    xml_content_info[i].keyblob, \
+                                    xml_content_info[i].id_offset);
+    }
+    
+    strBuilderAppendFormat(out, "  <Digest>%s</Digest>\n" \
+                                "  <KeyGenerationMin>%u</KeyGenerationMin>\n" \
+                                "  <%s>%u</%s>\n" \
+                                "  <%s>0x%016lx</%s>\n", \
+                                xml_program_info->digest_str, \
+                                xml_program_info->min_keyblob, \
+                                getRequiredMinTitleType(xml_program_info->type), \
+                                xml_program_info->min_sysver, \
+                                getRequiredMinTitleType(xml_program_info->type), \
+                                getReferenceTitleIDType(xml_program_info->type), \
+                                xml_program_info->patch_tid, \
+                                getReferenceTitleIDType(xml_program_info->type));
     
     if (xml_program_info->type == NcmContentMetaType_Application)
     {
-        sprintf(tmp, "  <RequiredApplicationVersion>%u</RequiredApplicationVersion>\n", xml_program_info->min_appver);
-        strcat(out, tmp);
+        strBuilderAppendFormat(out, "  <RequiredApplicationVersion>%u</RequiredApplicationVersion>\n", xml_program_info->min_appver);
     }
     
-    strcat(out, "</ContentMeta>");
+    return strBuilderAppend(out, "</ContentMeta>");
 }
 
 void convertNcaSizeToU64(const u8 size[0x6], u64 *out)
@@ -295,6 +326,32 @@ static void nca_update_bktr_ctr(unsigned char *ctr, u32 ctr_val, u64 ofs)
     }
 }
 
+void setNcaMemoryData(const NcmContentInfo *contentInfos, u8 * const *ncaData, u32 ncaCnt)
+{
+    ncaMemContentInfos = (ncaData ? contentInfos : NULL);
+    ncaMemData = (contentInfos ? ncaData : NULL);
+    ncaMemCnt = ((contentInfos && ncaData) ? ncaCnt : 0);
+}
+
+static bool readNcaDataFromMemory(const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize)
+{
+    u32 i;
+    u64 ncaSize;
+    
+    for(i = 0; i < ncaMemCnt; i++)
+    {
+        if (!ncaMemData[i] || memcmp(ncaMemContentInfos[i].content_id.c, ncaId->c, sizeof(NcmContentId)) != 0) continue;
+        
+        convertNcaSizeToU64(ncaMemContentInfos[i].size, &ncaSize);
+        if (offset >= ncaSize || bufSize > (ncaSize - offset)) return false;
+        
+        memcpy(outBuf, ncaMemData[i] + offset, bufSize);
+        return true;
+    }
+    
+    return false;
+}
+
 bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize)
 {
     if (!ncmStorage || !ncaId || !outBuf || !bufSize)
@@ -303,6 +360,8 @@ bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *n
         return false;
     }
     
+    if (readNcaDataFromMemory(ncaId, offset, outBuf, bufSize)) return true;
+    
     Result result = 0;
     bool success = false;
     
@@ -700,17 +759,28 @@ bool encryptNcaHeader(nca_header_t *input, u8 *outBuf, u64 outBufSize)
     return true;
 }
 
-bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData)
+static void setTitleRightsId(title_rights_ctx *rights_info, const u8 *rights_id)
 {
-    if (!ncaBuf || !ncaBufSize || ncaBufSize < NCA_FULL_HEADER_LENGTH || !out || !decrypted_nca_keys)
+    memcpy(rights_info->rights_id, rights_id, 16);
+    convertDataToHexString(rights_id, 16, rights_info->rights_id_str, 33);
+    sprintf(rights_info->tik_filename, "%s.tik", rights_info->rights_id_str);
+    sprintf(rights_info->cert_filename, "%s.cert", rights_info->rights_id_str);
+}
+
+bool decryptNcaHeaderEx(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, char *errorStr, size_t errorStrSize)
+{
+    if (!ncaBuf || !ncaBufSize || ncaBufSize < NCA_FULL_HEADER_LENGTH || !out)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NCA header decryption parameters!", __func__);
+        snprintf(errorStr, errorStrSize, "%s: invalid NCA header decryption parameters!", __func__);
         return false;
     }
     
-    if (!loadNcaKeyset()) return false;
-    
-    int ret;
+    // loadNcaKeyset() draws its own errors, so it's up to the caller
+    if (!nca_keyset.total_key_cnt)
+    {
+        snprintf(errorStr, errorStrSize, "%s: NCA keyset hasn't been loaded yet!", __func__);
+        return false;
+    }
     
     u32 i;
     size_t crypt_res;
@@ -719,8 +789,6 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
     u8 header_key_0[16];
     u8 header_key_1[16];
     
-    bool has_rights_id = false;
-    
     memcpy(header_key_0, nca_keyset.header_key, 16);
     memcpy(header_key_1, nca_keyset.header_key + 16, 16);
     
@@ -729,7 +797,7 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
     crypt_res = aes128XtsNintendoCrypt(&hdr_aes_ctx, out, ncaBuf, NCA_HEADER_LENGTH, 0, false);
     if (crypt_res != NCA_HEADER_LENGTH)
     {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid output length for decrypted NCA header! (%u != %lu)", __func__, NCA_HEADER_LENGTH, crypt_res);
+        snprintf(errorStr, errorStrSize, "%s: invalid output length for decrypted NCA header! (%u != %lu)", __func__, NCA_HEADER_LENGTH, crypt_res);
         return false;
     }
     
@@ -738,7 +806,7 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
         crypt_res = aes128XtsNintendoCrypt(&hdr_aes_ctx, out, ncaBuf, NCA_FULL_HEADER_LENGTH, 0, false);
         if (crypt_res != NCA_FULL_HEADER_LENGTH)
         {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid output length for decrypted NCA header! (%u != %lu)", __func__, NCA_FULL_HEADER_LENGTH, crypt_res);
+            snprintf(errorStr, errorStrSize, "%s: invalid output length for decrypted NCA header! (%u != %lu)", __func__, NCA_FULL_HEADER_LENGTH, crypt_res);
             return false;
         }
     } else
@@ -751,7 +819,7 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
                 crypt_res = aes128XtsNintendoCrypt(&hdr_aes_ctx, &(out->fs_headers[i]), ncaBuf + NCA_HEADER_LENGTH + (i * NCA_SECTION_HEADER_LENGTH), NCA_SECTION_HEADER_LENGTH, 0, false);
                 if (crypt_res != NCA_SECTION_HEADER_LENGTH)
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid output length for decrypted NCA header section #%u! (%u != %lu)", __func__, i, NCA_SECTION_HEADER_LENGTH, crypt_res);
+                    snprintf(errorStr, errorStrSize, "%s: invalid output length for decrypted NCA header section #%u! (%u != %lu)", __func__, i, NCA_SECTION_HEADER_LENGTH, crypt_res);
                     return false;
                 }
             } else {
@@ -759,10 +827,48 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
             }
         }
     } else {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NCA magic word! Wrong header key? (0x%08X)\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__, __builtin_bswap32(out->magic));
+        snprintf(errorStr, errorStrSize, "%s: invalid NCA magic word! Wrong header key? (0x%08X)\nTry running Lockpick_RCM to generate the keys file from scratch.", __func__, __builtin_bswap32(out->magic));
+        return false;
+    }
+    
+    return true;
+}
+
+bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData)
+{
+    if (!ncaBuf || !ncaBufSize || ncaBufSize < NCA_FULL_HEADER_LENGTH || !out || !decrypted_nca_keys)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid NCA header decryption parameters!", __func__);
+        return false;
+    }
+    
+    if (!loadNcaKeyset()) return false;
+    
+    char errorStr[NAME_BUF_LEN] = {'\0'};
+    
+    if (!decryptNcaHeaderEx(ncaBuf, ncaBufSize, out, errorStr, MAX_CHARACTERS(errorStr)))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s", errorStr);
+        return false;
+    }
+    
+    return processDecryptedNcaHeader(out, rights_info, decrypted_nca_keys, retrieveTitleKeyData);
+}
+
+bool processDecryptedNcaHeader(nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData)
+{
+    if (!out || !decrypted_nca_keys)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to process decrypted NCA header!", __func__);
         return false;
     }
     
+    int ret;
+    
+    u32 i;
+    
+    bool has_rights_id = false;
+    
     for(i = 0; i < 0x10; i++)
     {
         if (out->rights_id[i] != 0)
@@ -782,10 +888,7 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
             {
                 rights_info->has_rights_id = true;
                 
-                memcpy(rights_info->rights_id, out->rights_id, 16);
-                convertDataToHexString(out->rights_id, 16, rights_info->rights_id_str, 33);
-                sprintf(rights_info->tik_filename, "%s.tik", rights_info->rights_id_str);
-                sprintf(rights_info->cert_filename, "%s.cert", rights_info->rights_id_str);
+                setTitleRightsId(rights_info, out->rights_id);
                 
                 if (retrieveTitleKeyData)
                 {
@@ -835,6 +938,33 @@ bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title
     return true;
 }
 
+bool retrieveTitleRightsInfoEx(nca_header_t *dec_nca_header, title_rights_ctx *rights_info, char *errorStr, size_t errorStrSize)
+{
+    if (!dec_nca_header || !rights_info)
+    {
+        snprintf(errorStr, errorStrSize, "%s: invalid parameters to retrieve title rights info!", __func__);
+        return false;
+    }
+    
+    memset(rights_info, 0, sizeof(title_rights_ctx));
+    
+    rights_info->has_rights_id = true;
+    setTitleRightsId(rights_info, dec_nca_header->rights_id);
+    
+    int ret = retrieveNcaTikTitleKeyEx(dec_nca_header, (u8*)(&(rights_info->tik_data)), rights_info->enc_titlekey, rights_info->dec_titlekey, errorStr, errorStrSize);
+    if (ret == -1)
+    {
+        memset(rights_info, 0, sizeof(title_rights_ctx));
+        return false;
+    }
+    
+    // Same flags decryptNcaHeader() would have set
+    rights_info->retrieved_tik = (ret >= 0);
+    rights_info->missing_tik = (ret == -2);
+    
+    return true;
+}
+
 bool retrieveTitleKeyFromGameCardTicket(title_rights_ctx *rights_info, u8 *decrypted_nca_keys)
 {
     if (!rights_info || !rights_info->has_rights_id || !strlen(rights_info->tik_filename) || !decrypted_nca_keys)
@@ -930,7 +1060,6 @@ bool processProgramNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId,
     u64 block_hash_table_end_offset;
     u64 block_start_offset[2] = { 0, 0 };
     u64 block_size[2] = { 0, 0 };
-    u8 block_hash[2][SHA256_HASH_SIZE];
     u8 *block_data[2] = { NULL, NULL };
     
     u64 sig_write_size[2] = { 0, 0 };
@@ -1072,9 +1201,6 @@ bool processProgramNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId,
     // Patch ACID public key changing it to a self-generated pubkey
     memcpy(block_data[0] + (acid_pubkey_offset - block_start_offset[0]), rsa_get_public_key(), sig_write_size[0]);
     
-    // Calculate new block hash
-    sha256CalculateHash(block_hash[0], block_data[0], block_size[0]);
-    
     if (block_hash_table_offset != block_hash_table_end_offset)
     {
         block_start_offset[1] = (nca_pfs0_offset + (((acid_pubkey_offset + (u64)NPDM_SIGNATURE_SIZE - nca_pfs0_offset) / (u64)dec_nca_header->fs_headers[0].pfs0_superblock.block_size) * (u64)dec_nca_header->fs_headers[0].pfs0_superblock.block_size));
@@ -1104,8 +1230,6 @@ bool processProgramNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId,
         }
         
         memcpy(block_data[1], rsa_get_public_key() + sig_write_size[0], sig_write_size[1]);
-        
-        sha256CalculateHash(block_hash[1], block_data[1], block_size[1]);
     }
     
     hash_table = malloc(dec_nca_header->fs_headers[0].pfs0_superblock.hash_table_size);
@@ -1117,23 +1241,33 @@ bool processProgramNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId,
         return false;
     }
     
-    if (!processNcaCtrSectionBlock(ncmStorage, ncaId, &aes_ctx, hash_table_offset, hash_table, dec_nca_header->fs_headers[0].pfs0_superblock.hash_table_size, false))
+    // Only rehash the patched NPDM blocks, then retrieve the updated hash table
+    nca_ctr_section_reader_t reader = { ncmStorage, ncaId, &aes_ctx };
+    hash_tree_ctx_t hashTree;
+    
+    bool hash_tree_ok = hashTreeInitPfs0(&hashTree, &(dec_nca_header->fs_headers[0].pfs0_superblock), section_offset, readNcaCtrSectionForHashTree, &reader);
+    if (hash_tree_ok)
+    {
+        for(i = 0; hash_tree_ok && i < (block_hash_table_offset != block_hash_table_end_offset ? 2 : 1); i++) hash_tree_ok = hashTreeAddModifiedRange(&hashTree, block_start_offset[i], block_data[i], block_size[i]);
+        
+        // Calculate PFS0 superblock master hash
+        if (hash_tree_ok) hash_tree_ok = hashTreeUpdate(&hashTree, dec_nca_header->fs_headers[0].pfs0_superblock.master_hash);
+        
+        if (hash_tree_ok) hash_tree_ok = hashTreeRead(&hashTree, hash_table_offset, hash_table, dec_nca_header->fs_headers[0].pfs0_superblock.hash_table_size);
+        
+        hashTreeFree(&hashTree);
+    }
+    
+    if (!hash_tree_ok)
     {
         breaks++;
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read Program NCA section #0 PFS0 hash table!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to update Program NCA section #0 PFS0 hash table!", __func__);
         free(block_data[0]);
         if (block_data[1]) free(block_data[1]);
         free(hash_table);
         return false;
     }
     
-    // Update block hashes
-    memcpy(hash_table + (block_hash_table_offset - hash_table_offset), block_hash[0], SHA256_HASH_SIZE);
-    if (block_hash_table_offset != block_hash_table_end_offset) memcpy(hash_table + (block_hash_table_end_offset - hash_table_offset), block_hash[1], SHA256_HASH_SIZE);
-    
-    // Calculate PFS0 superblock master hash
-    sha256CalculateHash(dec_nca_header->fs_headers[0].pfs0_superblock.master_hash, hash_table, dec_nca_header->fs_headers[0].pfs0_superblock.hash_table_size);
-    
     // Calculate section hash
     sha256CalculateHash(dec_nca_header->section_hashes[0], &(dec_nca_header->fs_headers[0]), sizeof(nca_fs_header_t));
     
@@ -1449,8 +1583,6 @@ bool retrieveCnmtNcaData(NcmStorageId curStorageId, u8 *ncaBuf, cnmt_xml_program
     output->section_offset = section_offset;
     output->section_size = section_size;
     output->hash_table_offset = (section_offset + dec_header.fs_headers[0].pfs0_superblock.hash_table_offset);
-    output->hash_block_size = dec_header.fs_headers[0].pfs0_superblock.block_size;
-    output->hash_block_cnt = (dec_header.fs_headers[0].pfs0_superblock.hash_table_size / SHA256_HASH_SIZE);
     output->pfs0_offset = nca_pfs0_offset;
     output->pfs0_size = dec_header.fs_headers[0].pfs0_superblock.pfs0_size;
     output->title_cnmt_offset = title_cnmt_offset;
@@ -1471,6 +1603,8 @@ bool patchCnmtNca(u8 *ncaBuf, u64 ncaBufSize, cnmt_xml_program_info *xml_program
     
     u32 nca_cnt = (xml_program_info->nca_cnt - 1); // Discard CNMT NCA
     
+    hash_tree_ctx_t hashTree;
+    
     cnmt_header title_cnmt_header;
     cnmt_content_record title_cnmt_content_record;
     u64 title_cnmt_content_records_offset;
@@ -1485,6 +1619,12 @@ bool patchCnmtNca(u8 *ncaBuf, u64 ncaBufSize, cnmt_xml_program_info *xml_program
     // Calculate the start offset for the content records
     title_cnmt_content_records_offset = (cnmt_mod->title_cnmt_offset + sizeof(cnmt_header) + (u64)title_cnmt_header.extended_header_size);
     
+    // Copy header to struct
+    memcpy(&dec_header, ncaBuf, sizeof(nca_header_t));
+    
+    // The content records are written straight into the NCA buffer, so the hash tree reads them from there
+    if (!hashTreeInitPfs0(&hashTree, &(dec_header.fs_headers[0].pfs0_superblock), cnmt_mod->section_offset, readNcaBufferForHashTree, ncaBuf)) return false;
+    
     // Write content records
     for(i = 0; i < nca_cnt; i++)
     {
@@ -1499,22 +1639,24 @@ bool patchCnmtNca(u8 *ncaBuf, u64 ncaBufSize, cnmt_xml_program_info *xml_program
         memcpy(ncaBuf + title_cnmt_content_records_offset + xml_content_info[i].cnt_record_offset, &title_cnmt_content_record, sizeof(cnmt_content_record));
     }
     
-    // Recalculate block hashes
-    for(i = 0; i < cnmt_mod->hash_block_cnt; i++)
-    {
-        u64 blk_offset = ((u64)i * cnmt_mod->hash_block_size);
-        
-        u64 rest_size = (cnmt_mod->pfs0_size - blk_offset);
-        u64 blk_size = (rest_size > cnmt_mod->hash_block_size ? cnmt_mod->hash_block_size : rest_size);
-        
-        sha256CalculateHash(ncaBuf + cnmt_mod->hash_table_offset + (i * SHA256_HASH_SIZE), ncaBuf + cnmt_mod->pfs0_offset + blk_offset, blk_size);
-    }
-    
-    // Copy header to struct
-    memcpy(&dec_header, ncaBuf, sizeof(nca_header_t));
+    // Only the blocks holding content records need to be rehashed
+    // Content records are contiguous, so they're registered as a single range
+    bool hash_tree_ok = hashTreeAddModifiedRange(&hashTree, title_cnmt_content_records_offset, ncaBuf + title_cnmt_content_records_offset, (u64)title_cnmt_header.content_cnt * sizeof(cnmt_content_record));
     
     // Calculate PFS0 superblock master hash
-    sha256CalculateHash(dec_header.fs_headers[0].pfs0_superblock.master_hash, ncaBuf + cnmt_mod->hash_table_offset, dec_header.fs_headers[0].pfs0_superblock.hash_table_size);
+    if (hash_tree_ok) hash_tree_ok = hashTreeUpdate(&hashTree, dec_header.fs_headers[0].pfs0_superblock.master_hash);
+    
+    // Write the updated hash table back to the NCA buffer
+    if (hash_tree_ok) patchOverlayApply(&(hashTree.overlay), cnmt_mod->hash_table_offset, ncaBuf + cnmt_mod->hash_table_offset, dec_header.fs_headers[0].pfs0_superblock.hash_table_size);
+    
+    hashTreeFree(&hashTree);
+    
+    if (!hash_tree_ok)
+    {
+        breaks++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to update CNMT NCA PFS0 hash table!", __func__);
+        return false;
+    }
     
     // Calculate section hash
     sha256CalculateHash(dec_header.section_hashes[0], &(dec_header.fs_headers[0]), sizeof(nca_fs_header_t));
@@ -1681,6 +1823,9 @@ bool parseExeFsEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *n
     memcpy(&(exeFsContext.ncmStorage), ncmStorage, sizeof(NcmContentStorage));
     memcpy(&(exeFsContext.ncaId), ncaId, sizeof(NcmContentId));
     memcpy(&(exeFsContext.aes_ctx), &aes_ctx, sizeof(Aes128CtrContext));
+    exeFsContext.section_offset = section_offset;
+    exeFsContext.section_size = section_size;
+    memcpy(&(exeFsContext.superblock), &(dec_nca_header->fs_headers[exefs_index].pfs0_superblock), sizeof(pfs0_superblock_t));
     exeFsContext.exefs_offset = nca_pfs0_offset;
     exeFsContext.exefs_size = dec_nca_header->fs_headers[exefs_index].pfs0_superblock.pfs0_size;
     memcpy(&(exeFsContext.exefs_header), &nca_pfs0_header, sizeof(pfs0_header));
@@ -1861,6 +2006,7 @@ int parseRomFsEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *nc
     memcpy(&(romFsContext.aes_ctx), &aes_ctx, sizeof(Aes128CtrContext));
     romFsContext.section_offset = section_offset;
     romFsContext.section_size = section_size;
+    memcpy(&(romFsContext.ivfc_header), &(dec_nca_header->fs_headers[romfs_index].romfs_superblock.ivfc_header), sizeof(ivfc_hdr_t));
     romFsContext.romfs_offset = romfs_offset;
     romFsContext.romfs_size = romfs_size;
     romFsContext.romfs_dirtable_offset = romfs_dirtable_offset;
@@ -2185,8 +2331,7 @@ bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *n
     
     Aes128CtrContext aes_ctx;
     
-    char *programInfoXml = NULL;
-    char tmp[NAME_BUF_LEN] = {'\0'};
+    str_builder_t programInfoXml;
     
     u32 npdmEntry = 0;
     npdm_t npdm_header;
@@ -2197,6 +2342,8 @@ bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *n
     
     u32 acid_flags = 0;
     
+    memset(&programInfoXml, 0, sizeof(str_builder_t));
+    
     section_offset = ((u64)dec_nca_header->section_entries[0].media_start_offset * (u64)MEDIA_UNIT_SIZE);
     nca_pfs0_offset = (section_offset + dec_nca_header->fs_headers[0].pfs0_superblock.pfs0_offset);
     
@@ -2272,17 +2419,16 @@ bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *n
     
     nca_pfs0_data_offset = (nca_pfs0_str_table_offset + (u64)nca_pfs0_header.str_table_size);
     
-    // Allocate memory for the programinfo.xml contents, making sure there's enough space
-    programInfoXml = calloc(NSP_XML_BUFFER_SIZE, sizeof(char));
-    if (!programInfoXml)
+    // The programinfo.xml buffer grows as needed
+    if (!strBuilderInit(&programInfoXml, 0))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the \"programinfo.xml\" contents!", __func__);
         goto out;
     }
     
-    sprintf(programInfoXml, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n" \
-                            "<ProgramInfo>\n" \
-                            "  <SdkVersion>%u_%u_%u</SdkVersion>\n", dec_nca_header->sdk_major, dec_nca_header->sdk_minor, dec_nca_header->sdk_micro);
+    strBuilderAppendFormat(&programInfoXml, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n" \
+                                            "<ProgramInfo>\n" \
+                                            "  <SdkVersion>%u_%u_%u</SdkVersion>\n", dec_nca_header->sdk_major, dec_nca_header->sdk_minor, dec_nca_header->sdk_micro);
     
     // Retrieve the main.npdm contents
     bool found_npdm = false;
@@ -2336,11 +2482,10 @@ bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *n
     // If we're dealing with a gamecard title, replace the ACID public key with the patched one
     if (useCustomAcidRsaPubKey) memcpy(npdm_acid_section + (u64)NPDM_SIGNATURE_SIZE, rsa_get_public_key(), (u64)NPDM_SIGNATURE_SIZE);
     
-    sprintf(tmp, "  <BuildTarget>%u</BuildTarget>\n", ((npdm_header.mmu_flags & 0x01) ? 64 : 32));
-    strcat(programInfoXml, tmp);
+    strBuilderAppendFormat(&programInfoXml, "  <BuildTarget>%u</BuildTarget>\n", ((npdm_header.mmu_flags & 0x01) ? 64 : 32));
     
     // Default this one to Release
-    strcat(programInfoXml, "  <BuildType>Release</BuildType>\n");
+    strBuilderAppend(&programInfoXml, "  <BuildType>Release</BuildType>\n");
     
     // Retrieve the Base64 conversion length for the whole ACID section
     mbedtls_base64_encode(NULL, 0, &npdm_acid_section_b64_size, npdm_acid_section, (u64)npdm_header.acid_size);
@@ -2364,26 +2509,24 @@ bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *n
         goto out;
     }
     
-    strcat(programInfoXml, "  <Desc>");
-    strcat(programInfoXml, npdm_acid_section_b64);
-    strcat(programInfoXml, "</Desc>\n");
+    strBuilderAppend(&programInfoXml, "  <Desc>");
+    strBuilderAppendLen(&programInfoXml, npdm_acid_section_b64, npdm_acid_section_b64_size);
+    strBuilderAppend(&programInfoXml, "</Desc>\n");
     
     // TO-DO: Add more ACID flags?
     
     acid_flags = *((u32*)(&(npdm_acid_section[0x20C])));
     
-    strcat(programInfoXml, "  <DescFlags>\n");
+    strBuilderAppend(&programInfoXml, "  <DescFlags>\n");
     
-    sprintf(tmp, "    <Production>%s</Production>\n", ((acid_flags & 0x01) ? "true" : "false"));
-    strcat(programInfoXml, tmp);
+    strBuilderAppendFormat(&programInfoXml, "    <Production>%s</Production>\n", ((acid_flags & 0x01) ? "true" : "false"));
     
-    sprintf(tmp, "    <UnqualifiedApproval>%s</UnqualifiedApproval>\n", ((acid_flags & 0x02) ? "true" : "false"));
-    strcat(programInfoXml, tmp);
+    strBuilderAppendFormat(&programInfoXml, "    <UnqualifiedApproval>%s</UnqualifiedApproval>\n", ((acid_flags & 0x02) ? "true" : "false"));
     
-    strcat(programInfoXml, "  </DescFlags>\n");
+    strBuilderAppend(&programInfoXml, "  </DescFlags>\n");
     
     // Middleware list
-    strcat(programInfoXml, "  <MiddlewareList>\n");
+    strBuilderAppend(&programInfoXml, "  <MiddlewareList>\n");
     
     for(i = 0; i < nca_pfs0_header.file_cnt; i++)
     {
@@ -2403,7 +2546,7 @@ bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *n
         if (__builtin_bswap32(nsoHeader.magic) != NSO_MAGIC) continue;
         
         // Retrieve middleware list from this NSO
-        if (!retrieveMiddlewareListFromNso(ncmStorage, ncaId, &aes_ctx, curFilename, curFileOffset, &nsoHeader, programInfoXml))
+        if (!retrieveMiddlewareListFromNso(ncmStorage, ncaId, &aes_ctx, curFilename, curFileOffset, &nsoHeader, &programInfoXml))
         {
             proceed = false;
             break;
@@ -2412,14 +2555,14 @@ bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *n
     
     if (!proceed) goto out;
     
-    strcat(programInfoXml, "  </MiddlewareList>\n");
+    strBuilderAppend(&programInfoXml, "  </MiddlewareList>\n");
     
     // Leave these fields empty (for now)
-    strcat(programInfoXml, "  <DebugApiList />\n");
-    strcat(programInfoXml, "  <PrivateApiList />\n");
+    strBuilderAppend(&programInfoXml, "  <DebugApiList />\n");
+    strBuilderAppend(&programInfoXml, "  <PrivateApiList />\n");
     
     // Symbols list from main NSO
-    strcat(programInfoXml, "  <UnresolvedApiList>\n");
+    strBuilderAppend(&programInfoXml, "  <UnresolvedApiList>\n");
     
     for(i = 0; i < nca_pfs0_header.file_cnt; i++)
     {
@@ -2439,22 +2582,26 @@ bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *n
         if (strlen(curFilename) != 4 || strncmp(curFilename, "main", 4) != 0 || __builtin_bswap32(nsoHeader.magic) != NSO_MAGIC) continue;
         
         // Retrieve symbols list from main NSO
-        if (!retrieveSymbolsListFromNso(ncmStorage, ncaId, &aes_ctx, curFilename, curFileOffset, &nsoHeader, programInfoXml)) proceed = false;
+        if (!retrieveSymbolsListFromNso(ncmStorage, ncaId, &aes_ctx, curFilename, curFileOffset, &nsoHeader, &programInfoXml)) proceed = false;
         
         break;
     }
     
     if (!proceed) goto out;
     
-    strcat(programInfoXml, "  </UnresolvedApiList>\n");
+    strBuilderAppend(&programInfoXml, "  </UnresolvedApiList>\n");
     
     // Leave this field empty (for now)
-    strcat(programInfoXml, "  <FsAccessControlData />\n");
+    strBuilderAppend(&programInfoXml, "  <FsAccessControlData />\n");
     
-    strcat(programInfoXml, "</ProgramInfo>");
+    strBuilderAppend(&programInfoXml, "</ProgramInfo>");
     
-    *outBuf = programInfoXml;
-    *outBufSize = strlen(programInfoXml);
+    *outBuf = strBuilderDetach(&programInfoXml, outBufSize);
+    if (!*outBuf)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the \"programinfo.xml\" contents!", __func__);
+        goto out;
+    }
     
     success = true;
     
@@ -2463,7 +2610,7 @@ out:
     
     if (npdm_acid_section) free(npdm_acid_section);
     
-    if (!success && programInfoXml) free(programInfoXml);
+    strBuilderFree(&programInfoXml);
     
     if (nca_pfs0_str_table) free(nca_pfs0_str_table);
     
@@ -2913,9 +3060,9 @@ char *getNacpJitConfigurationFlag(u64 val)
     return out;
 }
 
-bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, char **out_nacp_xml, u64 *out_nacp_xml_size, nacp_icons_ctx **out_nacp_icons_ctx, u8 *out_nacp_icons_ctx_cnt)
+bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, char **out_nacp_xml, u64 *out_nacp_xml_size, nacp_icons_ctx **out_nacp_icons_ctx, u8 *out_nacp_icons_ctx_cnt, nca_romfs_file_ref **out_nacp_icon_data, u8 *out_nacp_icon_data_cnt)
 {
-    if (!ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys || !out_nacp_xml || !out_nacp_xml_size || !out_nacp_icons_ctx || !out_nacp_icons_ctx_cnt)
+    if (!ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys || !out_nacp_xml || !out_nacp_xml_size || !out_nacp_icons_ctx || !out_nacp_icons_ctx_cnt || !out_nacp_icon_data || !out_nacp_icon_data_cnt)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to generate NACP XML!", __func__);
         return false;
@@ -2926,16 +3073,22 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
     bool found_nacp = false, success = false;
     
     nacp_t controlNacp;
-    char *nacpXml = NULL;
+    str_builder_t nacpXml;
     
-    u8 i = 0, j = 0;
+    u8 i = 0, j = 0, k = 0;
     char tmp[NAME_BUF_LEN] = {'\0'};
     u32 flag;
     
     u8 nacpIconCnt = 0;
     nacp_icons_ctx *nacpIcons = NULL;
     
+    u8 nacpIconDataCnt = 0;
+    nca_romfs_file_ref *nacpIconData = NULL;
+    u8 nacpIconDataHashes[0x10][SHA256_HASH_SIZE];
+    
     bool found_icon = false;
+    u8 *iconBuf = NULL;
+    u64 iconOffset = 0;
     u8 languageIconHash[SHA256_HASH_SIZE];
     char languageIconHashStr[SHA256_HASH_SIZE + 1] = {'\0'};
     
@@ -2946,6 +3099,7 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
     
     u8 null_key[0x10];
     memset(null_key, 0, 0x10);
+    memset(&nacpXml, 0, sizeof(str_builder_t));
     
     bool availableSGC = false, availableRGC = false;
     
@@ -2978,152 +3132,131 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
         goto out;
     }
     
-    // Make sure that the output buffer for our NACP XML is big enough
-    nacpXml = calloc(NSP_XML_BUFFER_SIZE, sizeof(char));
-    if (!nacpXml)
+    // The NACP XML buffer grows as needed
+    if (!strBuilderInit(&nacpXml, 0))
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the NACP XML!", __func__);
         goto out;
     }
     
-    sprintf(nacpXml, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n" \
-                     "<Application>\n");
+    strBuilderAppendFormat(&nacpXml, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n" \
+                                     "<Application>\n");
     
     for(i = 0; i < 0x10; i++)
     {
         if (strlen(controlNacp.titles[i].name) || strlen(controlNacp.titles[i].publisher))
         {
-            sprintf(tmp, "  <Title>\n" \
-                         "    <Language>%s</Language>\n" \
-                         "    <Name>%s</Name>\n" \
-                         "    <Publisher>%s</Publisher>\n" \
-                         "  </Title>\n", \
-                         getNacpLangName(i), \
-                         controlNacp.titles[i].name, \
-                         controlNacp.titles[i].publisher);
-            
-            strcat(nacpXml, tmp);
+            strBuilderAppendFormat(&nacpXml, "  <Title>\n" \
+                                             "    <Language>%s</Language>\n" \
+                                             "    <Name>%s</Name>\n" \
+                                             "    <Publisher>%s</Publisher>\n" \
+                                             "  </Title>\n", \
+                                             getNacpLangName(i), \
+                                             controlNacp.titles[i].name, \
+                                             controlNacp.titles[i].publisher);
         }
     }
     
     if (strlen(controlNacp.isbn))
     {
-        sprintf(tmp, "  <Isbn>%s</Isbn>\n", controlNacp.isbn);
-        strcat(nacpXml, tmp);
+        strBuilderAppendFormat(&nacpXml, "  <Isbn>%s</Isbn>\n", controlNacp.isbn);
     } else {
-        strcat(nacpXml, "  <Isbn />\n");
+        strBuilderAppend(&nacpXml, "  <Isbn />\n");
     }
     
-    sprintf(tmp, "  <StartupUserAccount>%s</StartupUserAccount>\n", getNacpStartupUserAccount(controlNacp.startup_user_account));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <StartupUserAccount>%s</StartupUserAccount>\n", getNacpStartupUserAccount(controlNacp.startup_user_account));
     
-    sprintf(tmp, "  <UserAccountSwitchLock>%s</UserAccountSwitchLock>\n", getNacpUserAccountSwitchLock(controlNacp.user_account_switch_lock));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <UserAccountSwitchLock>%s</UserAccountSwitchLock>\n", getNacpUserAccountSwitchLock(controlNacp.user_account_switch_lock));
     
-    strcat(nacpXml, "  <ParentalControl>");
+    strBuilderAppend(&nacpXml, "  <ParentalControl>");
     
     memcpy(&flag, &(controlNacp.parental_control_flag), sizeof(u32));
     if (flag != 0)
     {
-        if (controlNacp.parental_control_flag.ParentalControlFlag_FreeCommunication) strcat(nacpXml, "FreeCommunication");
+        if (controlNacp.parental_control_flag.ParentalControlFlag_FreeCommunication) strBuilderAppend(&nacpXml, "FreeCommunication");
     } else {
-        strcat(nacpXml, "None");
+        strBuilderAppend(&nacpXml, "None");
     }
     
-    strcat(nacpXml, "</ParentalControl>\n");
+    strBuilderAppend(&nacpXml, "</ParentalControl>\n");
     
     for(i = 0; i < 0x10; i++)
     {
         char *str = getNacpSupportedLanguageFlag(&(controlNacp.supported_language_flag), i);
         if (!str) continue;
         
-        sprintf(tmp, "  <SupportedLanguage>%s</SupportedLanguage>\n", str);
-        strcat(nacpXml, tmp);
+        strBuilderAppendFormat(&nacpXml, "  <SupportedLanguage>%s</SupportedLanguage>\n", str);
         
         nacpIconCnt++;
     }
     
-    sprintf(tmp, "  <Screenshot>%s</Screenshot>\n", getNacpScreenshot(controlNacp.screenshot));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <Screenshot>%s</Screenshot>\n", getNacpScreenshot(controlNacp.screenshot));
     
-    sprintf(tmp, "  <VideoCapture>%s</VideoCapture>\n", getNacpVideoCapture(controlNacp.video_capture));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <VideoCapture>%s</VideoCapture>\n", getNacpVideoCapture(controlNacp.video_capture));
     
-    sprintf(tmp, "  <PresenceGroupId>0x%016lx</PresenceGroupId>\n", controlNacp.presence_group_id);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <PresenceGroupId>0x%016lx</PresenceGroupId>\n", controlNacp.presence_group_id);
     
-    sprintf(tmp, "  <DisplayVersion>%s</DisplayVersion>\n", controlNacp.display_version);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <DisplayVersion>%s</DisplayVersion>\n", controlNacp.display_version);
     
     for(i = 0; i < 0x20; i++)
     {
         u8 *ptr = ((u8*)(&(controlNacp.rating_ages)) + i);
         if (*ptr == 0xFF) continue;
         
-        sprintf(tmp, "  <Rating>\n" \
-                     "    <Organization>%s</Organization>\n" \
-                     "    <Age>%u</Age>\n" \
-                     "  </Rating>\n", \
-                     getNacpRatingAgeOrganization(i), \
-                     *ptr);
-        
-        strcat(nacpXml, tmp);
+        strBuilderAppendFormat(&nacpXml, "  <Rating>\n" \
+                                         "    <Organization>%s</Organization>\n" \
+                                         "    <Age>%u</Age>\n" \
+                                         "  </Rating>\n", \
+                                         getNacpRatingAgeOrganization(i), \
+                                         *ptr);
     }
     
-    sprintf(tmp, "  <DataLossConfirmation>%s</DataLossConfirmation>\n", getNacpDataLossConfirmation(controlNacp.data_loss_confirmation));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <DataLossConfirmation>%s</DataLossConfirmation>\n", getNacpDataLossConfirmation(controlNacp.data_loss_confirmation));
     
-    sprintf(tmp, "  <PlayLogPolicy>%s</PlayLogPolicy>\n", getNacpPlayLogPolicy(controlNacp.play_log_policy));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <PlayLogPolicy>%s</PlayLogPolicy>\n", getNacpPlayLogPolicy(controlNacp.play_log_policy));
     
-    sprintf(tmp, "  <SaveDataOwnerId>0x%016lx</SaveDataOwnerId>\n", controlNacp.save_data_owner_id);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <SaveDataOwnerId>0x%016lx</SaveDataOwnerId>\n", controlNacp.save_data_owner_id);
     
-    sprintf(tmp, "  <UserAccountSaveDataSize>0x%016lx</UserAccountSaveDataSize>\n", controlNacp.user_account_save_data_size);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <UserAccountSaveDataSize>0x%016lx</UserAccountSaveDataSize>\n", controlNacp.user_account_save_data_size);
     
-    sprintf(tmp, "  <UserAccountSaveDataJournalSize>0x%016lx</UserAccountSaveDataJournalSize>\n", controlNacp.user_account_save_data_journal_size);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <UserAccountSaveDataJournalSize>0x%016lx</UserAccountSaveDataJournalSize>\n", controlNacp.user_account_save_data_journal_size);
     
-    sprintf(tmp, "  <DeviceSaveDataSize>0x%016lx</DeviceSaveDataSize>\n", controlNacp.device_save_data_size);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <DeviceSaveDataSize>0x%016lx</DeviceSaveDataSize>\n", controlNacp.device_save_data_size);
     
-    sprintf(tmp, "  <DeviceSaveDataJournalSize>0x%016lx</DeviceSaveDataJournalSize>\n", controlNacp.device_save_data_journal_size);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <DeviceSaveDataJournalSize>0x%016lx</DeviceSaveDataJournalSize>\n", controlNacp.device_save_data_journal_size);
     
-    sprintf(tmp, "  <BcatDeliveryCacheStorageSize>0x%016lx</BcatDeliveryCacheStorageSize>\n", controlNacp.bcat_delivery_cache_storage_size);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <BcatDeliveryCacheStorageSize>0x%016lx</BcatDeliveryCacheStorageSize>\n", controlNacp.bcat_delivery_cache_storage_size);
     
     if (strlen(controlNacp.application_error_code_category))
     {
-        sprintf(tmp, "  <ApplicationErrorCodeCategory>%s</ApplicationErrorCodeCategory>\n", controlNacp.application_error_code_category);
-        strcat(nacpXml, tmp);
+        strBuilderAppendFormat(&nacpXml, "  <ApplicationErrorCodeCategory>%s</ApplicationErrorCodeCategory>\n", controlNacp.application_error_code_category);
     } else {
-        strcat(nacpXml, "  <ApplicationErrorCodeCategory />\n");
+        strBuilderAppend(&nacpXml, "  <ApplicationErrorCodeCategory />\n");
     }
     
-    sprintf(tmp, "  <AddOnContentBaseId>0x%016lx</AddOnContentBaseId>\n", controlNacp.add_on_content_base_id);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <AddOnContentBaseId>0x%016lx</AddOnContentBaseId>\n", controlNacp.add_on_content_base_id);
     
-    sprintf(tmp, "  <LogoType>%s</LogoType>\n", getNacpLogoType(controlNacp.logo_type));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <LogoType>%s</LogoType>\n", getNacpLogoType(controlNacp.logo_type));
     
     for(i = 0; i < 0x8; i++)
     {
         if (controlNacp.local_communication_ids[i] != 0)
         {
-            sprintf(tmp, "  <LocalCommunicationId>0x%016lx</LocalCommunicationId>\n", controlNacp.local_communication_ids[i]);
-            strcat(nacpXml, tmp);
+            strBuilderAppendFormat(&nacpXml, "  <LocalCommunicationId>0x%016lx</LocalCommunicationId>\n", controlNacp.local_communication_ids[i]);
         }
     }
     
-    sprintf(tmp, "  <LogoHandling>%s</LogoHandling>\n", getNacpLogoHandling(controlNacp.logo_handling));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <LogoHandling>%s</LogoHandling>\n", getNacpLogoHandling(controlNacp.logo_handling));
     
     if (nacpIconCnt)
     {
         nacpIcons = calloc(nacpIconCnt, sizeof(nacp_icons_ctx));
-        if (!nacpIcons)
+        nacpIconData = calloc(nacpIconCnt, sizeof(nca_romfs_file_ref));
+        
+        // Icons are only read here to calculate their hashes. Their data is read again from the NCA while the NSP is being written
+        iconBuf = malloc(NACP_ICON_MAX_SIZE);
+        
+        if (!nacpIcons || !nacpIconData || !iconBuf)
         {
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the NACP icons!", __func__);
             goto out;
@@ -3147,7 +3280,7 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
             {
                 entry = (romfs_file*)((u8*)romFsContext.romfs_file_entries + entryOffset);
                 
-                if (entry->parent == 0 && entry->nameLen == strlen(tmp) && !strncasecmp((char*)entry->name, tmp, strlen(tmp)) && entry->dataSize <= 0x20000)
+                if (entry->parent == 0 && entry->nameLen == strlen(tmp) && !strncasecmp((char*)entry->name, tmp, strlen(tmp)) && entry->dataSize > 0 && entry->dataSize <= NACP_ICON_MAX_SIZE)
                 {
                     found_icon = true;
                     break;
@@ -3162,155 +3295,165 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
                 continue;
             }
             
-            strcat(nacpXml, "  <Icon>\n");
+            strBuilderAppend(&nacpXml, "  <Icon>\n");
             
-            sprintf(tmp, "    <Language>%s</Language>\n", getNacpLangName(i));
-            strcat(nacpXml, tmp);
+            strBuilderAppendFormat(&nacpXml, "    <Language>%s</Language>\n", getNacpLangName(i));
             
             // Fill details for our NACP icon context
-            sprintf(nacpIcons[j].filename, "%s.nx.%s.jpg", ncaIdStr, getNacpLangName(i)); // Temporary, the NCA ID is subject to change
-            nacpIcons[j].icon_size = entry->dataSize;
+            snprintf(nacpIcons[j].filename, MAX_CHARACTERS(nacpIcons[j].filename), "%s.nx.%s.jpg", ncaIdStr, getNacpLangName(i)); // Temporary, the NCA ID is subject to change
+            
+            // Identical icons are usually stored only once in the RomFS section, with multiple file entries pointing to the same data
+            iconOffset = (romFsContext.romfs_filedata_offset + entry->dataOff);
             
-            if (!processNcaCtrSectionBlock(ncmStorage, ncaId, &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff, nacpIcons[j].icon_data, nacpIcons[j].icon_size, false))
+            for(k = 0; k < nacpIconDataCnt; k++)
             {
-                breaks++;
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read \"%s\" from RomFS section in Control NCA!", __func__, tmp);
-                goto out;
+                if (nacpIconData[k].offset == iconOffset && nacpIconData[k].size == entry->dataSize) break;
             }
             
-            sha256CalculateHash(languageIconHash, nacpIcons[j].icon_data, nacpIcons[j].icon_size);
+            if (k < nacpIconDataCnt)
+            {
+                memcpy(languageIconHash, nacpIconDataHashes[k], SHA256_HASH_SIZE);
+            } else {
+                memcpy(&(nacpIconData[k].ncaId), ncaId, sizeof(NcmContentId));
+                memcpy(&(nacpIconData[k].aes_ctx), &(romFsContext.aes_ctx), sizeof(Aes128CtrContext));
+                nacpIconData[k].offset = iconOffset;
+                nacpIconData[k].size = entry->dataSize;
+                
+                if (!readNcaRomFsFileRef(ncmStorage, &(nacpIconData[k]), 0, iconBuf, nacpIconData[k].size))
+                {
+                    breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read \"%s\" from RomFS section in Control NCA!", __func__, tmp);
+                    goto out;
+                }
+                
+                sha256CalculateHash(languageIconHash, iconBuf, nacpIconData[k].size);
+                
+                // Fall back to a hash comparison for identical icons stored more than once
+                for(k = 0; k < nacpIconDataCnt; k++)
+                {
+                    if (nacpIconData[k].size == entry->dataSize && !memcmp(nacpIconDataHashes[k], languageIconHash, SHA256_HASH_SIZE)) break;
+                }
+                
+                if (k == nacpIconDataCnt)
+                {
+                    memcpy(nacpIconDataHashes[k], languageIconHash, SHA256_HASH_SIZE);
+                    nacpIconDataCnt++;
+                }
+            }
+            
+            nacpIcons[j].data_idx = k;
             
             // Only retrieve the first half from the SHA-256 checksum
             convertDataToHexString(languageIconHash, SHA256_HASH_SIZE / 2, languageIconHashStr, SHA256_HASH_SIZE + 1);
             
             // Now print the hash
-            sprintf(tmp, "    <NxIconHash>%s</NxIconHash>\n", languageIconHashStr);
-            strcat(nacpXml, tmp);
+            strBuilderAppendFormat(&nacpXml, "    <NxIconHash>%s</NxIconHash>\n", languageIconHashStr);
             
-            strcat(nacpXml, "  </Icon>\n");
+            strBuilderAppend(&nacpXml, "  </Icon>\n");
             
             j++;
         }
     }
     
-    sprintf(tmp, "  <SeedForPseudoDeviceId>0x%016lx</SeedForPseudoDeviceId>\n", controlNacp.seed_for_pseudo_device_id);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <SeedForPseudoDeviceId>0x%016lx</SeedForPseudoDeviceId>\n", controlNacp.seed_for_pseudo_device_id);
     
     if (strlen(controlNacp.bcat_passphrase))
     {
-        sprintf(tmp, "  <BcatPassphrase>%s</BcatPassphrase>\n", controlNacp.bcat_passphrase);
-        strcat(nacpXml, tmp);
+        strBuilderAppendFormat(&nacpXml, "  <BcatPassphrase>%s</BcatPassphrase>\n", controlNacp.bcat_passphrase);
     } else {
-        strcat(nacpXml, "  <BcatPassphrase />\n");
+        strBuilderAppend(&nacpXml, "  <BcatPassphrase />\n");
     }
     
-    strcat(nacpXml, "  <StartupUserAccountOption>");
+    strBuilderAppend(&nacpXml, "  <StartupUserAccountOption>");
     
     if (*((u8*)&(controlNacp.startup_user_account_option)) != 0)
     {
-        if (controlNacp.startup_user_account_option.StartupUserAccountOptionFlag_IsOptional) strcat(nacpXml, "IsOptional");
+        if (controlNacp.startup_user_account_option.StartupUserAccountOptionFlag_IsOptional) strBuilderAppend(&nacpXml, "IsOptional");
     } else {
-        strcat(nacpXml, "None");
+        strBuilderAppend(&nacpXml, "None");
     }
     
-    strcat(nacpXml, "</StartupUserAccountOption>\n");
+    strBuilderAppend(&nacpXml, "</StartupUserAccountOption>\n");
     
-    sprintf(tmp, "  <AddOnContentRegistrationType>%s</AddOnContentRegistrationType>\n", getNacpAddOnContentRegistrationType(controlNacp.add_on_content_registration_type));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <AddOnContentRegistrationType>%s</AddOnContentRegistrationType>\n", getNacpAddOnContentRegistrationType(controlNacp.add_on_content_registration_type));
     
-    sprintf(tmp, "  <UserAccountSaveDataSizeMax>0x%016lx</UserAccountSaveDataSizeMax>\n", controlNacp.user_account_save_data_size_max);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <UserAccountSaveDataSizeMax>0x%016lx</UserAccountSaveDataSizeMax>\n", controlNacp.user_account_save_data_size_max);
     
-    sprintf(tmp, "  <UserAccountSaveDataJournalSizeMax>0x%016lx</UserAccountSaveDataJournalSizeMax>\n", controlNacp.user_account_save_data_journal_size_max);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <UserAccountSaveDataJournalSizeMax>0x%016lx</UserAccountSaveDataJournalSizeMax>\n", controlNacp.user_account_save_data_journal_size_max);
     
-    sprintf(tmp, "  <DeviceSaveDataSizeMax>0x%016lx</DeviceSaveDataSizeMax>\n", controlNacp.device_save_data_size_max);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <DeviceSaveDataSizeMax>0x%016lx</DeviceSaveDataSizeMax>\n", controlNacp.device_save_data_size_max);
     
-    sprintf(tmp, "  <DeviceSaveDataJournalSizeMax>0x%016lx</DeviceSaveDataJournalSizeMax>\n", controlNacp.device_save_data_journal_size_max);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <DeviceSaveDataJournalSizeMax>0x%016lx</DeviceSaveDataJournalSizeMax>\n", controlNacp.device_save_data_journal_size_max);
     
-    sprintf(tmp, "  <TemporaryStorageSize>0x%016lx</TemporaryStorageSize>\n", controlNacp.temporary_storage_size);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <TemporaryStorageSize>0x%016lx</TemporaryStorageSize>\n", controlNacp.temporary_storage_size);
     
-    sprintf(tmp, "  <CacheStorageSize>0x%016lx</CacheStorageSize>\n", controlNacp.cache_storage_size);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <CacheStorageSize>0x%016lx</CacheStorageSize>\n", controlNacp.cache_storage_size);
     
-    sprintf(tmp, "  <CacheStorageJournalSize>0x%016lx</CacheStorageJournalSize>\n", controlNacp.cache_storage_journal_size);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <CacheStorageJournalSize>0x%016lx</CacheStorageJournalSize>\n", controlNacp.cache_storage_journal_size);
     
-    sprintf(tmp, "  <CacheStorageDataAndJournalSizeMax>0x%016lx</CacheStorageDataAndJournalSizeMax>\n", controlNacp.cache_storage_data_and_journal_size_max);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <CacheStorageDataAndJournalSizeMax>0x%016lx</CacheStorageDataAndJournalSizeMax>\n", controlNacp.cache_storage_data_and_journal_size_max);
     
-    sprintf(tmp, "  <CacheStorageIndexMax>0x%04x</CacheStorageIndexMax>\n", controlNacp.cache_storage_index_max);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <CacheStorageIndexMax>0x%04x</CacheStorageIndexMax>\n", controlNacp.cache_storage_index_max);
     
-    sprintf(tmp, "  <Hdcp>%s</Hdcp>\n", getNacpHdcp(controlNacp.hdcp));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <Hdcp>%s</Hdcp>\n", getNacpHdcp(controlNacp.hdcp));
     
-    sprintf(tmp, "  <CrashReport>%s</CrashReport>\n", getNacpCrashReport(controlNacp.crash_report));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <CrashReport>%s</CrashReport>\n", getNacpCrashReport(controlNacp.crash_report));
     
-    sprintf(tmp, "  <RuntimeAddOnContentInstall>%s</RuntimeAddOnContentInstall>\n", getNacpRuntimeAddOnContentInstall(controlNacp.runtime_add_on_content_install));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <RuntimeAddOnContentInstall>%s</RuntimeAddOnContentInstall>\n", getNacpRuntimeAddOnContentInstall(controlNacp.runtime_add_on_content_install));
     
-    sprintf(tmp, "  <RuntimeParameterDelivery>%s</RuntimeParameterDelivery>\n", getNacpRuntimeParameterDelivery(controlNacp.runtime_parameter_delivery));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <RuntimeParameterDelivery>%s</RuntimeParameterDelivery>\n", getNacpRuntimeParameterDelivery(controlNacp.runtime_parameter_delivery));
     
     for(i = 0; i < 0x10; i++)
     {
         if (controlNacp.play_log_queryable_application_ids[i] != 0)
         {
-            sprintf(tmp, "  <PlayLogQueryableApplicationId>0x%016lx</PlayLogQueryableApplicationId>\n", controlNacp.play_log_queryable_application_ids[i]);
-            strcat(nacpXml, tmp);
+            strBuilderAppendFormat(&nacpXml, "  <PlayLogQueryableApplicationId>0x%016lx</PlayLogQueryableApplicationId>\n", controlNacp.play_log_queryable_application_ids[i]);
         }
     }
     
-    sprintf(tmp, "  <PlayLogQueryCapability>%s</PlayLogQueryCapability>\n", getNacpPlayLogQueryCapability(controlNacp.play_log_query_capability));
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <PlayLogQueryCapability>%s</PlayLogQueryCapability>\n", getNacpPlayLogQueryCapability(controlNacp.play_log_query_capability));
     
-    strcat(nacpXml, "  <Repair>");
+    strBuilderAppend(&nacpXml, "  <Repair>");
     
     if (*((u8*)&(controlNacp.repair_flag)) != 0)
     {
-        if (controlNacp.repair_flag.RepairFlag_SuppressGameCardAccess) strcat(nacpXml, "SuppressGameCardAccess");
+        if (controlNacp.repair_flag.RepairFlag_SuppressGameCardAccess) strBuilderAppend(&nacpXml, "SuppressGameCardAccess");
     } else {
-        strcat(nacpXml, "None");
+        strBuilderAppend(&nacpXml, "None");
     }
     
-    strcat(nacpXml, "</Repair>\n");
+    strBuilderAppend(&nacpXml, "</Repair>\n");
     
-    strcat(nacpXml, "  <Attribute>");
+    strBuilderAppend(&nacpXml, "  <Attribute>");
     
     memcpy(&flag, &(controlNacp.attribute_flag), sizeof(u32));
     if (flag != 0)
     {
-        if (controlNacp.attribute_flag.AttributeFlag_Demo) strcat(nacpXml, "Demo");
+        if (controlNacp.attribute_flag.AttributeFlag_Demo) strBuilderAppend(&nacpXml, "Demo");
         
         if (controlNacp.attribute_flag.AttributeFlag_RetailInteractiveDisplay)
         {
-            if (controlNacp.attribute_flag.AttributeFlag_Demo) strcat(nacpXml, ",");
-            strcat(nacpXml, "RetailInteractiveDisplay");
+            if (controlNacp.attribute_flag.AttributeFlag_Demo) strBuilderAppend(&nacpXml, ",");
+            strBuilderAppend(&nacpXml, "RetailInteractiveDisplay");
         }
     } else {
-        strcat(nacpXml, "None");
+        strBuilderAppend(&nacpXml, "None");
     }
     
-    strcat(nacpXml, "</Attribute>\n");
+    strBuilderAppend(&nacpXml, "</Attribute>\n");
     
-    sprintf(tmp, "  <ProgramIndex>%u</ProgramIndex>\n", controlNacp.program_index);
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <ProgramIndex>%u</ProgramIndex>\n", controlNacp.program_index);
     
-    strcat(nacpXml, "  <RequiredNetworkServiceLicenseOnLaunch>");
+    strBuilderAppend(&nacpXml, "  <RequiredNetworkServiceLicenseOnLaunch>");
     
     if (*((u8*)&(controlNacp.required_network_service_license_on_launch_flag)) != 0)
     {
-        if (controlNacp.required_network_service_license_on_launch_flag.RequiredNetworkServiceLicenseOnLaunchFlag_Common) strcat(nacpXml, "Common");
+        if (controlNacp.required_network_service_license_on_launch_flag.RequiredNetworkServiceLicenseOnLaunchFlag_Common) strBuilderAppend(&nacpXml, "Common");
     } else {
-        strcat(nacpXml, "None");
+        strBuilderAppend(&nacpXml, "None");
     }
     
-    strcat(nacpXml, "</RequiredNetworkServiceLicenseOnLaunch>\n");
+    strBuilderAppend(&nacpXml, "</RequiredNetworkServiceLicenseOnLaunch>\n");
     
     // Check if we actually have valid NeighborDetectionClientConfiguration values
     availableSGC = (controlNacp.neighbor_detection_client_configuration.send_group_configuration.group_id != 0 && memcmp(controlNacp.neighbor_detection_client_configuration.send_group_configuration.key, null_key, 0x10) != 0);
@@ -3326,20 +3469,18 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
     
     if (availableSGC || availableRGC)
     {
-        strcat(nacpXml, "  <NeighborDetectionClientConfiguration>\n");
+        strBuilderAppend(&nacpXml, "  <NeighborDetectionClientConfiguration>\n");
         
         if (availableSGC)
         {
             convertDataToHexString(controlNacp.neighbor_detection_client_configuration.send_group_configuration.key, 0x10, dataStr, 100);
             
-            sprintf(tmp, "    <SendDataConfiguration>\n" \
-                         "      <DataId>0x%016lx</DataId>\n" \
-                         "      <Key>%s</Key>\n" \
-                         "    </SendDataConfiguration>\n", \
-                         controlNacp.neighbor_detection_client_configuration.send_group_configuration.group_id, \
-                         dataStr);
-            
-            strcat(nacpXml, tmp);
+            strBuilderAppendFormat(&nacpXml, "    <SendDataConfiguration>\n" \
+                                             "      <DataId>0x%016lx</DataId>\n" \
+                                             "      <Key>%s</Key>\n" \
+                                             "    </SendDataConfiguration>\n", \
+                                             controlNacp.neighbor_detection_client_configuration.send_group_configuration.group_id, \
+                                             dataStr);
         }
         
         if (availableRGC)
@@ -3350,51 +3491,57 @@ bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *
                 {
                     convertDataToHexString(controlNacp.neighbor_detection_client_configuration.receivable_group_configurations[i].key, 0x10, dataStr, 100);
                     
-                    sprintf(tmp, "    <ReceivableDataConfiguration>\n" \
-                                 "      <DataId>0x%016lx</DataId>\n" \
-                                 "      <Key>%s</Key>\n" \
-                                 "    </ReceivableDataConfiguration>\n", \
-                                 controlNacp.neighbor_detection_client_configuration.receivable_group_configurations[i].group_id, \
-                                 dataStr);
-                    
-                    strcat(nacpXml, tmp);
+                    strBuilderAppendFormat(&nacpXml, "    <ReceivableDataConfiguration>\n" \
+                                                     "      <DataId>0x%016lx</DataId>\n" \
+                                                     "      <Key>%s</Key>\n" \
+                                                     "    </ReceivableDataConfiguration>\n", \
+                                                     controlNacp.neighbor_detection_client_configuration.receivable_group_configurations[i].group_id, \
+                                                     dataStr);
                 }
             }
         }
         
-        strcat(nacpXml, "  </NeighborDetectionClientConfiguration>\n");
+        strBuilderAppend(&nacpXml, "  </NeighborDetectionClientConfiguration>\n");
     }
     
-    sprintf(tmp, "  <JitConfiguration>\n" \
-                 "    <IsEnabled>%s</IsEnabled>\n" \
-                 "    <MemorySize>0x%016lx</MemorySize>\n" \
-                 "  </JitConfiguration>\n", \
-                 getNacpJitConfigurationFlag(controlNacp.jit_configuration.jit_configuration_flag), \
-                 controlNacp.jit_configuration.memory_size);
-    
-    strcat(nacpXml, tmp);
+    strBuilderAppendFormat(&nacpXml, "  <JitConfiguration>\n" \
+                                     "    <IsEnabled>%s</IsEnabled>\n" \
+                                     "    <MemorySize>0x%016lx</MemorySize>\n" \
+                                     "  </JitConfiguration>\n", \
+                                     getNacpJitConfigurationFlag(controlNacp.jit_configuration.jit_configuration_flag), \
+                                     controlNacp.jit_configuration.memory_size);
     
-    strcat(nacpXml, "</Application>");
+    strBuilderAppend(&nacpXml, "</Application>");
     
-    *out_nacp_xml = nacpXml;
-    *out_nacp_xml_size = strlen(nacpXml);
+    *out_nacp_xml = strBuilderDetach(&nacpXml, out_nacp_xml_size);
+    if (!*out_nacp_xml)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the NACP XML!", __func__);
+        goto out;
+    }
     
     if (nacpIconCnt)
     {
         *out_nacp_icons_ctx = nacpIcons;
         *out_nacp_icons_ctx_cnt = nacpIconCnt;
+        
+        *out_nacp_icon_data = nacpIconData;
+        *out_nacp_icon_data_cnt = nacpIconDataCnt;
     }
     
     success = true;
     
 out:
-    if (!success)
+    if (!success || !nacpIconCnt)
     {
         if (nacpIcons != NULL) free(nacpIcons);
-        
-        if (nacpXml != NULL) free(nacpXml);
+        if (nacpIconData != NULL) free(nacpIconData);
     }
     
+    if (iconBuf) free(iconBuf);
+    
+    strBuilderFree(&nacpXml);
+    
     // Manually free these pointers
     // Calling freeRomFsContext() would also close the ncmStorage handle
     free(romFsContext.romfs_dir_entries);
@@ -3406,9 +3553,9 @@ out:
     return success;
 }
 
-bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, char **outBuf, u64 *outBufSize)
+bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, nca_romfs_file_ref *outRef)
 {
-    if (!ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys || !outBuf)
+    if (!ncmStorage || !ncaId || !dec_nca_header || !decrypted_nca_keys || !outRef)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to retrieve \"legalinfo.xml\"!", __func__);
         return false;
@@ -3418,9 +3565,6 @@ bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContent
     romfs_file *entry = NULL;
     bool found_legalinfo = false, success = false;
     
-    u64 legalInfoXmlSize = 0;
-    char *legalInfoXml = NULL;
-    
     if (parseRomFsEntryFromNca(ncmStorage, ncaId, dec_nca_header, decrypted_nca_keys) != 0) return false;
     
     // Look for the legalinfo.xml file
@@ -3443,30 +3587,21 @@ bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContent
         goto out;
     }
     
-    // Allocate memory for the legalinfo.xml contents
-    legalInfoXmlSize = entry->dataSize;
-    legalInfoXml = calloc(legalInfoXmlSize, sizeof(char));
-    if (!legalInfoXml)
-    {
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the \"legalinfo.xml\" contents!", __func__);
-        goto out;
-    }
-    
-    if (!processNcaCtrSectionBlock(ncmStorage, ncaId, &(romFsContext.aes_ctx), romFsContext.romfs_filedata_offset + entry->dataOff, legalInfoXml, legalInfoXmlSize, false))
+    if (!entry->dataSize)
     {
-        breaks++;
-        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read \"legalinfo.xml\" from RomFS section in Manual NCA!", __func__);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: \"legalinfo.xml\" file in Manual NCA RomFS section is empty!", __func__);
         goto out;
     }
     
-    *outBuf = legalInfoXml;
-    *outBufSize = legalInfoXmlSize;
+    // The legalinfo.xml contents are copied straight from the NCA while the NSP is being written
+    memcpy(&(outRef->ncaId), ncaId, sizeof(NcmContentId));
+    memcpy(&(outRef->aes_ctx), &(romFsContext.aes_ctx), sizeof(Aes128CtrContext));
+    outRef->offset = (romFsContext.romfs_filedata_offset + entry->dataOff);
+    outRef->size = entry->dataSize;
     
     success = true;
     
 out:
-    if (!success && legalInfoXml != NULL) free(legalInfoXml);
-    
     // Manually free these pointers
     // Calling freeRomFsContext() would also close the ncmStorage handle
     free(romFsContext.romfs_dir_entries);
@@ -3477,3 +3612,25 @@ out:
     
     return success;
 }
+
+bool readNcaRomFsFileRef(NcmContentStorage *ncmStorage, const nca_romfs_file_ref *ref, u64 offset, void *outBuf, u64 bufSize)
+{
+    if (!ncmStorage || !ref || !outBuf || !bufSize || (offset + bufSize) > ref->size)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to read RomFS file data from NCA!", __func__);
+        return false;
+    }
+    
+    // processNcaCtrSectionBlock() updates the CTR from the AES context, so the referenced one is left untouched
+    Aes128CtrContext aes_ctx;
+    memcpy(&aes_ctx, &(ref->aes_ctx), sizeof(Aes128CtrContext));
+    
+    if (!processNcaCtrSectionBlock(ncmStorage, &(ref->ncaId), &aes_ctx, ref->offset + offset, outBuf, bufSize, false))
+    {
+        breaks++;
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read 0x%016lX bytes from RomFS file data in NCA!", __func__, bufSize);
+        return false;
+    }
+    
+    return true;
+}
@@ -4,6 +4,7 @@
 #define __NCA_H__
 
 #include <switch.h>
+#include "str_builder.h"
 
 #define NCA3_MAGIC                      (u32)0x4E434133     // "NCA3"
 #define NCA2_MAGIC                      (u32)0x4E434132     // "NCA2"
@@ -58,6 +59,9 @@
 #define NSP_LEGAL_XML_FILENAME_LENGTH   0x2F                // NCA ID + ".legalinfo.xml" + NULL terminator
 #define NSP_TIK_FILENAME_LENGTH         0x25                // Rights ID + ".tik" + NULL terminator
 #define NSP_CERT_FILENAME_LENGTH        0x26                // Rights ID + ".cert" + NULL terminator
+#define NSP_NACP_ICON_FILENAME_LENGTH   0x3E                // NCA ID + ".nx." + longest language name + ".jpg" + NULL terminator
+
+#define NACP_ICON_MAX_SIZE              0x20000             // Bigger icon files are skipped
 
 #define ETICKET_ENTRY_SIZE              0x400
 #define ETICKET_TITLEKEY_OFFSET         0x180
@@ -276,6 +280,11 @@ typedef struct {
     u64 cnt_record_offset; // Relative to the start of the content records section in the CNMT
     u8 decrypted_nca_keys[NCA_KEY_AREA_SIZE];
     u8 encrypted_header_mod[NCA_FULL_HEADER_LENGTH];
+    bool unmodified; // Set if the NCA is dumped as-is, in which case its content ID and hash stay the same
+    bool verify_exefs; // Program NCAs only. Set if the ExeFS section can be verified while the NCA is being dumped
+    u64 exefs_section_offset; // Relative to NCA start
+    u64 exefs_section_size;
+    nca_fs_header_t exefs_fs_header; // Holds the updated master hash if the Program NCA was modified
 } cnmt_xml_content_info;
 
 typedef struct {
@@ -289,26 +298,34 @@ typedef struct {
     u64 block_size[2];
 } nca_program_mod_data;
 
+// Location of a file stored in the RomFS section from a NCA. Its data is only read when it's needed
 typedef struct {
-    char filename[100];
-    u64 icon_size;
-    u8 icon_data[0x20000];
+    NcmContentId ncaId;
+    Aes128CtrContext aes_ctx;
+    u64 offset; // Relative to NCA start
+    u64 size;
+} nca_romfs_file_ref;
+
+typedef struct {
+    char filename[NSP_NACP_ICON_FILENAME_LENGTH];
+    u8 data_idx; // Index of the icon file from the distinct icon list retrieved alongside this entry
 } nacp_icons_ctx;
 
 typedef struct {
     u32 nca_index;
     u64 xml_size;
-    char *xml_data;
+    char *xml_data; // NULL with LegalInformation NCAs
+    nca_romfs_file_ref xml_ref; // Only used with LegalInformation NCAs
     u8 nacp_icon_cnt; // Only used with Control NCAs
     nacp_icons_ctx *nacp_icons; // Only used with Control NCAs
+    u8 nacp_icon_data_cnt; // Only used with Control NCAs
+    nca_romfs_file_ref *nacp_icon_data; // Distinct icon files. Languages with identical icons share the same entry. Only used with Control NCAs
 } xml_record_info;
 
 typedef struct {
     u64 section_offset; // Relative to NCA start
     u64 section_size;
     u64 hash_table_offset; // Relative to NCA start
-    u64 hash_block_size;
-    u32 hash_block_cnt;
     u64 pfs0_offset; // Relative to NCA start
     u64 pfs0_size;
     u64 title_cnmt_offset; // Relative to NCA start
@@ -353,6 +370,9 @@ typedef struct {
     NcmContentId ncaId;
     u8 idOffset;
     Aes128CtrContext aes_ctx;
+    u64 section_offset; // Relative to NCA start
+    u64 section_size;
+    pfs0_superblock_t superblock;
     u64 exefs_offset; // Relative to NCA start
     u64 exefs_size;
     pfs0_header exefs_header;
@@ -371,6 +391,7 @@ typedef struct {
     Aes128CtrContext aes_ctx;
     u64 section_offset; // Relative to NCA start
     u64 section_size;
+    ivfc_hdr_t ivfc_header;
     u64 romfs_offset; // Relative to NCA start
     u64 romfs_size;
     u64 romfs_dirtable_offset; // Relative to NCA start
@@ -723,12 +744,17 @@ typedef struct {
 
 char *getContentType(u8 type);
 
-void generateCnmtXml(cnmt_xml_program_info *xml_program_info, cnmt_xml_content_info *xml_content_info, char *out);
+// Rebuilds the CNMT XML in place. Regenerating an XML of the same length doesn't move the buffer
+bool generateCnmtXml(cnmt_xml_program_info *xml_program_info, cnmt_xml_content_info *xml_content_info, str_builder_t *out);
 
 void convertNcaSizeToU64(const u8 size[0x6], u64 *out);
 
 void convertU64ToNcaSize(const u64 size, u8 out[0x6]);
 
+// Makes readNcaDataByContentId() serve reads from whole NCAs that have already been loaded into memory (e.g. by the title prefetch thread)
+// 'ncaData' holds one pointer per content record (NULL if that NCA wasn't loaded). Both arrays must stay valid until this is called again with NULL pointers
+void setNcaMemoryData(const NcmContentInfo *contentInfos, u8 * const *ncaData, u32 ncaCnt);
+
 bool readNcaDataByContentId(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, u64 offset, void *outBuf, size_t bufSize);
 
 bool processNcaCtrSectionBlock(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *ctx, u64 offset, void *outBuf, size_t bufSize, bool encrypt);
@@ -737,8 +763,19 @@ bool readBktrSectionBlock(u64 offset, void *outBuf, size_t bufSize);
 
 bool encryptNcaHeader(nca_header_t *input, u8 *outBuf, u64 outBufSize);
 
+// Only decrypts the NCA header. Errors are written to 'errorStr' instead of being drawn, so it can be used by background threads
+// The NCA keyset must have already been loaded with loadNcaKeyset()
+bool decryptNcaHeaderEx(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, char *errorStr, size_t errorStrSize);
+
 bool decryptNcaHeader(const u8 *ncaBuf, u64 ncaBufSize, nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData);
 
+// Second half of decryptNcaHeader(): retrieves the ticket and/or decrypts the key area from an already decrypted NCA header
+bool processDecryptedNcaHeader(nca_header_t *out, title_rights_ctx *rights_info, u8 *decrypted_nca_keys, bool retrieveTitleKeyData);
+
+// Performs the ticket lookup decryptNcaHeader() would perform for the first NCA with a populated Rights ID field, without drawing anything
+// A missing ticket isn't treated as an error: 'missing_tik' is set instead. On failure, 'rights_info' is cleared
+bool retrieveTitleRightsInfoEx(nca_header_t *dec_nca_header, title_rights_ctx *rights_info, char *errorStr, size_t errorStrSize);
+
 bool retrieveTitleKeyFromGameCardTicket(title_rights_ctx *rights_info, u8 *decrypted_nca_keys);
 
 bool processProgramNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, cnmt_xml_content_info *xml_content_info, nca_program_mod_data **output, u32 *cur_mod_cnt, u32 idx);
@@ -755,8 +792,11 @@ bool parseBktrEntryFromNca(NcmContentStorage *ncmStorage, const NcmContentId *nc
 
 bool generateProgramInfoXml(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, bool useCustomAcidRsaPubKey, char **outBuf, u64 *outBufSize);
 
-bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, char **out_nacp_xml, u64 *out_nacp_xml_size, nacp_icons_ctx **out_nacp_icons_ctx, u8 *out_nacp_icons_ctx_cnt);
+bool retrieveNacpDataFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, char **out_nacp_xml, u64 *out_nacp_xml_size, nacp_icons_ctx **out_nacp_icons_ctx, u8 *out_nacp_icons_ctx_cnt, nca_romfs_file_ref **out_nacp_icon_data, u8 *out_nacp_icon_data_cnt);
+
+bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, nca_romfs_file_ref *outRef);
 
-bool retrieveLegalInfoXmlFromNca(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, nca_header_t *dec_nca_header, u8 *decrypted_nca_keys, char **outBuf, u64 *outBufSize);
+// Reads 'bufSize' bytes from 'offset' within a file referenced by retrieveNacpDataFromNca() or retrieveLegalInfoXmlFromNca()
+bool readNcaRomFsFileRef(NcmContentStorage *ncmStorage, const nca_romfs_file_ref *ref, u64 offset, void *outBuf, u64 bufSize);
 
 #endif
@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "nca_store.h"
+#include "crc32_fast.h"
+
+#define NCA_STORE_INDEX_TMP_PATH        NCA_STORE_INDEX_PATH ".tmp"
+
+static nca_store_entry_t *storeEntries = NULL;
+static u32 storeEntryCnt = 0, storeEntryCapacity = 0;
+static bool storeLoaded = false, storeDirty = false;
+
+// Batch mode may access the store from its background worker thread
+static pthread_mutex_t storeMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int ncaStoreEntryCmp(const void *a, const void *b)
+{
+    const nca_store_entry_t *entryA = (const nca_store_entry_t*)a;
+    const nca_store_entry_t *entryB = (const nca_store_entry_t*)b;
+    
+    return memcmp(entryA->hash, entryB->hash, SHA256_HASH_SIZE / 2);
+}
+
+// Returns the position of the entry for the provided NCA ID, or the position at which it would have to be inserted
+static u32 ncaStoreSearch(const u8 *ncaId, bool *outFound)
+{
+    u32 low = 0, high = storeEntryCnt, mid;
+    int cmp;
+    
+    *outFound = false;
+    
+    while(low < high)
+    {
+        mid = (low + ((high - low) / 2));
+        
+        cmp = memcmp(ncaId, storeEntries[mid].hash, SHA256_HASH_SIZE / 2);
+        if (!cmp)
+        {
+            *outFound = true;
+            return mid;
+        }
+        
+        if (cmp < 0)
+        {
+            high = mid;
+        } else {
+            low = (mid + 1);
+        }
+    }
+    
+    return low;
+}
+
+static bool ncaStoreReserve(u32 count)
+{
+    if (count <= storeEntryCapacity) return true;
+    
+    u32 newCapacity = (((count + NCA_STORE_ALLOC_STEP - 1) / NCA_STORE_ALLOC_STEP) * NCA_STORE_ALLOC_STEP);
+    
+    nca_store_entry_t *tmpEntries = realloc(storeEntries, newCapacity * sizeof(nca_store_entry_t));
+    if (!tmpEntries) return false;
+    
+    storeEntries = tmpEntries;
+    storeEntryCapacity = newCapacity;
+    
+    return true;
+}
+
+static bool ncaStoreReadIndex(const char *path)
+{
+    FILE *indexFile = fopen(path, "rb");
+    if (!indexFile) return false;
+    
+    bool success = false;
+    size_t read_res;
+    u64 indexFileSize;
+    u32 crc = 0;
+    nca_store_header_t header;
+    
+    fseek(indexFile, 0, SEEK_END);
+    indexFileSize = ftell(indexFile);
+    rewind(indexFile);
+    
+    read_res = fread(&header, 1, sizeof(nca_store_header_t), indexFile);
+    if (read_res != sizeof(nca_store_header_t) || header.magic != NCA_STORE_MAGIC || header.formatVersion != NCA_STORE_FORMAT_VERSION) goto out;
+    
+    if (indexFileSize != (sizeof(nca_store_header_t) + ((u64)header.entryCount * sizeof(nca_store_entry_t)))) goto out;
+    
+    if (!ncaStoreReserve(header.entryCount)) goto out;
+    
+    read_res = fread(storeEntries, 1, (u64)header.entryCount * sizeof(nca_store_entry_t), indexFile);
+    if (read_res != ((u64)header.entryCount * sizeof(nca_store_entry_t))) goto out;
+    
+    crc32(storeEntries, (u64)header.entryCount * sizeof(nca_store_entry_t), &crc);
+    if (crc != header.entryCrc) goto out;
+    
+    storeEntryCnt = header.entryCount;
+    
+    // Just in case the file was modified by hand
+    if (storeEntryCnt > 1) qsort(storeEntries, storeEntryCnt, sizeof(nca_store_entry_t), ncaStoreEntryCmp);
+    
+    success = true;
+    
+out:
+    fclose(indexFile);
+    
+    return success;
+}
+
+static void ncaStoreReset()
+{
+    if (storeEntries)
+    {
+        free(storeEntries);
+        storeEntries = NULL;
+    }
+    
+    storeEntryCnt = storeEntryCapacity = 0;
+    storeLoaded = storeDirty = false;
+}
+
+static void ncaStoreLoad()
+{
+    ncaStoreReset();
+    
+    storeLoaded = true;
+    
+    // Fall back to the temporary file if writing the index was interrupted right after the previous one was removed
+    if (!ncaStoreReadIndex(NCA_STORE_INDEX_PATH) && !ncaStoreReadIndex(NCA_STORE_INDEX_TMP_PATH)) storeEntryCnt = 0;
+}
+
+void ncaStoreGetNcaPath(const u8 *ncaId, char *outPath, size_t outPathSize)
+{
+    char ncaIdStr[SHA256_HASH_SIZE + 1] = {'\0'};
+    
+    convertDataToHexString(ncaId, SHA256_HASH_SIZE / 2, ncaIdStr, SHA256_HASH_SIZE + 1);
+    snprintf(outPath, outPathSize, "%s%s.nca", NCA_STORE_PATH, ncaIdStr);
+}
+
+bool ncaStoreLookup(const u8 *ncaId, u64 size, u8 *outHash, u64 *outPartSize)
+{
+    if (!ncaId) return false;
+    
+    char ncaPath[NAME_BUF_LEN] = {'\0'};
+    bool found = false, success = false;
+    u32 pos;
+    
+    pthread_mutex_lock(&storeMutex);
+    
+    if (!storeLoaded) ncaStoreLoad();
+    
+    pos = ncaStoreSearch(ncaId, &found);
+    if (!found || storeEntries[pos].size != size) goto out;
+    
+    // Make sure the NCA is still there
+    ncaStoreGetNcaPath(ncaId, ncaPath, MAX_CHARACTERS(ncaPath));
+    
+    if (!checkIfFileExists(ncaPath))
+    {
+        if (pos < (storeEntryCnt - 1)) memmove(&(storeEntries[pos]), &(storeEntries[pos + 1]), (storeEntryCnt - pos - 1) * sizeof(nca_store_entry_t));
+        storeEntryCnt--;
+        storeDirty = true;
+        goto out;
+    }
+    
+    if (outHash) memcpy(outHash, storeEntries[pos].hash, SHA256_HASH_SIZE);
+    if (outPartSize) *outPartSize = storeEntries[pos].partSize;
+    
+    success = true;
+    
+out:
+    pthread_mutex_unlock(&storeMutex);
+    
+    return success;
+}
+
+bool ncaStoreAdd(const char *tmpPath, const u8 *hash, u64 size, u64 partSize)
+{
+    if (!tmpPath || !strlen(tmpPath) || !hash) return false;
+    
+    char ncaPath[NAME_BUF_LEN] = {'\0'};
+    bool found = false, success = false;
+    u32 pos;
+    
+    ncaStoreGetNcaPath(hash, ncaPath, MAX_CHARACTERS(ncaPath));
+    
+    pthread_mutex_lock(&storeMutex);
+    
+    if (!storeLoaded) ncaStoreLoad();
+    
+    pos = ncaStoreSearch(hash, &found);
+    
+    // Modified NCAs can only be identified once they have been written
+    if (found && storeEntries[pos].size == size && checkIfFileExists(ncaPath))
+    {
+        remove(tmpPath);
+        fsdevDeleteDirectoryRecursively(tmpPath);
+        success = true;
+        goto out;
+    }
+    
+    // Get rid of any leftovers from a previous entry with the same NCA ID
+    remove(ncaPath);
+    fsdevDeleteDirectoryRecursively(ncaPath);
+    
+    if (rename(tmpPath, ncaPath) != 0) goto out;
+    
+    if (!found)
+    {
+        if (!ncaStoreReserve(storeEntryCnt + 1)) goto out;
+        
+        if (pos < storeEntryCnt) memmove(&(storeEntries[pos + 1]), &(storeEntries[pos]), (storeEntryCnt - pos) * sizeof(nca_store_entry_t));
+        storeEntryCnt++;
+    }
+    
+    memcpy(storeEntries[pos].hash, hash, SHA256_HASH_SIZE);
+    storeEntries[pos].size = size;
+    storeEntries[pos].partSize = partSize;
+    
+    storeDirty = true;
+    success = true;
+    
+out:
+    pthread_mutex_unlock(&storeMutex);
+    
+    return success;
+}
+
+static bool ncaStoreWriteIndex()
+{
+    if (!storeLoaded || !storeDirty) return true;
+    
+    FILE *indexFile = fopen(NCA_STORE_INDEX_TMP_PATH, "wb");
+    if (!indexFile) return false;
+    
+    size_t write_res;
+    bool success = false;
+    u32 crc = 0;
+    nca_store_header_t header;
+    
+    memset(&header, 0, sizeof(nca_store_header_t));
+    header.magic = NCA_STORE_MAGIC;
+    header.formatVersion = NCA_STORE_FORMAT_VERSION;
+    header.entryCount = storeEntryCnt;
+    
+    if (storeEntryCnt) crc32(storeEntries, (u64)storeEntryCnt * sizeof(nca_store_entry_t), &crc);
+    header.entryCrc = crc;
+    
+    write_res = fwrite(&header, 1, sizeof(nca_store_header_t), indexFile);
+    if (write_res == sizeof(nca_store_header_t) && storeEntryCnt) write_res = fwrite(storeEntries, 1, (u64)storeEntryCnt * sizeof(nca_store_entry_t), indexFile);
+    
+    success = (write_res == (storeEntryCnt ? ((u64)storeEntryCnt * sizeof(nca_store_entry_t)) : sizeof(nca_store_header_t)));
+    
+    if (fclose(indexFile) != 0) success = false;
+    
+    if (!success)
+    {
+        remove(NCA_STORE_INDEX_TMP_PATH);
+        return false;
+    }
+    
+    // The SD card filesystem driver can't rename a file on top of an existing one
+    remove(NCA_STORE_INDEX_PATH);
+    
+    if (rename(NCA_STORE_INDEX_TMP_PATH, NCA_STORE_INDEX_PATH) != 0) return false;
+    
+    storeDirty = false;
+    
+    return true;
+}
+
+bool ncaStoreSave()
+{
+    pthread_mutex_lock(&storeMutex);
+    bool success = ncaStoreWriteIndex();
+    pthread_mutex_unlock(&storeMutex);
+    
+    return success;
+}
+
+void ncaStoreFree()
+{
+    pthread_mutex_lock(&storeMutex);
+    ncaStoreReset();
+    pthread_mutex_unlock(&storeMutex);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#ifndef __NCA_STORE_H__
+#define __NCA_STORE_H__
+
+#include <switch.h>
+#include "util.h"
+
+#define NCA_STORE_MAGIC                 0x54534E43                  // "CNST"
+#define NCA_STORE_FORMAT_VERSION        1
+#define NCA_STORE_ALLOC_STEP            256                         // Growth step for the in-memory entry list
+
+// Each NCA in the store is saved as "[NCA_STORE_PATH][NCA ID].nca". The NCA ID is the first half of its SHA-256 checksum, so every NCA is only stored once no matter how many titles reference it
+// NCAs bigger than 4 GiB are stored as a directory with the archive bit set if 'partSize' isn't zero, like split NSP dumps
+typedef struct {
+    u8 hash[SHA256_HASH_SIZE];
+    u64 size;
+    u64 partSize;
+} PACKED nca_store_entry_t;
+
+typedef struct {
+    u32 magic;                                      // NCA_STORE_MAGIC
+    u32 formatVersion;                              // NCA_STORE_FORMAT_VERSION
+    u32 entryCount;
+    u32 entryCrc;                                   // CRC32 checksum of all entries
+} PACKED nca_store_header_t;
+
+// All functions below may be called from any thread
+
+// Generates the path for a stored NCA
+void ncaStoreGetNcaPath(const u8 *ncaId, char *outPath, size_t outPathSize);
+
+// Returns true if the NCA is available in the store with the provided size. Its full SHA-256 checksum and part size are copied to 'outHash' and 'outPartSize' if so
+// Entries whose NCA has been removed from the SD card are dropped from the store index
+bool ncaStoreLookup(const u8 *ncaId, u64 size, u8 *outHash, u64 *outPartSize);
+
+// Moves a complete NCA written to 'tmpPath' into the store, using the NCA ID taken from 'hash'
+// The temporary copy is removed instead if the store already holds that NCA. Changes to the store index are kept in memory until ncaStoreSave() is called
+bool ncaStoreAdd(const char *tmpPath, const u8 *hash, u64 size, u64 partSize);
+
+// Writes the store index to the SD card if it has been modified
+bool ncaStoreSave();
+
+// Frees the in-memory store index. Unsaved changes are discarded
+void ncaStoreFree();
+
+#endif
@@ -27,14 +27,21 @@ static u64 nsoBinaryRodataSectionSize = 0;
 static u64 nsoBinaryDataSectionOffset = 0;
 static u64 nsoBinaryDataSectionSize = 0;
 
+static bool nsoBinaryDataCached = false;    // Set if nsoBinaryData is owned by the NSO image cache
+
+static nso_cache_entry_t nsoImageCache[NSO_CACHE_MAX_ENTRIES];
+static u32 nsoImageCacheCount = 0;
+static u64 nsoImageCacheSize = 0;
+
 void freeNsoBinaryData()
 {
     if (nsoBinaryData)
     {
-        free(nsoBinaryData);
+        if (!nsoBinaryDataCached) free(nsoBinaryData);
         nsoBinaryData = NULL;
     }
     
+    nsoBinaryDataCached = false;
     nsoBinaryDataSize = 0;
     
     nsoBinaryTextSectionOffset = 0;
@@ -47,7 +54,364 @@ void freeNsoBinaryData()
     nsoBinaryDataSectionSize = 0;
 }
 
-bool loadNsoBinaryData(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, u64 nso_base_offset, nso_header_t *nsoHeader)
+static int nsoImageCacheFind(const NcmContentId *ncaId, u64 nso_offset)
+{
+    u32 i;
+    
+    for(i = 0; i < nsoImageCacheCount; i++)
+    {
+        if (nsoImageCache[i].nso_offset == nso_offset && !memcmp(nsoImageCache[i].ncaId.c, ncaId->c, sizeof(NcmContentId))) return (int)i;
+    }
+    
+    return -1;
+}
+
+static void nsoImageCacheRemove(u32 idx)
+{
+    free(nsoImageCache[idx].data);
+    nsoImageCacheSize -= nsoImageCache[idx].data_size;
+    
+    if (idx < (nsoImageCacheCount - 1)) memmove(&(nsoImageCache[idx]), &(nsoImageCache[idx + 1]), (nsoImageCacheCount - idx - 1) * sizeof(nso_cache_entry_t));
+    
+    nsoImageCacheCount--;
+    memset(&(nsoImageCache[nsoImageCacheCount]), 0, sizeof(nso_cache_entry_t));
+}
+
+// Hands the currently loaded NSO image over to the cache, if it fits
+static void nsoImageCacheStore(const NcmContentId *ncaId, u64 nso_offset)
+{
+    u32 i;
+    u64 maxSize = (appletModeCheck() ? NSO_CACHE_APPLET_MAX_SIZE : NSO_CACHE_MAX_SIZE);
+    nso_cache_entry_t *entry = NULL;
+    
+    if (nsoBinaryDataSize > maxSize) return;
+    
+    // Make room by dropping images from other NCAs, oldest first
+    // Images from the current NCA are never evicted: the first NSOs to be loaded (e.g. "main") are the ones that get reused
+    for(i = 0; i < nsoImageCacheCount && ((nsoImageCacheSize + nsoBinaryDataSize) > maxSize || nsoImageCacheCount == NSO_CACHE_MAX_ENTRIES);)
+    {
+        if (memcmp(nsoImageCache[i].ncaId.c, ncaId->c, sizeof(NcmContentId)) != 0)
+        {
+            nsoImageCacheRemove(i);
+        } else {
+            i++;
+        }
+    }
+    
+    if ((nsoImageCacheSize + nsoBinaryDataSize) > maxSize || nsoImageCacheCount == NSO_CACHE_MAX_ENTRIES) return;
+    
+    entry = &(nsoImageCache[nsoImageCacheCount]);
+    
+    memcpy(&(entry->ncaId), ncaId, sizeof(NcmContentId));
+    entry->nso_offset = nso_offset;
+    entry->data = nsoBinaryData;
+    entry->data_size = nsoBinaryDataSize;
+    entry->segment_offset[0] = nsoBinaryTextSectionOffset;
+    entry->segment_size[0] = nsoBinaryTextSectionSize;
+    entry->segment_offset[1] = nsoBinaryRodataSectionOffset;
+    entry->segment_size[1] = nsoBinaryRodataSectionSize;
+    entry->segment_offset[2] = nsoBinaryDataSectionOffset;
+    entry->segment_size[2] = nsoBinaryDataSectionSize;
+    
+    nsoImageCacheCount++;
+    nsoImageCacheSize += nsoBinaryDataSize;
+    
+    nsoBinaryDataCached = true;
+}
+
+void freeNsoImageCache()
+{
+    // Don't leave a dangling pointer behind
+    if (nsoBinaryDataCached) freeNsoBinaryData();
+    
+    while(nsoImageCacheCount > 0) nsoImageCacheRemove(nsoImageCacheCount - 1);
+    
+    nsoImageCacheSize = 0;
+}
+
+static const char *nsoSegmentNames[NSO_SEGMENT_CNT] = { ".text", ".rodata", ".data" };
+
+static void nsoDecompressSegment(nso_segment_job_t *job)
+{
+    int res;
+    
+    if (!job->dst_size)
+    {
+        job->success = true;
+        return;
+    }
+    
+    if (job->dst_size < job->decompressed_size)
+    {
+        // Only decompress the part that isn't overwritten by the next segment
+        res = LZ4_decompress_safe_partial((const char*)job->compressed, (char*)job->dst, (int)job->compressed_size, (int)job->dst_size, (int)job->dst_size);
+        job->success = (res == (int)job->dst_size);
+    } else {
+        res = LZ4_decompress_safe((const char*)job->compressed, (char*)job->dst, (int)job->compressed_size, (int)job->decompressed_size);
+        job->success = (res == (int)job->decompressed_size);
+    }
+}
+
+// Decompresses the segment (if it hasn't been already) and checks its hash
+static void nsoProcessSegment(nso_segment_job_t *job)
+{
+    u8 hash[SHA256_HASH_SIZE];
+    
+    if (job->compressed) nsoDecompressSegment(job);
+    
+    if (job->success && job->expected_hash)
+    {
+        sha256CalculateHash(hash, job->dst, job->dst_size);
+        job->hash_mismatch = (memcmp(hash, job->expected_hash, SHA256_HASH_SIZE) != 0);
+    }
+}
+
+static void *nsoProcessSegmentThreadFunc(void *arg)
+{
+    nsoProcessSegment((nso_segment_job_t*)arg);
+    return NULL;
+}
+
+static void nsoLz4StreamInit(nso_lz4_stream_t *stream, u8 *dst, u64 dst_size, u64 compressed_size)
+{
+    memset(stream, 0, sizeof(nso_lz4_stream_t));
+    
+    stream->state = NSO_LZ4_STATE_TOKEN;
+    stream->dst = dst;
+    stream->dst_size = dst_size;
+    stream->compressed_size = compressed_size;
+    stream->done = (dst_size == 0);
+}
+
+// Feeds the next piece of the compressed block to the decoder. Returns false if the block data is invalid
+static bool nsoLz4StreamUpdate(nso_lz4_stream_t *stream, const u8 *in, u64 inSize)
+{
+    u64 pos = 0, cnt, i;
+    u8 val;
+    
+    while(!stream->done)
+    {
+        switch(stream->state)
+        {
+            case NSO_LZ4_STATE_TOKEN:
+                if (pos >= inSize) goto out;
+                
+                val = in[pos++];
+                stream->literal_len = (u64)(val >> 4);
+                stream->match_len = (u64)(val & 0x0F);
+                stream->state = (stream->literal_len == 0x0F ? NSO_LZ4_STATE_LITERAL_LEN : NSO_LZ4_STATE_LITERALS);
+                break;
+            case NSO_LZ4_STATE_LITERAL_LEN:
+                if (pos >= inSize) goto out;
+                
+                val = in[pos++];
+                stream->literal_len += (u64)val;
+                if (val != 0xFF) stream->state = NSO_LZ4_STATE_LITERALS;
+                break;
+            case NSO_LZ4_STATE_LITERALS:
+                if (stream->literal_len)
+                {
+                    if (pos >= inSize) goto out;
+                    
+                    cnt = (stream->literal_len < (inSize - pos) ? stream->literal_len : (inSize - pos));
+                    if (cnt > (stream->dst_size - stream->written)) cnt = (stream->dst_size - stream->written);
+                    
+                    memcpy(stream->dst + stream->written, in + pos, cnt);
+                    pos += cnt;
+                    stream->written += cnt;
+                    stream->literal_len -= cnt;
+                    
+                    if (stream->written == stream->dst_size)
+                    {
+                        stream->done = true;
+                        break;
+                    }
+                    
+                    if (stream->literal_len) break;
+                }
+                
+                // The last sequence from a block only holds literals
+                if ((stream->consumed + pos) == stream->compressed_size) return false;
+                
+                stream->state = NSO_LZ4_STATE_OFFSET_LO;
+                break;
+            case NSO_LZ4_STATE_OFFSET_LO:
+                if (pos >= inSize) goto out;
+                
+                stream->match_offset = (u64)in[pos++];
+                stream->state = NSO_LZ4_STATE_OFFSET_HI;
+                break;
+            case NSO_LZ4_STATE_OFFSET_HI:
+                if (pos >= inSize) goto out;
+                
+                stream->match_offset |= ((u64)in[pos++] << 8);
+                if (!stream->match_offset || stream->match_offset > stream->written) return false;
+                
+                if (stream->match_len == 0x0F)
+                {
+                    stream->state = NSO_LZ4_STATE_MATCH_LEN;
+                } else {
+                    stream->match_len += 4;
+                    stream->state = NSO_LZ4_STATE_MATCH;
+                }
+                
+                break;
+            case NSO_LZ4_STATE_MATCH_LEN:
+                if (pos >= inSize) goto out;
+                
+                val = in[pos++];
+                stream->match_len += (u64)val;
+                
+                if (val != 0xFF)
+                {
+                    stream->match_len += 4;
+                    stream->state = NSO_LZ4_STATE_MATCH;
+                }
+                
+                break;
+            case NSO_LZ4_STATE_MATCH:
+                cnt = (stream->match_len < (stream->dst_size - stream->written) ? stream->match_len : (stream->dst_size - stream->written));
+                
+                if (stream->match_offset >= cnt)
+                {
+                    memcpy(stream->dst + stream->written, stream->dst + stream->written - stream->match_offset, cnt);
+                } else {
+                    // Overlapping match: repeat the last 'match_offset' bytes
+                    for(i = 0; i < cnt; i++) stream->dst[stream->written + i] = stream->dst[stream->written + i - stream->match_offset];
+                }
+                
+                stream->written += cnt;
+                stream->match_len = 0;
+                
+                if (stream->written == stream->dst_size)
+                {
+                    stream->done = true;
+                    break;
+                }
+                
+                stream->state = NSO_LZ4_STATE_TOKEN;
+                break;
+            default:
+                return false;
+        }
+    }
+    
+out:
+    stream->consumed += pos;
+    
+    // Every byte from the block must be used before the output is complete
+    if (!stream->done && stream->consumed >= stream->compressed_size) return false;
+    
+    return true;
+}
+
+// Reads, decrypts and decompresses a segment in NSO_STREAM_CHUNK_SIZE pieces, so the whole compressed segment never has to be held in memory
+static bool nsoStreamDecompressSegment(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, u64 offset, nso_segment_job_t *job, u8 *chunkBuf, u8 segmentIdx)
+{
+    nso_lz4_stream_t stream;
+    u64 chunkOffset, chunkSize;
+    
+    nsoLz4StreamInit(&stream, job->dst, job->dst_size, job->compressed_size);
+    
+    for(chunkOffset = 0; chunkOffset < job->compressed_size && !stream.done; chunkOffset += chunkSize)
+    {
+        chunkSize = ((job->compressed_size - chunkOffset) > NSO_STREAM_CHUNK_SIZE ? NSO_STREAM_CHUNK_SIZE : (job->compressed_size - chunkOffset));
+        
+        if (!processNcaCtrSectionBlock(ncmStorage, ncaId, aes_ctx, offset + chunkOffset, chunkBuf, chunkSize, false))
+        {
+            breaks++;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read 0x%016lX bytes %s section chunk from NSO in Program NCA!", __func__, chunkSize, nsoSegmentNames[segmentIdx]);
+            return false;
+        }
+        
+        if (!nsoLz4StreamUpdate(&stream, chunkBuf, chunkSize)) break;
+    }
+    
+    if (!stream.done)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to decompress %s section from NSO in Program NCA!", __func__, nsoSegmentNames[segmentIdx]);
+        return false;
+    }
+    
+    return true;
+}
+
+u64 nsoGetBinaryImageSize(const nso_header_t *nsoHeader)
+{
+    if (!nsoHeader) return 0;
+    return ((u64)nsoHeader->data_segment_header.memory_offset + ((nsoHeader->flags & (1 << 2)) ? (u64)nsoHeader->data_segment_header.decompressed_size : (u64)nsoHeader->data_compressed_size));
+}
+
+// Validates the segment layout from the NSO header and allocates the binary image. Segment sizes are stored in 'segmentSizes' (full size) and 'finalSegmentSizes' (size within the binary image)
+static bool nsoAllocBinaryImage(nso_header_t *nsoHeader, u64 *segmentSizes, u64 *finalSegmentSizes)
+{
+    u8 i;
+    
+    segment_header_t *segmentHeaders[NSO_SEGMENT_CNT] = { &(nsoHeader->text_segment_header), &(nsoHeader->rodata_segment_header), &(nsoHeader->data_segment_header) };
+    u32 compressedSizes[NSO_SEGMENT_CNT] = { nsoHeader->text_compressed_size, nsoHeader->rodata_compressed_size, nsoHeader->data_compressed_size };
+    bool compressed;
+    
+    for(i = 0; i < NSO_SEGMENT_CNT; i++)
+    {
+        compressed = (nsoHeader->flags & (1 << i));
+        
+        if (compressed && (u64)segmentHeaders[i]->decompressed_size <= (u64)compressedSizes[i])
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid decompressed size for %s section from NSO in Program NCA!", __func__, nsoSegmentNames[i]);
+            return false;
+        }
+        
+        segmentSizes[i] = (compressed ? (u64)segmentHeaders[i]->decompressed_size : (u64)compressedSizes[i]);
+    }
+    
+    if (nsoHeader->data_segment_header.memory_offset < nsoHeader->rodata_segment_header.memory_offset)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid segment layout in NSO from Program NCA!", __func__);
+        return false;
+    }
+    
+    // Calculate full binary size
+    // Segments are placed at their memory offsets. If a segment overlaps the next one, its last bytes are discarded
+    finalSegmentSizes[0] = (segmentSizes[0] > (u64)nsoHeader->rodata_segment_header.memory_offset ? (u64)nsoHeader->rodata_segment_header.memory_offset : segmentSizes[0]);
+    finalSegmentSizes[1] = (segmentSizes[1] > (u64)(nsoHeader->data_segment_header.memory_offset - nsoHeader->rodata_segment_header.memory_offset) ? (u64)(nsoHeader->data_segment_header.memory_offset - nsoHeader->rodata_segment_header.memory_offset) : segmentSizes[1]);
+    finalSegmentSizes[2] = segmentSizes[2];
+    
+    nsoBinaryDataSize = nsoGetBinaryImageSize(nsoHeader);
+    
+    nsoBinaryData = calloc(nsoBinaryDataSize, sizeof(u8));
+    if (!nsoBinaryData)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate %lu bytes for full decompressed NSO in Program NCA!", __func__, nsoBinaryDataSize);
+        nsoBinaryDataSize = 0;
+        return false;
+    }
+    
+    return true;
+}
+
+static void nsoSetBinarySectionInfo(nso_header_t *nsoHeader, const u64 *finalSegmentSizes)
+{
+    nsoBinaryTextSectionOffset = 0;
+    nsoBinaryTextSectionSize = finalSegmentSizes[0];
+    
+    nsoBinaryRodataSectionOffset = (u64)nsoHeader->rodata_segment_header.memory_offset;
+    nsoBinaryRodataSectionSize = finalSegmentSizes[1];
+    
+    nsoBinaryDataSectionOffset = (u64)nsoHeader->data_segment_header.memory_offset;
+    nsoBinaryDataSectionSize = finalSegmentSizes[2];
+}
+
+// Sets up the hash check for a segment job. Returns false if the segment can't be checked: either the NSO header has no hash for it, or its last bytes are overwritten by the next segment
+static bool nsoSetSegmentJobHash(nso_header_t *nsoHeader, nso_segment_job_t *job, u8 segmentIdx)
+{
+    const u8 *segmentHashes[NSO_SEGMENT_CNT] = { nsoHeader->text_decompressed_hash, nsoHeader->rodata_decompressed_hash, nsoHeader->data_decompressed_hash };
+    
+    job->expected_hash = (((nsoHeader->flags & (1 << (segmentIdx + 3))) && job->dst_size == job->decompressed_size) ? segmentHashes[segmentIdx] : NULL);
+    
+    return (job->expected_hash != NULL);
+}
+
+bool loadNsoBinaryData(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, u64 nso_base_offset, nso_header_t *nsoHeader, u8 *outUnverifiedMask)
 {
     if (!ncmStorage || !ncaId || !aes_ctx || !nso_base_offset || !nsoHeader)
     {
@@ -57,188 +421,321 @@ bool loadNsoBinaryData(NcmContentStorage *ncmStorage, const NcmContentId *ncaId,
     
     u8 i;
     
-    u8 *nsoTextSection = NULL;
-    u64 nsoTextSectionSize = 0;
+    segment_header_t *segmentHeaders[NSO_SEGMENT_CNT] = { &(nsoHeader->text_segment_header), &(nsoHeader->rodata_segment_header), &(nsoHeader->data_segment_header) };
+    u32 compressedSizes[NSO_SEGMENT_CNT] = { nsoHeader->text_compressed_size, nsoHeader->rodata_compressed_size, nsoHeader->data_compressed_size };
     
-    u8 *nsoRodataSection = NULL;
-    u64 nsoRodataSectionSize = 0;
+    u64 segmentSizes[NSO_SEGMENT_CNT];
+    u64 finalSegmentSizes[NSO_SEGMENT_CNT];
     
-    u8 *nsoDataSection = NULL;
-    u64 nsoDataSectionSize = 0;
+    nso_segment_job_t jobs[NSO_SEGMENT_CNT];
+    nso_segment_job_t *job;
     
-    u8 *curCompressedSection;
-    u64 curCompressedSectionSize;
-    u64 curCompressedSectionOffset;
-    u8 curSectionFlag;
+    int cacheIdx;
     
-    u8 *curDecompressedSection;
-    u64 curDecompressedSectionSize;
+    // Under applet mode, compressed segments are streamed in chunks instead of being fully read into memory first
+    bool useStreaming = appletModeCheck();
+    u8 *chunkBuf = NULL;
     
     bool success = true;
     
     freeNsoBinaryData();
     
-    for(i = 0; i < 3; i++)
+    // Reuse the decompressed image if this NSO has already been loaded
+    // Cached images aren't necessarily checked against the segment hashes, so they're dropped if verification was requested
+    cacheIdx = nsoImageCacheFind(ncaId, nso_base_offset);
+    if (cacheIdx >= 0 && outUnverifiedMask)
     {
-        curCompressedSection = NULL;
-        curCompressedSectionSize = (i == 0 ? (u64)nsoHeader->text_compressed_size : (i == 1 ? (u64)nsoHeader->rodata_compressed_size : (u64)nsoHeader->data_compressed_size));
-        curCompressedSectionOffset = (nso_base_offset + (i == 0 ? (u64)nsoHeader->text_segment_header.file_offset : (i == 1 ? (u64)nsoHeader->rodata_segment_header.file_offset : (u64)nsoHeader->data_segment_header.file_offset)));
-        curSectionFlag = (1 << i);
+        nsoImageCacheRemove((u32)cacheIdx);
+        cacheIdx = -1;
+    }
+    
+    if (cacheIdx >= 0)
+    {
+        nsoBinaryData = nsoImageCache[cacheIdx].data;
+        nsoBinaryDataSize = nsoImageCache[cacheIdx].data_size;
+        nsoBinaryDataCached = true;
         
-        curDecompressedSection = NULL;
-        curDecompressedSectionSize = (i == 0 ? (u64)nsoHeader->text_segment_header.decompressed_size : (i == 1 ? (u64)nsoHeader->rodata_segment_header.decompressed_size : (u64)nsoHeader->data_segment_header.decompressed_size));
+        nsoBinaryTextSectionOffset = nsoImageCache[cacheIdx].segment_offset[0];
+        nsoBinaryTextSectionSize = nsoImageCache[cacheIdx].segment_size[0];
         
-        // Load section
-        curCompressedSection = malloc(curCompressedSectionSize);
-        if (!curCompressedSection)
-        {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the compressed %s section from NSO in Program NCA!", __func__, (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
-            success = false;
-            break;
-        }
+        nsoBinaryRodataSectionOffset = nsoImageCache[cacheIdx].segment_offset[1];
+        nsoBinaryRodataSectionSize = nsoImageCache[cacheIdx].segment_size[1];
         
-        if (!processNcaCtrSectionBlock(ncmStorage, ncaId, aes_ctx, curCompressedSectionOffset, curCompressedSection, curCompressedSectionSize, false))
-        {
-            breaks++;
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read 0x%016lX bytes %s section from NSO in Program NCA!", __func__, curCompressedSectionSize, (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
-            free(curCompressedSection);
-            success = false;
-            break;
-        }
+        nsoBinaryDataSectionOffset = nsoImageCache[cacheIdx].segment_offset[2];
+        nsoBinaryDataSectionSize = nsoImageCache[cacheIdx].segment_size[2];
+        
+        return true;
+    }
+    
+    memset(jobs, 0, sizeof(jobs));
+    
+    if (outUnverifiedMask) *outUnverifiedMask = 0;
+    
+    if (!nsoAllocBinaryImage(nsoHeader, segmentSizes, finalSegmentSizes)) return false;
+    
+    // Segments are read one after another (NCA reads share a single CTR buffer), but each compressed segment is decompressed straight into the binary image by a separate thread while the next one is being read
+    // Segment hashes are checked by the same threads, right after decompression
+    for(i = 0; i < NSO_SEGMENT_CNT; i++)
+    {
+        job = &(jobs[i]);
+        
+        job->compressed_size = (u64)compressedSizes[i];
+        job->decompressed_size = segmentSizes[i];
+        job->dst = (nsoBinaryData + (i == 0 ? 0 : (u64)segmentHeaders[i]->memory_offset));
+        job->dst_size = finalSegmentSizes[i];
+        
+        if (outUnverifiedMask && !nsoSetSegmentJobHash(nsoHeader, job, i)) *outUnverifiedMask |= (u8)(1 << i);
         
-        if (nsoHeader->flags & curSectionFlag)
+        if (!(nsoHeader->flags & (1 << i)))
         {
-            if (curDecompressedSectionSize <= curCompressedSectionSize)
+            // Uncompressed segments are read straight into the binary image
+            if (job->dst_size && !processNcaCtrSectionBlock(ncmStorage, ncaId, aes_ctx, nso_base_offset + (u64)segmentHeaders[i]->file_offset, job->dst, job->dst_size, false))
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid decompressed size for %s section from NSO in Program NCA!", __func__, (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
-                free(curCompressedSection);
+                breaks++;
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read 0x%016lX bytes %s section from NSO in Program NCA!", __func__, job->dst_size, nsoSegmentNames[i]);
                 success = false;
                 break;
             }
             
-            // Uncompress section
-            curDecompressedSection = malloc(curDecompressedSectionSize);
-            if (!curDecompressedSection)
+            job->success = true;
+        } else {
+            // Fall back to streaming if there isn't enough memory left for the whole compressed segment
+            if (!useStreaming)
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the decompressed %s section from NSO in Program NCA!", __func__, (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
-                free(curCompressedSection);
-                success = false;
-                break;
+                job->compressed = malloc(job->compressed_size);
+                if (!job->compressed) useStreaming = true;
             }
             
-            if (LZ4_decompress_safe((const char*)curCompressedSection, (char*)curDecompressedSection, (int)curCompressedSectionSize, (int)curDecompressedSectionSize) != (int)curDecompressedSectionSize)
+            if (useStreaming)
+            {
+                if (!chunkBuf)
+                {
+                    chunkBuf = malloc(NSO_STREAM_CHUNK_SIZE);
+                    if (!chunkBuf)
+                    {
+                        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the compressed %s section from NSO in Program NCA!", __func__, nsoSegmentNames[i]);
+                        success = false;
+                        break;
+                    }
+                }
+                
+                job->success = nsoStreamDecompressSegment(ncmStorage, ncaId, aes_ctx, nso_base_offset + (u64)segmentHeaders[i]->file_offset, job, chunkBuf, i);
+                if (!job->success)
+                {
+                    success = false;
+                    break;
+                }
+            } else
+            if (!processNcaCtrSectionBlock(ncmStorage, ncaId, aes_ctx, nso_base_offset + (u64)segmentHeaders[i]->file_offset, job->compressed, job->compressed_size, false))
             {
-                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to decompress %s section from NSO in Program NCA!", __func__, (i == 0 ? ".text" : (i == 1 ? ".rodata" : ".data")));
-                free(curDecompressedSection);
-                free(curCompressedSection);
+                breaks++;
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read 0x%016lX bytes %s section from NSO in Program NCA!", __func__, job->compressed_size, nsoSegmentNames[i]);
                 success = false;
                 break;
             }
-            
-            free(curCompressedSection);
-            
-            switch(i)
-            {
-                case 0:
-                    nsoTextSection = curDecompressedSection;
-                    nsoTextSectionSize = curDecompressedSectionSize;
-                    break;
-                case 1:
-                    nsoRodataSection = curDecompressedSection;
-                    nsoRodataSectionSize = curDecompressedSectionSize;
-                    break;
-                case 2:
-                    nsoDataSection = curDecompressedSection;
-                    nsoDataSectionSize = curDecompressedSectionSize;
-                    break;
-                default:
-                    break;
-            }
+        }
+        
+        if (!job->compressed && !job->expected_hash) continue;
+        
+        // The last segment is processed by the calling thread. The same goes for any segment whose thread couldn't be started
+        if (i < (NSO_SEGMENT_CNT - 1) && pthread_create(&(job->thread), NULL, &nsoProcessSegmentThreadFunc, job) == 0)
+        {
+            job->thread_started = true;
         } else {
-            switch(i)
-            {
-                case 0:
-                    nsoTextSection = curCompressedSection;
-                    nsoTextSectionSize = curCompressedSectionSize;
-                    break;
-                case 1:
-                    nsoRodataSection = curCompressedSection;
-                    nsoRodataSectionSize = curCompressedSectionSize;
-                    break;
-                case 2:
-                    nsoDataSection = curCompressedSection;
-                    nsoDataSectionSize = curCompressedSectionSize;
-                    break;
-                default:
-                    break;
-            }
+            nsoProcessSegment(job);
         }
     }
     
-    curCompressedSection = curDecompressedSection = NULL;
-    
-    if (success)
+    for(i = 0; i < NSO_SEGMENT_CNT; i++)
     {
-        // Calculate full binary size
-        u64 finalTextSectionSize = nsoTextSectionSize;
-        u64 finalRodataSectionSize = nsoRodataSectionSize;
+        job = &(jobs[i]);
         
-        nsoBinaryDataSize = nsoTextSectionSize;
+        if (job->thread_started) pthread_join(job->thread, NULL);
         
-        if ((u64)nsoHeader->rodata_segment_header.memory_offset > nsoBinaryDataSize)
-        {
-            nsoBinaryDataSize += ((u64)nsoHeader->rodata_segment_header.memory_offset - nsoBinaryDataSize);
-        } else
-        if ((u64)nsoHeader->rodata_segment_header.memory_offset < nsoBinaryDataSize)
+        if (success && !job->success)
         {
-            finalTextSectionSize -= (nsoBinaryDataSize - (u64)nsoHeader->rodata_segment_header.memory_offset);
-            nsoBinaryDataSize -= (nsoBinaryDataSize - (u64)nsoHeader->rodata_segment_header.memory_offset);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to decompress %s section from NSO in Program NCA!", __func__, nsoSegmentNames[i]);
+            success = false;
         }
         
-        nsoBinaryDataSize += nsoRodataSectionSize;
-        
-        if ((u64)nsoHeader->data_segment_header.memory_offset > nsoBinaryDataSize)
+        if (success && job->hash_mismatch)
         {
-            nsoBinaryDataSize += ((u64)nsoHeader->data_segment_header.memory_offset - nsoBinaryDataSize);
-        } else
-        if ((u64)nsoHeader->data_segment_header.memory_offset < nsoBinaryDataSize)
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s section hash mismatch in NSO from Program NCA!", __func__, nsoSegmentNames[i]);
+            success = false;
+        }
+        
+        if (job->compressed) free(job->compressed);
+    }
+    
+    if (chunkBuf) free(chunkBuf);
+    
+    if (!success)
+    {
+        freeNsoBinaryData();
+        return false;
+    }
+    
+    nsoSetBinarySectionInfo(nsoHeader, finalSegmentSizes);
+    
+    nsoImageCacheStore(ncaId, nso_base_offset);
+    
+    return true;
+}
+
+bool loadNsoBinaryDataFromMemory(const u8 *nsoData, u64 nsoDataSize, nso_header_t *nsoHeader, u8 *outUnverifiedMask)
+{
+    if (!nsoData || nsoDataSize < sizeof(nso_header_t) || !nsoHeader)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to load .text, .rodata and .data sections from NSO!", __func__);
+        return false;
+    }
+    
+    u8 i;
+    
+    segment_header_t *segmentHeaders[NSO_SEGMENT_CNT] = { &(nsoHeader->text_segment_header), &(nsoHeader->rodata_segment_header), &(nsoHeader->data_segment_header) };
+    u32 compressedSizes[NSO_SEGMENT_CNT] = { nsoHeader->text_compressed_size, nsoHeader->rodata_compressed_size, nsoHeader->data_compressed_size };
+    
+    u64 segmentSizes[NSO_SEGMENT_CNT];
+    u64 finalSegmentSizes[NSO_SEGMENT_CNT];
+    
+    nso_segment_job_t jobs[NSO_SEGMENT_CNT];
+    nso_segment_job_t *job;
+    
+    bool success = true;
+    
+    freeNsoBinaryData();
+    
+    memset(jobs, 0, sizeof(jobs));
+    
+    if (outUnverifiedMask) *outUnverifiedMask = 0;
+    
+    for(i = 0; i < NSO_SEGMENT_CNT; i++)
+    {
+        if (((u64)segmentHeaders[i]->file_offset + (u64)compressedSizes[i]) > nsoDataSize)
         {
-            finalRodataSectionSize -= (nsoBinaryDataSize - (u64)nsoHeader->data_segment_header.memory_offset);
-            nsoBinaryDataSize -= (nsoBinaryDataSize - (u64)nsoHeader->data_segment_header.memory_offset);
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s section exceeds NSO boundaries!", __func__, nsoSegmentNames[i]);
+            return false;
         }
+    }
+    
+    if (!nsoAllocBinaryImage(nsoHeader, segmentSizes, finalSegmentSizes)) return false;
+    
+    // All segment data is already available, so every segment is decompressed and checked at the same time
+    for(i = 0; i < NSO_SEGMENT_CNT; i++)
+    {
+        job = &(jobs[i]);
+        
+        job->compressed_size = (u64)compressedSizes[i];
+        job->decompressed_size = segmentSizes[i];
+        job->dst = (nsoBinaryData + (i == 0 ? 0 : (u64)segmentHeaders[i]->memory_offset));
+        job->dst_size = finalSegmentSizes[i];
         
-        nsoBinaryDataSize += nsoDataSectionSize;
+        if (outUnverifiedMask && !nsoSetSegmentJobHash(nsoHeader, job, i)) *outUnverifiedMask |= (u8)(1 << i);
         
-        nsoBinaryData = calloc(nsoBinaryDataSize, sizeof(u8));
-        if (nsoBinaryData)
+        if (nsoHeader->flags & (1 << i))
         {
-            memcpy(nsoBinaryData, nsoTextSection, finalTextSectionSize);
-            memcpy(nsoBinaryData + (u64)nsoHeader->rodata_segment_header.memory_offset, nsoRodataSection, finalRodataSectionSize);
-            memcpy(nsoBinaryData + (u64)nsoHeader->data_segment_header.memory_offset, nsoDataSection, nsoDataSectionSize);
-            
-            nsoBinaryTextSectionOffset = 0;
-            nsoBinaryTextSectionSize = finalTextSectionSize;
-            
-            nsoBinaryRodataSectionOffset = (u64)nsoHeader->rodata_segment_header.memory_offset;
-            nsoBinaryRodataSectionSize = finalRodataSectionSize;
+            // The compressed data is only read from the NSO, never freed
+            job->compressed = (u8*)(nsoData + (u64)segmentHeaders[i]->file_offset);
+        } else {
+            memcpy(job->dst, nsoData + (u64)segmentHeaders[i]->file_offset, job->dst_size);
+            job->success = true;
             
-            nsoBinaryDataSectionOffset = (u64)nsoHeader->data_segment_header.memory_offset;
-            nsoBinaryDataSectionSize = nsoDataSectionSize;
+            if (!job->expected_hash) continue;
+        }
+        
+        if (i < (NSO_SEGMENT_CNT - 1) && pthread_create(&(job->thread), NULL, &nsoProcessSegmentThreadFunc, job) == 0)
+        {
+            job->thread_started = true;
         } else {
-            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate %lu bytes for full decompressed NSO in Program NCA!", __func__, nsoBinaryDataSize);
-            nsoBinaryDataSize = 0;
+            nsoProcessSegment(job);
+        }
+    }
+    
+    for(i = 0; i < NSO_SEGMENT_CNT; i++)
+    {
+        job = &(jobs[i]);
+        
+        if (job->thread_started) pthread_join(job->thread, NULL);
+        
+        if (success && !job->success)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to decompress %s section from NSO!", __func__, nsoSegmentNames[i]);
+            success = false;
+        }
+        
+        if (success && job->hash_mismatch)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: %s section hash mismatch in NSO!", __func__, nsoSegmentNames[i]);
             success = false;
         }
     }
     
-    if (nsoTextSection) free(nsoTextSection);
-    if (nsoRodataSection) free(nsoRodataSection);
-    if (nsoDataSection) free(nsoDataSection);
+    if (!success)
+    {
+        freeNsoBinaryData();
+        return false;
+    }
+    
+    nsoSetBinarySectionInfo(nsoHeader, finalSegmentSizes);
     
-    return success;
+    return true;
+}
+
+const u8 *getNsoBinaryImage(u64 *outSize)
+{
+    if (outSize) *outSize = nsoBinaryDataSize;
+    return nsoBinaryData;
+}
+
+u64 nsoFindNextPattern(const u8 *data, u64 size, u64 offset, const char **patterns, u32 patternCnt, u32 *outPatternIdx)
+{
+    if (!data || !size || offset >= size || !patterns || !patternCnt) return size;
+    
+    u32 i;
+    u8 firstChars[0x100] = {0};
+    u8 firstChar = (u8)patterns[0][0];
+    bool singleFirstChar = true;
+    size_t len;
+    const u8 *ptr = (data + offset);
+    const u8 *end = (data + size);
+    
+    for(i = 0; i < patternCnt; i++)
+    {
+        firstChars[(u8)patterns[i][0]] = 1;
+        if ((u8)patterns[i][0] != firstChar) singleFirstChar = false;
+    }
+    
+    while(ptr < end)
+    {
+        if (singleFirstChar)
+        {
+            ptr = memchr(ptr, firstChar, (size_t)(end - ptr));
+            if (!ptr) break;
+        } else
+        if (!firstChars[*ptr])
+        {
+            ptr++;
+            continue;
+        }
+        
+        for(i = 0; i < patternCnt; i++)
+        {
+            len = strlen(patterns[i]);
+            
+            if (len > 0 && len <= (size_t)(end - ptr) && !memcmp(ptr, patterns[i], len))
+            {
+                if (outPatternIdx) *outPatternIdx = i;
+                return (u64)(ptr - data);
+            }
+        }
+        
+        ptr++;
+    }
+    
+    return size;
 }
 
-bool retrieveMiddlewareListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, char *programInfoXml)
+bool retrieveMiddlewareListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, str_builder_t *programInfoXml)
 {
     if (!ncmStorage || !ncaId || !aes_ctx || !nso_filename || !strlen(nso_filename) || !nso_base_offset || !nsoHeader || !programInfoXml)
     {
@@ -248,37 +745,34 @@ bool retrieveMiddlewareListFromNso(NcmContentStorage *ncmStorage, const NcmConte
     
     u64 i;
     
-    char tmp[NAME_BUF_LEN] = {'\0'};
+    if (!loadNsoBinaryData(ncmStorage, ncaId, aes_ctx, nso_base_offset, nsoHeader, NULL)) return false;
     
-    if (!loadNsoBinaryData(ncmStorage, ncaId, aes_ctx, nso_base_offset, nsoHeader)) return false;
+    const char *mwPattern = "SDK MW+";
+    const u8 *rodata = (nsoBinaryData + nsoBinaryRodataSectionOffset);
     
-    for(i = 0; i < nsoBinaryRodataSectionSize; i++)
+    for(i = nsoFindNextPattern(rodata, nsoBinaryRodataSectionSize, 0, &mwPattern, 1, NULL); i < nsoBinaryRodataSectionSize; i = nsoFindNextPattern(rodata, nsoBinaryRodataSectionSize, i + 1, &mwPattern, 1, NULL))
     {
-        char *curStr = ((char*)nsoBinaryData + nsoBinaryRodataSectionOffset + i);
-        
-        if (strncmp(curStr, "SDK MW+", 7) != 0) continue;
+        char *curStr = ((char*)rodata + i);
         
         // Found a match
         char *mwDev = (curStr + 7);
-        char *mwName = (strchr(mwDev, '+') + 1);
+        char *mwName = strchr(mwDev, '+');
         
-        // Filter nnSdk entries
-        if (!strncasecmp(mwName, "NintendoSdk_nnSdk", 17))
+        // Filter nnSdk entries (and malformed ones)
+        if (!mwName || !strncasecmp(++mwName, "NintendoSdk_nnSdk", 17))
         {
             i += strlen(curStr);
             continue;
         }
         
-        sprintf(tmp, "    <Middleware>\n" \
-                     "      <ModuleName>%s</ModuleName>\n" \
-                     "      <VenderName>%.*s</VenderName>\n" \
-                     "      <NsoName>%s</NsoName>\n" \
-                     "    </Middleware>\n", \
-                     mwName, \
-                     (int)(mwName - mwDev - 1), mwDev, \
-                     nso_filename);
-        
-        strcat(programInfoXml, tmp);
+        strBuilderAppendFormat(programInfoXml, "    <Middleware>\n" \
+                                               "      <ModuleName>%s</ModuleName>\n" \
+                                               "      <VenderName>%.*s</VenderName>\n" \
+                                               "      <NsoName>%s</NsoName>\n" \
+                                               "    </Middleware>\n", \
+                                               mwName, \
+                                               (int)(mwName - mwDev - 1), mwDev, \
+                                               nso_filename);
         
         // Update counter
         i += strlen(curStr);
@@ -289,7 +783,7 @@ bool retrieveMiddlewareListFromNso(NcmContentStorage *ncmStorage, const NcmConte
     return true;
 }
 
-bool retrieveSymbolsListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, char *programInfoXml)
+bool retrieveSymbolsListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, str_builder_t *programInfoXml)
 {
     if (!ncmStorage || !ncaId || !aes_ctx || !nso_filename || !strlen(nso_filename) || !nso_base_offset || !nsoHeader || !programInfoXml)
     {
@@ -301,8 +795,6 @@ bool retrieveSymbolsListFromNso(NcmContentStorage *ncmStorage, const NcmContentI
     
     bool success = false;
     
-    char tmp[NAME_BUF_LEN] = {'\0'};
-    
     u32 mod_magic_offset;
     u32 mod_magic;
     s32 dynamic_section_offset;
@@ -325,7 +817,7 @@ bool retrieveSymbolsListFromNso(NcmContentStorage *ncmStorage, const NcmContentI
     
     u64 cur_symbol_table_offset = 0;
     
-    if (!loadNsoBinaryData(ncmStorage, ncaId, aes_ctx, nso_base_offset, nsoHeader)) return false;
+    if (!loadNsoBinaryData(ncmStorage, ncaId, aes_ctx, nso_base_offset, nsoHeader, NULL)) return false;
     
     mod_magic_offset = *((u32*)(&(nsoBinaryData[0x04])));
     mod_magic = *((u32*)(&(nsoBinaryData[mod_magic_offset])));
@@ -410,14 +902,12 @@ bool retrieveSymbolsListFromNso(NcmContentStorage *ncmStorage, const NcmContentI
         // TO-DO: Add more filters?
         if (!st_shndx && !st_value && st_type != ST_OBJECT)
         {
-            sprintf(tmp, "    <UnresolvedApi>\n" \
-                         "      <ApiName>%s</ApiName>\n" \
-                         "      <NsoName>%s</NsoName>\n" \
-                         "    </UnresolvedApi>\n", \
-                         symbol_str_table + st_name, \
-                         nso_filename);
-            
-            strcat(programInfoXml, tmp);
+            strBuilderAppendFormat(programInfoXml, "    <UnresolvedApi>\n" \
+                                                   "      <ApiName>%s</ApiName>\n" \
+                                                   "      <NsoName>%s</NsoName>\n" \
+                                                   "    </UnresolvedApi>\n", \
+                                                   symbol_str_table + st_name, \
+                                                   nso_filename);
         }
     }
     
@@ -4,6 +4,8 @@
 #define __NSO_H__
 
 #include <switch.h>
+#include <pthread.h>
+#include "str_builder.h"
 
 #define NSO_MAGIC       (u32)0x4E534F30     // "NSO0"
 #define MOD_MAGIC       (u32)0x4D4F4430     // "MOD0"
@@ -14,6 +16,14 @@
 
 #define ST_OBJECT       0x01
 
+#define NSO_SEGMENT_CNT 3                   // .text, .rodata, .data
+
+#define NSO_CACHE_MAX_ENTRIES       8
+#define NSO_CACHE_MAX_SIZE          (u64)0x8000000      // 128 MiB of decompressed NSO images
+#define NSO_CACHE_APPLET_MAX_SIZE   (u64)0x2000000      // 32 MiB when running under applet mode
+
+#define NSO_STREAM_CHUNK_SIZE       (u64)0x80000        // Compressed segment data read at once by the streaming decompressor
+
 typedef struct {
     u32 file_offset;
     u32 memory_offset;
@@ -49,10 +59,83 @@ typedef struct {
     u8 data_decompressed_hash[0x20];
 } PACKED nso_header_t;
 
+typedef struct {
+    u8 *compressed;
+    u64 compressed_size;
+    u64 decompressed_size;
+    u8 *dst;                                // Final location of the segment inside the NSO binary image
+    u64 dst_size;                           // Less than decompressed_size if the end of the segment is overwritten by the next one
+    const u8 *expected_hash;                // Decompressed segment hash from the NSO header. NULL if it isn't checked
+    bool success;
+    bool hash_mismatch;
+    pthread_t thread;
+    bool thread_started;
+} nso_segment_job_t;
+
+typedef enum {
+    NSO_LZ4_STATE_TOKEN = 0,
+    NSO_LZ4_STATE_LITERAL_LEN,
+    NSO_LZ4_STATE_LITERALS,
+    NSO_LZ4_STATE_OFFSET_LO,
+    NSO_LZ4_STATE_OFFSET_HI,
+    NSO_LZ4_STATE_MATCH_LEN,
+    NSO_LZ4_STATE_MATCH
+} nso_lz4_state_t;
+
+// Resumable LZ4 block decoder. NSO segments are stored as a single raw LZ4 block, which can't be fed in pieces to the bundled LZ4 library
+typedef struct {
+    nso_lz4_state_t state;
+    u8 *dst;
+    u64 dst_size;                           // Decoding stops as soon as this many bytes have been written
+    u64 written;
+    u64 compressed_size;
+    u64 consumed;
+    u64 literal_len;
+    u64 match_len;
+    u64 match_offset;
+    bool done;
+} nso_lz4_stream_t;
+
+typedef struct {
+    NcmContentId ncaId;
+    u64 nso_offset;                         // Relative to NCA start
+    u8 *data;
+    u64 data_size;
+    u64 segment_offset[NSO_SEGMENT_CNT];
+    u64 segment_size[NSO_SEGMENT_CNT];
+} nso_cache_entry_t;
+
+// Returns the offset of the first occurrence of any of the 'patternCnt' strings from 'patterns' found in 'data', starting at 'offset'. Returns 'size' if there are no more matches
+// All patterns are looked up in a single pass. Candidate positions are located with memchr() if all patterns start with the same character
+// If 'outPatternIdx' is provided, the index of the matched pattern is stored in it
+u64 nsoFindNextPattern(const u8 *data, u64 size, u64 offset, const char **patterns, u32 patternCnt, u32 *outPatternIdx);
+
+// Decompressed NSO images are kept in memory after being loaded, so both of these functions can be used on the same NSO without decompressing it twice
+// freeNsoImageCache() must be called once the current title has been processed
+
 // Retrieves the middleware list from a NSO stored in a partition from a NCA file
-bool retrieveMiddlewareListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, char *programInfoXml);
+bool retrieveMiddlewareListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, str_builder_t *programInfoXml);
 
 // Retrieves the symbols list from a NSO stored in a partition from a NCA file
-bool retrieveSymbolsListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, char *programInfoXml);
+bool retrieveSymbolsListFromNso(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, const char *nso_filename, u64 nso_base_offset, nso_header_t *nsoHeader, str_builder_t *programInfoXml);
+
+// Returns the size of the binary image generated from a NSO (segments placed at their memory offsets, without .bss)
+u64 nsoGetBinaryImageSize(const nso_header_t *nsoHeader);
+
+// Loads the binary image from a NSO stored in a partition from a NCA file
+// If 'outUnverifiedMask' is provided, each segment is checked against its hash from the NSO header while the next one is being read. Bits are set in it for segments that couldn't be checked (no hash available, or their last bytes are overwritten by the next segment)
+bool loadNsoBinaryData(NcmContentStorage *ncmStorage, const NcmContentId *ncaId, Aes128CtrContext *aes_ctx, u64 nso_base_offset, nso_header_t *nsoHeader, u8 *outUnverifiedMask);
+
+// Same as loadNsoBinaryData(), using a whole NSO that has already been read into memory. All segments are decompressed and checked in parallel
+// Images loaded this way aren't cached
+bool loadNsoBinaryDataFromMemory(const u8 *nsoData, u64 nsoDataSize, nso_header_t *nsoHeader, u8 *outUnverifiedMask);
+
+// Returns the binary image loaded by the functions above. It remains valid until freeNsoBinaryData() is called
+const u8 *getNsoBinaryImage(u64 *outSize);
+
+void freeNsoBinaryData();
+
+// Frees all cached decompressed NSO images
+void freeNsoImageCache();
 
 #endif
@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "patch_overlay.h"
+
+// Returns the index of the first range that ends after 'offset'
+static u32 patchOverlayFindRange(const patch_overlay_t *overlay, u64 offset)
+{
+    u32 low = 0, high = overlay->range_cnt;
+    
+    while(low < high)
+    {
+        u32 mid = (low + ((high - low) / 2));
+        
+        if ((overlay->ranges[mid].offset + overlay->ranges[mid].size) <= offset)
+        {
+            low = (mid + 1);
+        } else {
+            high = mid;
+        }
+    }
+    
+    return low;
+}
+
+void patchOverlayInit(patch_overlay_t *overlay)
+{
+    if (!overlay) return;
+    memset(overlay, 0, sizeof(patch_overlay_t));
+}
+
+void patchOverlayFree(patch_overlay_t *overlay)
+{
+    if (!overlay) return;
+    if (overlay->ranges) free(overlay->ranges);
+    memset(overlay, 0, sizeof(patch_overlay_t));
+}
+
+void patchOverlayReset(patch_overlay_t *overlay)
+{
+    if (!overlay) return;
+    
+    overlay->range_cnt = 0;
+    overlay->start_offset = overlay->end_offset = 0;
+}
+
+bool patchOverlayAddRange(patch_overlay_t *overlay, u64 offset, const void *data, u64 size)
+{
+    if (!overlay || !data || !size) return false;
+    
+    u32 idx = patchOverlayFindRange(overlay, offset);
+    
+    // The first range that ends after the new one's start offset must also start after the new one's end offset
+    if (idx < overlay->range_cnt && overlay->ranges[idx].offset < (offset + size)) return false;
+    
+    if (overlay->range_cnt == overlay->range_capacity)
+    {
+        patch_overlay_range_t *tmpRanges = realloc(overlay->ranges, (overlay->range_capacity + PATCH_OVERLAY_RANGE_STEP) * sizeof(patch_overlay_range_t));
+        if (!tmpRanges) return false;
+        
+        overlay->ranges = tmpRanges;
+        overlay->range_capacity += PATCH_OVERLAY_RANGE_STEP;
+    }
+    
+    if (idx < overlay->range_cnt) memmove(&(overlay->ranges[idx + 1]), &(overlay->ranges[idx]), (overlay->range_cnt - idx) * sizeof(patch_overlay_range_t));
+    
+    overlay->ranges[idx].offset = offset;
+    overlay->ranges[idx].size = size;
+    overlay->ranges[idx].data = (const u8*)data;
+    overlay->range_cnt++;
+    
+    overlay->start_offset = overlay->ranges[0].offset;
+    overlay->end_offset = (overlay->ranges[overlay->range_cnt - 1].offset + overlay->ranges[overlay->range_cnt - 1].size);
+    
+    return true;
+}
+
+bool patchOverlayCoversRange(const patch_overlay_t *overlay, u64 offset, u64 size)
+{
+    if (!overlay || !overlay->range_cnt || !size) return false;
+    
+    u32 idx = patchOverlayFindRange(overlay, offset);
+    
+    return (idx < overlay->range_cnt && overlay->ranges[idx].offset <= offset && (overlay->ranges[idx].offset + overlay->ranges[idx].size) >= (offset + size));
+}
+
+void patchOverlayApply(const patch_overlay_t *overlay, u64 offset, void *buf, u64 size)
+{
+    if (!overlay || !overlay->range_cnt || !buf || !size) return;
+    
+    u64 end = (offset + size);
+    if (end <= overlay->start_offset || offset >= overlay->end_offset) return;
+    
+    u32 i;
+    u8 *out = (u8*)buf;
+    
+    for(i = patchOverlayFindRange(overlay, offset); i < overlay->range_cnt && overlay->ranges[i].offset < end; i++)
+    {
+        const patch_overlay_range_t *range = &(overlay->ranges[i]);
+        
+        u64 start = (range->offset > offset ? range->offset : offset);
+        u64 rangeEnd = (range->offset + range->size);
+        u64 copyEnd = (rangeEnd < end ? rangeEnd : end);
+        
+        memcpy(out + (start - offset), range->data + (start - range->offset), copyEnd - start);
+    }
+}
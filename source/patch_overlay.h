@@ -0,0 +1,41 @@
+#pragma once
+
+#ifndef __PATCH_OVERLAY_H__
+#define __PATCH_OVERLAY_H__
+
+#include <switch.h>
+
+#define PATCH_OVERLAY_RANGE_STEP    8                       // Growth step for the range list
+
+// Modified data that replaces a byte range from a file while it's being dumped
+typedef struct {
+    u64 offset;                                     // Relative to the start of the dumped file
+    u64 size;
+    const u8 *data;                                 // Not owned by the overlay. Must stay valid until the overlay is reset or freed
+} patch_overlay_range_t;
+
+// List of modified byte ranges, kept sorted by offset. Ranges never overlap each other
+typedef struct {
+    patch_overlay_range_t *ranges;
+    u32 range_cnt;
+    u32 range_capacity;
+    u64 start_offset;                               // Lowest start offset and highest end offset from all ranges. Used to quickly skip unpatched chunks
+    u64 end_offset;
+} patch_overlay_t;
+
+void patchOverlayInit(patch_overlay_t *overlay);
+void patchOverlayFree(patch_overlay_t *overlay);
+
+// Removes all ranges without releasing the range list
+void patchOverlayReset(patch_overlay_t *overlay);
+
+// Registers a modified range. Returns false if it overlaps with a range that has already been registered, or if the range list couldn't be grown
+bool patchOverlayAddRange(patch_overlay_t *overlay, u64 offset, const void *data, u64 size);
+
+// Returns true if a single registered range fully covers the 'size' bytes located at 'offset'
+bool patchOverlayCoversRange(const patch_overlay_t *overlay, u64 offset, u64 size);
+
+// Replaces all the modified data that falls within a chunk located at 'offset' in the dumped file
+void patchOverlayApply(const patch_overlay_t *overlay, u64 offset, void *buf, u64 size);
+
+#endif
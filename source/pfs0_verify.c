@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pfs0_verify.h"
+#include "ui.h"
+
+/* Extern variables */
+
+extern int breaks;
+extern int font_height;
+
+extern exefs_ctx_t exeFsContext;
+
+// Resets the CTR for a stream offset. Offsets that aren't aligned to the AES block size advance the keystream up to the right position
+static void pfs0VerifySetCtr(pfs0_verify_ctx_t *ctx, u64 offset)
+{
+    u32 i;
+    u8 ctr[0x10];
+    u8 skip[0x10] = {0};
+    u64 ofs = (offset >> 4);
+    
+    memcpy(ctr, ctx->base_ctr, 0x10);
+    
+    for(i = 0; i < 0x8; i++)
+    {
+        ctr[0x10 - i - 1] = (u8)(ofs & 0xFF);
+        ofs >>= 8;
+    }
+    
+    aes128CtrContextResetCtr(&(ctx->aes_ctx), ctr);
+    
+    if ((offset % 0x10) > 0) aes128CtrCrypt(&(ctx->aes_ctx), skip, skip, offset % 0x10);
+}
+
+static bool pfs0VerifySetup(pfs0_verify_ctx_t *ctx, const pfs0_superblock_t *superblock, u64 sectionOffset, u64 sectionSize, bool streaming)
+{
+    u64 blockCnt;
+    
+    memset(ctx, 0, sizeof(pfs0_verify_ctx_t));
+    
+    ctx->streaming = streaming;
+    ctx->hash_table_offset = (sectionOffset + superblock->hash_table_offset);
+    ctx->hash_table_size = superblock->hash_table_size;
+    ctx->data_offset = (sectionOffset + superblock->pfs0_offset);
+    ctx->data_size = superblock->pfs0_size;
+    ctx->block_size = superblock->block_size;
+    memcpy(ctx->master_hash, superblock->master_hash, SHA256_HASH_SIZE);
+    
+    blockCnt = (ctx->block_size ? (round_up(ctx->data_size, ctx->block_size) / ctx->block_size) : 0);
+    
+    // Streamed sections must store their hash table before the PFS0 data, since every data block is checked as soon as it is received
+    if (!ctx->block_size || ctx->block_size > PFS0_VERIFY_WINDOW_SIZE || !ctx->hash_table_size || ctx->hash_table_size > PFS0_VERIFY_WINDOW_SIZE || !ctx->data_size || \
+        (superblock->hash_table_offset + ctx->hash_table_size) > sectionSize || (superblock->pfs0_offset + ctx->data_size) > sectionSize || (blockCnt * SHA256_HASH_SIZE) > ctx->hash_table_size || \
+        (streaming && (ctx->hash_table_offset + ctx->hash_table_size) > ctx->data_offset))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid hash table information in PFS0 section superblock!", __func__);
+        return false;
+    }
+    
+    if (!hashPoolInit(&(ctx->pool)))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize PFS0 verification sync objects!", __func__);
+        return false;
+    }
+    
+    ctx->initialized = true;
+    
+    ctx->window_capacity = ((PFS0_VERIFY_WINDOW_SIZE / ctx->block_size) * ctx->block_size);
+    
+    ctx->hash_table = malloc(ctx->hash_table_size);
+    ctx->window_data = malloc(ctx->window_capacity);
+    ctx->window_hashes = malloc((ctx->window_capacity / ctx->block_size) * SHA256_HASH_SIZE);
+    
+    if (!ctx->hash_table || !ctx->window_data || !ctx->window_hashes)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for PFS0 verification buffers!", __func__);
+        pfs0VerifyClose(ctx);
+        return false;
+    }
+    
+    return true;
+}
+
+static bool pfs0VerifyCheckHashTable(pfs0_verify_ctx_t *ctx)
+{
+    u8 masterHash[SHA256_HASH_SIZE];
+    
+    sha256CalculateHash(masterHash, ctx->hash_table, ctx->hash_table_size);
+    
+    if (memcmp(masterHash, ctx->master_hash, SHA256_HASH_SIZE) != 0)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: PFS0 master hash mismatch! Section data may be corrupted.", __func__);
+        return false;
+    }
+    
+    ctx->hash_table_verified = true;
+    
+    return true;
+}
+
+// Checks the first 'size' bytes from the window buffer. Only the last block from the PFS0 data may be shorter than the block size, and it is hashed as-is
+static bool pfs0VerifyCheckWindow(pfs0_verify_ctx_t *ctx, u64 windowOffset, u64 size)
+{
+    u32 i;
+    u32 blockCnt = (u32)(round_up(size, ctx->block_size) / ctx->block_size);
+    u64 firstBlock = (windowOffset / ctx->block_size);
+    u64 lastBlockSize = (size - ((u64)(blockCnt - 1) * ctx->block_size));
+    
+    hashPoolHashBlocks(&(ctx->pool), ctx->window_data, ctx->block_size, blockCnt, lastBlockSize, ctx->window_hashes);
+    
+    for(i = 0; i < blockCnt; i++)
+    {
+        if (memcmp(ctx->window_hashes + (i * SHA256_HASH_SIZE), ctx->hash_table + ((firstBlock + i) * SHA256_HASH_SIZE), SHA256_HASH_SIZE) != 0)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: hash mismatch for PFS0 data block #%lu (offset 0x%016lX)! Section data may be corrupted.", __func__, firstBlock + i, ctx->data_offset + ((firstBlock + i) * ctx->block_size));
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+static bool pfs0VerifyLoadWindow(pfs0_verify_ctx_t *ctx, u64 windowOffset)
+{
+    u64 size = (ctx->data_size - windowOffset);
+    if (size > ctx->window_capacity) size = ctx->window_capacity;
+    
+    ctx->window_size = 0;
+    
+    if (!processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), ctx->data_offset + windowOffset, ctx->window_data, size, false)) return false;
+    
+    if (!pfs0VerifyCheckWindow(ctx, windowOffset, size)) return false;
+    
+    ctx->window_offset = windowOffset;
+    ctx->window_size = size;
+    
+    return true;
+}
+
+bool pfs0VerifyInit(pfs0_verify_ctx_t *ctx)
+{
+    if (!ctx || !exeFsContext.exefs_size || !exeFsContext.section_size)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to set up PFS0 verification!", __func__);
+        return false;
+    }
+    
+    if (!pfs0VerifySetup(ctx, &(exeFsContext.superblock), exeFsContext.section_offset, exeFsContext.section_size, false)) return false;
+    
+    // The hash table is small enough to be kept in memory during the whole process
+    if (!processNcaCtrSectionBlock(&(exeFsContext.ncmStorage), &(exeFsContext.ncaId), &(exeFsContext.aes_ctx), ctx->hash_table_offset, ctx->hash_table, ctx->hash_table_size, false) || !pfs0VerifyCheckHashTable(ctx))
+    {
+        pfs0VerifyClose(ctx);
+        return false;
+    }
+    
+    return true;
+}
+
+bool pfs0VerifyStreamInit(pfs0_verify_ctx_t *ctx, const nca_fs_header_t *fsHeader, u64 sectionOffset, u64 sectionSize, const u8 *ctrKey)
+{
+    if (!ctx || !fsHeader || !sectionOffset || !sectionSize || !ctrKey)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to set up PFS0 verification!", __func__);
+        return false;
+    }
+    
+    u32 i;
+    
+    if (!pfs0VerifySetup(ctx, &(fsHeader->pfs0_superblock), sectionOffset, sectionSize, true)) return false;
+    
+    for(i = 0; i < 0x8; i++) ctx->base_ctr[i] = fsHeader->section_ctr[0x08 - i - 1];
+    
+    aes128CtrContextCreate(&(ctx->aes_ctx), ctrKey, ctx->base_ctr);
+    
+    return true;
+}
+
+void pfs0VerifyClose(pfs0_verify_ctx_t *ctx)
+{
+    if (!ctx || !ctx->initialized) return;
+    
+    hashPoolClose(&(ctx->pool));
+    
+    if (ctx->hash_table) free(ctx->hash_table);
+    if (ctx->window_data) free(ctx->window_data);
+    if (ctx->window_hashes) free(ctx->window_hashes);
+    
+    memset(ctx, 0, sizeof(pfs0_verify_ctx_t));
+}
+
+bool pfs0VerifyReadData(pfs0_verify_ctx_t *ctx, u64 offset, void *outBuf, u64 bufSize)
+{
+    if (!ctx || !ctx->initialized || ctx->streaming || !outBuf || !bufSize || offset < ctx->data_offset || (offset + bufSize) > (ctx->data_offset + ctx->data_size))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to read verified PFS0 data!", __func__);
+        return false;
+    }
+    
+    u8 *out = (u8*)outBuf;
+    u64 dataOffset = (offset - ctx->data_offset);
+    u64 chunk;
+    
+    while(bufSize > 0)
+    {
+        if (!ctx->window_size || dataOffset < ctx->window_offset || dataOffset >= (ctx->window_offset + ctx->window_size))
+        {
+            if (!pfs0VerifyLoadWindow(ctx, dataOffset - (dataOffset % ctx->block_size))) return false;
+        }
+        
+        chunk = ((ctx->window_offset + ctx->window_size) - dataOffset);
+        if (chunk > bufSize) chunk = bufSize;
+        
+        memcpy(out, ctx->window_data + (dataOffset - ctx->window_offset), chunk);
+        
+        out += chunk;
+        dataOffset += chunk;
+        bufSize -= chunk;
+    }
+    
+    return true;
+}
+
+bool pfs0VerifyStreamUpdate(pfs0_verify_ctx_t *ctx, u64 offset, const void *encData, u64 size)
+{
+    if (!ctx || !ctx->initialized || !ctx->streaming || !encData || !size || offset != ctx->stream_offset)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to verify PFS0 data chunk!", __func__);
+        return false;
+    }
+    
+    const u8 *in = (const u8*)encData;
+    u64 end = (offset + size);
+    u64 start, chunkEnd, chunk;
+    
+    ctx->stream_offset = end;
+    
+    // Hash table
+    start = (offset > ctx->hash_table_offset ? offset : ctx->hash_table_offset);
+    chunkEnd = (end < (ctx->hash_table_offset + ctx->hash_table_size) ? end : (ctx->hash_table_offset + ctx->hash_table_size));
+    
+    if (start < chunkEnd)
+    {
+        pfs0VerifySetCtr(ctx, start);
+        aes128CtrCrypt(&(ctx->aes_ctx), ctx->hash_table + (start - ctx->hash_table_offset), in + (start - offset), chunkEnd - start);
+        
+        if (chunkEnd == (ctx->hash_table_offset + ctx->hash_table_size) && !pfs0VerifyCheckHashTable(ctx)) return false;
+    }
+    
+    // PFS0 data
+    start = (offset > ctx->data_offset ? offset : ctx->data_offset);
+    chunkEnd = (end < (ctx->data_offset + ctx->data_size) ? end : (ctx->data_offset + ctx->data_size));
+    
+    if (start < chunkEnd) pfs0VerifySetCtr(ctx, start);
+    
+    while(start < chunkEnd)
+    {
+        chunk = (chunkEnd - start);
+        if (chunk > (ctx->window_capacity - ctx->window_size)) chunk = (ctx->window_capacity - ctx->window_size);
+        
+        aes128CtrCrypt(&(ctx->aes_ctx), ctx->window_data + ctx->window_size, in + (start - offset), chunk);
+        
+        ctx->window_size += chunk;
+        start += chunk;
+        
+        if (ctx->window_size == ctx->window_capacity || (ctx->window_offset + ctx->window_size) == ctx->data_size)
+        {
+            if (!pfs0VerifyCheckWindow(ctx, ctx->window_offset, ctx->window_size)) return false;
+            
+            ctx->window_offset += ctx->window_size;
+            ctx->window_size = 0;
+        }
+    }
+    
+    return true;
+}
+
+bool pfs0VerifyStreamFinish(pfs0_verify_ctx_t *ctx)
+{
+    if (!ctx || !ctx->initialized || !ctx->streaming || !ctx->hash_table_verified || ctx->window_offset != ctx->data_size)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: PFS0 section data wasn't fully verified!", __func__);
+        return false;
+    }
+    
+    return true;
+}
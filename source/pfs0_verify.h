@@ -0,0 +1,56 @@
+#pragma once
+
+#ifndef __PFS0_VERIFY_H__
+#define __PFS0_VERIFY_H__
+
+#include <switch.h>
+#include "util.h"
+#include "hash_pool.h"
+
+#define PFS0_VERIFY_WINDOW_SIZE         DUMP_BUFFER_SIZE            // Max amount of PFS0 data verified at once
+
+typedef struct {
+    bool initialized;
+    bool streaming;                                 // Data is fed through pfs0VerifyStreamUpdate() instead of being read by the context itself
+    u64 hash_table_offset;                          // Relative to NCA start
+    u64 hash_table_size;
+    u64 data_offset;                                // Relative to NCA start
+    u64 data_size;
+    u64 block_size;
+    u8 master_hash[SHA256_HASH_SIZE];
+    u8 *hash_table;                                 // Verified against the master hash before any data block is checked
+    u8 *window_data;                                // Verified PFS0 data window
+    u64 window_capacity;                            // Multiple of the block size
+    u64 window_offset;                              // Relative to the start of the PFS0 data
+    u64 window_size;
+    u8 *window_hashes;                              // Calculated hashes for each block from the current window
+    Aes128CtrContext aes_ctx;
+    u8 base_ctr[0x10];
+    u64 stream_offset;                              // Next NCA offset expected by pfs0VerifyStreamUpdate()
+    bool hash_table_verified;
+    hash_pool_ctx_t pool;
+} pfs0_verify_ctx_t;
+
+// Sets up verified reads for the currently loaded ExeFS section (exeFsContext), using the hash table information from its superblock
+// The hash table is read and checked against the master hash right away
+bool pfs0VerifyInit(pfs0_verify_ctx_t *ctx);
+
+// Sets up verification for a PFS0 section whose encrypted data is fed sequentially through pfs0VerifyStreamUpdate() (e.g. while dumping the whole NCA)
+// 'ctrKey' is the decrypted AES-CTR key from the NCA key area
+bool pfs0VerifyStreamInit(pfs0_verify_ctx_t *ctx, const nca_fs_header_t *fsHeader, u64 sectionOffset, u64 sectionSize, const u8 *ctrKey);
+
+// Stops the hashing threads and frees all buffers
+void pfs0VerifyClose(pfs0_verify_ctx_t *ctx);
+
+// Drop-in replacement for processNcaCtrSectionBlock() calls that read ExeFS data. 'offset' is relative to NCA start and must be located within the PFS0 data
+// Every block covering the requested range is hashed and checked against the hash table before any data is returned
+bool pfs0VerifyReadData(pfs0_verify_ctx_t *ctx, u64 offset, void *outBuf, u64 bufSize);
+
+// Feeds an encrypted NCA chunk located at 'offset'. Chunks must be consecutive, but they don't need to be aligned to anything
+// Chunks that don't overlap the hash table or the PFS0 data are ignored. Blocks are verified as soon as a full window (or the last block) is available
+bool pfs0VerifyStreamUpdate(pfs0_verify_ctx_t *ctx, u64 offset, const void *encData, u64 size);
+
+// Returns true if the whole hash table and all PFS0 data blocks were fed and verified
+bool pfs0VerifyStreamFinish(pfs0_verify_ctx_t *ctx);
+
+#endif
@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "romfs_filter.h"
+
+static bool romFsFilterGlobMatch(const char *pattern, const char *str, const char *strEnd)
+{
+    while(*pattern)
+    {
+        if (*pattern == '*')
+        {
+            bool crossDirs = (pattern[1] == '*');
+            pattern += (crossDirs ? 2 : 1);
+            
+            // "/**/" also matches a single slash
+            if (crossDirs && *pattern == '/' && romFsFilterGlobMatch(pattern + 1, str, strEnd)) return true;
+            
+            while(true)
+            {
+                if (romFsFilterGlobMatch(pattern, str, strEnd)) return true;
+                if (str >= strEnd || (!crossDirs && *str == '/')) return false;
+                str++;
+            }
+        }
+        
+        if (str >= strEnd) return false;
+        
+        if (*pattern == '?')
+        {
+            if (*str == '/') return false;
+        } else {
+            if (*pattern == '\\' && pattern[1]) pattern++;
+            if (*pattern != *str) return false;
+        }
+        
+        pattern++;
+        str++;
+    }
+    
+    return (str >= strEnd);
+}
+
+static bool romFsFilterMatchPattern(const char *pattern, const char *path)
+{
+    const char *ptr = path;
+    const char *end = (path + strlen(path));
+    
+    // Check every parent directory from the path, as well as the path itself
+    while(ptr != NULL)
+    {
+        ptr = strchr(ptr + 1, '/');
+        if (romFsFilterGlobMatch(pattern, path, (ptr != NULL ? ptr : end))) return true;
+    }
+    
+    return false;
+}
+
+static char *romFsFilterEscapePath(const char *path)
+{
+    size_t i, j, len = strlen(path);
+    
+    char *escaped = malloc((len * 2) + 2);
+    if (!escaped) return NULL;
+    
+    j = 0;
+    
+    if (path[0] != '/') escaped[j++] = '/';
+    
+    for(i = 0; i < len; i++)
+    {
+        if (path[i] == '*' || path[i] == '?' || path[i] == '\\') escaped[j++] = '\\';
+        escaped[j++] = path[i];
+    }
+    
+    escaped[j] = '\0';
+    
+    return escaped;
+}
+
+static int romFsFilterFindPattern(const romfs_filter_t *filter, const char *pattern, bool exclude)
+{
+    u32 i;
+    
+    for(i = 0; i < filter->entry_cnt; i++)
+    {
+        if (filter->entries[i].exclude == exclude && !strcmp(filter->entries[i].pattern, pattern)) return (int)i;
+    }
+    
+    return -1;
+}
+
+void romFsFilterInit(romfs_filter_t *filter)
+{
+    if (filter) memset(filter, 0, sizeof(romfs_filter_t));
+}
+
+void romFsFilterFree(romfs_filter_t *filter)
+{
+    if (!filter) return;
+    
+    u32 i;
+    
+    if (filter->entries)
+    {
+        for(i = 0; i < filter->entry_cnt; i++)
+        {
+            if (filter->entries[i].pattern) free(filter->entries[i].pattern);
+        }
+        
+        free(filter->entries);
+    }
+    
+    memset(filter, 0, sizeof(romfs_filter_t));
+}
+
+// Returns a dynamically allocated copy of the provided pattern in the form it's stored in the filter
+static char *romFsFilterNormalizePattern(const char *pattern)
+{
+    size_t len = strlen(pattern);
+    char *entryPattern = NULL;
+    
+    // Trailing slashes aren't needed, since matching a directory already matches everything inside it
+    while(len > 0 && pattern[len - 1] == '/') len--;
+    
+    // An empty pattern (or a single slash) matches the whole RomFS section
+    if (!len)
+    {
+        pattern = "/**";
+        len = 3;
+    }
+    
+    entryPattern = calloc(len + 2, sizeof(char));
+    if (!entryPattern) return NULL;
+    
+    if (pattern[0] != '/') entryPattern[0] = '/';
+    strncat(entryPattern, pattern, len);
+    
+    return entryPattern;
+}
+
+bool romFsFilterAddPattern(romfs_filter_t *filter, const char *pattern, bool exclude)
+{
+    if (!filter || !pattern || filter->entry_cnt >= ROMFS_FILTER_MAX_PATTERNS) return false;
+    
+    romfs_filter_entry_t *tmpEntries = NULL;
+    
+    char *entryPattern = romFsFilterNormalizePattern(pattern);
+    if (!entryPattern) return false;
+    
+    // Don't store duplicates
+    if (romFsFilterFindPattern(filter, entryPattern, exclude) >= 0)
+    {
+        free(entryPattern);
+        return true;
+    }
+    
+    tmpEntries = realloc(filter->entries, (filter->entry_cnt + 1) * sizeof(romfs_filter_entry_t));
+    if (!tmpEntries)
+    {
+        free(entryPattern);
+        return false;
+    }
+    
+    filter->entries = tmpEntries;
+    filter->entries[filter->entry_cnt].pattern = entryPattern;
+    filter->entries[filter->entry_cnt].exclude = exclude;
+    filter->entry_cnt++;
+    
+    if (!exclude) filter->include_cnt++;
+    
+    return true;
+}
+
+bool romFsFilterAddPatternsFromFilter(romfs_filter_t *dst, const romfs_filter_t *src)
+{
+    if (!dst || !src) return false;
+    
+    u32 i;
+    
+    for(i = 0; i < src->entry_cnt; i++)
+    {
+        if (!romFsFilterAddPattern(dst, src->entries[i].pattern, src->entries[i].exclude)) return false;
+    }
+    
+    return true;
+}
+
+bool romFsFilterLoadFile(romfs_filter_t *filter, const char *path, u32 *outCount)
+{
+    if (!filter || !path || !strlen(path)) return false;
+    
+    FILE *filterFile = NULL;
+    char line[NAME_BUF_LEN] = {'\0'};
+    char *ptr = NULL;
+    size_t len;
+    bool exclude, success = true;
+    u32 count = 0;
+    
+    filterFile = fopen(path, "r");
+    if (!filterFile)
+    {
+        if (outCount) *outCount = 0;
+        return (errno == ENOENT);
+    }
+    
+    while(fgets(line, MAX_ELEMENTS(line), filterFile) != NULL)
+    {
+        // Strip line endings and surrounding whitespace
+        len = strlen(line);
+        while(len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' || line[len - 1] == ' ' || line[len - 1] == '\t')) len--;
+        line[len] = '\0';
+        
+        ptr = line;
+        while(*ptr == ' ' || *ptr == '\t') ptr++;
+        
+        if (!strlen(ptr) || *ptr == '#') continue;
+        
+        exclude = (*ptr == '!' || *ptr == '-');
+        if (exclude || *ptr == '+') ptr++;
+        
+        if (!romFsFilterAddPattern(filter, ptr, exclude))
+        {
+            success = false;
+            break;
+        }
+        
+        count++;
+    }
+    
+    fclose(filterFile);
+    
+    if (outCount) *outCount = count;
+    
+    return success;
+}
+
+bool romFsFilterToggleLiteralPath(romfs_filter_t *filter, const char *path)
+{
+    if (!filter || !path || !strlen(path)) return false;
+    
+    int idx;
+    bool success = true;
+    
+    char *escaped = romFsFilterEscapePath(path), *entryPattern = NULL;
+    if (!escaped) return false;
+    
+    // Look for the pattern in the same form romFsFilterAddPattern() stores it (e.g. the root directory is stored as "/**")
+    entryPattern = romFsFilterNormalizePattern(escaped);
+    if (!entryPattern)
+    {
+        free(escaped);
+        return false;
+    }
+    
+    idx = romFsFilterFindPattern(filter, entryPattern, false);
+    if (idx >= 0)
+    {
+        free(filter->entries[idx].pattern);
+        
+        if ((u32)idx < (filter->entry_cnt - 1)) memmove(&(filter->entries[idx]), &(filter->entries[idx + 1]), (filter->entry_cnt - (u32)idx - 1) * sizeof(romfs_filter_entry_t));
+        
+        filter->entry_cnt--;
+        filter->include_cnt--;
+    } else {
+        success = romFsFilterAddPattern(filter, escaped, false);
+    }
+    
+    free(entryPattern);
+    free(escaped);
+    
+    return success;
+}
+
+bool romFsFilterHasLiteralPath(const romfs_filter_t *filter, const char *path)
+{
+    if (!filter || !filter->entry_cnt || !path || !strlen(path)) return false;
+    
+    bool found;
+    
+    char *escaped = romFsFilterEscapePath(path), *entryPattern = NULL;
+    if (!escaped) return false;
+    
+    entryPattern = romFsFilterNormalizePattern(escaped);
+    found = (entryPattern && romFsFilterFindPattern(filter, entryPattern, false) >= 0);
+    
+    if (entryPattern) free(entryPattern);
+    free(escaped);
+    
+    return found;
+}
+
+bool romFsFilterMatchPath(const romfs_filter_t *filter, const char *path)
+{
+    if (!filter || !path || !strlen(path)) return false;
+    
+    u32 i;
+    bool included = (!filter->include_cnt);
+    
+    for(i = 0; i < filter->entry_cnt; i++)
+    {
+        if (filter->entries[i].exclude || included) continue;
+        if (romFsFilterMatchPattern(filter->entries[i].pattern, path)) included = true;
+    }
+    
+    return (included && !romFsFilterIsPathExcluded(filter, path));
+}
+
+bool romFsFilterIsPathExcluded(const romfs_filter_t *filter, const char *path)
+{
+    if (!filter || !path || !strlen(path)) return false;
+    
+    u32 i;
+    
+    for(i = 0; i < filter->entry_cnt; i++)
+    {
+        if (filter->entries[i].exclude && romFsFilterMatchPattern(filter->entries[i].pattern, path)) return true;
+    }
+    
+    return false;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef __ROMFS_FILTER_H__
+#define __ROMFS_FILTER_H__
+
+#include <switch.h>
+#include "util.h"
+
+#define ROMFS_FILTER_MAX_PATTERNS       256
+#define ROMFS_FILTER_OFFSET_LIST_STEP   256                         // Growth step for the list of matched file entry offsets
+
+// Pattern syntax:
+// - '*' matches any amount of characters within a single path element.
+// - '**' matches any amount of characters, including slashes. "/**/" also matches a single slash.
+// - '?' matches a single character other than a slash.
+// - '\' escapes the next character.
+// Patterns are always matched against the full RomFS path (e.g. "/Data/Sound/bgm.bfsar"). A leading slash is added if missing.
+// A pattern that matches a directory also matches everything stored inside it.
+
+typedef struct {
+    char *pattern;
+    bool exclude;
+} romfs_filter_entry_t;
+
+typedef struct {
+    romfs_filter_entry_t *entries;
+    u32 entry_cnt;
+    u32 include_cnt;
+} romfs_filter_t;
+
+void romFsFilterInit(romfs_filter_t *filter);
+void romFsFilterFree(romfs_filter_t *filter);
+
+bool romFsFilterAddPattern(romfs_filter_t *filter, const char *pattern, bool exclude);
+
+// Copies all patterns from 'src' into 'dst'
+bool romFsFilterAddPatternsFromFilter(romfs_filter_t *dst, const romfs_filter_t *src);
+
+// Loads patterns from a text file. One pattern per line, lines starting with '#' are ignored
+// Lines starting with '!' or '-' are exclude patterns, while lines starting with '+' (or without any prefix) are include patterns
+// Returns true if the file doesn't exist, since it is optional
+bool romFsFilterLoadFile(romfs_filter_t *filter, const char *path, u32 *outCount);
+
+// Adds 'path' as an include pattern with all special characters escaped, or removes it if it has already been added. Used to mark entries from the RomFS section browser
+bool romFsFilterToggleLiteralPath(romfs_filter_t *filter, const char *path);
+bool romFsFilterHasLiteralPath(const romfs_filter_t *filter, const char *path);
+
+// Returns true if 'path' is matched by at least one include pattern (or if there are no include patterns) and by no exclude patterns
+bool romFsFilterMatchPath(const romfs_filter_t *filter, const char *path);
+
+// Returns true if 'path' is matched by an exclude pattern, in which case everything stored inside it can be skipped
+bool romFsFilterIsPathExcluded(const romfs_filter_t *filter, const char *path);
+
+#endif
@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "save.h"
 #include "util.h"
@@ -17,6 +18,10 @@ extern char strbuf[NAME_BUF_LEN];
 
 /* Statically allocated variables */
 
+// FatFs and the savefile contexts can't be used by more than one thread at a time. Errors are kept apart from the UI string buffer for the same reason
+static pthread_mutex_t saveMutex = PTHREAD_MUTEX_INITIALIZER;
+static char saveErrorStr[NAME_BUF_LEN] = {'\0'};
+
 static bool loadedCerts = false, personalizedCertAvailable = false;
 
 static const char *cert_CA00000003_path = "/certificate/CA00000003";
@@ -69,7 +74,7 @@ bool save_duplex_storage_init(duplex_storage_ctx_t *ctx, duplex_fs_layer_info_t
 {
     if (!ctx || !layer || !layer->data_a || !layer->data_b || !layer->info.block_size_power || !bitmap || !bitmap_size)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to initialize duplex storage!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to initialize duplex storage!", __func__);
         return false;
     }
     
@@ -82,7 +87,7 @@ bool save_duplex_storage_init(duplex_storage_ctx_t *ctx, duplex_fs_layer_info_t
     ctx->bitmap.bitmap = calloc(1, bitmap_size >> 3);
     if (!ctx->bitmap.bitmap)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for duplex bitmap!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for duplex bitmap!", __func__);
         return false;
     }
     
@@ -119,7 +124,7 @@ u32 save_duplex_storage_read(duplex_storage_ctx_t *ctx, void *buffer, u64 offset
 {
     if (!ctx || !ctx->block_size || !ctx->bitmap.bitmap || !buffer || !count)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to read duplex storage data!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to read duplex storage data!", __func__);
         return 0;
     }
     
@@ -148,14 +153,14 @@ remap_segment_ctx_t *save_remap_init_segments(remap_header_t *header, remap_entr
 {
     if (!header || !header->map_segment_count || !map_entries || !num_map_entries)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to initialize remap segments!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to initialize remap segments!", __func__);
         return NULL;
     }
     
     remap_segment_ctx_t *segments = calloc(header->map_segment_count, sizeof(remap_segment_ctx_t));
     if (!segments)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate initial memory for remap segments!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate initial memory for remap segments!", __func__);
         return NULL;
     }
     
@@ -171,7 +176,7 @@ remap_segment_ctx_t *save_remap_init_segments(remap_header_t *header, remap_entr
         seg->entries = calloc(1, sizeof(remap_entry_ctx_t*));
         if (!seg->entries)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for remap segment entry #%u!", __func__, entry_idx);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for remap segment entry #%u!", __func__, entry_idx);
             goto out;
         }
         
@@ -187,7 +192,7 @@ remap_segment_ctx_t *save_remap_init_segments(remap_header_t *header, remap_entr
             remap_entry_ctx_t **ptr = calloc(sizeof(remap_entry_ctx_t*), seg->entry_count + 1);
             if (!ptr)
             {
-                snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for remap segment entry #%u!", __func__, entry_idx);
+                snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for remap segment entry #%u!", __func__, entry_idx);
                 goto out;
             }
             
@@ -246,7 +251,7 @@ remap_entry_ctx_t *save_remap_get_map_entry(remap_storage_ctx_t *ctx, u64 offset
 {
     if (!ctx || !ctx->header || !ctx->segments)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to retrieve map entry!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to retrieve map entry!", __func__);
         return NULL;
     }
     
@@ -260,7 +265,7 @@ remap_entry_ctx_t *save_remap_get_map_entry(remap_storage_ctx_t *ctx, u64 offset
         }
     }
     
-    snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: unable to find map entry for offset 0x%lX!", __func__, offset);
+    snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: unable to find map entry for offset 0x%lX!", __func__, offset);
     return NULL;
 }
 
@@ -268,7 +273,7 @@ u32 save_remap_read(remap_storage_ctx_t *ctx, void *buffer, u64 offset, size_t c
 {
     if (!ctx || (ctx->type == STORAGE_BYTES && !ctx->file) || (ctx->type == STORAGE_DUPLEX && !ctx->duplex) || (ctx->type != STORAGE_BYTES && ctx->type != STORAGE_DUPLEX) || !buffer || !count)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to read remap data!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to read remap data!", __func__);
         return 0;
     }
     
@@ -278,7 +283,7 @@ u32 save_remap_read(remap_storage_ctx_t *ctx, void *buffer, u64 offset, size_t c
     if (!entry)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to retrieve map entry!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return 0;
     }
     
@@ -300,14 +305,14 @@ u32 save_remap_read(remap_storage_ctx_t *ctx, void *buffer, u64 offset, size_t c
                 fr = f_lseek(ctx->file, ctx->base_storage_offset + entry->physical_offset + entry_pos);
                 if (fr || f_tell(ctx->file) != (ctx->base_storage_offset + entry->physical_offset + entry_pos))
                 {
-                    snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to seek to offset 0x%lX in savefile! (%u)", __func__, ctx->base_storage_offset + entry->physical_offset + entry_pos, fr);
+                    snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to seek to offset 0x%lX in savefile! (%u)", __func__, ctx->base_storage_offset + entry->physical_offset + entry_pos, fr);
                     return out_pos;
                 }
                 
                 fr = f_read(ctx->file, (u8*)buffer + out_pos, bytes_to_read, &br);
                 if (fr || br != bytes_to_read)
                 {
-                    snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to read %u bytes chunk from offset 0x%lX in savefile! (%u)", __func__, bytes_to_read, ctx->base_storage_offset + entry->physical_offset + entry_pos, fr);
+                    snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to read %u bytes chunk from offset 0x%lX in savefile! (%u)", __func__, bytes_to_read, ctx->base_storage_offset + entry->physical_offset + entry_pos, fr);
                     return (out_pos + br);
                 }
                 
@@ -317,7 +322,7 @@ u32 save_remap_read(remap_storage_ctx_t *ctx, void *buffer, u64 offset, size_t c
                 if (br != bytes_to_read)
                 {
                     snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read remap data from duplex storage!", __func__);
-                    strcat(strbuf, tmp);
+                    strcat(saveErrorStr, tmp);
                     return (out_pos + br);
                 }
                 break;
@@ -339,7 +344,7 @@ u32 save_journal_storage_read(journal_storage_ctx_t *ctx, remap_storage_ctx_t *r
 {
     if (!ctx || !ctx->block_size || !remap || !buffer || !count)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to read journal storage data!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to read journal storage data!", __func__);
         return 0;
     }
     
@@ -361,7 +366,7 @@ u32 save_journal_storage_read(journal_storage_ctx_t *ctx, remap_storage_ctx_t *r
         if (br != bytes_to_read)
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: invalid parameters to read journal storage data!", __func__);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             return (out_pos + br);
         }
         
@@ -377,7 +382,7 @@ bool save_ivfc_storage_init(hierarchical_integrity_verification_storage_ctx_t *c
 {
     if (!ctx || !ctx->levels || !ivfc || !ivfc->num_levels)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to initialize IVFC storage!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to initialize IVFC storage!", __func__);
         return false;
     }
     
@@ -434,7 +439,7 @@ bool save_ivfc_storage_init(hierarchical_integrity_verification_storage_ctx_t *c
     ctx->level_validities = calloc(sizeof(validity_t*), (ivfc->num_levels - 1));
     if (!ctx->level_validities)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for level validities!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for level validities!", __func__);
         goto out;
     }
     
@@ -451,7 +456,7 @@ bool save_ivfc_storage_init(hierarchical_integrity_verification_storage_ctx_t *c
         level_data->block_validities = calloc(sizeof(validity_t), level_data->sector_count);
         if (!level_data->block_validities)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for block validities in IVFC level #%u!", __func__, i);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for block validities in IVFC level #%u!", __func__, i);
             goto out;
         }
         
@@ -492,7 +497,7 @@ size_t save_ivfc_level_fread(ivfc_level_save_ctx_t *ctx, void *buffer, u64 offse
 {
     if (!ctx || (ctx->type == STORAGE_BYTES && !ctx->save_ctx->file) || (ctx->type != STORAGE_BYTES && ctx->type != STORAGE_REMAP && ctx->type != STORAGE_JOURNAL) || !buffer || !count)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to read IVFC level data!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to read IVFC level data!", __func__);
         return 0;
     }
     
@@ -507,14 +512,14 @@ size_t save_ivfc_level_fread(ivfc_level_save_ctx_t *ctx, void *buffer, u64 offse
             fr = f_lseek(ctx->save_ctx->file, ctx->hash_offset + offset);
             if (fr || f_tell(ctx->save_ctx->file) != (ctx->hash_offset + offset))
             {
-                snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to seek to offset 0x%lX in savefile! (%u)", __func__, ctx->hash_offset + offset, fr);
+                snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to seek to offset 0x%lX in savefile! (%u)", __func__, ctx->hash_offset + offset, fr);
                 return (size_t)br;
             }
             
             fr = f_read(ctx->save_ctx->file, buffer, count, &br);
             if (fr || br != count)
             {
-                snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to read IVFC level data from offset 0x%lX in savefile! (%u)", __func__, ctx->hash_offset + offset, fr);
+                snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to read IVFC level data from offset 0x%lX in savefile! (%u)", __func__, ctx->hash_offset + offset, fr);
                 return (size_t)br;
             }
             
@@ -524,7 +529,7 @@ size_t save_ivfc_level_fread(ivfc_level_save_ctx_t *ctx, void *buffer, u64 offse
             if (br != count)
             {
                 snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read IVFC level data from remap storage!", __func__);
-                strcat(strbuf, tmp);
+                strcat(saveErrorStr, tmp);
                 return (size_t)br;
             }
             
@@ -534,7 +539,7 @@ size_t save_ivfc_level_fread(ivfc_level_save_ctx_t *ctx, void *buffer, u64 offse
             if (br != count)
             {
                 snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read IVFC level data from journal storage!", __func__);
-                strcat(strbuf, tmp);
+                strcat(saveErrorStr, tmp);
                 return (size_t)br;
             }
             
@@ -550,13 +555,13 @@ bool save_ivfc_storage_read(integrity_verification_storage_ctx_t *ctx, void *buf
 {
     if (!ctx || !ctx->sector_size || (!ctx->next_level && !ctx->hash_storage && !ctx->base_storage) || !buffer || !count)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to read IVFC storage data!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to read IVFC storage data!", __func__);
         return false;
     }
     
     if (count > ctx->sector_size)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: IVFC read exceeds sector size!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: IVFC read exceeds sector size!", __func__);
         return false;
     }
     
@@ -564,7 +569,7 @@ bool save_ivfc_storage_read(integrity_verification_storage_ctx_t *ctx, void *buf
     
     if (ctx->block_validities[block_index] == VALIDITY_INVALID && verify)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: hash error from previous check found at offset 0x%08X, count 0x%lX!", __func__, (u32)offset, count);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: hash error from previous check found at offset 0x%08X, count 0x%lX!", __func__, (u32)offset, count);
         return false;
     }
     
@@ -579,14 +584,14 @@ bool save_ivfc_storage_read(integrity_verification_storage_ctx_t *ctx, void *buf
         if (!save_ivfc_storage_read(ctx->next_level, hash_buffer, hash_pos, 0x20, verify))
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read hash from next IVFC level!", __func__);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             return false;
         }
     } else {
         if (save_ivfc_level_fread(ctx->hash_storage, hash_buffer, hash_pos, 0x20) != 0x20)
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read hash from hash storage!", __func__);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             return false;
         }
     }
@@ -601,7 +606,7 @@ bool save_ivfc_storage_read(integrity_verification_storage_ctx_t *ctx, void *buf
     if (save_ivfc_level_fread(ctx->base_storage, buffer, offset, count) != count)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read IVFC level from base storage!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return false;
     }
     
@@ -612,7 +617,7 @@ bool save_ivfc_storage_read(integrity_verification_storage_ctx_t *ctx, void *buf
     u8 *data_buffer = calloc(1, ctx->sector_size + 0x20);
     if (!data_buffer)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for data buffer!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for data buffer!", __func__);
         return false;
     }
     
@@ -628,7 +633,7 @@ bool save_ivfc_storage_read(integrity_verification_storage_ctx_t *ctx, void *buf
 
     if (ctx->block_validities[block_index] == VALIDITY_INVALID && verify)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: hash error from current check found at offset 0x%08X, count 0x%lX!", __func__, (u32)offset, count);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: hash error from current check found at offset 0x%08X, count 0x%lX!", __func__, (u32)offset, count);
         return false;
     }
     
@@ -639,7 +644,7 @@ u32 save_allocation_table_read_entry_with_length(allocation_table_ctx_t *ctx, al
 {
     if (!ctx || !ctx->base_storage || !entry)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to read entry!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to read entry!", __func__);
         return 0;
     }
     
@@ -652,7 +657,7 @@ u32 save_allocation_table_read_entry_with_length(allocation_table_ctx_t *ctx, al
     {
         if ((entries[0].prev & 0x80000000) && entries[0].prev != 0x80000000)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid range entry in allocation table!", __func__);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid range entry in allocation table!", __func__);
             return 0;
         }
     } else {
@@ -680,7 +685,7 @@ u32 save_allocation_table_get_list_length(allocation_table_ctx_t *ctx, u32 block
 {
     if (!ctx || !ctx->header->allocation_table_block_count)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to calculate FAT list length!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to calculate FAT list length!", __func__);
         return 0;
     }
     
@@ -698,7 +703,7 @@ u32 save_allocation_table_get_list_length(allocation_table_ctx_t *ctx, u32 block
         if (!entry_length)
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to retrieve FAT entry length!", __func__);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             return 0;
         }
         
@@ -707,7 +712,7 @@ u32 save_allocation_table_get_list_length(allocation_table_ctx_t *ctx, u32 block
         
         if (nodes_iterated > table_size)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: cycle detected in allocation table!", __func__);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: cycle detected in allocation table!", __func__);
             return 0;
         }
     }
@@ -719,7 +724,7 @@ bool save_allocation_table_iterator_begin(allocation_table_iterator_ctx_t *ctx,
 {
     if (!ctx || !table)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to initialize FAT interator!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to initialize FAT interator!", __func__);
         return false;
     }
     
@@ -736,7 +741,7 @@ bool save_allocation_table_iterator_begin(allocation_table_iterator_ctx_t *ctx,
     if (!ctx->current_segment_size)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to retrieve FAT entry length!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return false;
     }
     
@@ -745,7 +750,7 @@ bool save_allocation_table_iterator_begin(allocation_table_iterator_ctx_t *ctx,
     
     if (ctx->prev_block != 0xFFFFFFFF)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: attempted to start FAT iteration from invalid block 0x%08X!", __func__, initial_block);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: attempted to start FAT iteration from invalid block 0x%08X!", __func__, initial_block);
         return false;
     }
     
@@ -756,7 +761,7 @@ bool save_allocation_table_iterator_move_next(allocation_table_iterator_ctx_t *c
 {
     if (!ctx || ctx->next_block == 0xFFFFFFFF)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to move iterator to the next block.", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to move iterator to the next block.", __func__);
         return false;
     }
     
@@ -772,7 +777,7 @@ bool save_allocation_table_iterator_move_next(allocation_table_iterator_ctx_t *c
     if (!ctx->current_segment_size)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to retrieve current segment size!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return false;
     }
     
@@ -786,7 +791,7 @@ bool save_allocation_table_iterator_move_prev(allocation_table_iterator_ctx_t *c
 {
     if (!ctx || ctx->prev_block == 0xFFFFFFFF)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to move iterator to the previous block!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to move iterator to the previous block!", __func__);
         return false;
     }
     
@@ -801,7 +806,7 @@ bool save_allocation_table_iterator_move_prev(allocation_table_iterator_ctx_t *c
     if (!ctx->current_segment_size)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to retrieve current segment size!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return false;
     }
     
@@ -834,7 +839,7 @@ u32 save_allocation_table_storage_read(allocation_table_storage_ctx_t *ctx, void
 {
     if (!ctx || !ctx->fat || !ctx->block_size || !buffer || !count)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to read data from FAT storage!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to read data from FAT storage!", __func__);
         return 0;
     }
     
@@ -844,7 +849,7 @@ u32 save_allocation_table_storage_read(allocation_table_storage_ctx_t *ctx, void
     if (!save_allocation_table_iterator_begin(&iterator, ctx->fat, ctx->initial_block))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to initialize FAT interator!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return 0;
     }
     
@@ -858,7 +863,7 @@ u32 save_allocation_table_storage_read(allocation_table_storage_ctx_t *ctx, void
         if (!save_allocation_table_iterator_seek(&iterator, block_num))
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to seek to block #%u within offset 0x%lX!", __func__, block_num, offset);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             return out_pos;
         }
         
@@ -878,7 +883,7 @@ u32 save_allocation_table_storage_read(allocation_table_storage_ctx_t *ctx, void
             if (!save_ivfc_storage_read(&ctx->base_storage->integrity_storages[3], (u8*)buffer + out_pos + i, physical_offset + i, bytes_to_request, ctx->base_storage->data_level->save_ctx->tool_ctx.action & ACTION_VERIFY))
             {
                 snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read %u bytes chunk from IVFC storage at physical offset 0x%lX!", __func__, bytes_to_request, physical_offset + i);
-                strcat(strbuf, tmp);
+                strcat(saveErrorStr, tmp);
                 return (out_pos + bytes_to_read - chunk_remaining);
             }
             
@@ -897,7 +902,7 @@ u32 save_fs_list_get_capacity(save_filesystem_list_ctx_t *ctx)
 {
     if (!ctx)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to retrieve FS capacity!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to retrieve FS capacity!", __func__);
         return 0;
     }
     
@@ -908,7 +913,7 @@ u32 save_fs_list_get_capacity(save_filesystem_list_ctx_t *ctx)
         if (save_allocation_table_storage_read(&ctx->storage, &ctx->capacity, 4, 4) != 4)
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read FS capacity from FAT storage!", __func__);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             return 0;
         }
     }
@@ -920,7 +925,7 @@ u32 save_fs_list_read_entry(save_filesystem_list_ctx_t *ctx, u32 index, save_fs_
 {
     if (!ctx || !entry)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to read FS entry!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to read FS entry!", __func__);
         return 0;
     }
     
@@ -930,7 +935,7 @@ u32 save_fs_list_read_entry(save_filesystem_list_ctx_t *ctx, u32 index, save_fs_
     if (ret != SAVE_FS_LIST_ENTRY_SIZE)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read FS entry from FAT storage!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return 0;
     }
     
@@ -941,7 +946,7 @@ bool save_fs_list_get_value(save_filesystem_list_ctx_t *ctx, u32 index, save_fs_
 {
     if (!ctx || !value)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to retrieve value for index!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to retrieve value for index!", __func__);
         return false;
     }
     
@@ -951,20 +956,20 @@ bool save_fs_list_get_value(save_filesystem_list_ctx_t *ctx, u32 index, save_fs_
     if (!capacity)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to retrieve FS capacity!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return false;
     }
     
     if (index >= capacity)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: provided index exceeds FS capacity!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: provided index exceeds FS capacity!", __func__);
         return false;
     }
     
     if (!save_fs_list_read_entry(ctx, index, value))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read FS entry!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return false;
     }
     
@@ -980,7 +985,7 @@ u32 save_fs_get_index_from_key(save_filesystem_list_ctx_t *ctx, save_entry_key_t
     
     if (!ctx || !key)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to retrieve FS index from key!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to retrieve FS index from key!", __func__);
         goto out;
     }
     
@@ -988,7 +993,7 @@ u32 save_fs_get_index_from_key(save_filesystem_list_ctx_t *ctx, save_entry_key_t
     if (!capacity)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to retrieve FS capacity!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
@@ -996,7 +1001,7 @@ u32 save_fs_get_index_from_key(save_filesystem_list_ctx_t *ctx, save_entry_key_t
     if (!save_fs_list_read_entry(ctx, ctx->used_list_head_index, &entry))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read FS entry for initial index %u!", __func__, ctx->used_list_head_index);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
@@ -1007,14 +1012,14 @@ u32 save_fs_get_index_from_key(save_filesystem_list_ctx_t *ctx, save_entry_key_t
     {
         if (index > capacity)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: save entry index %d out of range!", __func__, index);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: save entry index %d out of range!", __func__, index);
             break;
         }
         
         if (!save_fs_list_read_entry(ctx, index, &entry))
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read FS entry for index %u!", __func__, index);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             break;
         }
         
@@ -1024,7 +1029,7 @@ u32 save_fs_get_index_from_key(save_filesystem_list_ctx_t *ctx, save_entry_key_t
         index = entry.next;
     }
     
-    if (!index) snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: unable to find FS index from key!", __func__);
+    if (!index) snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: unable to find FS index from key!", __func__);
     
 out:
     *prev_index = 0xFFFFFFFF;
@@ -1035,7 +1040,7 @@ bool save_hierarchical_file_table_find_path_recursive(hierarchical_save_file_tab
 {
     if (!ctx || !key || !path || !strlen(path))
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to find FS path!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to find FS path!", __func__);
         return false;
     }
     
@@ -1068,7 +1073,7 @@ bool save_hierarchical_file_table_get_file_entry_by_path(hierarchical_save_file_
 {
     if (!ctx || !path || !strlen(path) || !entry)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to retrieve file entry!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to retrieve file entry!", __func__);
         return false;
     }
     
@@ -1078,7 +1083,7 @@ bool save_hierarchical_file_table_get_file_entry_by_path(hierarchical_save_file_
     if (!save_hierarchical_file_table_find_path_recursive(ctx, &key, path))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: unable to locate file \"%s\".", __func__, path);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return false;
     }
     
@@ -1086,14 +1091,14 @@ bool save_hierarchical_file_table_get_file_entry_by_path(hierarchical_save_file_
     if (index == 0xFFFFFFFF)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: unable to get table index for file \"%s\".", __func__, path);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return false;
     }
     
     if (!save_fs_list_get_value(&ctx->file_table, index, entry))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: unable to get file entry for \"%s\" from index.", __func__, path);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return false;
     }
     
@@ -1104,7 +1109,7 @@ bool save_open_fat_storage(save_filesystem_ctx_t *ctx, allocation_table_storage_
 {
     if (!ctx || !ctx->base_storage || !storage_ctx)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to open savefile FAT storage!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to open savefile FAT storage!", __func__);
         return false;
     }
     
@@ -1123,7 +1128,7 @@ bool save_open_fat_storage(save_filesystem_ctx_t *ctx, allocation_table_storage_
         if (!fat_list_length)
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to retrieve FAT list length!", __func__);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             return false;
         }
         
@@ -1137,7 +1142,7 @@ bool save_filesystem_init(save_filesystem_ctx_t *ctx, void *fat, save_fs_header_
 {
     if (!ctx || !fat || !save_fs_header || !fat_header)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to initialize savefile FS!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to initialize savefile FS!", __func__);
         return false;
     }
     
@@ -1151,14 +1156,14 @@ bool save_filesystem_init(save_filesystem_ctx_t *ctx, void *fat, save_fs_header_
     if (!save_open_fat_storage(ctx, &ctx->file_table.directory_table.storage, fat_header->directory_table_block))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to open FAT directory storage!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return false;
     }
     
     if (!save_open_fat_storage(ctx, &ctx->file_table.file_table.storage, fat_header->file_table_block))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to open FAT file storage!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         return false;
     }
     
@@ -1174,7 +1179,7 @@ validity_t save_ivfc_validate(hierarchical_integrity_verification_storage_ctx_t
 {
     if (!ctx || !ivfc || !ivfc->num_levels)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to verify savefile FS!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to verify savefile FS!", __func__);
         return VALIDITY_INVALID;
     }
     
@@ -1192,7 +1197,7 @@ validity_t save_ivfc_validate(hierarchical_integrity_verification_storage_ctx_t
         u8 *buffer = calloc(1, block_size);
         if (!buffer)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for input buffer!", __func__);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for input buffer!", __func__);
             result = VALIDITY_INVALID;
             break;
         }
@@ -1205,7 +1210,7 @@ validity_t save_ivfc_validate(hierarchical_integrity_verification_storage_ctx_t
                 if (!save_ivfc_storage_read(storage, buffer, block_size * j, to_read, 1))
                 {
                     snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read IVFC storage data!", __func__);
-                    strcat(strbuf, tmp);
+                    strcat(saveErrorStr, tmp);
                     result = VALIDITY_INVALID;
                     break;
                 }
@@ -1230,7 +1235,7 @@ bool save_ivfc_set_level_validities(hierarchical_integrity_verification_storage_
 {
     if (!ctx || !ivfc || !ivfc->num_levels)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to set IVFC level validities!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to set IVFC level validities!", __func__);
         return false;
     }
     
@@ -1256,7 +1261,7 @@ bool save_ivfc_set_level_validities(hierarchical_integrity_verification_storage_
         if (success && level_validity == VALIDITY_INVALID) success = false;
     }
     
-    if (!success) snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid IVFC level!", __func__);
+    if (!success) snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid IVFC level!", __func__);
     
     return success;
 }
@@ -1265,7 +1270,7 @@ validity_t save_filesystem_verify(save_ctx_t *ctx)
 {
     if (!ctx)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to verify savefile FS!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to verify savefile FS!", __func__);
         return VALIDITY_INVALID;
     }
     
@@ -1274,14 +1279,14 @@ validity_t save_filesystem_verify(save_ctx_t *ctx)
     validity_t journal_validity = save_ivfc_validate(&ctx->core_data_ivfc_storage, &ctx->header.data_ivfc_header);
     if (journal_validity == VALIDITY_INVALID)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid core IVFC storage!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid core IVFC storage!", __func__);
         return journal_validity;
     }
     
     if (!save_ivfc_set_level_validities(&ctx->core_data_ivfc_storage, &ctx->header.data_ivfc_header))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: invalid IVFC level in core IVFC storage!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         journal_validity = VALIDITY_INVALID;
         return journal_validity;
     }
@@ -1291,14 +1296,14 @@ validity_t save_filesystem_verify(save_ctx_t *ctx)
     validity_t fat_validity = save_ivfc_validate(&ctx->fat_ivfc_storage, &ctx->header.fat_ivfc_header);
     if (fat_validity == VALIDITY_INVALID)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid FAT IVFC storage!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid FAT IVFC storage!", __func__);
         return fat_validity;
     }
     
     if (!save_ivfc_set_level_validities(&ctx->fat_ivfc_storage, &ctx->header.fat_ivfc_header))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: invalid IVFC level in FAT IVFC storage!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         fat_validity = VALIDITY_INVALID;
         return fat_validity;
     }
@@ -1311,11 +1316,11 @@ validity_t save_filesystem_verify(save_ctx_t *ctx)
 
 bool save_process(save_ctx_t *ctx)
 {
-    strbuf[0] = '\0';
+    saveErrorStr[0] = '\0';
     
     if (!ctx || !ctx->file)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to process savefile!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to process savefile!", __func__);
         return false;
     }
     
@@ -1331,7 +1336,7 @@ bool save_process(save_ctx_t *ctx)
     fr = f_read(ctx->file, &ctx->header, sizeof(ctx->header), &br);
     if (fr || br != sizeof(ctx->header))
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to read savefile header A! (%u)", __func__, fr);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to read savefile header A! (%u)", __func__, fr);
         return success;
     }
     
@@ -1341,20 +1346,20 @@ bool save_process(save_ctx_t *ctx)
         fr = f_lseek(ctx->file, 0x4000);
         if (fr || f_tell(ctx->file) != 0x4000)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to seek to offset 0x4000 in savefile! (%u)", __func__, fr);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to seek to offset 0x4000 in savefile! (%u)", __func__, fr);
             return success;
         }
         
         fr = f_read(ctx->file, &ctx->header, sizeof(ctx->header), &br);
         if (fr || br != sizeof(ctx->header))
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to read savefile header B! (%u)", __func__, fr);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to read savefile header B! (%u)", __func__, fr);
             return success;
         }
         
         if (!save_process_header(ctx) || ctx->header_hash_validity == VALIDITY_INVALID)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: savefile header is invalid!", __func__);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: savefile header is invalid!", __func__);
             return success;
         }
     }
@@ -1374,14 +1379,14 @@ bool save_process(save_ctx_t *ctx)
     ctx->data_remap_storage.map_entries = calloc(sizeof(remap_entry_ctx_t), ctx->data_remap_storage.header->map_entry_count);
     if (!ctx->data_remap_storage.map_entries)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for data remap storage entries!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for data remap storage entries!", __func__);
         return success;
     }
     
     fr = f_lseek(ctx->file, ctx->header.layout.file_map_entry_offset);
     if (fr || f_tell(ctx->file) != ctx->header.layout.file_map_entry_offset)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to seek to file map entry offset 0x%lX in savefile! (%u)", __func__, ctx->header.layout.file_map_entry_offset, fr);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to seek to file map entry offset 0x%lX in savefile! (%u)", __func__, ctx->header.layout.file_map_entry_offset, fr);
         return success;
     }
     
@@ -1390,7 +1395,7 @@ bool save_process(save_ctx_t *ctx)
         fr = f_read(ctx->file, &ctx->data_remap_storage.map_entries[i], 0x20, &br);
         if (fr || br != 0x20)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to read data remap storage entry #%u! (%u)", __func__, i, fr);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to read data remap storage entry #%u! (%u)", __func__, i, fr);
             goto out;
         }
         
@@ -1403,7 +1408,7 @@ bool save_process(save_ctx_t *ctx)
     if (!ctx->data_remap_storage.segments)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to retrieve data remap storage segments!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
@@ -1415,28 +1420,28 @@ bool save_process(save_ctx_t *ctx)
     ctx->duplex_layers[1].data_a = calloc(1, ctx->header.layout.duplex_l1_size);
     if (!ctx->duplex_layers[1].data_a)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for data_a block in duplex layer #1!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for data_a block in duplex layer #1!", __func__);
         goto out;
     }
     
     if (save_remap_read(&ctx->data_remap_storage, ctx->duplex_layers[1].data_a, ctx->header.layout.duplex_l1_offset_a, ctx->header.layout.duplex_l1_size) != ctx->header.layout.duplex_l1_size)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read data_a block from duplex layer #1 in data remap storage!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
     ctx->duplex_layers[1].data_b = calloc(1, ctx->header.layout.duplex_l1_size);
     if (!ctx->duplex_layers[1].data_b)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for data_b block in duplex layer #1!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for data_b block in duplex layer #1!", __func__);
         goto out;
     }
     
     if (save_remap_read(&ctx->data_remap_storage, ctx->duplex_layers[1].data_b, ctx->header.layout.duplex_l1_offset_b, ctx->header.layout.duplex_l1_size) != ctx->header.layout.duplex_l1_size)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read data_b block from duplex layer #1 in data remap storage!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
@@ -1445,28 +1450,28 @@ bool save_process(save_ctx_t *ctx)
     ctx->duplex_layers[2].data_a = calloc(1, ctx->header.layout.duplex_data_size);
     if (!ctx->duplex_layers[2].data_a)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for data_a block in duplex layer #2!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for data_a block in duplex layer #2!", __func__);
         goto out;
     }
     
     if (save_remap_read(&ctx->data_remap_storage, ctx->duplex_layers[2].data_a, ctx->header.layout.duplex_data_offset_a, ctx->header.layout.duplex_data_size) != ctx->header.layout.duplex_data_size)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read data_a block from duplex layer #2 in data remap storage!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
     ctx->duplex_layers[2].data_b = calloc(1, ctx->header.layout.duplex_data_size);
     if (!ctx->duplex_layers[2].data_b)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for data_b block in duplex layer #2!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for data_b block in duplex layer #2!", __func__);
         goto out;
     }
     
     if (save_remap_read(&ctx->data_remap_storage, ctx->duplex_layers[2].data_b, ctx->header.layout.duplex_data_offset_b, ctx->header.layout.duplex_data_size) != ctx->header.layout.duplex_data_size)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read data_b block from duplex layer #2 in data remap storage!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
@@ -1478,7 +1483,7 @@ bool save_process(save_ctx_t *ctx)
     if (!save_duplex_storage_init(&ctx->duplex_storage.layers[0], &ctx->duplex_layers[1], bitmap, ctx->header.layout.duplex_master_size))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to initialize duplex storage layer #0!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
@@ -1487,13 +1492,13 @@ bool save_process(save_ctx_t *ctx)
     bitmap = calloc(1, ctx->duplex_storage.layers[0]._length);
     if (!bitmap)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for duplex storage layer #0 bitmap!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for duplex storage layer #0 bitmap!", __func__);
         goto out;
     }
     
     if (save_duplex_storage_read(&ctx->duplex_storage.layers[0], bitmap, 0, ctx->duplex_storage.layers[0]._length) != ctx->duplex_storage.layers[0]._length)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to read duplex storage layer #0 bitmap!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to read duplex storage layer #0 bitmap!", __func__);
         free(bitmap);
         goto out;
     }
@@ -1501,7 +1506,7 @@ bool save_process(save_ctx_t *ctx)
     if (!save_duplex_storage_init(&ctx->duplex_storage.layers[1], &ctx->duplex_layers[2], bitmap, ctx->duplex_storage.layers[0]._length))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to initialize duplex storage layer #1!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
@@ -1518,14 +1523,14 @@ bool save_process(save_ctx_t *ctx)
     ctx->meta_remap_storage.map_entries = calloc(sizeof(remap_entry_ctx_t), ctx->meta_remap_storage.header->map_entry_count);
     if (!ctx->meta_remap_storage.map_entries)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for meta remap storage entries!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for meta remap storage entries!", __func__);
         goto out;
     }
     
     fr = f_lseek(ctx->file, ctx->header.layout.meta_map_entry_offset);
     if (fr || f_tell(ctx->file) != ctx->header.layout.meta_map_entry_offset)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to seek to meta map entry offset 0x%lX in savefile! (%u)", __func__, ctx->header.layout.meta_map_entry_offset, fr);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to seek to meta map entry offset 0x%lX in savefile! (%u)", __func__, ctx->header.layout.meta_map_entry_offset, fr);
         goto out;
     }
     
@@ -1534,7 +1539,7 @@ bool save_process(save_ctx_t *ctx)
         fr = f_read(ctx->file, &ctx->meta_remap_storage.map_entries[i], 0x20, &br);
         if (fr || br != 0x20)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to read meta remap storage entry #%u! (%u)", __func__, i, fr);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to read meta remap storage entry #%u! (%u)", __func__, i, fr);
             goto out;
         }
         
@@ -1546,7 +1551,7 @@ bool save_process(save_ctx_t *ctx)
     if (!ctx->meta_remap_storage.segments)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to retrieve meta remap storage segments!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
@@ -1554,14 +1559,14 @@ bool save_process(save_ctx_t *ctx)
     ctx->journal_map_info.map_storage = calloc(1, ctx->header.layout.journal_map_table_size);
     if (!ctx->journal_map_info.map_storage)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for journal map info!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for journal map info!", __func__);
         goto out;
     }
     
     if (save_remap_read(&ctx->meta_remap_storage, ctx->journal_map_info.map_storage, ctx->header.layout.journal_map_table_offset, ctx->header.layout.journal_map_table_size) != ctx->header.layout.journal_map_table_size)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read map storage from journal map info in meta remap storage!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
@@ -1576,7 +1581,7 @@ bool save_process(save_ctx_t *ctx)
     ctx->journal_storage.map.entries = calloc(sizeof(journal_map_entry_t), ctx->journal_storage.map.header->main_data_block_count);
     if (!ctx->journal_storage.map.entries)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for journal map storage entries!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for journal map storage entries!", __func__);
         goto out;
     }
     
@@ -1598,7 +1603,7 @@ bool save_process(save_ctx_t *ctx)
     if (!save_ivfc_storage_init(&ctx->core_data_ivfc_storage, ctx->header.layout.ivfc_master_hash_offset_a, &ctx->header.data_ivfc_header))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to initialize core IVFC storage!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
@@ -1608,14 +1613,14 @@ bool save_process(save_ctx_t *ctx)
         ctx->fat_storage = calloc(1, ctx->header.layout.fat_size);
         if (!ctx->fat_storage)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for FAT storage!", __func__);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for FAT storage!", __func__);
             goto out;
         }
         
         if (save_remap_read(&ctx->meta_remap_storage, ctx->fat_storage, ctx->header.layout.fat_offset, ctx->header.layout.fat_size) != ctx->header.layout.fat_size)
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read FAT storage from meta remap storage!", __func__);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             goto out;
         }
     } else {
@@ -1624,21 +1629,21 @@ bool save_process(save_ctx_t *ctx)
         if (!save_ivfc_storage_init(&ctx->fat_ivfc_storage, ctx->header.layout.fat_ivfc_master_hash_a, &ctx->header.fat_ivfc_header))
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to initialize FAT storage (IVFC)!", __func__);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             goto out;
         }
         
         ctx->fat_storage = calloc(1, ctx->fat_ivfc_storage._length);
         if (!ctx->fat_storage)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for FAT storage (IVFC)!", __func__);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for FAT storage (IVFC)!", __func__);
             goto out;
         }
         
         if (save_remap_read(&ctx->meta_remap_storage, ctx->fat_storage, ctx->header.fat_ivfc_header.level_headers[ctx->header.fat_ivfc_header.num_levels - 2].logical_offset, ctx->fat_ivfc_storage._length) != ctx->fat_ivfc_storage._length)
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to read FAT storage from meta remap storage (IVFC)!", __func__);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             goto out;
         }
     }
@@ -1648,7 +1653,7 @@ bool save_process(save_ctx_t *ctx)
         if (save_filesystem_verify(ctx) == VALIDITY_INVALID)
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: savefile FS verification failed!", __func__);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             goto out;
         }
     }
@@ -1658,7 +1663,7 @@ bool save_process(save_ctx_t *ctx)
     if (!save_filesystem_init(&ctx->save_filesystem_core, ctx->fat_storage, &ctx->header.save_header, &ctx->header.fat_header))
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to initialize savefile FS!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
@@ -1674,7 +1679,7 @@ bool save_process_header(save_ctx_t *ctx)
 {
     if (!ctx)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to process savefile header!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to process savefile header!", __func__);
         return false;
     }
     
@@ -1683,7 +1688,7 @@ bool save_process_header(save_ctx_t *ctx)
         ctx->header.save_header.magic != MAGIC_SAVE || ctx->header.main_remap_header.magic != MAGIC_RMAP || \
         ctx->header.meta_remap_header.magic != MAGIC_RMAP)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: save header is corrupt!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: save header is corrupt!", __func__);
         return false;
     }
     
@@ -1855,14 +1860,14 @@ bool readCertsFromSystemSave()
     certSave = calloc(1, sizeof(FIL));
     if (!certSave)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: unable to allocate memory for FatFs file descriptor!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: unable to allocate memory for FatFs file descriptor!", __func__);
         goto out;
     }
     
     fr = f_open(certSave, BIS_CERT_SAVE_NAME, FA_READ | FA_OPEN_EXISTING);
     if (fr != FR_OK)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to open \"%s\" savefile from BIS System partition! (%u)", __func__, BIS_CERT_SAVE_NAME, fr);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to open \"%s\" savefile from BIS System partition! (%u)", __func__, BIS_CERT_SAVE_NAME, fr);
         goto out;
     }
     
@@ -1871,7 +1876,7 @@ bool readCertsFromSystemSave()
     save_ctx = calloc(1, sizeof(save_ctx_t));
     if (!save_ctx)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to allocate memory for savefile context!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to allocate memory for savefile context!", __func__);
         goto out;
     }
     
@@ -1882,7 +1887,7 @@ bool readCertsFromSystemSave()
     if (!initSaveCtx)
     {
         snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to process system savefile!", __func__);
-        strcat(strbuf, tmp);
+        strcat(saveErrorStr, tmp);
         goto out;
     }
     
@@ -1923,7 +1928,7 @@ bool readCertsFromSystemSave()
                         break;
                 }
                 
-                strbuf[0] = '\0';
+                saveErrorStr[0] = '\0';
                 
                 getFileEntry = save_hierarchical_file_table_get_file_entry_by_path(&save_ctx->save_filesystem_core.file_table, cert_path, &entry);
                 if (getFileEntry) break;
@@ -1936,7 +1941,7 @@ bool readCertsFromSystemSave()
             if (i < 2)
             {
                 snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to get file entry for \"%s\" in system savefile!", __func__, cert_path);
-                strcat(strbuf, tmp);
+                strcat(saveErrorStr, tmp);
             } else {
                 success = loadedCerts = true;
             }
@@ -1947,21 +1952,21 @@ bool readCertsFromSystemSave()
         if (!save_open_fat_storage(&save_ctx->save_filesystem_core, &fat_storage, entry.value.save_file_info.start_block))
         {
             snprintf(tmp, MAX_CHARACTERS(tmp), "\n%s: failed to open FAT storage at block 0x%X for \"%s\" in system savefile!", __func__, entry.value.save_file_info.start_block, cert_path);
-            strcat(strbuf, tmp);
+            strcat(saveErrorStr, tmp);
             goto out;
         }
         
         internalCertSize = entry.value.save_file_info.length;
         if (internalCertSize != cert_expected_size)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid size for \"%s\" in system savefile! (%lu != %lu)", __func__, cert_path, internalCertSize, cert_expected_size);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid size for \"%s\" in system savefile! (%lu != %lu)", __func__, cert_path, internalCertSize, cert_expected_size);
             goto out;
         }
         
         br = save_allocation_table_storage_read(&fat_storage, cert_data_ptr, 0, cert_expected_size);
         if (br != (UINT)cert_expected_size)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: failed to read \"%s\" from system savefile!", __func__, cert_path);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: failed to read \"%s\" from system savefile!", __func__, cert_path);
             goto out;
         }
         
@@ -1969,7 +1974,7 @@ bool readCertsFromSystemSave()
         
         if (memcmp(tmp_hash, cert_expected_hash, 0x20) != 0)
         {
-            snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid hash for \"%s\" in system savefile!", __func__, cert_path);
+            snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid hash for \"%s\" in system savefile!", __func__, cert_path);
             goto out;
         }
     }
@@ -1992,11 +1997,11 @@ out:
     return success;
 }
 
-bool retrieveCertData(u8 *out_cert, bool personalized)
+static bool retrieveCertDataUnlocked(u8 *out_cert, bool personalized)
 {
     if (!out_cert)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid parameters to retrieve %s ticket certificate chain.", __func__, (!personalized ? "common" : "personalized"));
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: invalid parameters to retrieve %s ticket certificate chain.", __func__, (!personalized ? "common" : "personalized"));
         return false;
     }
     
@@ -2004,7 +2009,7 @@ bool retrieveCertData(u8 *out_cert, bool personalized)
     
     if (personalized && !personalizedCertAvailable)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: personalized ticket RSA certificate requested but unavailable in ES system savefile!", __func__);
+        snprintf(saveErrorStr, MAX_CHARACTERS(saveErrorStr), "%s: personalized ticket RSA certificate requested but unavailable in ES system savefile!", __func__);
         return false;
     }
     
@@ -2013,3 +2018,30 @@ bool retrieveCertData(u8 *out_cert, bool personalized)
     
     return true;
 }
+
+bool retrieveCertData(u8 *out_cert, bool personalized)
+{
+    saveLock();
+    
+    bool success = retrieveCertDataUnlocked(out_cert, personalized);
+    if (!success) snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s", saveErrorStr);
+    
+    saveUnlock();
+    
+    return success;
+}
+
+void saveLock()
+{
+    pthread_mutex_lock(&saveMutex);
+}
+
+void saveUnlock()
+{
+    pthread_mutex_unlock(&saveMutex);
+}
+
+const char *saveGetErrorStr()
+{
+    return saveErrorStr;
+}
@@ -484,6 +484,14 @@ u32 save_fs_get_index_from_key(save_filesystem_list_ctx_t *ctx, save_entry_key_t
 bool save_hierarchical_file_table_find_path_recursive(hierarchical_save_file_table_ctx_t *ctx, save_entry_key_t *key, const char *path);
 bool save_hierarchical_file_table_get_file_entry_by_path(hierarchical_save_file_table_ctx_t *ctx, const char *path, save_fs_list_entry_t *entry);
 
+// Thread-safe. Errors are copied to the UI string buffer
 bool retrieveCertData(u8 *out_cert, bool personalized);
 
+// Must be held around any other savefile access (e.g. ticket lookups), since it goes through FatFs
+void saveLock();
+void saveUnlock();
+
+// Error from the last savefile function that failed. Only valid while the lock is held
+const char *saveGetErrorStr();
+
 #endif
@@ -0,0 +1,647 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <malloc.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "split_writer.h"
+#include "hash_pool.h"
+#include "ui.h"
+
+/* Extern variables */
+
+extern int breaks;
+extern int font_height;
+
+// Errors are written to the buffer provided to splitWriterOpenEx() if there's one, so writers can be used by background threads
+static void splitWriterError(split_writer_ctx_t *writer, const char *fmt, ...)
+{
+    char msg[NAME_BUF_LEN * 2] = {'\0'};
+    
+    va_list va;
+    va_start(va, fmt);
+    vsnprintf(msg, MAX_CHARACTERS(msg), fmt, va);
+    va_end(va);
+    
+    if (writer && writer->error_str)
+    {
+        snprintf(writer->error_str, writer->error_str_size, "%s", msg);
+        return;
+    }
+    
+    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s", msg);
+}
+
+static void splitWriterGetPartPath(split_writer_ctx_t *writer, u32 index, char *outPath, size_t outPathSize)
+{
+    if (!writer->part_size)
+    {
+        snprintf(outPath, outPathSize, "%s", writer->base_path);
+        return;
+    }
+    
+    switch(writer->naming)
+    {
+        case SPLIT_WRITER_NAMING_DIRECTORY:
+            snprintf(outPath, outPathSize, "%s/%02u", writer->base_path, index);
+            break;
+        case SPLIT_WRITER_NAMING_DOT_INDEX:
+            snprintf(outPath, outPathSize, "%s.%02u", writer->base_path, index);
+            break;
+        case SPLIT_WRITER_NAMING_XCI:
+            snprintf(outPath, outPathSize, "%s.xc%u", writer->base_path, index);
+            break;
+        default:
+            break;
+    }
+}
+
+static u64 splitWriterGetPartAllocSize(split_writer_ctx_t *writer, u32 index)
+{
+    if (!writer->total_size) return 0;
+    
+    if (!writer->part_size) return writer->total_size;
+    
+    u64 partStart = ((u64)(index - writer->first_part) * writer->part_size);
+    if (partStart >= writer->total_size) return 0;
+    
+    return ((writer->total_size - partStart) < writer->part_size ? (writer->total_size - partStart) : writer->part_size);
+}
+
+static bool splitWriterPreallocPart(split_writer_ctx_t *writer, u64 size)
+{
+    if (!size) return true;
+    
+    // Reserve the whole cluster chain at once instead of growing it with every flush
+    if (ftruncate(fileno(writer->outFile), (off_t)size) != 0)
+    {
+        if (errno == ENOSPC)
+        {
+            splitWriterError(writer, "%s: not enough free space to allocate %lu bytes for part #%02u!", __func__, size, writer->part_index);
+            return false;
+        }
+        
+        // The filesystem can't preallocate files. Don't try again with the rest of the parts
+        writer->total_size = 0;
+        return true;
+    }
+    
+    writer->part_alloc_size = size;
+    
+    return true;
+}
+
+// Drops the preallocated space that hasn't been written to (e.g. a sequential dump session that stopped early)
+static void splitWriterTrimPart(split_writer_ctx_t *writer)
+{
+    if (!writer->outFile || !writer->part_alloc_size) return;
+    
+    long pos;
+    
+    if (fflush(writer->outFile) == 0 && (pos = ftell(writer->outFile)) >= 0 && (u64)pos < writer->part_alloc_size) ftruncate(fileno(writer->outFile), (off_t)pos);
+    
+    writer->part_alloc_size = 0;
+}
+
+// Stores the digest from the block currently being written
+static bool splitWriterAddBlock(split_writer_ctx_t *writer)
+{
+    if (!writer->block_fill) return true;
+    
+    if (writer->block_cnt == writer->block_capacity)
+    {
+        split_writer_block_t *tmpBlocks = realloc(writer->blocks, (writer->block_capacity + SPLIT_WRITER_VERIFY_BLOCK_STEP) * sizeof(split_writer_block_t));
+        if (!tmpBlocks)
+        {
+            splitWriterError(writer, "%s: failed to reallocate block digest list!", __func__);
+            return false;
+        }
+        
+        writer->blocks = tmpBlocks;
+        writer->block_capacity += SPLIT_WRITER_VERIFY_BLOCK_STEP;
+    }
+    
+    split_writer_block_t *block = &(writer->blocks[writer->block_cnt]);
+    
+    block->part_index = writer->part_index;
+    block->offset = (writer->part_data_offset - writer->block_fill);
+    block->size = writer->block_fill;
+    sha256ContextGetHash(&(writer->block_ctx), block->hash);
+    
+    writer->block_cnt++;
+    writer->block_fill = 0;
+    
+    return true;
+}
+
+static bool splitWriterHashData(split_writer_ctx_t *writer, const u8 *data, u64 size)
+{
+    u64 chunk;
+    
+    while(size > 0)
+    {
+        if (!writer->block_fill) sha256ContextCreate(&(writer->block_ctx));
+        
+        chunk = (size < (SPLIT_WRITER_VERIFY_BLOCK_SIZE - writer->block_fill) ? size : (SPLIT_WRITER_VERIFY_BLOCK_SIZE - writer->block_fill));
+        
+        sha256ContextUpdate(&(writer->block_ctx), data, chunk);
+        
+        data += chunk;
+        size -= chunk;
+        writer->block_fill += chunk;
+        writer->part_data_offset += chunk;
+        
+        if (writer->block_fill == SPLIT_WRITER_VERIFY_BLOCK_SIZE && !splitWriterAddBlock(writer)) return false;
+    }
+    
+    return true;
+}
+
+// Recalculates the digests from all blocks touched by a rewrite, before the new data is written
+// Each block is checked against its current digest first, so data that got corrupted in the meantime doesn't end up being trusted
+static bool splitWriterUpdateBlocks(split_writer_ctx_t *writer, u32 index, u64 partOffset, const u8 *data, u64 size)
+{
+    u32 i;
+    u64 start, end;
+    u8 hash[SHA256_HASH_SIZE];
+    bool success = false;
+    
+    u8 *blockBuf = malloc(SPLIT_WRITER_VERIFY_BLOCK_SIZE);
+    if (!blockBuf)
+    {
+        splitWriterError(writer, "%s: failed to allocate memory for the block buffer!", __func__);
+        return false;
+    }
+    
+    for(i = 0; i < writer->block_cnt; i++)
+    {
+        split_writer_block_t *block = &(writer->blocks[i]);
+        if (block->part_index != index || (block->offset + block->size) <= partOffset || block->offset >= (partOffset + size)) continue;
+        
+        if (fseek(writer->outFile, (long)block->offset, SEEK_SET) != 0 || fread(blockBuf, 1, block->size, writer->outFile) != block->size)
+        {
+            splitWriterError(writer, "%s: failed to read %lu bytes block from offset 0x%016lX in part #%02u!", __func__, block->size, block->offset, index);
+            goto out;
+        }
+        
+        sha256CalculateHash(hash, blockBuf, block->size);
+        
+        if (memcmp(hash, block->hash, SHA256_HASH_SIZE) != 0)
+        {
+            splitWriterError(writer, "%s: data mismatch at offset 0x%016lX in part #%02u!", __func__, block->offset, index);
+            goto out;
+        }
+        
+        start = (block->offset > partOffset ? block->offset : partOffset);
+        end = ((block->offset + block->size) < (partOffset + size) ? (block->offset + block->size) : (partOffset + size));
+        
+        memcpy(blockBuf + (start - block->offset), data + (start - partOffset), end - start);
+        
+        sha256CalculateHash(block->hash, blockBuf, block->size);
+    }
+    
+    success = true;
+    
+out:
+    free(blockBuf);
+    
+    return success;
+}
+
+static bool splitWriterOpenPart(split_writer_ctx_t *writer, u32 index, const char *mode)
+{
+    splitWriterGetPartPath(writer, index, writer->path, MAX_ELEMENTS(writer->path));
+    
+    writer->outFile = fopen(writer->path, mode);
+    if (!writer->outFile)
+    {
+        splitWriterError(writer, "%s: failed to open output file for part #%02u!", __func__, index);
+        return false;
+    }
+    
+    // Use a big page-aligned stdio buffer to issue large sequential writes
+    if (writer->outBuf) setvbuf(writer->outFile, (char*)writer->outBuf, _IOFBF, SPLIT_WRITER_BUFFER_SIZE);
+    
+    writer->part_index = index;
+    writer->part_offset = 0;
+    writer->part_alloc_size = 0;
+    writer->part_update_mode = (strcmp(mode, "wb") != 0);
+    writer->part_data_offset = 0;
+    writer->block_fill = 0;
+    
+    // Parts reopened to rewrite data already have their final size
+    if (!strcmp(mode, "wb") && !splitWriterPreallocPart(writer, splitWriterGetPartAllocSize(writer, index)))
+    {
+        fclose(writer->outFile);
+        writer->outFile = NULL;
+        remove(writer->path);
+        return false;
+    }
+    
+    return true;
+}
+
+static bool splitWriterClosePart(split_writer_ctx_t *writer)
+{
+    if (!writer->outFile) return true;
+    
+    // The last block from each part is usually smaller than the rest
+    if (writer->verify && !splitWriterAddBlock(writer))
+    {
+        splitWriterTrimPart(writer);
+        fclose(writer->outFile);
+        writer->outFile = NULL;
+        return false;
+    }
+    
+    splitWriterTrimPart(writer);
+    
+    int ret = fclose(writer->outFile);
+    writer->outFile = NULL;
+    
+    if (ret != 0)
+    {
+        splitWriterError(writer, "%s: failed to flush output part #%02u!", __func__, writer->part_index);
+        return false;
+    }
+    
+    return true;
+}
+
+bool splitWriterOpenEx(split_writer_ctx_t *writer, const char *path, u64 totalSize, u64 partSize, splitWriterNaming naming, u32 firstPart, char *errorStr, size_t errorStrSize)
+{
+    if (!writer || !path || !strlen(path) || strlen(path) >= MAX_ELEMENTS(writer->base_path))
+    {
+        if (errorStr)
+        {
+            snprintf(errorStr, errorStrSize, "%s: invalid parameters to create output file!", __func__);
+        } else {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to create output file!", __func__);
+        }
+        
+        return false;
+    }
+    
+    memset(writer, 0, sizeof(split_writer_ctx_t));
+    
+    writer->error_str = errorStr;
+    writer->error_str_size = errorStrSize;
+    
+    // Small outputs (tickets, certificates, XMLs, NSO images...) barely get any benefit from a big buffer or from preallocation, and they're created often
+    bool smallFile = (totalSize && totalSize <= SPLIT_WRITER_SMALL_FILE_SIZE);
+    
+    snprintf(writer->base_path, MAX_CHARACTERS(writer->base_path), "%s", path);
+    writer->total_size = (smallFile ? 0 : totalSize);
+    writer->part_size = partSize;
+    writer->naming = naming;
+    writer->first_part = (partSize ? firstPart : 0);
+    
+    // Not fatal: stdio falls back to its default buffer
+    if (!smallFile) writer->outBuf = memalign(SPLIT_WRITER_BUFFER_ALIGNMENT, SPLIT_WRITER_BUFFER_SIZE);
+    
+    if (writer->part_size && writer->naming == SPLIT_WRITER_NAMING_DIRECTORY) mkdir(writer->base_path, 0744);
+    
+    if (!splitWriterOpenPart(writer, writer->first_part, "wb"))
+    {
+        splitWriterAbort(writer);
+        return false;
+    }
+    
+    return true;
+}
+
+bool splitWriterOpen(split_writer_ctx_t *writer, const char *path, u64 totalSize, u64 partSize, splitWriterNaming naming, u32 firstPart)
+{
+    return splitWriterOpenEx(writer, path, totalSize, partSize, naming, firstPart, NULL, 0);
+}
+
+void splitWriterEnableVerification(split_writer_ctx_t *writer)
+{
+    if (!writer || writer->offset) return;
+    
+    writer->verify = true;
+    writer->block_cnt = 0;
+    writer->block_fill = 0;
+    writer->part_data_offset = 0;
+}
+
+bool splitWriterWrite(split_writer_ctx_t *writer, const void *data, u64 size)
+{
+    if (!writer || (!writer->outFile && (!writer->part_size || writer->part_offset < writer->part_size)) || !data)
+    {
+        splitWriterError(writer, "%s: invalid parameters to write output data!", __func__);
+        return false;
+    }
+    
+    const u8 *ptr = (const u8*)data;
+    u64 chunk;
+    size_t write_res;
+    
+    while(size > 0)
+    {
+        if (writer->part_size && writer->part_offset >= writer->part_size)
+        {
+            if (!splitWriterClosePart(writer) || !splitWriterOpenPart(writer, writer->part_index + 1, "wb")) return false;
+        }
+        
+        chunk = size;
+        if (writer->part_size && chunk > (writer->part_size - writer->part_offset)) chunk = (writer->part_size - writer->part_offset);
+        
+        write_res = fwrite(ptr, 1, chunk, writer->outFile);
+        if (write_res != chunk)
+        {
+            if (writer->part_size)
+            {
+                splitWriterError(writer, "%s: failed to write %lu bytes chunk from offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, chunk, writer->offset, writer->part_index, write_res);
+            } else {
+                splitWriterError(writer, "%s: failed to write %lu bytes chunk from offset 0x%016lX! (wrote %lu bytes)", __func__, chunk, writer->offset, write_res);
+            }
+            
+            return false;
+        }
+        
+        if (writer->verify && !splitWriterHashData(writer, ptr, chunk)) return false;
+        
+        ptr += chunk;
+        size -= chunk;
+        writer->part_offset += chunk;
+        writer->offset += chunk;
+    }
+    
+    return true;
+}
+
+bool splitWriterFinishPart(split_writer_ctx_t *writer)
+{
+    if (!writer || !writer->part_size || writer->part_offset != writer->part_size)
+    {
+        splitWriterError(writer, "%s: invalid parameters to finish output part!", __func__);
+        return false;
+    }
+    
+    return splitWriterClosePart(writer);
+}
+
+bool splitWriterSkip(split_writer_ctx_t *writer, u64 size)
+{
+    if (!writer || !writer->outFile || writer->offset || (writer->part_size && size >= writer->part_size))
+    {
+        splitWriterError(writer, "%s: invalid parameters to skip output data!", __func__);
+        return false;
+    }
+    
+    // Skipped data doesn't take any space in the current part
+    if (writer->part_alloc_size)
+    {
+        writer->part_alloc_size = (writer->part_alloc_size > size ? (writer->part_alloc_size - size) : 0);
+        if (ftruncate(fileno(writer->outFile), (off_t)writer->part_alloc_size) != 0) writer->part_alloc_size = 0;
+    }
+    
+    writer->part_offset += size;
+    writer->offset += size;
+    
+    return true;
+}
+
+bool splitWriterRewrite(split_writer_ctx_t *writer, u64 offset, const void *data, u64 size)
+{
+    if (!writer || !data || !size || (offset + size) > writer->offset)
+    {
+        splitWriterError(writer, "%s: invalid parameters to rewrite output data!", __func__);
+        return false;
+    }
+    
+    u32 index = (writer->part_size ? (writer->first_part + (u32)(offset / writer->part_size)) : 0);
+    u64 partOffset = (writer->part_size ? (offset % writer->part_size) : offset);
+    
+    if (writer->part_size && (partOffset + size) > writer->part_size)
+    {
+        splitWriterError(writer, "%s: data to rewrite crosses the boundary from part #%02u!", __func__, index);
+        return false;
+    }
+    
+    // Parts being verified must be readable so their digests can be updated
+    if (!writer->outFile || index != writer->part_index || (writer->verify && !writer->part_update_mode))
+    {
+        if (!splitWriterClosePart(writer) || !splitWriterOpenPart(writer, index, "rb+")) return false;
+    }
+    
+    if (writer->verify && !splitWriterUpdateBlocks(writer, index, partOffset, (const u8*)data, size)) return false;
+    
+    if (fseek(writer->outFile, (long)partOffset, SEEK_SET) != 0 || fwrite(data, 1, size, writer->outFile) != size)
+    {
+        splitWriterError(writer, "%s: failed to write %lu bytes to offset 0x%016lX from part #%02u!", __func__, size, partOffset, index);
+        return false;
+    }
+    
+    // Go back to the end of the part
+    if (fseek(writer->outFile, 0, SEEK_END) != 0)
+    {
+        splitWriterError(writer, "%s: failed to seek to the end of part #%02u!", __func__, index);
+        return false;
+    }
+    
+    writer->part_offset = (u64)ftell(writer->outFile);
+    
+    return true;
+}
+
+bool splitWriterClose(split_writer_ctx_t *writer)
+{
+    if (!writer) return false;
+    
+    bool success = splitWriterClosePart(writer);
+    
+    splitWriterAbort(writer);
+    
+    return success;
+}
+
+void splitWriterAbort(split_writer_ctx_t *writer)
+{
+    if (!writer) return;
+    
+    if (writer->outFile)
+    {
+        splitWriterTrimPart(writer);
+        fclose(writer->outFile);
+        writer->outFile = NULL;
+    }
+    
+    if (writer->outBuf)
+    {
+        free(writer->outBuf);
+        writer->outBuf = NULL;
+    }
+}
+
+bool splitWriterVerify(split_writer_ctx_t *writer, u8 *buf, u64 bufSize)
+{
+    if (!writer || !writer->verify || writer->outFile || !buf || bufSize < SPLIT_WRITER_VERIFY_BLOCK_SIZE)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to verify output data!", __func__);
+        return false;
+    }
+    
+    if (!writer->block_cnt) return true;
+    
+    u32 i, j, k, m, part, blkCnt;
+    u32 bufBlockCnt = (u32)(bufSize / SPLIT_WRITER_VERIFY_BLOCK_SIZE);
+    u32 partCnt = 0, badPartCnt = 0;
+    u32 totalPartCnt = (writer->blocks[writer->block_cnt - 1].part_index - writer->blocks[0].part_index + 1);
+    u64 partSize, readSize, lastBlockSize;
+    FILE *partFile = NULL;
+    char partPath[NAME_BUF_LEN * 2 + 8] = {'\0'};
+    hash_pool_ctx_t pool;
+    bool partOk;
+    
+    int statusLine = breaks;
+    
+    u8 *hashes = malloc(bufBlockCnt * SHA256_HASH_SIZE);
+    if (!hashes)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the block digests!", __func__);
+        return false;
+    }
+    
+    if (!hashPoolInit(&pool))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to initialize hashing threads!", __func__);
+        free(hashes);
+        return false;
+    }
+    
+    for(i = 0; i < writer->block_cnt; i = j)
+    {
+        // Blocks from the same part are stored consecutively
+        part = writer->blocks[i].part_index;
+        for(j = i; j < writer->block_cnt && writer->blocks[j].part_index == part; j++);
+        
+        partSize = (writer->blocks[j - 1].offset + writer->blocks[j - 1].size);
+        partOk = false;
+        partCnt++;
+        
+        uiFill(0, (statusLine * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT, BG_COLOR_RGB);
+        uiDrawString(STRING_X_POS, STRING_Y_POS(statusLine), FONT_COLOR_RGB, "Verifying output part #%02u (%u / %u)...", part, partCnt, totalPartCnt);
+        uiRefreshDisplay();
+        
+        splitWriterGetPartPath(writer, part, partPath, MAX_ELEMENTS(partPath));
+        
+        partFile = fopen(partPath, "rb");
+        if (!partFile)
+        {
+            breaks++;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output part #%02u!", __func__, part);
+            badPartCnt++;
+            continue;
+        }
+        
+        // Data is read straight into the provided buffer
+        setvbuf(partFile, NULL, _IONBF, 0);
+        
+        fseek(partFile, 0, SEEK_END);
+        readSize = (u64)ftell(partFile);
+        rewind(partFile);
+        
+        if (readSize != partSize)
+        {
+            breaks++;
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: output part #%02u is %lu bytes long (expected %lu bytes)!", __func__, part, readSize, partSize);
+            goto next;
+        }
+        
+        for(k = i; k < j; k += blkCnt)
+        {
+            blkCnt = ((j - k) < bufBlockCnt ? (j - k) : bufBlockCnt);
+            lastBlockSize = writer->blocks[k + blkCnt - 1].size;
+            readSize = (((u64)(blkCnt - 1) * SPLIT_WRITER_VERIFY_BLOCK_SIZE) + lastBlockSize);
+            
+            if (fread(buf, 1, readSize, partFile) != readSize)
+            {
+                breaks++;
+                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to read %lu bytes chunk from offset 0x%016lX in output part #%02u!", __func__, readSize, writer->blocks[k].offset, part);
+                goto next;
+            }
+            
+            hashPoolHashBlocks(&pool, buf, SPLIT_WRITER_VERIFY_BLOCK_SIZE, blkCnt, lastBlockSize, hashes);
+            
+            for(m = 0; m < blkCnt; m++)
+            {
+                if (memcmp(hashes + (m * SHA256_HASH_SIZE), writer->blocks[k + m].hash, SHA256_HASH_SIZE) != 0)
+                {
+                    breaks++;
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: data mismatch in output part #%02u (%lu bytes block at offset 0x%016lX)!", __func__, part, writer->blocks[k + m].size, writer->blocks[k + m].offset);
+                    goto next;
+                }
+            }
+        }
+        
+        partOk = true;
+    
+next:
+        fclose(partFile);
+        partFile = NULL;
+        
+        if (!partOk) badPartCnt++;
+    }
+    
+    hashPoolClose(&pool);
+    free(hashes);
+    
+    uiFill(0, (statusLine * LINE_HEIGHT) + 8, FB_WIDTH, LINE_HEIGHT, BG_COLOR_RGB);
+    
+    if (!badPartCnt)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(statusLine), FONT_COLOR_SUCCESS_RGB, "Output data successfully verified (%u part(s) read back).", partCnt);
+    } else {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(statusLine), FONT_COLOR_ERROR_RGB, "Output verification failed: %u out of %u part(s) don't match the dumped data!", badPartCnt, partCnt);
+    }
+    
+    breaks++;
+    uiRefreshDisplay();
+    
+    return (badPartCnt == 0);
+}
+
+void splitWriterFreeVerification(split_writer_ctx_t *writer)
+{
+    if (!writer) return;
+    
+    if (writer->blocks) free(writer->blocks);
+    
+    writer->blocks = NULL;
+    writer->block_cnt = writer->block_capacity = 0;
+    writer->block_fill = 0;
+    writer->verify = false;
+}
+
+void splitWriterDelete(split_writer_ctx_t *writer)
+{
+    if (!writer || !strlen(writer->base_path)) return;
+    
+    u32 i;
+    char partPath[NAME_BUF_LEN * 2 + 8] = {'\0'};
+    
+    splitWriterAbort(writer);
+    
+    if (!writer->part_size)
+    {
+        remove(writer->base_path);
+        return;
+    }
+    
+    if (writer->naming == SPLIT_WRITER_NAMING_DIRECTORY)
+    {
+        fsdevDeleteDirectoryRecursively(writer->base_path);
+        return;
+    }
+    
+    for(i = writer->first_part; i <= writer->part_index; i++)
+    {
+        splitWriterGetPartPath(writer, i, partPath, MAX_ELEMENTS(partPath));
+        remove(partPath);
+    }
+}
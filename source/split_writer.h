@@ -0,0 +1,103 @@
+#pragma once
+
+#ifndef __SPLIT_WRITER_H__
+#define __SPLIT_WRITER_H__
+
+#include <switch.h>
+#include <stdio.h>
+#include "util.h"
+
+#define SPLIT_WRITER_BUFFER_SIZE        (u64)0x100000               // 1 MiB (1048576 bytes). stdio buffer used for each output part
+#define SPLIT_WRITER_BUFFER_ALIGNMENT   0x1000
+#define SPLIT_WRITER_SMALL_FILE_SIZE    SPLIT_WRITER_BUFFER_SIZE    // Outputs up to this size skip both the stdio buffer and preallocation
+
+#define SPLIT_WRITER_VERIFY_BLOCK_SIZE  (u64)0x100000               // 1 MiB (1048576 bytes). Size of each output block hashed while writing for read-back verification
+#define SPLIT_WRITER_VERIFY_BLOCK_STEP  256                         // Growth step for the block digest list
+
+typedef enum {
+    SPLIT_WRITER_NAMING_DIRECTORY = 0,              // "[path]/00", "[path]/01"... 'path' is created as a directory. Its archive bit must be set by the caller once the dump is complete
+    SPLIT_WRITER_NAMING_DOT_INDEX,                  // "[path].00", "[path].01"... Used by sequential dumps and generic split files
+    SPLIT_WRITER_NAMING_XCI                         // "[path].xc0", "[path].xc1"... 'path' shouldn't include the file extension (based on XCI-Cutter)
+} splitWriterNaming;
+
+// SHA-256 digest from a block of data written to an output part
+typedef struct {
+    u32 part_index;
+    u64 offset;                                     // Relative to the start of the part file
+    u64 size;                                       // Only the last block from each part may be smaller than SPLIT_WRITER_VERIFY_BLOCK_SIZE
+    u8 hash[SHA256_HASH_SIZE];
+} split_writer_block_t;
+
+typedef struct {
+    FILE *outFile;
+    u8 *outBuf;                                     // Aligned stdio buffer for the current part
+    char base_path[NAME_BUF_LEN * 2];
+    char path[NAME_BUF_LEN * 2 + 8];                // Path of the current part
+    splitWriterNaming naming;
+    u64 total_size;                                 // Expected output size starting at the first part. 0 if unknown or if the filesystem can't preallocate files
+    u64 part_size;                                  // 0 if the output isn't split, in which case 'base_path' is used as is
+    u32 first_part;
+    u32 part_index;
+    u64 part_offset;                                // Bytes written to the current part
+    u64 part_alloc_size;                            // Size the current part was preallocated to. Unwritten space is dropped when the part is closed
+    u64 offset;                                     // Bytes written through the writer since it was opened
+    bool part_update_mode;                          // True if the current part was reopened by splitWriterRewrite()
+    bool verify;                                    // Set by splitWriterEnableVerification()
+    split_writer_block_t *blocks;                   // Digests from all blocks written so far, in output order
+    u32 block_cnt;
+    u32 block_capacity;
+    Sha256Context block_ctx;                        // Digest from the block currently being written
+    u64 block_fill;                                 // Bytes hashed into the current block
+    u64 part_data_offset;                           // Bytes stored in the current part file (skipped data isn't included)
+    char *error_str;                                // Set by splitWriterOpenEx(). Errors are drawn if NULL
+    size_t error_str_size;
+} split_writer_ctx_t;
+
+// Creates the first output part. If 'partSize' is zero, 'path' is written as a single file and 'naming' is ignored
+// 'firstPart' lets sequential dumps continue from the part where the previous session stopped
+// Each part is preallocated to its final size (based on 'totalSize') as soon as it's created, which fails right away if there's not enough free space
+// Preallocation is silently skipped if 'totalSize' is zero, if it's no bigger than SPLIT_WRITER_SMALL_FILE_SIZE or if the filesystem doesn't support it
+// All writer functions report their own errors using the current 'breaks' value
+bool splitWriterOpen(split_writer_ctx_t *writer, const char *path, u64 totalSize, u64 partSize, splitWriterNaming naming, u32 firstPart);
+
+// Same as splitWriterOpen(), but errors from all writer functions (except splitWriterVerify()) are written to 'errorStr' instead of being drawn
+// Meant to be used by background threads, which must not touch the UI
+bool splitWriterOpenEx(split_writer_ctx_t *writer, const char *path, u64 totalSize, u64 partSize, splitWriterNaming naming, u32 firstPart, char *errorStr, size_t errorStrSize);
+
+// Records a SHA-256 digest for every SPLIT_WRITER_VERIFY_BLOCK_SIZE bytes written from now on, so the output can be checked with splitWriterVerify()
+// Must be called right after splitWriterOpen(). The digest list must be released with splitWriterFreeVerification()
+void splitWriterEnableVerification(split_writer_ctx_t *writer);
+
+// Appends data to the output. A new part is created as soon as there's data left to write after the current one has been filled
+bool splitWriterWrite(split_writer_ctx_t *writer, const void *data, u64 size);
+
+// Closes the current part right after it has been filled, so its data is committed to storage before the next one is created by splitWriterWrite()
+// 'path' keeps pointing to the finished part until then
+bool splitWriterFinishPart(split_writer_ctx_t *writer);
+
+// Advances the output position without writing anything, as if 'size' bytes had been written to the current part
+// Only valid before any data has been written. Used when the beginning of the output is saved somewhere else, so part boundaries stay where they'd be in the full output
+bool splitWriterSkip(split_writer_ctx_t *writer, u64 size);
+
+// Overwrites data that has already been written (e.g. a placeholder header). 'offset' is relative to the start of the first part written by this writer and the range must not cross a part boundary
+// The current part is closed if the data is located in a different one, so this is meant to be used once all data has been written
+bool splitWriterRewrite(split_writer_ctx_t *writer, u64 offset, const void *data, u64 size);
+
+// Flushes and closes the current part. Returns false if buffered data couldn't be written
+bool splitWriterClose(split_writer_ctx_t *writer);
+
+// Closes the current part without checking for errors and frees the stdio buffer
+void splitWriterAbort(split_writer_ctx_t *writer);
+
+// Reads back every part written by this writer using large sequential reads and compares each block against the digest recorded while writing it
+// Hashing is spread across the hash pool threads. 'buf' is used to hold the data being read and should be at least a few blocks long
+// The writer must have been closed first. Each part that doesn't match is reported with the offset of its first bad block, and false is returned
+bool splitWriterVerify(split_writer_ctx_t *writer, u8 *buf, u64 bufSize);
+
+// Frees the block digest list. Safe to call even if verification was never enabled
+void splitWriterFreeVerification(split_writer_ctx_t *writer);
+
+// Removes all parts created by the writer (or the whole part directory). The writer must have been closed or aborted first
+void splitWriterDelete(split_writer_ctx_t *writer);
+
+#endif
@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "store_worker.h"
+#include "dumper.h"
+#include "nca.h"
+#include "nca_store.h"
+#include "split_writer.h"
+
+static bool storeWorkerSkipContent(store_worker_ctx_t *ctx, const NcmContentInfo *contentInfo)
+{
+    if (contentInfo->content_type == NcmContentType_Meta) return true;
+    if (contentInfo->content_type == NcmContentType_Program && ctx->skip_program_ncas) return true;
+    if (contentInfo->content_type >= NcmContentType_DeltaFragment && ctx->skip_delta_fragments) return true;
+    return false;
+}
+
+// Same data dumpNintendoSubmissionPackage() writes for an unmodified NCA, without any UI output
+static bool storeWorkerCopyNca(store_worker_ctx_t *ctx, NcmContentStorage *ncmStorage, const NcmContentInfo *contentInfo, u64 ncaSize)
+{
+    Result result;
+    Sha256Context hashCtx;
+    u8 hash[SHA256_HASH_SIZE];
+    
+    char tmpPath[NAME_BUF_LEN] = {'\0'}, ncaIdStr[SHA256_HASH_SIZE + 1] = {'\0'}, errorStr[NAME_BUF_LEN * 2] = {'\0'};
+    
+    u64 partSize = ((ncaSize > FAT32_FILESIZE_LIMIT && ctx->is_fat32) ? SPLIT_FILE_NSP_PART_SIZE : 0);
+    u64 offset = 0, chunk;
+    
+    split_writer_ctx_t writer;
+    bool writerOpen = false, success = false;
+    
+    convertDataToHexString(contentInfo->content_id.c, SHA256_HASH_SIZE / 2, ncaIdStr, SHA256_HASH_SIZE + 1);
+    
+    // Kept apart from the temporary file used by the UI thread for the same NCA
+    snprintf(tmpPath, MAX_CHARACTERS(tmpPath), "%s%s.nca.bgtmp", NCA_STORE_PATH, ncaIdStr);
+    remove(tmpPath);
+    fsdevDeleteDirectoryRecursively(tmpPath);
+    
+    // Errors are written to 'errorStr' and ignored: the UI thread dumps any NCA that's missing from the store by itself
+    if (!splitWriterOpenEx(&writer, tmpPath, ncaSize, partSize, SPLIT_WRITER_NAMING_DIRECTORY, 0, errorStr, MAX_CHARACTERS(errorStr))) goto out;
+    writerOpen = true;
+    
+    sha256ContextCreate(&hashCtx);
+    
+    while(offset < ncaSize)
+    {
+        if (__atomic_load_n(&(ctx->cancel), __ATOMIC_SEQ_CST)) goto out;
+        
+        chunk = ((ncaSize - offset) > ctx->buf_size ? ctx->buf_size : (ncaSize - offset));
+        
+        result = ncmContentStorageReadContentIdFile(ncmStorage, ctx->buf, chunk, &(contentInfo->content_id), offset);
+        if (R_FAILED(result)) goto out;
+        
+        sha256ContextUpdate(&hashCtx, ctx->buf, chunk);
+        
+        if (!splitWriterWrite(&writer, ctx->buf, chunk)) goto out;
+        
+        offset += chunk;
+        
+        __atomic_add_fetch(&(ctx->cur_offset), chunk, __ATOMIC_SEQ_CST);
+    }
+    
+    writerOpen = false;
+    if (!splitWriterClose(&writer)) goto out;
+    
+    sha256ContextGetHash(&hashCtx, hash);
+    
+    // The content ID is the first half of the SHA-256 checksum from the NCA. Don't store anything that doesn't match it
+    if (memcmp(hash, contentInfo->content_id.c, SHA256_HASH_SIZE / 2) != 0) goto out;
+    
+    // Split NCAs can't be read as a single file without the archive bit
+    if (partSize && R_FAILED(fsdevSetConcatenationFileAttribute(tmpPath))) goto out;
+    
+    success = ncaStoreAdd(tmpPath, hash, ncaSize, partSize);
+    
+out:
+    if (writerOpen) splitWriterAbort(&writer);
+    
+    if (!success)
+    {
+        remove(tmpPath);
+        fsdevDeleteDirectoryRecursively(tmpPath);
+    }
+    
+    return success;
+}
+
+static void *storeWorkerThreadFunc(void *arg)
+{
+    store_worker_ctx_t *ctx = (store_worker_ctx_t*)arg;
+    
+    u32 i;
+    u64 ncaSize, ncaStartOffset, totalSize = 0;
+    Result result;
+    NcmContentStorage ncmStorage;
+    NcmContentInfo *contentInfos = NULL;
+    u32 contentInfoCnt = 0;
+    char errorStr[256] = {'\0'};
+    bool success = true;
+    
+    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
+    
+    // Errors aren't reported: the UI thread dumps any NCA that's missing from the store by itself
+    if (!retrieveContentInfosFromTitleEx(ctx->storage_id, ctx->meta_type, ctx->title_count, ctx->ncm_title_index, &contentInfos, &contentInfoCnt, errorStr, MAX_CHARACTERS(errorStr)))
+    {
+        success = false;
+        goto out;
+    }
+    
+    result = ncmOpenContentStorage(&ncmStorage, ctx->storage_id);
+    if (R_FAILED(result))
+    {
+        success = false;
+        goto out;
+    }
+    
+    for(i = 0; i < contentInfoCnt; i++)
+    {
+        if (storeWorkerSkipContent(ctx, &(contentInfos[i]))) continue;
+        
+        convertNcaSizeToU64(contentInfos[i].size, &ncaSize);
+        totalSize += ncaSize;
+    }
+    
+    __atomic_store_n(&(ctx->total_size), totalSize, __ATOMIC_SEQ_CST);
+    
+    for(i = 0; i < contentInfoCnt; i++)
+    {
+        if (__atomic_load_n(&(ctx->cancel), __ATOMIC_SEQ_CST))
+        {
+            success = false;
+            break;
+        }
+        
+        if (storeWorkerSkipContent(ctx, &(contentInfos[i]))) continue;
+        
+        convertNcaSizeToU64(contentInfos[i].size, &ncaSize);
+        
+        // Already stored while dumping another title
+        if (ncaStoreLookup(contentInfos[i].content_id.c, ncaSize, NULL, NULL))
+        {
+            __atomic_add_fetch(&(ctx->cur_offset), ncaSize, __ATOMIC_SEQ_CST);
+            continue;
+        }
+        
+        ncaStartOffset = __atomic_load_n(&(ctx->cur_offset), __ATOMIC_SEQ_CST);
+        
+        if (!storeWorkerCopyNca(ctx, &ncmStorage, &(contentInfos[i]), ncaSize))
+        {
+            // Keep going: every NCA that makes it to the store saves time later. Account for the rest of this NCA, so the progress stays consistent
+            __atomic_store_n(&(ctx->cur_offset), ncaStartOffset + ncaSize, __ATOMIC_SEQ_CST);
+            success = false;
+        }
+    }
+    
+    ncmContentStorageClose(&ncmStorage);
+    
+    ncaStoreSave();
+    
+out:
+    if (contentInfos) free(contentInfos);
+    
+    ctx->success = success;
+    __atomic_store_n(&(ctx->done), true, __ATOMIC_SEQ_CST);
+    
+    return NULL;
+}
+
+bool storeWorkerInit(store_worker_ctx_t *ctx, u64 mainBufSize)
+{
+    if (!ctx || mainBufSize >= STORE_WORKER_MEMORY_LIMIT) return false;
+    
+    memset(ctx, 0, sizeof(store_worker_ctx_t));
+    
+    u64 bufSize = (STORE_WORKER_MEMORY_LIMIT - mainBufSize);
+    if (bufSize > STORE_WORKER_MAX_BUFFER_SIZE) bufSize = STORE_WORKER_MAX_BUFFER_SIZE;
+    if (bufSize < STORE_WORKER_MIN_BUFFER_SIZE) return false;
+    
+    ctx->buf = malloc(bufSize);
+    if (!ctx->buf) return false;
+    
+    ctx->buf_size = bufSize;
+    
+    return true;
+}
+
+bool storeWorkerStart(store_worker_ctx_t *ctx, u32 entryIndex, NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 ncmTitleIndex, bool isFat32, bool skipProgramNcas, bool skipDeltaFragments)
+{
+    if (!ctx || !ctx->buf || (storageId != NcmStorageId_SdCard && storageId != NcmStorageId_BuiltInUser) || !titleCount || ncmTitleIndex >= titleCount) return false;
+    
+    storeWorkerJoin(ctx);
+    
+    ctx->entry_index = entryIndex;
+    ctx->storage_id = storageId;
+    ctx->meta_type = metaType;
+    ctx->title_count = titleCount;
+    ctx->ncm_title_index = ncmTitleIndex;
+    ctx->is_fat32 = isFat32;
+    ctx->skip_program_ncas = skipProgramNcas;
+    ctx->skip_delta_fragments = skipDeltaFragments;
+    ctx->success = false;
+    
+    __atomic_store_n(&(ctx->cancel), false, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&(ctx->done), false, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&(ctx->cur_offset), 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&(ctx->total_size), 0, __ATOMIC_SEQ_CST);
+    
+    if (pthread_create(&(ctx->thread), NULL, &storeWorkerThreadFunc, ctx) != 0) return false;
+    
+    ctx->running = true;
+    
+    return true;
+}
+
+bool storeWorkerIsBusy(store_worker_ctx_t *ctx)
+{
+    return (ctx && ctx->running && !__atomic_load_n(&(ctx->done), __ATOMIC_SEQ_CST));
+}
+
+void storeWorkerGetProgress(store_worker_ctx_t *ctx, u64 *outCurOffset, u64 *outTotalSize)
+{
+    if (!ctx) return;
+    
+    if (outCurOffset) *outCurOffset = __atomic_load_n(&(ctx->cur_offset), __ATOMIC_SEQ_CST);
+    if (outTotalSize) *outTotalSize = __atomic_load_n(&(ctx->total_size), __ATOMIC_SEQ_CST);
+}
+
+bool storeWorkerJoin(store_worker_ctx_t *ctx)
+{
+    if (!ctx || !ctx->running) return false;
+    
+    pthread_join(ctx->thread, NULL);
+    ctx->running = false;
+    
+    return ctx->success;
+}
+
+void storeWorkerFree(store_worker_ctx_t *ctx)
+{
+    if (!ctx) return;
+    
+    __atomic_store_n(&(ctx->cancel), true, __ATOMIC_SEQ_CST);
+    storeWorkerJoin(ctx);
+    
+    if (ctx->buf) free(ctx->buf);
+    
+    memset(ctx, 0, sizeof(store_worker_ctx_t));
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#ifndef __STORE_WORKER_H__
+#define __STORE_WORKER_H__
+
+#include <switch.h>
+#include <pthread.h>
+#include "util.h"
+
+#define STORE_WORKER_MEMORY_LIMIT       (u64)0x1800000              // 24 MiB (25165824 bytes). Combined size of the dump buffer and the worker buffer
+#define STORE_WORKER_MIN_BUFFER_SIZE    (u64)0x100000               // 1 MiB (1048576 bytes)
+#define STORE_WORKER_MAX_BUFFER_SIZE    DUMP_BUFFER_SIZE
+
+// Copies the NCAs from an installed title into the NCA store on a background thread
+// Used by batch mode to read titles from one storage (SD card or eMMC) while a title from the other one is being dumped. The copied NCAs are picked up as store hits once that title gets dumped
+typedef struct {
+    bool running;                                   // True if the thread has been started and hasn't been joined yet
+    pthread_t thread;
+    u8 *buf;                                        // Owned by the context for its whole lifetime, so the memory limit holds no matter how many titles are copied
+    u64 buf_size;
+    NcmStorageId storage_id;
+    NcmContentMetaType meta_type;
+    u32 title_count;
+    u32 ncm_title_index;
+    bool is_fat32;
+    bool skip_program_ncas;                         // Program NCAs may be modified by the "Change NPDM RSA key/sig in Program NCA" option
+    bool skip_delta_fragments;
+    u32 entry_index;                                // Batch entry the thread is working on
+    volatile bool cancel;
+    volatile bool done;
+    volatile u64 cur_offset;
+    volatile u64 total_size;
+    bool success;
+} store_worker_ctx_t;
+
+// Allocates the worker buffer. Its size is picked so it fits alongside a dump buffer of 'mainBufSize' bytes within STORE_WORKER_MEMORY_LIMIT
+// Returns false if there's not enough memory left for a buffer of at least STORE_WORKER_MIN_BUFFER_SIZE bytes
+bool storeWorkerInit(store_worker_ctx_t *ctx, u64 mainBufSize);
+
+// Starts copying the NCAs from the provided title. Meta NCAs are always skipped, since they're modified at dump time
+// Gamecard titles aren't supported, since their data must be read through the Secure HFS0 partition opened by the UI thread
+bool storeWorkerStart(store_worker_ctx_t *ctx, u32 entryIndex, NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 ncmTitleIndex, bool isFat32, bool skipProgramNcas, bool skipDeltaFragments);
+
+// Returns true if the thread is still copying NCAs
+bool storeWorkerIsBusy(store_worker_ctx_t *ctx);
+
+// Retrieves the amount of data copied so far from the current title, and the total amount that has to be copied
+void storeWorkerGetProgress(store_worker_ctx_t *ctx, u64 *outCurOffset, u64 *outTotalSize);
+
+// Waits for the thread to finish. Returns false if any NCA couldn't be copied
+bool storeWorkerJoin(store_worker_ctx_t *ctx);
+
+// Cancels any ongoing copy, waits for the thread and frees the worker buffer
+void storeWorkerFree(store_worker_ctx_t *ctx);
+
+#endif
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "str_builder.h"
+
+static bool strBuilderReserve(str_builder_t *sb, u64 extra)
+{
+    u64 newCapacity;
+    char *newStr;
+    
+    if (sb->error) return false;
+    
+    if ((sb->len + extra + 1) <= sb->capacity) return true;
+    
+    newCapacity = (sb->capacity ? sb->capacity : STR_BUILDER_DEFAULT_CAPACITY);
+    while(newCapacity < (sb->len + extra + 1)) newCapacity *= 2;
+    
+    newStr = realloc(sb->str, newCapacity);
+    if (!newStr)
+    {
+        sb->error = true;
+        return false;
+    }
+    
+    sb->str = newStr;
+    sb->capacity = newCapacity;
+    
+    return true;
+}
+
+bool strBuilderInit(str_builder_t *sb, u64 capacity)
+{
+    if (!sb) return false;
+    
+    memset(sb, 0, sizeof(str_builder_t));
+    
+    sb->str = malloc(capacity ? capacity : STR_BUILDER_DEFAULT_CAPACITY);
+    if (!sb->str)
+    {
+        sb->error = true;
+        return false;
+    }
+    
+    sb->str[0] = '\0';
+    sb->capacity = (capacity ? capacity : STR_BUILDER_DEFAULT_CAPACITY);
+    
+    return true;
+}
+
+void strBuilderFree(str_builder_t *sb)
+{
+    if (!sb) return;
+    
+    if (sb->str) free(sb->str);
+    
+    memset(sb, 0, sizeof(str_builder_t));
+}
+
+void strBuilderReset(str_builder_t *sb)
+{
+    if (!sb || !sb->str) return;
+    
+    sb->len = 0;
+    sb->str[0] = '\0';
+}
+
+bool strBuilderAppendLen(str_builder_t *sb, const char *str, u64 len)
+{
+    if (!sb || !str || !strBuilderReserve(sb, len)) return false;
+    
+    memcpy(sb->str + sb->len, str, len);
+    sb->len += len;
+    sb->str[sb->len] = '\0';
+    
+    return true;
+}
+
+bool strBuilderAppend(str_builder_t *sb, const char *str)
+{
+    if (!str) return false;
+    
+    return strBuilderAppendLen(sb, str, strlen(str));
+}
+
+bool strBuilderAppendFormat(str_builder_t *sb, const char *fmt, ...)
+{
+    if (!sb || !fmt || sb->error) return false;
+    
+    int res;
+    va_list args;
+    
+    // Try to format straight into the free space first. Only retry if the output didn't fit
+    if (!strBuilderReserve(sb, 1)) return false;
+    
+    va_start(args, fmt);
+    res = vsnprintf(sb->str + sb->len, sb->capacity - sb->len, fmt, args);
+    va_end(args);
+    
+    if (res < 0)
+    {
+        sb->str[sb->len] = '\0';
+        return false;
+    }
+    
+    if ((sb->len + (u64)res + 1) > sb->capacity)
+    {
+        if (!strBuilderReserve(sb, (u64)res))
+        {
+            sb->str[sb->len] = '\0';
+            return false;
+        }
+        
+        va_start(args, fmt);
+        vsnprintf(sb->str + sb->len, sb->capacity - sb->len, fmt, args);
+        va_end(args);
+    }
+    
+    sb->len += (u64)res;
+    
+    return true;
+}
+
+char *strBuilderDetach(str_builder_t *sb, u64 *outLen)
+{
+    if (!sb) return NULL;
+    
+    char *str = NULL;
+    
+    if (!sb->error)
+    {
+        str = sb->str;
+        if (outLen) *outLen = sb->len;
+    } else {
+        if (sb->str) free(sb->str);
+    }
+    
+    memset(sb, 0, sizeof(str_builder_t));
+    
+    return str;
+}
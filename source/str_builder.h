@@ -0,0 +1,34 @@
+#pragma once
+
+#ifndef __STR_BUILDER_H__
+#define __STR_BUILDER_H__
+
+#include <switch.h>
+
+#define STR_BUILDER_DEFAULT_CAPACITY    (u64)0x1000                 // Initial buffer size. The buffer doubles in size each time it runs out of space
+
+typedef struct {
+    char *str;                                      // Always NULL terminated
+    u64 len;
+    u64 capacity;
+    bool error;                                     // Set if the buffer couldn't be grown. All further appends are ignored
+} str_builder_t;
+
+// Allocates the initial buffer. A zero 'capacity' selects STR_BUILDER_DEFAULT_CAPACITY
+bool strBuilderInit(str_builder_t *sb, u64 capacity);
+
+void strBuilderFree(str_builder_t *sb);
+
+// Empties the string without releasing its buffer. Contents of the same length or shorter can then be written without moving the buffer
+void strBuilderReset(str_builder_t *sb);
+
+// Append functions return false if the buffer couldn't be grown. Since the error flag is sticky, it's enough to check it once the whole string has been built
+bool strBuilderAppend(str_builder_t *sb, const char *str);
+bool strBuilderAppendLen(str_builder_t *sb, const char *str, u64 len);
+bool strBuilderAppendFormat(str_builder_t *sb, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Hands the buffer over to the caller, who becomes responsible for freeing it. The builder is left empty
+// Returns NULL if an append operation failed at some point
+char *strBuilderDetach(str_builder_t *sb, u64 *outLen);
+
+#endif
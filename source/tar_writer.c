@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "tar_writer.h"
+#include "ui.h"
+
+/* Extern variables */
+
+extern int breaks;
+extern int font_height;
+
+/* Statically allocated variables */
+
+static const u8 tarZeroBlock[TAR_BLOCK_SIZE] = {0};
+
+static void tarWriterFormatOctal(char *out, size_t outSize, u64 val)
+{
+    // Values that don't fit in (outSize - 1) octal digits are stored using the GNU base-256 encoding
+    if (val >> (3 * (outSize - 1)))
+    {
+        size_t i;
+        
+        for(i = (outSize - 1); i > 0; i--)
+        {
+            out[i] = (char)(val & 0xFF);
+            val >>= 8;
+        }
+        
+        out[0] = (char)0x80;
+    } else {
+        snprintf(out, outSize, "%0*lo", (int)(outSize - 1), val);
+    }
+}
+
+static bool tarWriterOpenPart(tar_writer_ctx_t *tar)
+{
+    char partPath[NAME_BUF_LEN * 2 + 8] = {'\0'};
+    
+    if (tar->partSize)
+    {
+        snprintf(partPath, MAX_CHARACTERS(partPath), "%s/%02u", tar->path, tar->partIndex);
+    } else {
+        snprintf(partPath, MAX_CHARACTERS(partPath), "%s", tar->path);
+    }
+    
+    tar->outFile = fopen(partPath, "wb");
+    if (!tar->outFile)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to open output file \"%s\"!", __func__, partPath);
+        return false;
+    }
+    
+    // Use a big stdio buffer to issue large sequential writes
+    if (tar->outBuf) setvbuf(tar->outFile, (char*)tar->outBuf, _IOFBF, TAR_WRITER_BUFFER_SIZE);
+    
+    tar->partOffset = 0;
+    
+    return true;
+}
+
+static bool tarWriterClosePart(tar_writer_ctx_t *tar)
+{
+    if (!tar->outFile) return true;
+    
+    int ret = fclose(tar->outFile);
+    tar->outFile = NULL;
+    
+    if (ret != 0)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to flush output part #%02u!", __func__, tar->partIndex);
+        return false;
+    }
+    
+    return true;
+}
+
+static bool tarWriterWriteRaw(tar_writer_ctx_t *tar, const void *data, u64 size)
+{
+    const u8 *ptr = (const u8*)data;
+    u64 chunk;
+    size_t write_res;
+    
+    while(size > 0)
+    {
+        if (tar->partSize && tar->partOffset >= tar->partSize)
+        {
+            if (!tarWriterClosePart(tar)) return false;
+            
+            tar->partIndex++;
+            if (!tarWriterOpenPart(tar)) return false;
+        }
+        
+        chunk = size;
+        if (tar->partSize && chunk > (tar->partSize - tar->partOffset)) chunk = (tar->partSize - tar->partOffset);
+        
+        write_res = fwrite(ptr, 1, chunk, tar->outFile);
+        if (write_res != chunk)
+        {
+            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: failed to write %lu bytes chunk at archive offset 0x%016lX to part #%02u! (wrote %lu bytes)", __func__, chunk, tar->archiveOffset, tar->partIndex, write_res);
+            return false;
+        }
+        
+        ptr += chunk;
+        size -= chunk;
+        tar->partOffset += chunk;
+        tar->archiveOffset += chunk;
+    }
+    
+    return true;
+}
+
+static bool tarWriterWriteHeader(tar_writer_ctx_t *tar, const char *name, size_t nameLen, u64 size, char typeflag)
+{
+    u32 i, chksum = 0;
+    tar_header_t header;
+    
+    memset(&header, 0, sizeof(tar_header_t));
+    
+    memcpy(header.name, name, (nameLen < TAR_NAME_LEN ? nameLen : (TAR_NAME_LEN - 1)));
+    tarWriterFormatOctal(header.mode, sizeof(header.mode), (typeflag == '5' ? 0755 : 0644));
+    tarWriterFormatOctal(header.uid, sizeof(header.uid), 0);
+    tarWriterFormatOctal(header.gid, sizeof(header.gid), 0);
+    tarWriterFormatOctal(header.size, sizeof(header.size), size);
+    tarWriterFormatOctal(header.mtime, sizeof(header.mtime), tar->mtime);
+    header.typeflag = typeflag;
+    memcpy(header.magic, "ustar", 6);
+    memcpy(header.version, "00", 2);
+    
+    // The checksum is calculated with the checksum field filled with spaces
+    memset(header.chksum, ' ', sizeof(header.chksum));
+    for(i = 0; i < sizeof(tar_header_t); i++) chksum += ((u8*)&header)[i];
+    snprintf(header.chksum, sizeof(header.chksum) - 1, "%06o", chksum);
+    
+    return tarWriterWriteRaw(tar, &header, sizeof(tar_header_t));
+}
+
+static bool tarWriterAddEntry(tar_writer_ctx_t *tar, const char *name, u64 size, bool isDir)
+{
+    if (!tar || !tar->outFile || !name || !strlen(name) || tar->curFileRemaining)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to add archive entry!", __func__);
+        return false;
+    }
+    
+    size_t nameLen = strlen(name);
+    char *entryName = malloc(nameLen + 2);
+    if (!entryName)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: unable to allocate memory for the archive entry name!", __func__);
+        return false;
+    }
+    
+    sprintf(entryName, "%s%s", name, (isDir ? "/" : ""));
+    nameLen = strlen(entryName);
+    
+    bool success = false;
+    
+    // Names that don't fit in the header are stored in a preceding GNU long name entry
+    if (nameLen >= TAR_NAME_LEN)
+    {
+        u64 padding = (round_up(nameLen + 1, TAR_BLOCK_SIZE) - (nameLen + 1));
+        
+        if (!tarWriterWriteHeader(tar, TAR_LONGNAME_MAGIC, strlen(TAR_LONGNAME_MAGIC), nameLen + 1, 'L') || !tarWriterWriteRaw(tar, entryName, nameLen + 1) || \
+            (padding > 0 && !tarWriterWriteRaw(tar, tarZeroBlock, padding))) goto out;
+    }
+    
+    if (!tarWriterWriteHeader(tar, entryName, nameLen, (isDir ? 0 : size), (isDir ? '5' : '0'))) goto out;
+    
+    tar->curFileRemaining = (isDir ? 0 : size);
+    tar->curFilePadding = (isDir ? 0 : (round_up(size, TAR_BLOCK_SIZE) - size));
+    
+    success = true;
+    
+out:
+    free(entryName);
+    
+    return success;
+}
+
+u64 tarWriterGetEntrySize(size_t nameLen, u64 dataSize, bool isDir)
+{
+    u64 size = TAR_BLOCK_SIZE;
+    
+    if (isDir)
+    {
+        nameLen++;
+        dataSize = 0;
+    }
+    
+    if (nameLen >= TAR_NAME_LEN) size += (TAR_BLOCK_SIZE + round_up(nameLen + 1, TAR_BLOCK_SIZE));
+    
+    size += round_up(dataSize, TAR_BLOCK_SIZE);
+    
+    return size;
+}
+
+u64 tarWriterGetTrailerSize()
+{
+    return (TAR_BLOCK_SIZE * 2);
+}
+
+bool tarWriterOpen(tar_writer_ctx_t *tar, const char *path, u64 totalSize, u64 partSize)
+{
+    if (!tar || !path || !strlen(path) || strlen(path) >= MAX_ELEMENTS(tar->path))
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to create output archive!", __func__);
+        return false;
+    }
+    
+    memset(tar, 0, sizeof(tar_writer_ctx_t));
+    
+    snprintf(tar->path, MAX_CHARACTERS(tar->path), "%s", path);
+    tar->path_len = strlen(tar->path);
+    tar->partSize = (partSize > 0 && totalSize > partSize ? partSize : 0);
+    tar->mtime = (u32)time(NULL);
+    
+    // Not fatal: stdio falls back to its default buffer
+    tar->outBuf = malloc(TAR_WRITER_BUFFER_SIZE);
+    
+    if (tar->partSize) mkdir(tar->path, 0744);
+    
+    if (!tarWriterOpenPart(tar))
+    {
+        tarWriterAbort(tar);
+        return false;
+    }
+    
+    return true;
+}
+
+bool tarWriterAddDirectory(tar_writer_ctx_t *tar, const char *name)
+{
+    return tarWriterAddEntry(tar, name, 0, true);
+}
+
+bool tarWriterBeginFile(tar_writer_ctx_t *tar, const char *name, u64 size)
+{
+    return tarWriterAddEntry(tar, name, size, false);
+}
+
+bool tarWriterWriteFileData(tar_writer_ctx_t *tar, const void *data, u64 size)
+{
+    if (!tar || !tar->outFile || !data || !size || size > tar->curFileRemaining)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: invalid parameters to write archive file data!", __func__);
+        return false;
+    }
+    
+    if (!tarWriterWriteRaw(tar, data, size)) return false;
+    
+    tar->curFileRemaining -= size;
+    
+    if (!tar->curFileRemaining && tar->curFilePadding)
+    {
+        if (!tarWriterWriteRaw(tar, tarZeroBlock, tar->curFilePadding)) return false;
+        tar->curFilePadding = 0;
+    }
+    
+    return true;
+}
+
+bool tarWriterClose(tar_writer_ctx_t *tar)
+{
+    if (!tar || !tar->outFile) return false;
+    
+    bool success = false;
+    
+    if (tar->curFileRemaining)
+    {
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_ERROR_RGB, "%s: archive closed with %lu data bytes left for the current entry!", __func__, tar->curFileRemaining);
+        goto out;
+    }
+    
+    if (!tarWriterWriteRaw(tar, tarZeroBlock, TAR_BLOCK_SIZE) || !tarWriterWriteRaw(tar, tarZeroBlock, TAR_BLOCK_SIZE)) goto out;
+    
+    success = tarWriterClosePart(tar);
+    
+    // Set archive bit (only for FAT32)
+    if (success && tar->partSize) fsdevSetConcatenationFileAttribute(tar->path);
+    
+out:
+    tarWriterAbort(tar);
+    
+    return success;
+}
+
+void tarWriterAbort(tar_writer_ctx_t *tar)
+{
+    if (!tar) return;
+    
+    if (tar->outFile)
+    {
+        fclose(tar->outFile);
+        tar->outFile = NULL;
+    }
+    
+    if (tar->outBuf)
+    {
+        free(tar->outBuf);
+        tar->outBuf = NULL;
+    }
+}
+
+void tarWriterDelete(tar_writer_ctx_t *tar)
+{
+    if (!tar || !strlen(tar->path)) return;
+    
+    tarWriterAbort(tar);
+    
+    if (tar->partSize)
+    {
+        fsdevDeleteDirectoryRecursively(tar->path);
+    } else {
+        remove(tar->path);
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#ifndef __TAR_WRITER_H__
+#define __TAR_WRITER_H__
+
+#include <switch.h>
+#include <stdio.h>
+#include "util.h"
+
+#define TAR_BLOCK_SIZE              (u64)0x200                  // 512 bytes
+#define TAR_NAME_LEN                100
+#define TAR_LONGNAME_MAGIC          "././@LongLink"
+#define TAR_WRITER_BUFFER_SIZE      DUMP_BUFFER_SIZE            // stdio buffer used for each output part
+
+typedef struct {
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char chksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char padding[12];
+} PACKED tar_header_t;
+
+typedef struct {
+    FILE *outFile;
+    u8 *outBuf;                                     // stdio buffer for the current part
+    char path[NAME_BUF_LEN * 2];                    // Output path. Becomes a directory holding the parts if the archive is split
+    size_t path_len;
+    u64 partSize;                                   // 0 if the archive isn't split
+    u8 partIndex;
+    u64 partOffset;                                 // Bytes written to the current part
+    u64 archiveOffset;                              // Bytes written to the whole archive
+    u64 curFileRemaining;                           // Data bytes left to write for the current file entry
+    u64 curFilePadding;                             // Padding bytes needed to complete the current file entry
+    u32 mtime;
+} tar_writer_ctx_t;
+
+// Returns the number of bytes a file or directory entry takes up in the archive, including its header blocks and data padding
+u64 tarWriterGetEntrySize(size_t nameLen, u64 dataSize, bool isDir);
+
+// Returns the number of bytes used by the end-of-archive marker
+u64 tarWriterGetTrailerSize();
+
+// Creates the output archive. If partSize is greater than zero and totalSize exceeds it, 'path' becomes a directory holding "%02u" parts and gets its archive bit set
+bool tarWriterOpen(tar_writer_ctx_t *tar, const char *path, u64 totalSize, u64 partSize);
+
+// Adds a directory entry. 'name' must be relative to the archive root
+bool tarWriterAddDirectory(tar_writer_ctx_t *tar, const char *name);
+
+// Writes the header for a file entry. Its data must be provided through tarWriterWriteFileData()
+bool tarWriterBeginFile(tar_writer_ctx_t *tar, const char *name, u64 size);
+
+// Appends data to the current file entry. Padding is added automatically after its last byte
+bool tarWriterWriteFileData(tar_writer_ctx_t *tar, const void *data, u64 size);
+
+// Writes the end-of-archive marker and closes the current part. Returns false if the archive is incomplete or couldn't be finalized
+bool tarWriterClose(tar_writer_ctx_t *tar);
+
+// Closes the current part without finalizing the archive (e.g. on errors)
+void tarWriterAbort(tar_writer_ctx_t *tar);
+
+// Deletes the output archive (single file or part directory). The archive must have been closed or aborted first
+void tarWriterDelete(tar_writer_ctx_t *tar);
+
+#endif
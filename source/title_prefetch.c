@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "title_prefetch.h"
+#include "keys.h"
+#include "util.h"
+
+/* Extern variables */
+
+extern nca_keyset_t nca_keyset;
+
+// Only small NCAs that are read multiple times while the NSP is being set up are worth keeping in memory
+static bool titlePrefetchIsMemoryContent(u8 contentType)
+{
+    return (contentType == NcmContentType_Meta || contentType == NcmContentType_Control || contentType == NcmContentType_LegalInformation);
+}
+
+static void titlePrefetchDecryptNcaHeaders(title_prefetch_data_t *data)
+{
+    u32 i;
+    char errorStr[NAME_BUF_LEN] = {'\0'};
+    
+    if (!nca_keyset.total_key_cnt) return;
+    
+    data->dec_nca_headers = calloc(data->content_info_cnt, sizeof(nca_header_t));
+    if (!data->dec_nca_headers) return;
+    
+    for(i = 0; i < data->content_info_cnt; i++)
+    {
+        if (!decryptNcaHeaderEx(data->nca_headers + ((u64)i * NCA_FULL_HEADER_LENGTH), NCA_FULL_HEADER_LENGTH, &(data->dec_nca_headers[i]), errorStr, MAX_CHARACTERS(errorStr))) break;
+    }
+    
+    if (i < data->content_info_cnt)
+    {
+        free(data->dec_nca_headers);
+        data->dec_nca_headers = NULL;
+    }
+}
+
+static void titlePrefetchRetrieveTicket(title_prefetch_data_t *data)
+{
+    u32 i, j;
+    char errorStr[NAME_BUF_LEN * 2] = {'\0'};
+    
+    // The UI thread performs the lookup by itself if anything goes wrong, so it gets to report the error
+    for(i = 0; i < data->content_info_cnt; i++)
+    {
+        for(j = 0; j < 0x10 && !data->dec_nca_headers[i].rights_id[j]; j++);
+        if (j == 0x10) continue;
+        
+        retrieveTitleRightsInfoEx(&(data->dec_nca_headers[i]), &(data->rights_info), errorStr, MAX_CHARACTERS(errorStr));
+        break;
+    }
+}
+
+static void titlePrefetchLoadNcas(title_prefetch_data_t *data, NcmContentStorage *ncmStorage)
+{
+    u32 i;
+    u64 ncaSize, totalSize = 0;
+    Result result;
+    
+    data->nca_data = calloc(data->content_info_cnt, sizeof(u8*));
+    if (!data->nca_data) return;
+    
+    for(i = 0; i < data->content_info_cnt; i++)
+    {
+        if (!titlePrefetchIsMemoryContent(data->content_infos[i].content_type)) continue;
+        
+        convertNcaSizeToU64(data->content_infos[i].size, &ncaSize);
+        if (!ncaSize || (totalSize + ncaSize) > TITLE_PREFETCH_MAX_NCA_DATA_SIZE) continue;
+        
+        data->nca_data[i] = malloc(ncaSize);
+        if (!data->nca_data[i]) continue;
+        
+        result = ncmContentStorageReadContentIdFile(ncmStorage, data->nca_data[i], ncaSize, &(data->content_infos[i].content_id), 0);
+        if (R_FAILED(result))
+        {
+            free(data->nca_data[i]);
+            data->nca_data[i] = NULL;
+            continue;
+        }
+        
+        totalSize += ncaSize;
+    }
+}
+
+static void *titlePrefetchThreadFunc(void *arg)
+{
+    title_prefetch_ctx_t *ctx = (title_prefetch_ctx_t*)arg;
+    title_prefetch_data_t *data = &(ctx->data);
+    
+    u32 i;
+    Result result;
+    NcmContentStorage ncmStorage;
+    char errorStr[256] = {'\0'};
+    
+    memset(&ncmStorage, 0, sizeof(NcmContentStorage));
+    
+    if (!retrieveContentInfosFromTitleEx(ctx->storage_id, ctx->meta_type, ctx->title_count, ctx->ncm_title_index, &(data->content_infos), &(data->content_info_cnt), errorStr, MAX_CHARACTERS(errorStr))) return NULL;
+    
+    data->nca_headers = malloc((u64)data->content_info_cnt * NCA_FULL_HEADER_LENGTH);
+    if (!data->nca_headers) return NULL;
+    
+    // Errors aren't reported: the UI thread retrieves the data by itself if anything goes wrong
+    result = ncmOpenContentStorage(&ncmStorage, ctx->storage_id);
+    if (R_FAILED(result)) return NULL;
+    
+    // Same read readNcaDataByContentId() performs for SD card / eMMC titles, without any UI output
+    for(i = 0; i < data->content_info_cnt; i++)
+    {
+        result = ncmContentStorageReadContentIdFile(&ncmStorage, data->nca_headers + ((u64)i * NCA_FULL_HEADER_LENGTH), NCA_FULL_HEADER_LENGTH, &(data->content_infos[i].content_id), 0);
+        if (R_FAILED(result)) break;
+    }
+    
+    ctx->success = (i == data->content_info_cnt);
+    
+    if (ctx->success)
+    {
+        titlePrefetchDecryptNcaHeaders(data);
+        if (data->dec_nca_headers) titlePrefetchRetrieveTicket(data);
+        
+        // Reads from the CNMT, NACP and legal information RomFS sections are then served from memory
+        titlePrefetchLoadNcas(data, &ncmStorage);
+    }
+    
+    ncmContentStorageClose(&ncmStorage);
+    
+    return NULL;
+}
+
+static void titlePrefetchJoin(title_prefetch_ctx_t *ctx)
+{
+    if (!ctx->running) return;
+    
+    pthread_join(ctx->thread, NULL);
+    ctx->running = false;
+}
+
+bool titlePrefetchStart(title_prefetch_ctx_t *ctx, NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 ncmTitleIndex)
+{
+    if (!ctx || (storageId != NcmStorageId_SdCard && storageId != NcmStorageId_BuiltInUser) || !titleCount || ncmTitleIndex >= titleCount) return false;
+    
+    titlePrefetchFree(ctx);
+    
+    // Keys are retrieved from FS memory at most once. This can't be done by the thread, since errors are drawn right away
+    loadNcaKeyset();
+    
+    ctx->storage_id = storageId;
+    ctx->meta_type = metaType;
+    ctx->title_count = titleCount;
+    ctx->ncm_title_index = ncmTitleIndex;
+    
+    if (pthread_create(&(ctx->thread), NULL, &titlePrefetchThreadFunc, ctx) != 0) return false;
+    
+    ctx->running = true;
+    
+    return true;
+}
+
+bool titlePrefetchTake(title_prefetch_ctx_t *ctx, NcmStorageId storageId, NcmContentMetaType metaType, u32 ncmTitleIndex, title_prefetch_data_t *outData)
+{
+    if (!ctx || !outData) return false;
+    
+    // Don't wait for a thread that's retrieving data from a different title
+    if ((!ctx->running && !ctx->success) || ctx->storage_id != storageId || ctx->meta_type != metaType || ctx->ncm_title_index != ncmTitleIndex) return false;
+    
+    titlePrefetchJoin(ctx);
+    
+    if (!ctx->success)
+    {
+        titlePrefetchFree(ctx);
+        return false;
+    }
+    
+    memcpy(outData, &(ctx->data), sizeof(title_prefetch_data_t));
+    memset(&(ctx->data), 0, sizeof(title_prefetch_data_t));
+    
+    titlePrefetchFree(ctx);
+    
+    return true;
+}
+
+void titlePrefetchFreeData(title_prefetch_data_t *data)
+{
+    if (!data) return;
+    
+    u32 i;
+    
+    if (data->nca_data)
+    {
+        for(i = 0; i < data->content_info_cnt; i++)
+        {
+            if (data->nca_data[i]) free(data->nca_data[i]);
+        }
+        
+        free(data->nca_data);
+    }
+    
+    if (data->content_infos) free(data->content_infos);
+    if (data->nca_headers) free(data->nca_headers);
+    if (data->dec_nca_headers) free(data->dec_nca_headers);
+    
+    memset(data, 0, sizeof(title_prefetch_data_t));
+}
+
+void titlePrefetchFree(title_prefetch_ctx_t *ctx)
+{
+    if (!ctx) return;
+    
+    titlePrefetchJoin(ctx);
+    titlePrefetchFreeData(&(ctx->data));
+    
+    memset(ctx, 0, sizeof(title_prefetch_ctx_t));
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#ifndef __TITLE_PREFETCH_H__
+#define __TITLE_PREFETCH_H__
+
+#include <switch.h>
+#include <pthread.h>
+#include "nca.h"
+
+#define TITLE_PREFETCH_MAX_NCA_DATA_SIZE    (u64)0x800000           // 8 MiB (8388608 bytes). Combined size of the whole NCAs loaded into memory for a single title
+
+// Data retrieved from a title by the prefetch thread. Everything but the content records is optional
+typedef struct {
+    NcmContentInfo *content_infos;
+    u32 content_info_cnt;
+    u8 *nca_headers;                                // NCA_FULL_HEADER_LENGTH bytes per content record, in the same order
+    nca_header_t *dec_nca_headers;                  // Decrypted copies of 'nca_headers'. NULL if any of them couldn't be decrypted
+    u8 **nca_data;                                  // Whole Meta, Control and LegalInformation NCAs, one pointer per content record (NULL if not loaded). Meant to be used with setNcaMemoryData()
+    title_rights_ctx rights_info;                   // Ticket from the title. Only valid if 'has_rights_id' is set
+} title_prefetch_data_t;
+
+// Retrieves the content records, the NCA headers, the ticket and the smaller NCAs (CNMT, NACP and legal information) from an installed title on a background thread
+// Used by batch mode to get the metadata from the next title while the current one is being dumped
+typedef struct {
+    bool running;                                   // True if the thread has been started and hasn't been joined yet
+    pthread_t thread;
+    NcmStorageId storage_id;
+    NcmContentMetaType meta_type;
+    u32 title_count;
+    u32 ncm_title_index;
+    bool success;
+    title_prefetch_data_t data;
+} title_prefetch_ctx_t;
+
+// Starts retrieving data from the provided title. Any data from a previous title that hasn't been taken is discarded
+// Gamecard titles aren't supported, since their data must be read through the Secure HFS0 partition opened by the UI thread
+// The NCA keyset is loaded right away if needed, so its errors can be drawn. The NCA headers are left encrypted if it can't be loaded
+bool titlePrefetchStart(title_prefetch_ctx_t *ctx, NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 ncmTitleIndex);
+
+// Waits for the background thread and hands its data over to the caller, who becomes responsible for freeing it with titlePrefetchFreeData()
+// Returns false if the prefetched title doesn't match the provided one (which is left untouched) or if its data couldn't be retrieved. The caller should then retrieve it by itself
+bool titlePrefetchTake(title_prefetch_ctx_t *ctx, NcmStorageId storageId, NcmContentMetaType metaType, u32 ncmTitleIndex, title_prefetch_data_t *outData);
+
+// Frees all buffers from prefetched data. Safe to call with data that has already been freed or that was never filled
+void titlePrefetchFreeData(title_prefetch_data_t *data);
+
+// Waits for the background thread and frees any data that hasn't been taken
+void titlePrefetchFree(title_prefetch_ctx_t *ctx);
+
+#endif
@@ -14,6 +14,7 @@
 #include <turbojpeg.h>
 
 #include "dumper.h"
+#include "dump_index.h"
 #include "fs_ext.h"
 #include "ui.h"
 #include "util.h"
@@ -89,6 +90,8 @@ static nspDumpType selectedNspDumpType;
 static bool exeFsUpdateFlag = false;
 static selectedRomFsType curRomFsType = ROMFS_TYPE_APP;
 
+static romfs_filter_t romFsMarkedEntries; // Entries marked in the RomFS section browser for filtered dumps
+
 static selectedTicketType curTikType = TICKET_TYPE_APP;
 
 static bool updatePerformed = false;
@@ -136,29 +139,30 @@ static const char *appControlsNoContent = "[ " NINTENDO_FONT_B " ] Back | [ " NI
 static const char *appControlsSdCardEmmcFull = "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_A " ] Select | [ " NINTENDO_FONT_B " ] Back | [ " NINTENDO_FONT_X " ] Batch mode | [ " NINTENDO_FONT_Y " ] Dump installed content with missing base application | [ " NINTENDO_FONT_PLUS " ] Exit";
 static const char *appControlsSdCardEmmcNoOrphan = "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_A " ] Select | [ " NINTENDO_FONT_B " ] Back | [ " NINTENDO_FONT_X " ] Batch mode | [ " NINTENDO_FONT_PLUS " ] Exit";
 static const char *appControlsSdCardEmmcNoApp = "[ " NINTENDO_FONT_B " ] Back | [ " NINTENDO_FONT_X " ] Batch mode | [ " NINTENDO_FONT_Y " ] Dump installed content with missing base application | [ " NINTENDO_FONT_PLUS " ] Exit";
-static const char *appControlsRomFs = "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_A " ] Select | [ " NINTENDO_FONT_B " ] Back | [ " NINTENDO_FONT_Y " ] Dump current directory | [ " NINTENDO_FONT_PLUS " ] Exit";
+static const char *appControlsRomFs = "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_A " ] Select | [ " NINTENDO_FONT_B " ] Back | [ " NINTENDO_FONT_R " ] Mark | [ " NINTENDO_FONT_X " ] Filtered dump | [ " NINTENDO_FONT_Y " ] Dump current directory | [ " NINTENDO_FONT_PLUS " ] Exit";
+static const char *appControlsRomFsRoot = "[ " NINTENDO_FONT_DPAD " / " NINTENDO_FONT_LSTICK " / " NINTENDO_FONT_RSTICK " ] Move | [ " NINTENDO_FONT_A " ] Select | [ " NINTENDO_FONT_B " ] Back | [ " NINTENDO_FONT_R " ] Mark | [ " NINTENDO_FONT_X " ] Filtered dump | [ " NINTENDO_FONT_PLUS " ] Exit";
 
 static const char *mainMenuItems[] = { "Dump gamecard content", "Dump installed SD card / eMMC content", "Update options" };
 static const char *gameCardMenuItems[] = { "NX Card Image (XCI) dump", "Nintendo Submission Package (NSP) dump", "HFS0 options", "ExeFS options", "RomFS options", "Dump gamecard certificate" };
-static const char *xciDumpMenuItems[] = { "Start XCI dump process", "Split output dump (FAT32 support): ", "Create directory with archive bit set: ", "Keep certificate: ", "Trim output dump: ", "CRC32 checksum calculation + dump verification: ", "Dump verification method: ", "Output naming scheme: " };
+static const char *xciDumpMenuItems[] = { "Start XCI dump process", "Split output dump (FAT32 support): ", "Create directory with archive bit set: ", "Keep certificate: ", "Trim output dump: ", "CRC32 checksum calculation + dump verification: ", "Dump verification method: ", "Output naming scheme: ", "Read back output after dumping: " };
 static const char *nspDumpGameCardMenuItems[] = { "Dump base application NSP", "Dump bundled update NSP", "Dump bundled DLC NSP" };
 static const char *nspDumpSdCardEmmcMenuItems[] = { "Dump base application NSP", "Dump installed update NSP", "Dump installed DLC NSP" };
-static const char *nspAppDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "Change NPDM RSA key/sig in Program NCA: ", "Base application to dump: ", "Output naming scheme: " };
-static const char *nspPatchDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "Change NPDM RSA key/sig in Program NCA: ", "Dump delta fragments: ", "Update to dump: ", "Output naming scheme: " };
-static const char *nspAddOnDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "DLC to dump: ", "Output naming scheme: " };
+static const char *nspAppDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "Change NPDM RSA key/sig in Program NCA: ", "Base application to dump: ", "Output naming scheme: ", "Verify ExeFS section using its hash table: ", "Read back output after dumping: " };
+static const char *nspPatchDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "Change NPDM RSA key/sig in Program NCA: ", "Dump delta fragments: ", "Update to dump: ", "Output naming scheme: ", "Verify ExeFS section using its hash table: ", "Read back output after dumping: " };
+static const char *nspAddOnDumpMenuItems[] = { "Start NSP dump process", "Split output dump (FAT32 support): ", "Verify dump using No-Intro database: ", "Remove console specific data: ", "Generate ticket-less dump: ", "DLC to dump: ", "Output naming scheme: ", "Read back output after dumping: " };
 static const char *hfs0MenuItems[] = { "Raw HFS0 partition dump", "HFS0 partition data dump", "Browse HFS0 partitions" };
 static const char *hfs0PartitionDumpType1MenuItems[] = { "Dump HFS0 partition 0 (Update)", "Dump HFS0 partition 1 (Normal)", "Dump HFS0 partition 2 (Secure)" };
 static const char *hfs0PartitionDumpType2MenuItems[] = { "Dump HFS0 partition 0 (Update)", "Dump HFS0 partition 1 (Logo)", "Dump HFS0 partition 2 (Normal)", "Dump HFS0 partition 3 (Secure)" };
 static const char *hfs0BrowserType1MenuItems[] = { "Browse HFS0 partition 0 (Update)", "Browse HFS0 partition 1 (Normal)", "Browse HFS0 partition 2 (Secure)" };
 static const char *hfs0BrowserType2MenuItems[] = { "Browse HFS0 partition 0 (Update)", "Browse HFS0 partition 1 (Logo)", "Browse HFS0 partition 2 (Normal)", "Browse HFS0 partition 3 (Secure)" };
-static const char *exeFsMenuItems[] = { "ExeFS section data dump", "Browse ExeFS section", "Split files bigger than 4 GiB (FAT32 support): ", "Save data to CFW directory (LayeredFS): ", "Use update: " };
+static const char *exeFsMenuItems[] = { "ExeFS section data dump", "Browse ExeFS section", "Split files bigger than 4 GiB (FAT32 support): ", "Save data to CFW directory (LayeredFS): ", "Use update: ", "Output as a single TAR archive: ", "Verify data using the PFS0 hash table: ", "Export decompressed NSO images: " };
 static const char *exeFsSectionDumpMenuItems[] = { "Start ExeFS data dump process", "Base application to dump: ", "Use update: " };
 static const char *exeFsSectionBrowserMenuItems[] = { "Browse ExeFS section", "Base application to browse: ", "Use update: " };
-static const char *romFsMenuItems[] = { "RomFS section data dump", "Browse RomFS section", "Split files bigger than 4 GiB (FAT32 support): ", "Save data to CFW directory (LayeredFS): ", "Use update/DLC: " };
+static const char *romFsMenuItems[] = { "RomFS section data dump", "Browse RomFS section", "Split files bigger than 4 GiB (FAT32 support): ", "Save data to CFW directory (LayeredFS): ", "Use update/DLC: ", "Output as a single TAR archive: ", "Verify data using the IVFC hash tree: " };
 static const char *romFsSectionDumpMenuItems[] = { "Start RomFS data dump process", "Base application to dump: ", "Use update/DLC: " };
 static const char *romFsSectionBrowserMenuItems[] = { "Browse RomFS section", "Base application to browse: ", "Use update/DLC: " };
 static const char *sdCardEmmcMenuItems[] = { "Nintendo Submission Package (NSP) dump", "ExeFS options", "RomFS options", "Ticket options" };
-static const char *batchModeMenuItems[] = { "Start batch dump process", "Dump base applications: ", "Dump updates: ", "Dump DLCs: ", "Split output dumps (FAT32 support): ", "Remove console specific data: ", "Generate ticket-less dumps: ", "Change NPDM RSA key/sig in Program NCA: ", "Dump delta fragments from updates: ", "Skip already dumped titles: ", "Remember dumped titles: ", "Halt dump process on errors: ", "Output naming scheme: ", "Source storage: " };
+static const char *batchModeMenuItems[] = { "Start batch dump process", "Dump base applications: ", "Dump updates: ", "Dump DLCs: ", "Split output dumps (FAT32 support): ", "Remove console specific data: ", "Generate ticket-less dumps: ", "Change NPDM RSA key/sig in Program NCA: ", "Dump delta fragments from updates: ", "Skip already dumped titles: ", "Remember dumped titles: ", "Halt dump process on errors: ", "Output naming scheme: ", "Source storage: ", "Use shared NCA store: " };
 static const char *ticketMenuItems[] = { "Start ticket dump", "Remove console specific data: ", "Use ticket from title: " };
 static const char *updateMenuItems[] = { "Update NSWDB.COM XML database", "Update application" };
 
@@ -961,6 +965,49 @@ void uiSetState(UIState state)
     exeFsAndRomFsSelectorStr[0] = '\0';
 }
 
+// Looks for a dumped NSP from a title. The output directory is only checked if the dump index can't tell whether the NSP holds console specific data
+static bool checkIfNspTitleWasDumped(nspDumpType selectedNspDumpType, u32 titleIndex, bool *outConsoleData)
+{
+    u32 i;
+    u8 indexFlags = 0;
+    bool available = false;
+    char *dumpName = NULL;
+    char dumpPath[NAME_BUF_LEN] = {'\0'};
+    
+    *outConsoleData = false;
+    
+    if (dumpIndexCheckNspTitle(selectedNspDumpType, titleIndex, &indexFlags, &available))
+    {
+        // Remembered titles stay in the index after their NSP has been removed
+        if (!available) return false;
+        
+        if (!(indexFlags & DUMP_INDEX_FLAG_IMPORTED))
+        {
+            *outConsoleData = ((indexFlags & DUMP_INDEX_FLAG_CONSOLE_DATA) != 0);
+            return true;
+        }
+    }
+    
+    for(i = 0; i < 2; i++)
+    {
+        dumpName = generateNSPDumpName(selectedNspDumpType, titleIndex, (i == 1));
+        if (!dumpName) continue;
+        
+        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
+        
+        free(dumpName);
+        dumpName = NULL;
+        
+        if (checkIfFileExists(dumpPath))
+        {
+            *outConsoleData = checkIfDumpedNspContainsConsoleData(dumpPath);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
 UIState uiGetState()
 {
     return uiState;
@@ -1000,9 +1047,9 @@ UIResult uiProcess()
                 uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, appControlsCommon);
                 break;
             case MENUTYPE_GAMECARD:
-                if (uiState == stateRomFsSectionBrowser && strlen(curRomFsPath) > 1)
+                if (uiState == stateRomFsSectionBrowser)
                 {
-                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, appControlsRomFs);
+                    uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, (strlen(curRomFsPath) > 1 ? appControlsRomFs : appControlsRomFsRoot));
                 } else {
                     uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, (!gameCardInfo.isInserted ? appControlsNoContent : (titleAppCount > 1 ? appControlsGameCardMultiApp : appControlsCommon)));
                 }
@@ -1023,9 +1070,9 @@ UIResult uiProcess()
                                 
                                 uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, "Hint: installed updates/DLCs for gamecard titles can be found in the orphan title list (press the " NINTENDO_FONT_Y " button).");
                             } else
-                            if (uiState == stateRomFsSectionBrowser && strlen(curRomFsPath) > 1)
+                            if (uiState == stateRomFsSectionBrowser)
                             {
-                                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, appControlsRomFs);
+                                uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, (strlen(curRomFsPath) > 1 ? appControlsRomFs : appControlsRomFsRoot));
                             } else {
                                 uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, appControlsSdCardEmmcNoOrphan);
                             }
@@ -1038,9 +1085,9 @@ UIResult uiProcess()
                             }
                         }
                     } else {
-                        if (uiState == stateRomFsSectionBrowser && strlen(curRomFsPath) > 1)
+                        if (uiState == stateRomFsSectionBrowser)
                         {
-                            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, appControlsRomFs);
+                            uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, (strlen(curRomFsPath) > 1 ? appControlsRomFs : appControlsRomFsRoot));
                         } else {
                             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_RGB, appControlsCommon);
                         }
@@ -1319,7 +1366,7 @@ UIResult uiProcess()
                 // Look for dumped content in the SD card
                 char *dumpName = NULL;
                 char dumpPath[NAME_BUF_LEN] = {'\0'}, tmpStr[64] = {'\0'};
-                bool dumpedXci = false, dumpedXciCertificate = false, dumpedBase = false, dumpedBaseConsoleData = false;
+                bool dumpedXci = false, dumpedXciCertificate = false, dumpedBase = false, dumpedBaseConsoleData = false, dumpedConsoleData = false;
                 
                 u32 patchCnt = 0, addOnCnt = 0;
                 u32 patchCntConsoleData = 0, addOnCntConsoleData = 0;
@@ -1356,45 +1403,17 @@ UIResult uiProcess()
                 // Now search for dumped NSPs
                 
                 // Look for a dumped base application
-                for(i = 0; i < 2; i++)
-                {
-                    dumpName = generateNSPDumpName(DUMP_APP_NSP, selectedAppInfoIndex, (i == 1));
-                    if (!dumpName) continue;
-                    
-                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-                    
-                    free(dumpName);
-                    dumpName = NULL;
-                    
-                    if (checkIfFileExists(dumpPath))
-                    {
-                        dumpedBase = true;
-                        dumpedBaseConsoleData = checkIfDumpedNspContainsConsoleData(dumpPath);
-                        break;
-                    }
-                }
+                dumpedBase = checkIfNspTitleWasDumped(DUMP_APP_NSP, selectedAppInfoIndex, &dumpedBaseConsoleData);
                 
                 // Look for dumped updates
                 for(patch = 0; patch < titlePatchCount; patch++)
                 {
                     if (!checkIfPatchOrAddOnBelongsToBaseApplication(patch, selectedAppInfoIndex, false)) continue;
                     
-                    for(i = 0; i < 2; i++)
+                    if (checkIfNspTitleWasDumped(DUMP_PATCH_NSP, patch, &dumpedConsoleData))
                     {
-                        dumpName = generateNSPDumpName(DUMP_PATCH_NSP, patch, (i == 1));
-                        if (!dumpName) continue;
-                        
-                        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-                        
-                        free(dumpName);
-                        dumpName = NULL;
-                        
-                        if (checkIfFileExists(dumpPath))
-                        {
-                            patchCnt++;
-                            if (checkIfDumpedNspContainsConsoleData(dumpPath)) patchCntConsoleData++;
-                            break;
-                        }
+                        patchCnt++;
+                        if (dumpedConsoleData) patchCntConsoleData++;
                     }
                 }
                 
@@ -1403,25 +1422,16 @@ UIResult uiProcess()
                 {
                     if (!checkIfPatchOrAddOnBelongsToBaseApplication(addon, selectedAppInfoIndex, true)) continue;
                     
-                    for(i = 0; i < 2; i++)
+                    if (checkIfNspTitleWasDumped(DUMP_ADDON_NSP, addon, &dumpedConsoleData))
                     {
-                        dumpName = generateNSPDumpName(DUMP_ADDON_NSP, addon, (i == 1));
-                        if (!dumpName) continue;
-                        
-                        snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-                        
-                        free(dumpName);
-                        dumpName = NULL;
-                        
-                        if (checkIfFileExists(dumpPath))
-                        {
-                            addOnCnt++;
-                            if (checkIfDumpedNspContainsConsoleData(dumpPath)) addOnCntConsoleData++;
-                            break;
-                        }
+                        addOnCnt++;
+                        if (dumpedConsoleData) addOnCntConsoleData++;
                     }
                 }
                 
+                // Entries from removed NSPs may have been dropped from the dump index
+                dumpIndexSave();
+                
                 if (!dumpedXci && !dumpedBase && !patchCnt && !addOnCnt)
                 {
                     strcat(dumpedContentInfoStr, "NONE");
@@ -1517,41 +1527,28 @@ UIResult uiProcess()
             if (!strlen(dumpedContentInfoStr))
             {
                 // Look for dumped content in the SD card
-                char *dumpName = NULL;
-                char dumpPath[NAME_BUF_LEN] = {'\0'};
-                bool dumpedOrphan = false;
+                bool dumpedOrphanConsoleData = false;
                 nspDumpType orphanDumpType = (orphanEntries[orphanListCursor].type == ORPHAN_ENTRY_TYPE_PATCH ? DUMP_PATCH_NSP : DUMP_ADDON_NSP);
                 u32 orphanIndex = (orphanEntries[orphanListCursor].type == ORPHAN_ENTRY_TYPE_PATCH ? selectedPatchIndex : selectedAddOnIndex);
                 
                 snprintf(dumpedContentInfoStr, MAX_CHARACTERS(dumpedContentInfoStr), "Title already dumped: ");
                 
-                for(i = 0; i < 2; i++)
+                bool dumpedOrphan = checkIfNspTitleWasDumped(orphanDumpType, orphanIndex, &dumpedOrphanConsoleData);
+                dumpIndexSave();
+                
+                if (dumpedOrphan)
                 {
-                    dumpName = generateNSPDumpName(orphanDumpType, orphanIndex, (i == 1));
-                    if (!dumpName) continue;
-                    
-                    snprintf(dumpPath, MAX_CHARACTERS(dumpPath), "%s%s.nsp", NSP_DUMP_PATH, dumpName);
-                    
-                    free(dumpName);
-                    dumpName = NULL;
+                    strcat(dumpedContentInfoStr, "Yes");
                     
-                    dumpedOrphan = checkIfFileExists(dumpPath);
-                    if (dumpedOrphan)
+                    if (dumpedOrphanConsoleData)
                     {
-                        strcat(dumpedContentInfoStr, "Yes");
-                        
-                        if (checkIfDumpedNspContainsConsoleData(dumpPath))
-                        {
-                            strcat(dumpedContentInfoStr, " (with console data)");
-                        } else {
-                            strcat(dumpedContentInfoStr, " (without console data)");
-                        }
-                        
-                        break;
+                        strcat(dumpedContentInfoStr, " (with console data)");
+                    } else {
+                        strcat(dumpedContentInfoStr, " (without console data)");
                     }
+                } else {
+                    strcat(dumpedContentInfoStr, "No");
                 }
-                
-                if (!dumpedOrphan) strcat(dumpedContentInfoStr, "No");
             }
             
             uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_SUCCESS_RGB, dumpedContentInfoStr);
@@ -2013,10 +2010,16 @@ UIResult uiProcess()
                         uiDrawString(FB_WIDTH - (8 + uiGetStrWidth(strbuf)), ypos, HIGHLIGHT_FONT_COLOR_RGB, strbuf);
                     }
                 } else {
-                    uiDrawString(xpos, ypos, FONT_COLOR_RGB, menu[i]);
-                    
                     u32 idx = ((uiState == stateRomFsSectionBrowser && strlen(curRomFsPath) <= 1) ? (i + 1) : i); // Adjust index if we're at the root directory
                     
+                    // Use a different color for entries marked for a filtered RomFS dump
+                    if (uiState == stateRomFsSectionBrowser && romFsMarkedEntries.entry_cnt && getRomFsBrowserEntryPath(idx, (curRomFsType == ROMFS_TYPE_PATCH), strbuf, MAX_ELEMENTS(strbuf)) && romFsFilterHasLiteralPath(&romFsMarkedEntries, strbuf))
+                    {
+                        uiDrawString(xpos, ypos, FONT_COLOR_SUCCESS_RGB, menu[i]);
+                    } else {
+                        uiDrawString(xpos, ypos, FONT_COLOR_RGB, menu[i]);
+                    }
+                    
                     if (uiState == stateHfs0Browser || uiState == stateExeFsSectionBrowser || (uiState == stateRomFsSectionBrowser && romFsBrowserEntries[idx].type == ROMFS_ENTRY_FILE))
                     {
                         snprintf(strbuf, MAX_CHARACTERS(strbuf), "(%s)", ((uiState == stateHfs0Browser || uiState == stateExeFsSectionBrowser) ? hfs0ExeFsEntriesSizes[idx].sizeStr : romFsBrowserEntries[idx].sizeInfo.sizeStr));
@@ -2055,6 +2058,9 @@ UIResult uiProcess()
                         case 7: // Output naming scheme
                             uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, dumpCfg.xciDumpCfg.useBrackets, !dumpCfg.xciDumpCfg.useBrackets, FONT_COLOR_RGB, (dumpCfg.xciDumpCfg.useBrackets ? xciNamingSchemes[1] : xciNamingSchemes[0]));
                             break;
+                        case 8: // Read back output after dumping
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.xciDumpCfg.verifyOutput, !dumpCfg.xciDumpCfg.verifyOutput, (dumpCfg.xciDumpCfg.verifyOutput ? 0 : 255), (dumpCfg.xciDumpCfg.verifyOutput ? 255 : 0), 0, (dumpCfg.xciDumpCfg.verifyOutput ? "Yes" : "No"));
+                            break;
                         default:
                             break;
                     }
@@ -2167,11 +2173,35 @@ UIResult uiProcess()
                                 rightArrowCondition = ((menuType == MENUTYPE_GAMECARD && titlePatchCount > 0 && selectedPatchIndex < (titlePatchCount - 1)) || (menuType == MENUTYPE_SDCARD_EMMC && !orphanMode && retrieveNextPatchOrAddOnIndexFromBaseApplication(selectedPatchIndex, selectedAppInfoIndex, false) != selectedPatchIndex));
                                 
                                 uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_RGB, titleSelectorStr);
+                            } else
+                            if (uiState == stateNspAddOnDumpMenu)
+                            {
+                                uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.nspDumpCfg.verifyOutput, !dumpCfg.nspDumpCfg.verifyOutput, (dumpCfg.nspDumpCfg.verifyOutput ? 0 : 255), (dumpCfg.nspDumpCfg.verifyOutput ? 255 : 0), 0, (dumpCfg.nspDumpCfg.verifyOutput ? "Yes" : "No"));
                             }
                             
                             break;
-                        case 8: // Output naming scheme (update)
-                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, dumpCfg.nspDumpCfg.useBrackets, !dumpCfg.nspDumpCfg.useBrackets, FONT_COLOR_RGB, (dumpCfg.nspDumpCfg.useBrackets ? nspNamingSchemes[1] : nspNamingSchemes[0]));
+                        case 8: // Verify ExeFS section (base application) || Output naming scheme (update)
+                            if (uiState == stateNspAppDumpMenu)
+                            {
+                                uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.nspDumpCfg.verifyExeFsHashes, !dumpCfg.nspDumpCfg.verifyExeFsHashes, (dumpCfg.nspDumpCfg.verifyExeFsHashes ? 0 : 255), (dumpCfg.nspDumpCfg.verifyExeFsHashes ? 255 : 0), 0, (dumpCfg.nspDumpCfg.verifyExeFsHashes ? "Yes" : "No"));
+                            } else
+                            if (uiState == stateNspPatchDumpMenu)
+                            {
+                                uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, dumpCfg.nspDumpCfg.useBrackets, !dumpCfg.nspDumpCfg.useBrackets, FONT_COLOR_RGB, (dumpCfg.nspDumpCfg.useBrackets ? nspNamingSchemes[1] : nspNamingSchemes[0]));
+                            }
+                            break;
+                        case 9: // Read back output after dumping (base application) || Verify ExeFS section (update)
+                            if (uiState == stateNspAppDumpMenu)
+                            {
+                                uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.nspDumpCfg.verifyOutput, !dumpCfg.nspDumpCfg.verifyOutput, (dumpCfg.nspDumpCfg.verifyOutput ? 0 : 255), (dumpCfg.nspDumpCfg.verifyOutput ? 255 : 0), 0, (dumpCfg.nspDumpCfg.verifyOutput ? "Yes" : "No"));
+                            } else
+                            if (uiState == stateNspPatchDumpMenu)
+                            {
+                                uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.nspDumpCfg.verifyExeFsHashes, !dumpCfg.nspDumpCfg.verifyExeFsHashes, (dumpCfg.nspDumpCfg.verifyExeFsHashes ? 0 : 255), (dumpCfg.nspDumpCfg.verifyExeFsHashes ? 255 : 0), 0, (dumpCfg.nspDumpCfg.verifyExeFsHashes ? "Yes" : "No"));
+                            }
+                            break;
+                        case 10: // Read back output after dumping (update)
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.nspDumpCfg.verifyOutput, !dumpCfg.nspDumpCfg.verifyOutput, (dumpCfg.nspDumpCfg.verifyOutput ? 0 : 255), (dumpCfg.nspDumpCfg.verifyOutput ? 255 : 0), 0, (dumpCfg.nspDumpCfg.verifyOutput ? "Yes" : "No"));
                             break;
                         default:
                             break;
@@ -2240,6 +2270,10 @@ UIResult uiProcess()
                             
                             uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_RGB, (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_ALL ? "All (SD card + eMMC)" : (dumpCfg.batchDumpCfg.batchModeSrc == BATCH_SOURCE_SDCARD ? "SD card" : "eMMC")));
                             
+                            break;
+                        case 14: // Use shared NCA store
+                            // SD card and eMMC titles are only read in parallel in NCA store mode. Regular NSP output is always dumped one title at a time
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, dumpCfg.batchDumpCfg.useNcaStore, !dumpCfg.batchDumpCfg.useNcaStore, (dumpCfg.batchDumpCfg.useNcaStore ? 0 : 255), (dumpCfg.batchDumpCfg.useNcaStore ? 255 : 0), 0, (dumpCfg.batchDumpCfg.useNcaStore ? "Yes (parallel SD card + eMMC reads with \"All\" source)" : "No (regular NSPs, no parallel reads)"));
                             break;
                         default:
                             break;
@@ -2285,6 +2319,15 @@ UIResult uiProcess()
                                 uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_ERROR_RGB, "No");
                             }
                             
+                            break;
+                        case 5: // Output as a single TAR archive
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.exeFsDumpCfg.useTarArchive, !dumpCfg.exeFsDumpCfg.useTarArchive, (dumpCfg.exeFsDumpCfg.useTarArchive ? 0 : 255), (dumpCfg.exeFsDumpCfg.useTarArchive ? 255 : 0), 0, (dumpCfg.exeFsDumpCfg.useTarArchive ? "Yes" : "No"));
+                            break;
+                        case 6: // Verify data using the PFS0 hash table
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.exeFsDumpCfg.verifyHashes, !dumpCfg.exeFsDumpCfg.verifyHashes, (dumpCfg.exeFsDumpCfg.verifyHashes ? 0 : 255), (dumpCfg.exeFsDumpCfg.verifyHashes ? 255 : 0), 0, (dumpCfg.exeFsDumpCfg.verifyHashes ? "Yes" : "No"));
+                            break;
+                        case 7: // Export decompressed NSO images
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.exeFsDumpCfg.exportNsoImages, !dumpCfg.exeFsDumpCfg.exportNsoImages, (dumpCfg.exeFsDumpCfg.exportNsoImages ? 0 : 255), (dumpCfg.exeFsDumpCfg.exportNsoImages ? 255 : 0), 0, (dumpCfg.exeFsDumpCfg.exportNsoImages ? "Yes" : "No"));
                             break;
                         default:
                             break;
@@ -2394,6 +2437,12 @@ UIResult uiProcess()
                                 uiPrintOption(xpos, ypos, OPTIONS_X_END_POS_NSP, leftArrowCondition, rightArrowCondition, FONT_COLOR_ERROR_RGB, "No");
                             }
                             
+                            break;
+                        case 5: // Output as a single TAR archive
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.romFsDumpCfg.useTarArchive, !dumpCfg.romFsDumpCfg.useTarArchive, (dumpCfg.romFsDumpCfg.useTarArchive ? 0 : 255), (dumpCfg.romFsDumpCfg.useTarArchive ? 255 : 0), 0, (dumpCfg.romFsDumpCfg.useTarArchive ? "Yes" : "No"));
+                            break;
+                        case 6: // Verify data using the IVFC hash tree
+                            uiPrintOption(xpos, ypos, OPTIONS_X_END_POS, dumpCfg.romFsDumpCfg.verifyHashes, !dumpCfg.romFsDumpCfg.verifyHashes, (dumpCfg.romFsDumpCfg.verifyHashes ? 0 : 255), (dumpCfg.romFsDumpCfg.verifyHashes ? 255 : 0), 0, (dumpCfg.romFsDumpCfg.verifyHashes ? "Yes" : "No"));
                             break;
                         default:
                             break;
@@ -2578,6 +2627,18 @@ UIResult uiProcess()
                 uiDrawString(STRING_X_POS, ypos, FONT_COLOR_RGB, "Dumps delta fragments for the selected update(s), if available. These are commonly excluded - they serve no real purpose in output dumps.");
             }
             
+            // Print information about the "Verify ExeFS section using its hash table" option
+            if ((uiState == stateNspAppDumpMenu && cursor == 8) || (uiState == stateNspPatchDumpMenu && cursor == 9))
+            {
+                uiDrawString(STRING_X_POS, ypos, FONT_COLOR_RGB, "Checks every ExeFS block from the Program NCA against its hash table while it is being dumped. Skipped if a sequential dump session resumes halfway through that NCA.");
+            }
+            
+            // Print information about the "Export decompressed NSO images" option
+            if (uiState == stateExeFsMenu && cursor == 7)
+            {
+                uiDrawString(STRING_X_POS, ypos, FONT_COLOR_RGB, "Saves a decompressed copy of every NSO as \"[name].bin\" and checks each segment against its hash from the NSO header. Ignored for TAR archives and LayeredFS directories.");
+            }
+            
             // Print information about the "Split files bigger than 4 GiB (FAT32 support)" option
             if ((uiState == stateExeFsMenu || uiState == stateRomFsMenu) && cursor == 2)
             {
@@ -2685,6 +2746,9 @@ UIResult uiProcess()
                         case 7: // Output naming scheme
                             dumpCfg.xciDumpCfg.useBrackets = false;
                             break;
+                        case 8: // Read back output after dumping
+                            dumpCfg.xciDumpCfg.verifyOutput = false;
+                            break;
                         default:
                             break;
                     }
@@ -2719,6 +2783,9 @@ UIResult uiProcess()
                         case 7: // Output naming scheme
                             dumpCfg.xciDumpCfg.useBrackets = true;
                             break;
+                        case 8: // Read back output after dumping
+                            dumpCfg.xciDumpCfg.verifyOutput = true;
+                            break;
                         default:
                             break;
                     }
@@ -2872,10 +2939,34 @@ UIResult uiProcess()
                                         }
                                     }
                                 }
+                            } else
+                            if (uiState == stateNspAddOnDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.verifyOutput = false;
+                            }
+                            break;
+                        case 8: // Verify ExeFS section (base application) || Output naming scheme (update)
+                            if (uiState == stateNspAppDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.verifyExeFsHashes = false;
+                            } else
+                            if (uiState == stateNspPatchDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.useBrackets = false;
+                            }
+                            break;
+                        case 9: // Read back output after dumping (base application) || Verify ExeFS section (update)
+                            if (uiState == stateNspAppDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.verifyOutput = false;
+                            } else
+                            if (uiState == stateNspPatchDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.verifyExeFsHashes = false;
                             }
                             break;
-                        case 8: // Output naming scheme (update)
-                            dumpCfg.nspDumpCfg.useBrackets = false;
+                        case 10: // Read back output after dumping (update)
+                            dumpCfg.nspDumpCfg.verifyOutput = false;
                             break;
                         default:
                             break;
@@ -2977,10 +3068,34 @@ UIResult uiProcess()
                                         }
                                     }
                                 }
+                            } else
+                            if (uiState == stateNspAddOnDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.verifyOutput = true;
+                            }
+                            break;
+                        case 8: // Verify ExeFS section (base application) || Output naming scheme (update)
+                            if (uiState == stateNspAppDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.verifyExeFsHashes = true;
+                            } else
+                            if (uiState == stateNspPatchDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.useBrackets = true;
+                            }
+                            break;
+                        case 9: // Read back output after dumping (base application) || Verify ExeFS section (update)
+                            if (uiState == stateNspAppDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.verifyOutput = true;
+                            } else
+                            if (uiState == stateNspPatchDumpMenu)
+                            {
+                                dumpCfg.nspDumpCfg.verifyExeFsHashes = true;
                             }
                             break;
-                        case 8: // Output naming scheme (update)
-                            dumpCfg.nspDumpCfg.useBrackets = true;
+                        case 10: // Read back output after dumping (update)
+                            dumpCfg.nspDumpCfg.verifyOutput = true;
                             break;
                         default:
                             break;
@@ -3078,6 +3193,9 @@ UIResult uiProcess()
                                 }
                             }
                             break;
+                        case 14: // Use shared NCA store
+                            dumpCfg.batchDumpCfg.useNcaStore = false;
+                            break;
                         default:
                             break;
                     }
@@ -3152,6 +3270,9 @@ UIResult uiProcess()
                                 }
                             }
                             break;
+                        case 14: // Use shared NCA store
+                            dumpCfg.batchDumpCfg.useNcaStore = true;
+                            break;
                         default:
                             break;
                     }
@@ -3236,6 +3357,15 @@ UIResult uiProcess()
                                 }
                             }
                             break;
+                        case 5: // Output as a single TAR archive
+                            dumpCfg.exeFsDumpCfg.useTarArchive = false;
+                            break;
+                        case 6: // Verify data using the PFS0 hash table
+                            dumpCfg.exeFsDumpCfg.verifyHashes = false;
+                            break;
+                        case 7: // Export decompressed NSO images
+                            dumpCfg.exeFsDumpCfg.exportNsoImages = false;
+                            break;
                         default:
                             break;
                     }
@@ -3272,6 +3402,15 @@ UIResult uiProcess()
                                 }
                             }
                             break;
+                        case 5: // Output as a single TAR archive
+                            dumpCfg.exeFsDumpCfg.useTarArchive = true;
+                            break;
+                        case 6: // Verify data using the PFS0 hash table
+                            dumpCfg.exeFsDumpCfg.verifyHashes = true;
+                            break;
+                        case 7: // Export decompressed NSO images
+                            dumpCfg.exeFsDumpCfg.exportNsoImages = true;
+                            break;
                         default:
                             break;
                     }
@@ -3471,6 +3610,12 @@ UIResult uiProcess()
                                 }
                             }
                             break;
+                        case 5: // Output as a single TAR archive
+                            dumpCfg.romFsDumpCfg.useTarArchive = false;
+                            break;
+                        case 6: // Verify data using the IVFC hash tree
+                            dumpCfg.romFsDumpCfg.verifyHashes = false;
+                            break;
                         default:
                             break;
                     }
@@ -3532,6 +3677,12 @@ UIResult uiProcess()
                                 }
                             }
                             break;
+                        case 5: // Output as a single TAR archive
+                            dumpCfg.romFsDumpCfg.useTarArchive = true;
+                            break;
+                        case 6: // Verify data using the IVFC hash tree
+                            dumpCfg.romFsDumpCfg.verifyHashes = true;
+                            break;
                         default:
                             break;
                     }
@@ -4151,6 +4302,7 @@ UIResult uiProcess()
                             freeFilenameBuffer();
                             if (curRomFsType == ROMFS_TYPE_PATCH) freeBktrContext();
                             freeRomFsContext();
+                            romFsFilterFree(&romFsMarkedEntries);
                             
                             res = ((menuType == MENUTYPE_GAMECARD && titleAppCount > 1) ? resultShowRomFsSectionBrowserMenu : resultShowRomFsMenu);
                         }
@@ -4189,6 +4341,11 @@ UIResult uiProcess()
                 // Special action #2
                 if (keysDown & KEY_X)
                 {
+                    if (uiState == stateRomFsSectionBrowser)
+                    {
+                        // RomFS section browser: dump marked entries and entries matching the patterns from the filter file
+                        res = resultRomFsSectionBrowserDumpFiltered;
+                    } else
                     if (uiState == stateSdCardEmmcMenu && (titleAppCount || titlePatchCount || titleAddOnCount))
                     {
                         // Batch mode
@@ -4204,6 +4361,26 @@ UIResult uiProcess()
                     }
                 }
                 
+                // Special action #3
+                if (keysDown & KEY_R)
+                {
+                    if (uiState == stateRomFsSectionBrowser && menu && menuItemsCount)
+                    {
+                        // RomFS section browser: mark/unmark the selected entry for a filtered dump
+                        u32 idx = (strlen(curRomFsPath) <= 1 ? ((u32)cursor + 1) : (u32)cursor); // Adjust index if we're at the root directory
+                        
+                        if (getRomFsBrowserEntryPath(idx, (curRomFsType == ROMFS_TYPE_PATCH), strbuf, MAX_ELEMENTS(strbuf)))
+                        {
+                            if (romFsFilterToggleLiteralPath(&romFsMarkedEntries, strbuf))
+                            {
+                                res = resultShowRomFsSectionBrowser;
+                            } else {
+                                uiStatusMsg("Unable to mark entry. Max marked entry count: %u.", ROMFS_FILTER_MAX_PATTERNS);
+                            }
+                        }
+                    }
+                }
+                
                 if (menu && menuItemsCount)
                 {
                     // Go up
@@ -4481,7 +4658,7 @@ UIResult uiProcess()
                 {
                     if (scrollAmount > 0)
                     {
-                        cursor = (scrollWithKeysDown ? 0 : 12);
+                        cursor++;
                     } else
                     if (scrollAmount < 0)
                     {
@@ -4495,11 +4672,11 @@ UIResult uiProcess()
                 {
                     if (scrollAmount > 0)
                     {
-                        cursor = (scrollWithKeysDown ? 0 : 1);
+                        cursor++;
                     } else
                     if (scrollAmount < 0)
                     {
-                        cursor = (scrollWithKeysDown ? 1 : 0);
+                        cursor--;
                     }
                 }
                 
@@ -4522,11 +4699,11 @@ UIResult uiProcess()
                 {
                     if (scrollAmount > 0)
                     {
-                        cursor = (scrollWithKeysDown ? 0 : 1);
+                        cursor++;
                     } else
                     if (scrollAmount < 0)
                     {
-                        cursor = (scrollWithKeysDown ? 1 : 0);
+                        cursor--;
                     }
                 }
                 
@@ -4611,6 +4788,9 @@ UIResult uiProcess()
         breaks++;
         
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", xciDumpMenuItems[7], (dumpCfg.xciDumpCfg.useBrackets ? xciNamingSchemes[1] : xciNamingSchemes[0]));
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", xciDumpMenuItems[8], (dumpCfg.xciDumpCfg.verifyOutput ? "Yes" : "No"));
         breaks += 2;
         
         uiRefreshDisplay();
@@ -4671,6 +4851,10 @@ UIResult uiProcess()
                 snprintf(tmp, MAX_CHARACTERS(tmp), "%s%s", menu[6], (dumpCfg.nspDumpCfg.dumpDeltaFragments ? "Yes" : "No"));
                 strcat(strbuf, tmp);
             }
+            
+            strcat(strbuf, " | ");
+            snprintf(tmp, MAX_CHARACTERS(tmp), "%s%s", (selectedNspDumpType == DUMP_APP_NSP ? menu[8] : menu[9]), (dumpCfg.nspDumpCfg.verifyExeFsHashes ? "Yes" : "No"));
+            strcat(strbuf, tmp);
         }
         
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, strbuf);
@@ -4693,6 +4877,9 @@ UIResult uiProcess()
         breaks++;
         
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", (selectedNspDumpType == DUMP_ADDON_NSP ? menu[6] : (selectedNspDumpType == DUMP_APP_NSP ? menu[7] : menu[8])), (dumpCfg.nspDumpCfg.useBrackets ? nspNamingSchemes[1] : nspNamingSchemes[0]));
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", (selectedNspDumpType == DUMP_ADDON_NSP ? menu[7] : (selectedNspDumpType == DUMP_APP_NSP ? menu[9] : menu[10])), (dumpCfg.nspDumpCfg.verifyOutput ? "Yes" : "No"));
         breaks += 2;
         
         uiRefreshDisplay();
@@ -4780,6 +4967,9 @@ UIResult uiProcess()
             breaks++;
         }
         
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s", menu[14], (dumpCfg.batchDumpCfg.useNcaStore ? "Yes" : "No"));
+        breaks++;
+        
         breaks++;
         uiRefreshDisplay();
         
@@ -5035,6 +5225,9 @@ UIResult uiProcess()
         
         bool romfs_fail = false;
         
+        // Marked entries only apply to the RomFS section being browsed
+        romFsFilterFree(&romFsMarkedEntries);
+        
         if (readNcaRomFsSection(curIndex, curRomFsType, -1) == 0)
         {
             if (getRomFsFileList(0, (curRomFsType == ROMFS_TYPE_PATCH)))
@@ -5197,6 +5390,46 @@ UIResult uiProcess()
         updateFreeSpace();
         res = resultShowRomFsSectionBrowser;
     } else
+    if (uiState == stateRomFsSectionBrowserDumpFiltered)
+    {
+        u32 curIndex = 0;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "Filtered RomFS Dump: marked entries + \"%s\" (RomFS)", strchr(ROMFS_FILTER_PATH, '/'));
+        breaks++;
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, "%s%s | %s%s", romFsMenuItems[2], (dumpCfg.romFsDumpCfg.isFat32 ? "Yes" : "No"), romFsMenuItems[3], (dumpCfg.romFsDumpCfg.useLayeredFSDir ? "Yes" : "No"));
+        breaks++;
+        
+        switch(curRomFsType)
+        {
+            case ROMFS_TYPE_APP:
+                snprintf(strbuf, MAX_CHARACTERS(strbuf), "Base application: %s v%s", baseAppEntries[selectedAppIndex].name, baseAppEntries[selectedAppIndex].versionStr);
+                curIndex = selectedAppIndex;
+                break;
+            case ROMFS_TYPE_PATCH:
+                retrieveDescriptionForPatchOrAddOn(selectedPatchIndex, false, true, "Update: ", strbuf, MAX_CHARACTERS(strbuf));
+                curIndex = selectedPatchIndex;
+                break;
+            case ROMFS_TYPE_ADDON:
+                retrieveDescriptionForPatchOrAddOn(selectedAddOnIndex, true, true, "DLC: ", strbuf, MAX_CHARACTERS(strbuf));
+                curIndex = selectedAddOnIndex;
+                break;
+            default:
+                break;
+        }
+        
+        uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, strbuf);
+        breaks += 2;
+        
+        uiRefreshDisplay();
+        
+        dumpFilteredRomFsSectionData(curIndex, curRomFsType, &(dumpCfg.romFsDumpCfg), &romFsMarkedEntries);
+        
+        waitForButtonPress();
+        
+        updateFreeSpace();
+        res = resultShowRomFsSectionBrowser;
+    } else
     if (uiState == stateDumpGameCardCertificate)
     {
         uiDrawString(STRING_X_POS, STRING_Y_POS(breaks), FONT_COLOR_TITLE_RGB, gameCardMenuItems[5]);
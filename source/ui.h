@@ -99,6 +99,7 @@ typedef enum {
     resultRomFsSectionBrowserChangeDir,
     resultRomFsSectionBrowserCopyFile,
     resultRomFsSectionBrowserCopyDir,
+    resultRomFsSectionBrowserDumpFiltered,
     resultDumpGameCardCertificate,
     resultShowSdCardEmmcMenu,
     resultShowSdCardEmmcTitleMenu,
@@ -148,6 +149,7 @@ typedef enum {
     stateRomFsSectionBrowserChangeDir,
     stateRomFsSectionBrowserCopyFile,
     stateRomFsSectionBrowserCopyDir,
+    stateRomFsSectionBrowserDumpFiltered,
     stateDumpGameCardCertificate,
     stateSdCardEmmcMenu,
     stateSdCardEmmcTitleMenu,
@@ -17,9 +17,12 @@
 #include <json-c/json.h>
 #include <pthread.h>
 
+#include "chunk_tuner.h"
 #include "dumper.h"
+#include "dump_index.h"
 #include "fs_ext.h"
 #include "keys.h"
+#include "nca_store.h"
 #include "ui.h"
 #include "util.h"
 #include "fatfs/ff.h"
@@ -86,6 +89,7 @@ char **filenameBuffer = NULL;
 int filenameCount = 0, filenameIndex = 0;
 
 u8 *dumpBuf = NULL;
+u64 dumpBufSize = 0;
 u8 *gcReadBuf = NULL;
 u8 *ncaCtrBuf = NULL;
 
@@ -160,6 +164,14 @@ void loadConfig()
     if (dumpCfg.batchDumpCfg.tiklessDump && !dumpCfg.batchDumpCfg.removeConsoleData) dumpCfg.batchDumpCfg.tiklessDump = false;
     
     if (dumpCfg.batchDumpCfg.batchModeSrc >= BATCH_SOURCE_CNT) dumpCfg.batchDumpCfg.batchModeSrc = BATCH_SOURCE_ALL;
+    
+    for(u32 i = 0; i < DUMP_SOURCE_CNT; i++)
+    {
+        if (dumpCfg.chunkSizeCfg.chunkSize[i] && !chunkTunerIsValidSize(dumpCfg.chunkSizeCfg.chunkSize[i], DUMP_BUFFER_MAX_SIZE)) dumpCfg.chunkSizeCfg.chunkSize[i] = 0;
+        
+        batchTimingStats stats = dumpCfg.batchTimingCfg.stats[i];
+        if (!isfinite(stats.weight) || !isfinite(stats.size_sum) || !isfinite(stats.time_sum) || !isfinite(stats.size_sq_sum) || !isfinite(stats.size_time_sum) || stats.weight < 0.0 || stats.size_sum < 0.0 || stats.time_sum < 0.0) memset(&(dumpCfg.batchTimingCfg.stats[i]), 0, sizeof(batchTimingStats));
+    }
 }
 
 void saveConfig()
@@ -453,6 +465,7 @@ static void createOutputDirectories()
     mkdir(ROMFS_DUMP_PATH, 0744);
     mkdir(CERT_DUMP_PATH, 0744);
     mkdir(BATCH_OVERRIDES_PATH, 0744);
+    mkdir(NCA_STORE_PATH, 0744);
     mkdir(TICKET_PATH, 0744);
 }
 
@@ -1004,7 +1017,15 @@ bool initApplicationResources(int argc, char **argv)
     if (!mountSysEmmcPartition()) goto out;
     
     /* Allocate memory for the general purpose dump buffer */
-    dumpBuf = calloc(DUMP_BUFFER_SIZE, sizeof(u8));
+    /* Fall back to the default chunk size if there's not enough memory for the biggest one the chunk size tuner can pick */
+    dumpBufSize = DUMP_BUFFER_MAX_SIZE;
+    dumpBuf = calloc(dumpBufSize, sizeof(u8));
+    if (!dumpBuf)
+    {
+        dumpBufSize = DUMP_BUFFER_SIZE;
+        dumpBuf = calloc(dumpBufSize, sizeof(u8));
+    }
+    
     if (!dumpBuf)
     {
         uiDrawString(STRING_DEFAULT_POS, FONT_COLOR_ERROR_RGB, "%s: failed to allocate memory for the dump buffer!", __func__);
@@ -1092,6 +1113,12 @@ void deinitApplicationResources()
     /* Save current settings to configuration file */
     saveConfig();
     
+    /* Free dump index */
+    dumpIndexFree();
+    
+    /* Free NCA store index */
+    ncaStoreFree();
+    
     if (gcThreadInit)
     {
         /* Signal the exit event to terminate the gamecard detection thread */
@@ -1863,8 +1890,11 @@ out:
     return success;
 }
 
-u64 calculateSizeFromContentRecords(NcmStorageId curStorageId, NcmContentMetaType metaType, u32 ncmTitleCount, u32 ncmTitleIndex)
+// The SHA-256 checksum of all content records is also calculated if 'outContentHash' is provided, so dumped titles can be told apart from reinstalled ones with different contents
+u64 calculateSizeFromContentRecords(NcmStorageId curStorageId, NcmContentMetaType metaType, u32 ncmTitleCount, u32 ncmTitleIndex, u8 *outContentHash)
 {
+    if (outContentHash) memset(outContentHash, 0, SHA256_HASH_SIZE);
+    
     if ((curStorageId != NcmStorageId_GameCard && curStorageId != NcmStorageId_SdCard && curStorageId != NcmStorageId_BuiltInUser) || (metaType != NcmContentMetaType_Application && metaType != NcmContentMetaType_Patch && metaType != NcmContentMetaType_AddOnContent) || ncmTitleIndex >= ncmTitleCount) return 0;
     
     NcmContentInfo *titleContentInfos = NULL;
@@ -1873,6 +1903,8 @@ u64 calculateSizeFromContentRecords(NcmStorageId curStorageId, NcmContentMetaTyp
     
     if (!retrieveContentInfosFromTitle(curStorageId, metaType, ncmTitleCount, ncmTitleIndex, &titleContentInfos, &titleContentInfoCnt)) return 0;
     
+    if (outContentHash) sha256CalculateHash(outContentHash, titleContentInfos, titleContentInfoCnt * sizeof(NcmContentInfo));
+    
     for(i = 0; i < titleContentInfoCnt; i++) 
     {
         if (titleContentInfos[i].content_type >= NcmContentType_DeltaFragment) continue;
@@ -1974,7 +2006,7 @@ void loadTitleInfo()
             
             // Retrieve base application content size
             ncmTitleCount = (baseAppEntries[i].storageId == NcmStorageId_GameCard ? titleAppCount : (baseAppEntries[i].storageId == NcmStorageId_SdCard ? sdCardTitleAppCount : emmcTitleAppCount));
-            baseAppEntries[i].contentSize = calculateSizeFromContentRecords(baseAppEntries[i].storageId, NcmContentMetaType_Application, ncmTitleCount, baseAppEntries[i].ncmIndex);
+            baseAppEntries[i].contentSize = calculateSizeFromContentRecords(baseAppEntries[i].storageId, NcmContentMetaType_Application, ncmTitleCount, baseAppEntries[i].ncmIndex, baseAppEntries[i].contentHash);
             convertSize(baseAppEntries[i].contentSize, baseAppEntries[i].contentSizeStr, MAX_CHARACTERS(baseAppEntries[i].contentSizeStr));
         }
         
@@ -1985,7 +2017,7 @@ void loadTitleInfo()
         {
             // Retrieve patch content size
             ncmTitleCount = (patchEntries[i].storageId == NcmStorageId_GameCard ? titlePatchCount : (patchEntries[i].storageId == NcmStorageId_SdCard ? sdCardTitlePatchCount : emmcTitlePatchCount));
-            patchEntries[i].contentSize = calculateSizeFromContentRecords(patchEntries[i].storageId, NcmContentMetaType_Patch, ncmTitleCount, patchEntries[i].ncmIndex);
+            patchEntries[i].contentSize = calculateSizeFromContentRecords(patchEntries[i].storageId, NcmContentMetaType_Patch, ncmTitleCount, patchEntries[i].ncmIndex, patchEntries[i].contentHash);
             convertSize(patchEntries[i].contentSize, patchEntries[i].contentSizeStr, MAX_CHARACTERS(patchEntries[i].contentSizeStr));
         }
         
@@ -1993,7 +2025,7 @@ void loadTitleInfo()
         {
             // Retrieve add-on content size
             ncmTitleCount = (addOnEntries[i].storageId == NcmStorageId_GameCard ? titleAddOnCount : (addOnEntries[i].storageId == NcmStorageId_SdCard ? sdCardTitleAddOnCount : emmcTitleAddOnCount));
-            addOnEntries[i].contentSize = calculateSizeFromContentRecords(addOnEntries[i].storageId, NcmContentMetaType_AddOnContent, ncmTitleCount, addOnEntries[i].ncmIndex);
+            addOnEntries[i].contentSize = calculateSizeFromContentRecords(addOnEntries[i].storageId, NcmContentMetaType_AddOnContent, ncmTitleCount, addOnEntries[i].ncmIndex, addOnEntries[i].contentHash);
             convertSize(addOnEntries[i].contentSize, addOnEntries[i].contentSizeStr, MAX_CHARACTERS(addOnEntries[i].contentSizeStr));
         }
         
@@ -2252,7 +2284,7 @@ bool calculateRomFsExtractedDirSize(u32 dir_offset, bool usePatch, u64 *out)
     return true;
 }
 
-bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 titleIndex, NcmContentInfo **outContentInfos, u32 *outContentInfoCnt)
+bool retrieveContentInfosFromTitleEx(NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 titleIndex, NcmContentInfo **outContentInfos, u32 *outContentInfoCnt, char *errorStr, size_t errorStrSize)
 {
     Result result;
     
@@ -2275,77 +2307,77 @@ bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType me
     
     if (storageId != NcmStorageId_GameCard && storageId != NcmStorageId_SdCard && storageId != NcmStorageId_BuiltInUser)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid title storage ID!", __func__);
+        snprintf(errorStr, errorStrSize, "%s: invalid title storage ID!", __func__);
         goto out;
     }
     
     if (metaType != NcmContentMetaType_Application && metaType != NcmContentMetaType_Patch && metaType != NcmContentMetaType_AddOnContent)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid title meta type!", __func__);
+        snprintf(errorStr, errorStrSize, "%s: invalid title meta type!", __func__);
         goto out;
     }
     
     if (!titleCount)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid title type count!", __func__);
+        snprintf(errorStr, errorStrSize, "%s: invalid title type count!", __func__);
         goto out;
     }
     
     if (titleIndex >= titleCount)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid title index!", __func__);
+        snprintf(errorStr, errorStrSize, "%s: invalid title index!", __func__);
         goto out;
     }
     
     if (!outContentInfos || !outContentInfoCnt)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: invalid output parameters!", __func__);
+        snprintf(errorStr, errorStrSize, "%s: invalid output parameters!", __func__);
         goto out;
     }
     
     titleList = calloc(1, titleListSize);
     if (!titleList)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: unable to allocate memory for the ApplicationContentMetaKey struct!", __func__);
+        snprintf(errorStr, errorStrSize, "%s: unable to allocate memory for the ApplicationContentMetaKey struct!", __func__);
         goto out;
     }
     
     result = ncmOpenContentMetaDatabase(&ncmDb, storageId);
     if (R_FAILED(result))
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmOpenContentMetaDatabase failed! (0x%08X)", __func__, result);
+        snprintf(errorStr, errorStrSize, "%s: ncmOpenContentMetaDatabase failed! (0x%08X)", __func__, result);
         goto out;
     }
     
     result = ncmContentMetaDatabaseListApplication(&ncmDb, (s32*)&total, (s32*)&written, titleList, (s32)titleCount, metaType);
     if (R_FAILED(result))
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmContentMetaDatabaseListApplication failed! (0x%08X)", __func__, result);
+        snprintf(errorStr, errorStrSize, "%s: ncmContentMetaDatabaseListApplication failed! (0x%08X)", __func__, result);
         goto out;
     }
     
     if (!written || !total)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmContentMetaDatabaseListApplication wrote no entries to output buffer!", __func__);
+        snprintf(errorStr, errorStrSize, "%s: ncmContentMetaDatabaseListApplication wrote no entries to output buffer!", __func__);
         goto out;
     }
     
     if (written != total)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: title count mismatch in ncmContentMetaDatabaseListApplication! (%u != %u)", __func__, written, total);
+        snprintf(errorStr, errorStrSize, "%s: title count mismatch in ncmContentMetaDatabaseListApplication! (%u != %u)", __func__, written, total);
         goto out;
     }
     
     if (titleIndex >= total)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: provided title index exceeds title count from ncmContentMetaDatabaseListApplication!", __func__);
+        snprintf(errorStr, errorStrSize, "%s: provided title index exceeds title count from ncmContentMetaDatabaseListApplication!", __func__);
         goto out;
     }
     
     result = ncmContentMetaDatabaseGet(&ncmDb, &(titleList[titleIndex].key), &cnmtHeaderReadSize, &cnmtHeader, sizeof(NcmContentMetaHeader));
     if (R_FAILED(result))
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmContentMetaDatabaseGet failed! (0x%08X)", __func__, result);
+        snprintf(errorStr, errorStrSize, "%s: ncmContentMetaDatabaseGet failed! (0x%08X)", __func__, result);
         goto out;
     }
     
@@ -2354,7 +2386,7 @@ bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType me
     titleContentInfos = calloc(titleContentInfoCnt, sizeof(NcmContentInfo));
     if (!titleContentInfos)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: unable to allocate memory for the title content information struct!", __func__);
+        snprintf(errorStr, errorStrSize, "%s: unable to allocate memory for the title content information struct!", __func__);
         goto out;
     }
     
@@ -2363,13 +2395,13 @@ bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType me
     result = ncmContentMetaDatabaseListContentInfo(&ncmDb, (s32*)&written, titleContentInfos, (s32)titleContentInfoCnt, &(titleList[titleIndex].key), 0);
     if (R_FAILED(result))
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: ncmContentMetaDatabaseListContentInfo failed! (0x%08X)", __func__, result);
+        snprintf(errorStr, errorStrSize, "%s: ncmContentMetaDatabaseListContentInfo failed! (0x%08X)", __func__, result);
         goto out;
     }
     
     if (written != titleContentInfoCnt)
     {
-        snprintf(strbuf, MAX_CHARACTERS(strbuf), "%s: title content count mismatch in ncmContentMetaDatabaseListContentInfo! (%u != %u)", __func__, written, titleContentInfoCnt);
+        snprintf(errorStr, errorStrSize, "%s: title content count mismatch in ncmContentMetaDatabaseListContentInfo! (%u != %u)", __func__, written, titleContentInfoCnt);
         goto out;
     }
     
@@ -2389,6 +2421,11 @@ out:
     return success;
 }
 
+bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 titleIndex, NcmContentInfo **outContentInfos, u32 *outContentInfoCnt)
+{
+    return retrieveContentInfosFromTitleEx(storageId, metaType, titleCount, titleIndex, outContentInfos, outContentInfoCnt, strbuf, MAX_CHARACTERS(strbuf));
+}
+
 void removeConsoleDataFromTicket(title_rights_ctx *rights_info)
 {
     if (!rights_info || !rights_info->has_rights_id || !rights_info->retrieved_tik || rights_info->missing_tik || rights_info->tik_data.titlekey_type != ETICKET_TITLEKEY_PERSONALIZED) return;
@@ -3212,6 +3249,31 @@ out:
     return true;
 }
 
+bool getRomFsBrowserEntryPath(u32 entryIndex, bool usePatch, char *out, size_t outSize)
+{
+    // The first entry is always the parent directory entry ("..")
+    if (!romFsBrowserEntries || !entryIndex || (int)entryIndex >= filenameCount || !out || !outSize) return false;
+    
+    u32 nameLen;
+    char *name = NULL;
+    
+    if (romFsBrowserEntries[entryIndex].type == ROMFS_ENTRY_DIR)
+    {
+        romfs_dir *entry = (!usePatch ? (romfs_dir*)((u8*)romFsContext.romfs_dir_entries + romFsBrowserEntries[entryIndex].offset) : (romfs_dir*)((u8*)bktrContext.romfs_dir_entries + romFsBrowserEntries[entryIndex].offset));
+        nameLen = entry->nameLen;
+        name = (char*)entry->name;
+    } else {
+        romfs_file *entry = (!usePatch ? (romfs_file*)((u8*)romFsContext.romfs_file_entries + romFsBrowserEntries[entryIndex].offset) : (romfs_file*)((u8*)bktrContext.romfs_file_entries + romFsBrowserEntries[entryIndex].offset));
+        nameLen = entry->nameLen;
+        name = (char*)entry->name;
+    }
+    
+    // Browser entry names are truncated, so the full name is retrieved from the RomFS tables
+    int ret = snprintf(out, outSize, "%s/%.*s", (strlen(curRomFsPath) > 1 ? curRomFsPath : ""), (int)nameLen, name);
+    
+    return (ret > 0 && (size_t)ret < outSize);
+}
+
 char *generateGameCardDumpName(bool useBrackets)
 {
     if (menuType != MENUTYPE_GAMECARD || !titleAppCount || !baseAppEntries) return NULL;
@@ -3869,6 +3931,24 @@ bool checkIfDumpedXciContainsCertificate(const char *xciPath)
     return false;
 }
 
+bool checkIfTicketContainsConsoleData(const rsa2048_sha256_ticket *tikData)
+{
+    if (!tikData) return false;
+    
+    const u8 titlekey_block_0x190_empty_hash[0x20] = {
+        0x2D, 0xFB, 0xA6, 0x33, 0x81, 0x70, 0x46, 0xC7, 0xF5, 0x59, 0xED, 0x4B, 0x93, 0x07, 0x60, 0x48,
+        0x43, 0x5F, 0x7E, 0x1A, 0x90, 0xF1, 0x4E, 0xB8, 0x03, 0x5C, 0x04, 0xB9, 0xEB, 0xAE, 0x25, 0x37
+    };
+    
+    u8 titlekey_block_0x190_hash[0x20];
+    
+    sha256CalculateHash(titlekey_block_0x190_hash, tikData->titlekey_block + 0x10, 0xF0);
+    
+    if (strncmp(tikData->sig_issuer, "Root-CA00000003-XS00000020", 26) != 0 || memcmp(titlekey_block_0x190_hash, titlekey_block_0x190_empty_hash, 0x20) != 0 || tikData->titlekey_type != ETICKET_TITLEKEY_COMMON || tikData->ticket_id != 0 || tikData->device_id != 0 || tikData->account_id != 0) return true;
+    
+    return false;
+}
+
 bool checkIfDumpedNspContainsConsoleData(const char *nspPath)
 {
     if (!nspPath || !strlen(nspPath)) return false;
@@ -3886,13 +3966,6 @@ bool checkIfDumpedNspContainsConsoleData(const char *nspPath)
     u64 tikOffset = 0, tikSize = 0;
     rsa2048_sha256_ticket tikData;
     
-    const u8 titlekey_block_0x190_empty_hash[0x20] = {
-        0x2D, 0xFB, 0xA6, 0x33, 0x81, 0x70, 0x46, 0xC7, 0xF5, 0x59, 0xED, 0x4B, 0x93, 0x07, 0x60, 0x48,
-        0x43, 0x5F, 0x7E, 0x1A, 0x90, 0xF1, 0x4E, 0xB8, 0x03, 0x5C, 0x04, 0xB9, 0xEB, 0xAE, 0x25, 0x37
-    };
-    
-    u8 titlekey_block_0x190_hash[0x20];
-    
     nspFile = fopen(nspPath, "rb");
     if (!nspFile) return false;
     
@@ -3978,11 +4051,7 @@ bool checkIfDumpedNspContainsConsoleData(const char *nspPath)
     
     if (read_bytes != ETICKET_TIK_FILE_SIZE) return false;
     
-    sha256CalculateHash(titlekey_block_0x190_hash, tikData.titlekey_block + 0x10, 0xF0);
-    
-    if (strncmp(tikData.sig_issuer, "Root-CA00000003-XS00000020", 26) != 0 || memcmp(titlekey_block_0x190_hash, titlekey_block_0x190_empty_hash, 0x20) != 0 || tikData.titlekey_type != ETICKET_TITLEKEY_COMMON || tikData.ticket_id != 0 || tikData.device_id != 0 || tikData.account_id != 0) return true;
-    
-    return false;
+    return checkIfTicketContainsConsoleData(&tikData);
 }
 
 void removeDirectoryWithVerbose(const char *path, const char *msg)
@@ -15,12 +15,16 @@
 #define ROMFS_DUMP_PATH                 APP_BASE_PATH "RomFS/"
 #define CERT_DUMP_PATH                  APP_BASE_PATH "Certificate/"
 #define BATCH_OVERRIDES_PATH            NSP_DUMP_PATH "BatchOverrides/"
+#define NCA_STORE_PATH                  NSP_DUMP_PATH "NCAStore/"
+#define NCA_STORE_INDEX_PATH            NCA_STORE_PATH "store_index.bin"
 #define TICKET_PATH                     APP_BASE_PATH "Ticket/"
 
 #define CONFIG_PATH                     APP_BASE_PATH "config.bin"
 #define NRO_NAME                        APP_TITLE ".nro"
 #define NRO_PATH                        APP_BASE_PATH NRO_NAME
 #define NSWDB_XML_PATH                  APP_BASE_PATH "NSWreleases.xml"
+#define ROMFS_FILTER_PATH               APP_BASE_PATH "romfs_filter.txt"
+#define DUMP_INDEX_PATH                 APP_BASE_PATH "dump_index.bin"
 #define KEYS_FILE_PATH                  HBLOADER_BASE_PATH "prod.keys"
 
 #define CFW_PATH_ATMOSPHERE             "sdmc:/atmosphere/contents/"
@@ -53,13 +57,12 @@
 #define NAME_BUF_LEN                    2048
 
 #define DUMP_BUFFER_SIZE                (u64)0x400000		                    // 4 MiB (4194304 bytes)
+#define DUMP_BUFFER_MAX_SIZE            (u64)0x1000000                          // 16 MiB (16777216 bytes). The dump buffer is allocated with this size if possible, so tuned chunk sizes can go past DUMP_BUFFER_SIZE
 
 #define GAMECARD_READ_BUFFER_SIZE       DUMP_BUFFER_SIZE                        // 4 MiB (4194304 bytes)
 
 #define NCA_CTR_BUFFER_SIZE             DUMP_BUFFER_SIZE                        // 4 MiB (4194304 bytes)
 
-#define NSP_XML_BUFFER_SIZE             (u64)0xA00000                           // 10 MiB (10485760 bytes)
-
 #define APPLICATION_PATCH_BITMASK       (u64)0x800
 #define APPLICATION_ADDON_BITMASK       (u64)0xFFFFFFFFFFFF0000
 
@@ -191,6 +194,7 @@ typedef struct {
     u8 *icon;
     u64 contentSize;
     char contentSizeStr[32];
+    u8 contentHash[SHA256_HASH_SIZE];              // SHA-256 checksum of the content records. Used as the content set key in the dump index
 } base_app_ctx_t;
 
 typedef struct {
@@ -201,6 +205,7 @@ typedef struct {
     char versionStr[VERSION_STR_LEN];
     u64 contentSize;
     char contentSizeStr[32];
+    u8 contentHash[SHA256_HASH_SIZE];              // SHA-256 checksum of the content records. Used as the content set key in the dump index
 } patch_addon_ctx_t;
 
 typedef struct {
@@ -267,6 +272,7 @@ typedef struct {
     bool calcCrc;
     bool useNoIntroLookup;
     bool useBrackets;
+    bool verifyOutput;
 } PACKED xciOptions;
 
 typedef struct {
@@ -277,6 +283,9 @@ typedef struct {
     bool npdmAcidRsaPatch;
     bool dumpDeltaFragments;
     bool useBrackets;
+    bool verifyExeFsHashes;
+    bool verifyOutput;
+    bool useNcaStore;
 } PACKED nspOptions;
 
 typedef enum {
@@ -300,6 +309,7 @@ typedef struct {
     bool haltOnErrors;
     bool useBrackets;
     batchModeSourceStorage batchModeSrc;
+    bool useNcaStore;
 } PACKED batchOptions;
 
 typedef struct {
@@ -309,8 +319,34 @@ typedef struct {
 typedef struct {
     bool isFat32;
     bool useLayeredFSDir;
+    bool useTarArchive;
+    bool verifyHashes;
+    bool exportNsoImages;           // ExeFS only
 } PACKED ncaFsOptions;
 
+typedef enum {
+    DUMP_SOURCE_GAMECARD = 0,
+    DUMP_SOURCE_SDCARD,
+    DUMP_SOURCE_EMMC,
+    DUMP_SOURCE_CNT
+} dumpSourceType;
+
+typedef struct {
+    u64 chunkSize[DUMP_SOURCE_CNT];                 // Picked by the chunk size tuner. 0 if the source hasn't been measured yet
+} PACKED chunkSizeOptions;
+
+typedef struct {
+    double weight;                                  // Sum of the sample weights. Older samples lose weight every time a new title is measured
+    double size_sum;                                // Weighted sums used to fit "time = setup + (size * time per byte)"
+    double time_sum;
+    double size_sq_sum;
+    double size_time_sum;
+} PACKED batchTimingStats;
+
+typedef struct {
+    batchTimingStats stats[DUMP_SOURCE_CNT];        // Measured by batch mode. Zeroed if the source hasn't been measured yet
+} PACKED batchTimingOptions;
+
 typedef struct {
     xciOptions xciDumpCfg;
     nspOptions nspDumpCfg;
@@ -318,6 +354,8 @@ typedef struct {
     ticketOptions tikDumpCfg;
     ncaFsOptions exeFsDumpCfg;
     ncaFsOptions romFsDumpCfg;
+    chunkSizeOptions chunkSizeCfg;
+    batchTimingOptions batchTimingCfg;
 } PACKED dumpOptions;
 
 void loadConfig();
@@ -382,6 +420,10 @@ bool calculateRomFsFullExtractedSize(bool usePatch, u64 *out);
 
 bool calculateRomFsExtractedDirSize(u32 dir_offset, bool usePatch, u64 *out);
 
+// Same as retrieveContentInfosFromTitle(), but error messages are written to the provided buffer instead of the global string buffer
+// Safe to use from threads other than the UI thread
+bool retrieveContentInfosFromTitleEx(NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 titleIndex, NcmContentInfo **outContentInfos, u32 *outContentInfoCnt, char *errorStr, size_t errorStrSize);
+
 bool retrieveContentInfosFromTitle(NcmStorageId storageId, NcmContentMetaType metaType, u32 titleCount, u32 titleIndex, NcmContentInfo **outContentInfos, u32 *outContentInfoCnt);
 
 void removeConsoleDataFromTicket(title_rights_ctx *rights_info);
@@ -394,6 +436,8 @@ bool getExeFsFileList();
 
 bool getRomFsFileList(u32 dir_offset, bool usePatch);
 
+bool getRomFsBrowserEntryPath(u32 entryIndex, bool usePatch, char *out, size_t outSize);
+
 char *generateGameCardDumpName(bool useBrackets);
 
 char *generateNSPDumpName(nspDumpType selectedNspDumpType, u32 titleIndex, bool useBrackets);
@@ -432,6 +476,8 @@ bool yesNoPrompt(const char *message);
 
 bool checkIfDumpedXciContainsCertificate(const char *xciPath);
 
+bool checkIfTicketContainsConsoleData(const rsa2048_sha256_ticket *tikData);
+
 bool checkIfDumpedNspContainsConsoleData(const char *nspPath);
 
 void removeDirectoryWithVerbose(const char *path, const char *msg);
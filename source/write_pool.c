@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "write_pool.h"
+
+static bool writePoolWriteJob(write_pool_ctx_t *pool, write_pool_job_t *job, char *errorMsg, size_t errorMsgSize)
+{
+    FILE *outFile = NULL;
+    size_t write_res;
+    
+    outFile = fopen(job->path, "wb");
+    if (!outFile)
+    {
+        // Used to overcome issues related to the max entry count per directory in FAT32
+        // Same naming scheme used by recursiveDumpRomFsFile()
+        int i, start, jobIdx = -1, sharedIdx;
+        char fallbackPath[NAME_BUF_LEN * 2] = {'\0'};
+        
+        // Resume from the fallback directory the caller already picked for this file, unless another file has moved on to a newer one in the meantime
+        if (job->path[job->dir_len] == '_') jobIdx = (int)strtol(job->path + job->dir_len + 1, NULL, 10);
+        
+        sharedIdx = writePoolGetDirFallback(pool, job->path, job->dir_len);
+        start = (sharedIdx > jobIdx ? sharedIdx : (jobIdx + 1));
+        
+        for(i = start; i < (start + WRITE_POOL_DIR_LIMIT_RETRIES); i++)
+        {
+            snprintf(fallbackPath, MAX_CHARACTERS(fallbackPath), "%.*s_%d", (int)job->dir_len, job->path, i);
+            mkdir(fallbackPath, 0744);
+            
+            if ((strlen(fallbackPath) + 1 + strlen(job->path + job->name_offset)) >= MAX_ELEMENTS(fallbackPath)) break;
+            
+            strcat(fallbackPath, "/");
+            strcat(fallbackPath, job->path + job->name_offset);
+            
+            outFile = fopen(fallbackPath, "wb");
+            if (outFile)
+            {
+                writePoolSetDirFallback(pool, job->path, job->dir_len, i);
+                strcpy(job->path, fallbackPath);
+                break;
+            }
+        }
+        
+        if (!outFile)
+        {
+            snprintf(errorMsg, errorMsgSize, "failed to open output file \"%s\"!", job->path);
+            return false;
+        }
+    }
+    
+    if (job->size)
+    {
+        write_res = fwrite(job->data, 1, job->size, outFile);
+        if (write_res != job->size)
+        {
+            snprintf(errorMsg, errorMsgSize, "failed to write %lu bytes to \"%s\"! (wrote %lu bytes)", job->size, job->path, write_res);
+            fclose(outFile);
+            return false;
+        }
+    }
+    
+    if (fclose(outFile) != 0)
+    {
+        snprintf(errorMsg, errorMsgSize, "failed to close output file \"%s\"!", job->path);
+        return false;
+    }
+    
+    return true;
+}
+
+static void *writePoolThreadFunc(void *arg)
+{
+    write_pool_ctx_t *pool = (write_pool_ctx_t*)arg;
+    write_pool_job_t *job = NULL;
+    
+    char errorMsg[MAX_ELEMENTS(pool->errorMsg)];
+    bool success;
+    
+    pthread_mutex_lock(&(pool->mutex));
+    
+    while(true)
+    {
+        while(!pool->queue_cnt && !pool->closing) pthread_cond_wait(&(pool->job_cond), &(pool->mutex));
+        
+        if (!pool->queue_cnt) break;
+        
+        job = pool->queue[pool->queue_start];
+        pool->queue_start = ((pool->queue_start + 1) % WRITE_POOL_SLOT_CNT);
+        pool->queue_cnt--;
+        pool->busy_cnt++;
+        
+        // Skip any pending jobs if something already went wrong
+        success = false;
+        
+        if (!pool->error)
+        {
+            pthread_mutex_unlock(&(pool->mutex));
+            success = writePoolWriteJob(pool, job, errorMsg, MAX_ELEMENTS(errorMsg));
+            pthread_mutex_lock(&(pool->mutex));
+            
+            if (!success && !pool->error)
+            {
+                pool->error = true;
+                snprintf(pool->errorMsg, MAX_CHARACTERS(pool->errorMsg), "%s", errorMsg);
+            }
+        }
+        
+        pool->free_jobs[pool->free_cnt++] = job;
+        pool->busy_cnt--;
+        
+        pthread_cond_broadcast(&(pool->idle_cond));
+    }
+    
+    pthread_mutex_unlock(&(pool->mutex));
+    
+    return NULL;
+}
+
+bool writePoolInit(write_pool_ctx_t *pool)
+{
+    if (!pool) return false;
+    
+    u32 i;
+    
+    memset(pool, 0, sizeof(write_pool_ctx_t));
+    
+    pool->dir_fallback_idx = -1;
+    
+    for(i = 0; i < WRITE_POOL_SLOT_CNT; i++)
+    {
+        pool->jobs[i].path = calloc(NAME_BUF_LEN * 2, sizeof(char));
+        pool->jobs[i].data = malloc(WRITE_POOL_SLOT_SIZE);
+        if (!pool->jobs[i].path || !pool->jobs[i].data) goto out;
+        
+        pool->free_jobs[pool->free_cnt++] = &(pool->jobs[i]);
+    }
+    
+    if (pthread_mutex_init(&(pool->mutex), NULL) != 0) goto out;
+    
+    if (pthread_cond_init(&(pool->job_cond), NULL) != 0)
+    {
+        pthread_mutex_destroy(&(pool->mutex));
+        goto out;
+    }
+    
+    if (pthread_cond_init(&(pool->idle_cond), NULL) != 0)
+    {
+        pthread_cond_destroy(&(pool->job_cond));
+        pthread_mutex_destroy(&(pool->mutex));
+        goto out;
+    }
+    
+    pool->initialized = true;
+    
+    for(i = 0; i < WRITE_POOL_THREAD_CNT; i++)
+    {
+        if (pthread_create(&(pool->threads[i]), NULL, &writePoolThreadFunc, pool) != 0) break;
+        pool->thread_cnt++;
+    }
+    
+    if (!pool->thread_cnt)
+    {
+        writePoolClose(pool);
+        return false;
+    }
+    
+    return true;
+    
+out:
+    for(i = 0; i < WRITE_POOL_SLOT_CNT; i++)
+    {
+        if (pool->jobs[i].path) free(pool->jobs[i].path);
+        if (pool->jobs[i].data) free(pool->jobs[i].data);
+    }
+    
+    memset(pool, 0, sizeof(write_pool_ctx_t));
+    
+    return false;
+}
+
+void writePoolClose(write_pool_ctx_t *pool)
+{
+    if (!pool || !pool->initialized) return;
+    
+    u32 i;
+    
+    pthread_mutex_lock(&(pool->mutex));
+    pool->closing = true;
+    pthread_cond_broadcast(&(pool->job_cond));
+    pthread_mutex_unlock(&(pool->mutex));
+    
+    for(i = 0; i < pool->thread_cnt; i++) pthread_join(pool->threads[i], NULL);
+    
+    pthread_cond_destroy(&(pool->idle_cond));
+    pthread_cond_destroy(&(pool->job_cond));
+    pthread_mutex_destroy(&(pool->mutex));
+    
+    for(i = 0; i < WRITE_POOL_SLOT_CNT; i++)
+    {
+        if (pool->jobs[i].path) free(pool->jobs[i].path);
+        if (pool->jobs[i].data) free(pool->jobs[i].data);
+    }
+    
+    memset(pool, 0, sizeof(write_pool_ctx_t));
+}
+
+write_pool_job_t *writePoolAcquireJob(write_pool_ctx_t *pool)
+{
+    if (!pool || !pool->initialized) return NULL;
+    
+    write_pool_job_t *job = NULL;
+    
+    pthread_mutex_lock(&(pool->mutex));
+    
+    while(!pool->free_cnt && !pool->error) pthread_cond_wait(&(pool->idle_cond), &(pool->mutex));
+    
+    if (!pool->error)
+    {
+        job = pool->free_jobs[--pool->free_cnt];
+        job->path[0] = '\0';
+        job->dir_len = job->name_offset = 0;
+        job->size = 0;
+    }
+    
+    pthread_mutex_unlock(&(pool->mutex));
+    
+    return job;
+}
+
+void writePoolSubmitJob(write_pool_ctx_t *pool, write_pool_job_t *job)
+{
+    if (!pool || !pool->initialized || !job) return;
+    
+    pthread_mutex_lock(&(pool->mutex));
+    
+    pool->queue[(pool->queue_start + pool->queue_cnt) % WRITE_POOL_SLOT_CNT] = job;
+    pool->queue_cnt++;
+    
+    pthread_cond_signal(&(pool->job_cond));
+    
+    pthread_mutex_unlock(&(pool->mutex));
+}
+
+void writePoolReleaseJob(write_pool_ctx_t *pool, write_pool_job_t *job)
+{
+    if (!pool || !pool->initialized || !job) return;
+    
+    pthread_mutex_lock(&(pool->mutex));
+    
+    pool->free_jobs[pool->free_cnt++] = job;
+    pthread_cond_broadcast(&(pool->idle_cond));
+    
+    pthread_mutex_unlock(&(pool->mutex));
+}
+
+bool writePoolWait(write_pool_ctx_t *pool)
+{
+    if (!pool || !pool->initialized) return true;
+    
+    bool success;
+    
+    pthread_mutex_lock(&(pool->mutex));
+    
+    while(pool->queue_cnt || pool->busy_cnt) pthread_cond_wait(&(pool->idle_cond), &(pool->mutex));
+    
+    success = !pool->error;
+    
+    pthread_mutex_unlock(&(pool->mutex));
+    
+    return success;
+}
+
+int writePoolGetDirFallback(write_pool_ctx_t *pool, const char *dirPath, size_t dirLen)
+{
+    if (!pool || !pool->initialized || !dirPath || !dirLen) return -1;
+    
+    int index = -1;
+    
+    pthread_mutex_lock(&(pool->mutex));
+    
+    if (strlen(pool->dir_fallback_path) == dirLen && !strncmp(pool->dir_fallback_path, dirPath, dirLen)) index = pool->dir_fallback_idx;
+    
+    pthread_mutex_unlock(&(pool->mutex));
+    
+    return index;
+}
+
+void writePoolSetDirFallback(write_pool_ctx_t *pool, const char *dirPath, size_t dirLen, int index)
+{
+    if (!pool || !pool->initialized || !dirPath || !dirLen || dirLen >= MAX_ELEMENTS(pool->dir_fallback_path)) return;
+    
+    pthread_mutex_lock(&(pool->mutex));
+    
+    if (strlen(pool->dir_fallback_path) == dirLen && !strncmp(pool->dir_fallback_path, dirPath, dirLen))
+    {
+        if (index > pool->dir_fallback_idx) pool->dir_fallback_idx = index;
+    } else {
+        snprintf(pool->dir_fallback_path, MAX_ELEMENTS(pool->dir_fallback_path), "%.*s", (int)dirLen, dirPath);
+        pool->dir_fallback_idx = index;
+    }
+    
+    pthread_mutex_unlock(&(pool->mutex));
+}
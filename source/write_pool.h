@@ -0,0 +1,70 @@
+#pragma once
+
+#ifndef __WRITE_POOL_H__
+#define __WRITE_POOL_H__
+
+#include <switch.h>
+#include <pthread.h>
+#include "util.h"
+
+#define WRITE_POOL_THREAD_CNT           2
+#define WRITE_POOL_SLOT_CNT             8
+#define WRITE_POOL_SLOT_SIZE            (u64)0x80000                // 512 KiB (524288 bytes). Files bigger than this are written by the caller itself
+
+#define WRITE_POOL_DIR_LIMIT_RETRIES    16                          // Max number of "_%d" fallback directories to try if a file can't be created because of the FAT32 max entry count per directory
+
+typedef struct {
+    char *path;                                     // Full output path
+    size_t dir_len;                                 // Length of the parent directory within 'path', without any "_%d" suffix
+    size_t name_offset;                             // Offset of the filename within 'path'
+    u8 *data;                                       // File data (WRITE_POOL_SLOT_SIZE bytes)
+    u64 size;                                       // File size
+} write_pool_job_t;
+
+typedef struct {
+    bool initialized;
+    u32 thread_cnt;
+    pthread_t threads[WRITE_POOL_THREAD_CNT];
+    pthread_mutex_t mutex;
+    pthread_cond_t job_cond;                        // Signaled when a job has been queued or when the pool is being closed
+    pthread_cond_t idle_cond;                       // Signaled when a job has been completed
+    write_pool_job_t jobs[WRITE_POOL_SLOT_CNT];
+    write_pool_job_t *free_jobs[WRITE_POOL_SLOT_CNT];
+    u32 free_cnt;
+    write_pool_job_t *queue[WRITE_POOL_SLOT_CNT];
+    u32 queue_start;
+    u32 queue_cnt;
+    u32 busy_cnt;                                   // Jobs currently being written
+    bool closing;
+    bool error;
+    char dir_fallback_path[NAME_BUF_LEN * 2];       // Output directory (without any "_%d" suffix) 'dir_fallback_idx' belongs to
+    int dir_fallback_idx;                           // Last "_%d" fallback directory used for 'dir_fallback_path'. -1 if files are still written to the directory itself
+    char errorMsg[NAME_BUF_LEN * 2 + 128];
+} write_pool_ctx_t;
+
+// Allocates the job buffers and starts the writer threads. Returns false if the pool couldn't be started, in which case the caller should write files by itself
+bool writePoolInit(write_pool_ctx_t *pool);
+
+// Waits for all queued jobs to be written, stops the writer threads and frees all job buffers
+void writePoolClose(write_pool_ctx_t *pool);
+
+// Returns a free job, waiting for one to become available if needed. Returns NULL if a previous job failed
+write_pool_job_t *writePoolAcquireJob(write_pool_ctx_t *pool);
+
+// Hands a filled job over to the writer threads
+void writePoolSubmitJob(write_pool_ctx_t *pool, write_pool_job_t *job);
+
+// Returns an acquired job to the pool without writing it
+void writePoolReleaseJob(write_pool_ctx_t *pool, write_pool_job_t *job);
+
+// Waits until all queued jobs have been written. Returns false if any of them failed
+bool writePoolWait(write_pool_ctx_t *pool);
+
+// Returns the "_%d" fallback directory index currently used for the output directory made of the first 'dirLen' characters from 'dirPath', or -1 if there's none
+// Shared by the writer threads and the caller, so files from a directory that has hit the FAT32 max entry count don't keep probing the full directories
+int writePoolGetDirFallback(write_pool_ctx_t *pool, const char *dirPath, size_t dirLen);
+
+// Records the "_%d" fallback directory index a file has been successfully created in. The shared index is only ever advanced for the same output directory
+void writePoolSetDirFallback(write_pool_ctx_t *pool, const char *dirPath, size_t dirLen, int index);
+
+#endif
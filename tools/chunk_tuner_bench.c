@@ -0,0 +1,137 @@
+// Host benchmark for the dump chunk size tuner, using regular files as stand-ins for the dump source and destination
+// Build from the repository root: cc -O2 -Isource -o chunk_tuner_bench tools/chunk_tuner_bench.c source/chunk_tuner.c
+// Usage: chunk_tuner_bench <input file> <output file> [max chunk size in MiB]
+// The input file is read in a loop if it's smaller than the data needed to measure every candidate. Output data is written sequentially, like a dump
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chunk_tuner.h"
+
+#define BENCH_DEFAULT_MAX_CHUNK_MIB     16
+
+static u64 benchGetTimeNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (((u64)ts.tv_sec * 1000000000ULL) + (u64)ts.tv_nsec);
+}
+
+// Reads 'size' bytes from the input file, going back to its start if needed
+static bool benchReadChunk(FILE *inFile, u8 *buf, u64 size)
+{
+    size_t read_res;
+    u64 total = 0;
+    bool rewound = false;
+    
+    while(total < size)
+    {
+        read_res = fread(buf + total, 1, size - total, inFile);
+        total += read_res;
+        
+        if (total < size)
+        {
+            // Empty input file
+            if (ferror(inFile) || (!read_res && rewound)) return false;
+            
+            rewind(inFile);
+            rewound = !read_res;
+        }
+    }
+    
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <input file> <output file> [max chunk size in MiB]\n", argv[0]);
+        return 1;
+    }
+    
+    u32 i;
+    u64 maxSize = ((u64)(argc > 3 ? strtoul(argv[3], NULL, 10) : BENCH_DEFAULT_MAX_CHUNK_MIB) << 20);
+    u64 chunk, startNs, elapsedNs, totalSize = 0;
+    chunk_tuner_ctx_t tuner;
+    FILE *inFile = NULL, *outFile = NULL;
+    u8 *buf = NULL;
+    int ret = 1;
+    
+    inFile = fopen(argv[1], "rb");
+    if (!inFile)
+    {
+        fprintf(stderr, "Failed to open input file \"%s\"!\n", argv[1]);
+        goto out;
+    }
+    
+    outFile = fopen(argv[2], "wb");
+    if (!outFile)
+    {
+        fprintf(stderr, "Failed to open output file \"%s\"!\n", argv[2]);
+        goto out;
+    }
+    
+    // Same as the dump loops: the whole chunk goes straight to the file
+    setvbuf(inFile, NULL, _IONBF, 0);
+    setvbuf(outFile, NULL, _IONBF, 0);
+    
+    buf = malloc(maxSize);
+    if (!buf)
+    {
+        fprintf(stderr, "Failed to allocate %llu bytes for the chunk buffer!\n", (unsigned long long)maxSize);
+        goto out;
+    }
+    
+    chunkTunerInit(&tuner, 0, maxSize);
+    
+    if (!tuner.tuning)
+    {
+        fprintf(stderr, "Nothing to measure: the max chunk size must be at least twice as big as the min chunk size (%llu bytes)!\n", (unsigned long long)CHUNK_TUNER_MIN_SIZE);
+        goto out;
+    }
+    
+    while(true)
+    {
+        chunk = chunkTunerGetChunkSize(&tuner);
+        
+        startNs = benchGetTimeNs();
+        
+        if (!benchReadChunk(inFile, buf, chunk))
+        {
+            fprintf(stderr, "Failed to read %llu bytes chunk from the input file!\n", (unsigned long long)chunk);
+            goto out;
+        }
+        
+        if (fwrite(buf, 1, chunk, outFile) != chunk)
+        {
+            fprintf(stderr, "Failed to write %llu bytes chunk to the output file!\n", (unsigned long long)chunk);
+            goto out;
+        }
+        
+        elapsedNs = (benchGetTimeNs() - startNs);
+        totalSize += chunk;
+        
+        if (chunkTunerUpdate(&tuner, chunk, elapsedNs)) break;
+    }
+    
+    for(i = 0; i < tuner.candidate_cnt; i++)
+    {
+        printf("%4llu MiB chunks: %8.2f MiB/s\n", (unsigned long long)(tuner.candidates[i] >> 20), (tuner.measured_ns[i] ? (((double)tuner.measured_size[i] / (double)(1 << 20)) / ((double)tuner.measured_ns[i] / 1000000000.0)) : 0.0));
+    }
+    
+    printf("Picked chunk size: %llu MiB (%llu MiB processed).\n", (unsigned long long)(chunkTunerGetChunkSize(&tuner) >> 20), (unsigned long long)(totalSize >> 20));
+    
+    ret = 0;
+    
+out:
+    if (buf) free(buf);
+    
+    if (outFile) fclose(outFile);
+    
+    if (inFile) fclose(inFile);
+    
+    return ret;
+}